@@ -1,6 +1,6 @@
 #pragma once
 
-#include <windows.h>
+#include <stdint.h>
 #include <string>
 #include <iostream>
 
@@ -11,8 +11,8 @@ class Chrono
 
 		void start();		
 		unsigned int getTimeElapsed(); //in ms
+		double getPreciseTimeElapsed(); //in ms, sub-millisecond resolution
 
 	private:
-		__int64 mFreq;
-		__int64 mStart;
+		uint64_t mStart; //ns, TimeService::now
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Ogre.h>
+#include <vector>
+
+/*
+	Depth-only occluder built from the Kinect depth map.
+
+	The depth map is sampled on a regular grid and back-projected in camera space, each grid cell
+	becomes two triangles rendered with colour writes disabled, right after the video background
+	and before the virtual objects. Real objects standing in front of the virtual content then win
+	the depth test and hide it.
+
+	Only the grid rows whose depth changed are recomputed and re-uploaded each frame.
+
+	The mesh is unprojected with the depth map intrinsics, the camera rendering it (and the video
+	behind it) must project with the same ones or the occluder slides off the real objects.
+
+	//Example
+	DepthOcclusion occlusion;
+	DepthOcclusion::setupCamera(camera, 640, 480);
+	occlusion.init(sceneMgr, cameraNode, 640, 480);
+	occlusion.update(depthBox); //on app loop, PF_L16 depth in mm registered to the color frame
+*/
+class DepthOcclusion
+{
+	public:
+		DepthOcclusion();
+		virtual ~DepthOcclusion();
+
+		void init(Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, int depthWidth, int depthHeight);
+		void shutdown();
+
+		bool update(const Ogre::PixelBox& depthFrame); //return true if the occluder mesh changed
+
+		void setVisible(bool visible);
+		bool isVisible() const;
+
+		//CPU side of the pipeline, usable without any render system
+		void resize(int depthWidth, int depthHeight, int gridStep = DepthOcclusion::gridStep);
+		bool updateGrid(const unsigned short* depth, size_t rowPitch);
+		int getGridStep() const;                  //may be larger than asked for, to keep 16 bits indices
+		int getGridWidth() const;
+		int getGridHeight() const;
+		const float* getVertices() const;         //xyz per grid point, camera space (Ogre convention)
+		const Ogre::uint16* getIndices() const;   //6 per cell, degenerate when the cell is not an occluder
+		bool isCellOccluder(int cellX, int cellY) const;
+		int getDirtyRowBegin() const;
+		int getDirtyRowEnd() const;
+
+		//pinhole projection of the intrinsics for a width x height image, Ogre frustum parameters
+		static void getProjection(int width, int height, Ogre::Radian& fovY, Ogre::Real& aspectRatio, Ogre::Vector2& frustumOffset);
+		static void setupCamera(Ogre::Camera* camera, int width, int height);
+
+		static int gridStep;             //depth pixels between two grid points, default of resize()
+		static float fx, fy, cx, cy;     //intrinsics of the (registered) depth map
+		static float minDepth;           //mm
+		static float maxDepth;           //mm
+		static float depthTolerance;     //mm, smaller changes do not dirty the grid
+		static float maxJumpRatio;       //cells spanning a larger relative depth jump are dropped
+		static Ogre::uint8 renderQueue;
+
+	protected:
+		void createMesh();
+		void uploadDirtyRows();
+		void updateCellRow(int cellY);
+
+		Ogre::SceneManager* mSceneMgr;
+		Ogre::SceneNode*    mNode;
+		Ogre::Entity*       mEntity;
+		Ogre::MeshPtr       mMesh;
+		Ogre::HardwareVertexBufferSharedPtr mVertexBuffer;
+		Ogre::HardwareIndexBufferSharedPtr  mIndexBuffer;
+
+		int mDepthWidth;
+		int mDepthHeight;
+		int mGridWidth;
+		int mGridHeight;
+		int mGridStep;
+		bool mFirstFrame;
+
+		std::vector<float> mRayX;        //(u - cx) / fx per grid column
+		std::vector<float> mRayY;        //(v - cy) / fy per grid row
+		std::vector<float> mGridDepth;   //last depth accepted per grid point, 0 = hole
+		std::vector<float> mRowDepth;    //scratch row
+		std::vector<float> mVertices;
+		std::vector<Ogre::uint16> mIndices;
+		std::vector<unsigned char> mRowDirty;
+
+		int mDirtyRowBegin;
+		int mDirtyRowEnd;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+//Least squares plane Z = a*X + b*Y + c fitted on the depth samples lying inside the detected markers
+struct DepthPlane
+{
+	DepthPlane();
+
+	bool valid;
+	int samples;
+	float a, b, c;
+	float rmsError; //in depth units (mm)
+};
+
+/*
+	Collects the back-projected depth samples of the marker quads and fits a DepthPlane on them.
+
+	The moments are accumulated in double around the mean of the samples: raw moments of points
+	a few meters away are dominated by their mean and lose the few millimeters the fit is about.
+
+	//Example
+	DepthPlaneFitter fitter;
+	fitter.setIntrinsics(fx, fy, cx, cy);
+	fitter.clear();
+	fitter.addRow(depth + v*rowPitch, v, x0, x1, 1); //for every scanline of the quads
+	DepthPlane plane;
+	fitter.fit(plane, 64, 15.0f);
+*/
+class DepthPlaneFitter
+{
+	public:
+		DepthPlaneFitter();
+
+		void setIntrinsics(float fx, float fy, float cx, float cy);
+		void clear();
+
+		void addSample(float x, float y, float z);  //camera space, mm
+		void addRow(const unsigned short* row, int v, int x0, int x1, int step); //depth pixels [x0, x1] of row v, holes (0) are skipped
+		int getSampleCount() const;
+
+		//return plane.valid, false when there are too few samples, they are (nearly) collinear or the residual is too large
+		bool fit(DepthPlane& plane, int minSamples, float maxRmsError) const;
+
+	protected:
+		float mInvFx, mInvFy, mCx, mCy;
+		std::vector<float> mX;
+		std::vector<float> mY;
+		std::vector<float> mZ;
+};
@@ -8,6 +8,8 @@
 #include "VideoDeviceManager.h"
 #include "KinectDeviceManager.h"
 #include "TrackingSystem.h"
+#include "DepthOcclusion.h"
+#include "SkeletonRetargeter.h"
 #include "KinectFramelistener.h"
 
 static const std::string colorTextureName        = "KinectColorTexture";
@@ -54,6 +56,7 @@ protected:
 
 	void initTracking(int width, int height);
 	void createWebcamPlane(int width, int height, Ogre::Real _distanceFromCamera);
+	void createOcclusion(int depthWidth, int depthHeight);
 	void createKinectOverlay(const std::string& colorTextureName, const std::string& depthTextureName, const std::string& coloredDepthTextureName);
 	Ogre::ManualObject* OgreAppLogic::createCubeMesh(Ogre::String name, Ogre::String matName);
 	// OGRE
@@ -69,7 +72,10 @@ protected:
 	KinectDevice* mKinectDevice;
 	unsigned char* mWebcamBufferL8;
 	TrackingSystem* mTrackingSystem;
+	DepthOcclusion* mDepthOcclusion;
+	bool mOcclusionEnabled;
 	Ogre::AnimationState* mAnimState;
+	SkeletonRetargeter* mRetargeter;
 	//exampleaplliation.h
 	Root *mRoot;
     KinectFrameListener* mFrameListener;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <OgrePrerequisites.h>
+#include <OgreQuaternion.h>
+#include <OgreVector3.h>
+#include <vector>
+#include "SkeletonSnapshot.h"
+#include "JointFilter.h"
+
+//Drives the bones of Sinbad-like avatars from the tracked skeletons.
+//The driven bones are manually controlled but keep inheriting their parent orientation, so they
+//stay attached to the animated bones above them. The joint orientation of the sensor (skeleton
+//space) times a rest pose offset precomputed at setup is the target bone orientation in skeleton
+//space; it is turned into a delta relative to the parent (the target of a driven parent, the
+//animated orientation of the others) and blended with the bind pose by the tracking weight.
+//All the bones of all the avatars are kept in flat arrays and converted in one pass per frame,
+//then written to the bones in a second pass.
+//The canned animations keep playing: the driven bones are masked out of the enabled animation
+//states by the tracking weight, which fades in and out when the user is found or lost.
+class SkeletonRetargeter
+{
+	public:
+		SkeletonRetargeter();
+		virtual ~SkeletonRetargeter();
+
+		//userID 0 binds the avatar to the first user tracked and keeps it until that user is lost,
+		//mirror swaps left and right joints
+		int addAvatar(Ogre::Entity* entity, XnUserID userID = 0, bool mirror = false);
+		void removeAvatars();
+
+		//binds an avatar to a user, 0 to take the next tracked user
+		void setAvatarUser(int avatar, XnUserID userID);
+		//user the avatar follows, 0 when it is not bound
+		XnUserID getTrackedUser(int avatar) const;
+
+		//filter is optional, its predicted torso position moves the root bone
+		void update(const SkeletonSnapshot& snapshot, const JointFilter* filter, Ogre::Real deltaTime);
+
+		Ogre::Real getTrackingWeight(int avatar) const;
+
+		static Ogre::Real blendTime;         //seconds to fade between the animations and the tracking
+		static Ogre::Real minConfidence;     //joints below keep their last orientation
+		static Ogre::Real translationScale;  //avatar units per mm of torso motion
+
+	protected:
+		struct Avatar
+		{
+			Ogre::Entity* entity;
+			XnUserID userID;          //requested user, 0 for any
+			XnUserID trackedUserID;   //user followed, kept while tracked
+			bool mirror;
+			Ogre::Real weight;
+			size_t firstBone;
+			size_t boneCount;
+			Ogre::Bone* root;
+			Ogre::Vector3 rootInitialPosition;
+			Ogre::Vector3 origTorsoPos;
+			bool hasOrigTorsoPos;
+		};
+
+		void setupBone(Avatar& avatar, const Ogre::String& name, XnSkeletonJoint joint, const Ogre::Quaternion& rest);
+		void updateBlendMasks(const Avatar& avatar);
+
+		std::vector<Avatar> mAvatars;
+
+		//one entry per driven bone of every avatar
+		std::vector<Ogre::Bone*>      mBones;
+		std::vector<unsigned short>   mBoneHandles;
+		std::vector<XnSkeletonJoint>  mJoints;
+		std::vector<size_t>           mParents;              //driven parent bone, or the bone itself when the parent is not driven
+		std::vector<Ogre::Quaternion> mRestOrientations;     //skeleton space, sensor identity orientation
+		std::vector<Ogre::Quaternion> mBindOrientations;     //parent space, the initial state of the mesh
+		std::vector<Ogre::Quaternion> mTargetOrientations;   //skeleton space
+		std::vector<Ogre::Quaternion> mOrientations;         //parent space, written to the bones
+};
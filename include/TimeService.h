@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Single time base of the application: a monotonic clock in nanoseconds, the same on Windows
+// (QueryPerformanceCounter) and Linux (CLOCK_MONOTONIC). Sensor timestamps are mapped onto it
+// by a SensorClock, so frames, poses and render times can be compared directly.
+class TimeService
+{
+	public:
+		static uint64_t now(); //in ns, monotonic, arbitrary origin
+		static double nowSeconds();
+
+		static double toMilliseconds(int64_t ns) { return ns * 1e-6; }
+		static double toSeconds(int64_t ns) { return ns * 1e-9; }
+};
+
+// Maps the timestamps of a device (microseconds, own origin) to TimeService::now.
+//
+// Each frame gives a sample host - sensor. The host side also holds the transfer and scheduling
+// delay, which only adds, so the smallest offset of the recent samples is the closest to the true
+// one. Keeping a window of samples lets the mapping follow the drift between the two clocks.
+class SensorClock
+{
+	public:
+		SensorClock();
+
+		void reset();
+		// sensorTime in us, hostTime in ns (TimeService::now at acquisition)
+		void observe(uint64_t sensorTime, uint64_t hostTime);
+		// host time in ns of a sensor timestamp, TimeService::now before the first sample
+		uint64_t toHost(uint64_t sensorTime) const;
+
+		bool isCalibrated() const { return mSamples > 0; }
+		// ns, delay of the last sample over the smallest one of the window: transfer jitter
+		int64_t getLatency() const { return mLastLatency; }
+
+	private:
+		enum { WINDOW = 64 };
+
+		int64_t mOffsets[WINDOW];
+		unsigned int mSamples;
+		unsigned int mNext;
+		int64_t mOffset;
+		int64_t mLastLatency;
+		uint64_t mLastSensorTime;
+		uint64_t mLastHostTime;
+};
+
+// Times of one sensor frame, stamped once when the frame is acquired.
+struct FrameTime
+{
+	unsigned int frameID;
+	uint64_t sensorTime;  //us, device clock
+	uint64_t hostTime;    //ns, sensor time mapped to TimeService::now
+	uint64_t acquireTime; //ns, TimeService::now when the frame was read
+};
@@ -3,6 +3,7 @@
 #include <ARToolKitPlus/TrackerMultiMarker.h>
 #include <OgreMatrix4.h>
 #include <vector>
+#include "DepthPlane.h"
 
 struct Marker
 {
@@ -22,10 +23,13 @@ class TrackingSystem
 		void init(int _width, int _height);
 
 		bool update(const Ogre::PixelBox& grayLevelFrame); //return true if pose is computed
+		bool update(const Ogre::PixelBox& grayLevelFrame, const Ogre::PixelBox& depthFrame); //depth must be PF_L16 in mm, registered to the color frame
 
 		bool isPoseComputed() const;
+		bool isPoseRefinedWithDepth() const;
 		Ogre::Vector3 getTranslation() const;
 		Ogre::Quaternion getOrientation() const;
+		const DepthPlane& getDepthPlane() const;
 
 		const std::vector<Marker> getMarkersInfo() const;
 		const std::vector<int>    getVisibleMarkersId() const;
@@ -37,17 +41,35 @@ class TrackingSystem
 		static bool isUsingAutoThreshold;
 		static int threshold;
 
+		//Depth assisted refinement
+		static bool isUsingDepthRefinement;
+		static float depthFx, depthFy, depthCx, depthCy; //intrinsics of the (registered) depth map
+		static float depthWeight;          //0 = ARToolKitPlus pose only, 1 = depth distance/normal only
+		static float depthMaxDistanceGap;  //reject depth if it disagrees with the marker distance by more than this ratio
+		static float depthMaxAngleGap;     //reject depth if the plane normal disagrees by more than this angle (degrees)
+		static float depthMaxRmsError;     //reject depth if the plane fit residual is above this value (mm)
+		static int   depthMinSamples;
+		static int   depthSampleStep;      //sample every Nth row/column inside the marker quads
+
 	protected:		
 
 		void convertPoseToOgreCoordinate();		
+		void convertPoseToOgreCoordinate(const Ogre::Matrix4& trans);
 		Ogre::Matrix4 convert(const ARFloat _trans[3][4]) const;
+		bool fitDepthPlane(const Ogre::PixelBox& depthFrame);
+		bool refinePoseWithDepth(Ogre::Matrix4& trans) const;
 		Ogre::Quaternion mRot180Z;
 					
 		ARToolKitPlus::TrackerMultiMarker *mTracker;
 		bool mMarkersFound;
 		bool mInitialized;
+		int mWidth;
+		int mHeight;
 
 		Ogre::Vector3     mTranslation;
 		Ogre::Quaternion  mOrientation;
 		bool              mPoseComputed;
+		bool              mPoseRefined;
+		DepthPlane        mDepthPlane;
+		DepthPlaneFitter  mPlaneFitter;
 };
@@ -1,8 +1,9 @@
 #include "Chrono.h"
+#include "TimeService.h"
 
 Chrono::Chrono(bool _autostart)
 {
-	QueryPerformanceFrequency((LARGE_INTEGER*)&mFreq);
+	mStart = 0;
 
 	if (_autostart)
 		start();
@@ -10,13 +11,15 @@ Chrono::Chrono(bool _autostart)
 
 void Chrono::start()
 {
-	QueryPerformanceCounter((LARGE_INTEGER*)&mStart);
+	mStart = TimeService::now();
 }
 
 unsigned int Chrono::getTimeElapsed()
 {
-	__int64 stop;
-	QueryPerformanceCounter((LARGE_INTEGER*) &stop);
-		
-	return abs((int)(((stop - mStart) * 1000) / mFreq));
-}
\ No newline at end of file
+	return (unsigned int)((TimeService::now() - mStart) / 1000000);
+}
+
+double Chrono::getPreciseTimeElapsed()
+{
+	return TimeService::toMilliseconds((int64_t)(TimeService::now() - mStart));
+}
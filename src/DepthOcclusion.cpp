@@ -0,0 +1,381 @@
+#include "DepthOcclusion.h"
+
+#include <algorithm>
+#include <cstring>
+#include <OgreHardwareBufferManager.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define OCCLUSION_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace Ogre;
+
+static const std::string occlusionMeshName     = "KinectOcclusionMesh";
+static const std::string occlusionMaterialName = "KinectOcclusionMaterial";
+
+int DepthOcclusion::gridStep          = 4;
+float DepthOcclusion::fx              = 5.2921508098293293e+02f;
+float DepthOcclusion::fy              = 5.2556393630057437e+02f;
+float DepthOcclusion::cx              = 3.2894272028759258e+02f;
+float DepthOcclusion::cy              = 2.6748068171871557e+02f;
+float DepthOcclusion::minDepth        = 400.0f;
+float DepthOcclusion::maxDepth        = 4000.0f;
+float DepthOcclusion::depthTolerance  = 8.0f;
+float DepthOcclusion::maxJumpRatio    = 0.05f;
+Ogre::uint8 DepthOcclusion::renderQueue = RENDER_QUEUE_4; //after the video plane (RENDER_QUEUE_WORLD_GEOMETRY_1), before RENDER_QUEUE_MAIN
+
+DepthOcclusion::DepthOcclusion()
+{
+	mSceneMgr = NULL;
+	mNode = NULL;
+	mEntity = NULL;
+	mDepthWidth = 0;
+	mDepthHeight = 0;
+	mGridWidth = 0;
+	mGridHeight = 0;
+	mGridStep = DepthOcclusion::gridStep;
+	mFirstFrame = true;
+	mDirtyRowBegin = 0;
+	mDirtyRowEnd = 0;
+}
+
+DepthOcclusion::~DepthOcclusion()
+{
+	shutdown();
+}
+
+void DepthOcclusion::getProjection(int width, int height, Ogre::Radian& fovY, Ogre::Real& aspectRatio, Ogre::Vector2& frustumOffset)
+{
+	//image edges at unit distance, Y up: [-cx/fx, (w-cx)/fx] x [-(h-cy)/fy, cy/fy]
+	Real halfWidth  = 0.5f * width / DepthOcclusion::fx;
+	Real halfHeight = 0.5f * height / DepthOcclusion::fy;
+	fovY = 2.0f * Math::ATan(halfHeight);
+	aspectRatio = halfWidth / halfHeight;
+	//with a focal length of 1 the frustum offset is the shift of the image centre at unit distance
+	frustumOffset.x = (0.5f * width - DepthOcclusion::cx) / DepthOcclusion::fx;
+	frustumOffset.y = (DepthOcclusion::cy - 0.5f * height) / DepthOcclusion::fy;
+}
+
+void DepthOcclusion::setupCamera(Ogre::Camera* camera, int width, int height)
+{
+	Radian fovY;
+	Real aspectRatio;
+	Vector2 frustumOffset;
+	getProjection(width, height, fovY, aspectRatio, frustumOffset);
+	camera->setFocalLength(1.0f);
+	camera->setFOVy(fovY);
+	camera->setAspectRatio(aspectRatio);
+	camera->setFrustumOffset(frustumOffset);
+}
+
+void DepthOcclusion::init(Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, int depthWidth, int depthHeight)
+{
+	mSceneMgr = sceneMgr;
+	resize(depthWidth, depthHeight);
+	createMesh();
+
+	mEntity = mSceneMgr->createEntity("KinectOcclusion", occlusionMeshName);
+	mEntity->setMaterialName(occlusionMaterialName);
+	mEntity->setRenderQueueGroup(DepthOcclusion::renderQueue);
+	mEntity->setCastShadows(false);
+
+	mNode = parentNode->createChildSceneNode("occlusionNode");
+	mNode->attachObject(mEntity);
+}
+
+void DepthOcclusion::shutdown()
+{
+	if (mSceneMgr && mEntity)
+	{
+		mNode->detachAllObjects();
+		mSceneMgr->destroyEntity(mEntity);
+		mSceneMgr->destroySceneNode(mNode);
+	}
+	mEntity = NULL;
+	mNode = NULL;
+	mSceneMgr = NULL;
+
+	mVertexBuffer.setNull();
+	mIndexBuffer.setNull();
+	if (!mMesh.isNull())
+	{
+		MeshManager::getSingleton().remove(mMesh->getHandle());
+		mMesh.setNull();
+	}
+}
+
+void DepthOcclusion::resize(int depthWidth, int depthHeight, int gridStep)
+{
+	//keep the grid addressable with 16 bits indices
+	int step = std::max(1, gridStep);
+	while (((depthWidth - 1) / step + 1) * ((depthHeight - 1) / step + 1) > 65535)
+		step++;
+	mGridStep = step;
+
+	mDepthWidth  = depthWidth;
+	mDepthHeight = depthHeight;
+	mGridWidth   = (depthWidth - 1) / step + 1;
+	mGridHeight  = (depthHeight - 1) / step + 1;
+
+	//ray directions are padded to a multiple of 4 for the SSE loop
+	const int paddedWidth = (mGridWidth + 3) & ~3;
+	mRayX.assign(paddedWidth, 0.0f);
+	mRayY.assign(mGridHeight, 0.0f);
+	for (int c=0; c<mGridWidth; ++c)
+		mRayX[c] = (c*step - DepthOcclusion::cx) / DepthOcclusion::fx;
+	for (int r=0; r<mGridHeight; ++r)
+		mRayY[r] = (r*step - DepthOcclusion::cy) / DepthOcclusion::fy;
+
+	mGridDepth.assign(mGridHeight * paddedWidth, 0.0f);
+	mRowDepth.assign(paddedWidth, 0.0f);
+	mVertices.assign(mGridWidth * mGridHeight * 3, 0.0f);
+	mIndices.assign((mGridWidth - 1) * (mGridHeight - 1) * 6, 0);
+	mRowDirty.assign(mGridHeight, 0);
+	mFirstFrame = true;
+	mDirtyRowBegin = mDirtyRowEnd = 0;
+}
+
+void DepthOcclusion::createMesh()
+{
+	MaterialPtr material = MaterialManager::getSingleton().create(occlusionMaterialName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	Pass* pass = material->getTechnique(0)->getPass(0);
+	pass->setLightingEnabled(false);
+	pass->setColourWriteEnabled(false);
+	pass->setDepthWriteEnabled(true);
+	pass->setDepthCheckEnabled(true);
+	pass->setCullingMode(CULL_NONE);
+
+	mMesh = MeshManager::getSingleton().createManual(occlusionMeshName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	SubMesh* subMesh = mMesh->createSubMesh();
+	subMesh->useSharedVertices = false;
+	subMesh->operationType = RenderOperation::OT_TRIANGLE_LIST;
+
+	subMesh->vertexData = new VertexData();
+	subMesh->vertexData->vertexStart = 0;
+	subMesh->vertexData->vertexCount = mGridWidth * mGridHeight;
+	VertexDeclaration* decl = subMesh->vertexData->vertexDeclaration;
+	decl->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+
+	mVertexBuffer = HardwareBufferManager::getSingleton().createVertexBuffer(
+		decl->getVertexSize(0), 
+		subMesh->vertexData->vertexCount, 
+		HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+	subMesh->vertexData->vertexBufferBinding->setBinding(0, mVertexBuffer);
+	mVertexBuffer->writeData(0, mVertexBuffer->getSizeInBytes(), &mVertices[0], true);
+
+	mIndexBuffer = HardwareBufferManager::getSingleton().createIndexBuffer(
+		HardwareIndexBuffer::IT_16BIT, 
+		mIndices.size(), 
+		HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+	subMesh->indexData->indexBuffer = mIndexBuffer;
+	subMesh->indexData->indexStart = 0;
+	subMesh->indexData->indexCount = mIndices.size();
+	mIndexBuffer->writeData(0, mIndexBuffer->getSizeInBytes(), &mIndices[0], true);
+
+	//the occluder covers the whole depth frustum
+	Real halfWidth  = DepthOcclusion::maxDepth * std::max(Math::Abs(mRayX[0]), Math::Abs(mRayX[mGridWidth-1]));
+	Real halfHeight = DepthOcclusion::maxDepth * std::max(Math::Abs(mRayY[0]), Math::Abs(mRayY[mGridHeight-1]));
+	AxisAlignedBox bounds(-halfWidth, -halfHeight, -DepthOcclusion::maxDepth, halfWidth, halfHeight, 0);
+	mMesh->_setBounds(bounds);
+	mMesh->_setBoundingSphereRadius(bounds.getHalfSize().length());
+	mMesh->load();
+}
+
+bool DepthOcclusion::update(const Ogre::PixelBox& depthFrame)
+{
+	if (mEntity == NULL || !mEntity->isVisible() || depthFrame.format != PF_L16)
+		return false;
+
+	if ((int)depthFrame.getWidth() != mDepthWidth || (int)depthFrame.getHeight() != mDepthHeight)
+		return false;
+
+	if (!updateGrid(static_cast<const unsigned short*>(depthFrame.data), depthFrame.rowPitch))
+		return false;
+
+	uploadDirtyRows();
+	return true;
+}
+
+bool DepthOcclusion::updateGrid(const unsigned short* depth, size_t rowPitch)
+{
+	const int step = mGridStep;
+	const int paddedWidth = (int)mRowDepth.size();
+	const float minZ = DepthOcclusion::minDepth;
+	const float maxZ = DepthOcclusion::maxDepth;
+
+	mDirtyRowBegin = mGridHeight;
+	mDirtyRowEnd = 0;
+
+	for (int r=0; r<mGridHeight; ++r)
+	{
+		const unsigned short* row = depth + (r*step)*rowPitch;
+		float* rowDepth = &mRowDepth[0];
+		float* gridDepth = &mGridDepth[r*paddedWidth];
+
+		//strided gather, out of range samples become holes
+		for (int c=0; c<mGridWidth; ++c)
+		{
+			float z = row[c*step];
+			rowDepth[c] = (z >= minZ && z <= maxZ) ? z : 0.0f;
+		}
+
+		bool changed = mFirstFrame;
+		int c = 0;
+#if OCCLUSION_USE_SSE2
+		const __m128 tolerance = _mm_set1_ps(DepthOcclusion::depthTolerance);
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 zero = _mm_setzero_ps();
+		for (; !changed && c + 4 <= mGridWidth; c += 4)
+		{
+			__m128 z = _mm_loadu_ps(rowDepth + c);
+			__m128 previous = _mm_loadu_ps(gridDepth + c);
+			__m128 delta = _mm_and_ps(_mm_sub_ps(z, previous), signMask);
+			//a hole appearing or disappearing is always a change
+			__m128 holeChange = _mm_xor_ps(_mm_cmpeq_ps(z, zero), _mm_cmpeq_ps(previous, zero));
+			__m128 mask = _mm_or_ps(_mm_cmpgt_ps(delta, tolerance), holeChange);
+			changed = _mm_movemask_ps(mask) != 0;
+		}
+#endif
+		for (; !changed && c < mGridWidth; ++c)
+		{
+			float z = rowDepth[c];
+			float previous = gridDepth[c];
+			if (Math::Abs(z - previous) > DepthOcclusion::depthTolerance || ((z == 0) != (previous == 0)))
+				changed = true;
+		}
+
+		mRowDirty[r] = changed ? 1 : 0;
+		if (!changed)
+			continue;
+
+		mDirtyRowBegin = std::min(mDirtyRowBegin, r);
+		mDirtyRowEnd = std::max(mDirtyRowEnd, r + 1);
+
+		//back-project the row, Ogre camera looks down -Z with Y up
+		memcpy(gridDepth, rowDepth, mGridWidth * sizeof(float));
+		const float rayY = -mRayY[r];
+		float* vertex = &mVertices[r*mGridWidth*3];
+		for (c=0; c<mGridWidth; ++c, vertex+=3)
+		{
+			float z = rowDepth[c];
+			vertex[0] = mRayX[c] * z;
+			vertex[1] = rayY * z;
+			vertex[2] = -z;
+		}
+	}
+
+	mFirstFrame = false;
+	if (mDirtyRowBegin >= mDirtyRowEnd)
+		return false;
+
+	//cells touching a dirty grid row must be rebuilt
+	int cellBegin = std::max(0, mDirtyRowBegin - 1);
+	int cellEnd = std::min(mGridHeight - 1, mDirtyRowEnd);
+	for (int cellY=cellBegin; cellY<cellEnd; ++cellY)
+		updateCellRow(cellY);
+
+	return true;
+}
+
+void DepthOcclusion::updateCellRow(int cellY)
+{
+	const int paddedWidth = (int)mRowDepth.size();
+	const float* top = &mGridDepth[cellY*paddedWidth];
+	const float* bottom = top + paddedWidth;
+	Ogre::uint16* index = &mIndices[cellY*(mGridWidth - 1)*6];
+
+	for (int c=0; c<mGridWidth-1; ++c, index+=6)
+	{
+		Ogre::uint16 i00 = (Ogre::uint16)(cellY*mGridWidth + c);
+		Ogre::uint16 i01 = i00 + 1;
+		Ogre::uint16 i10 = (Ogre::uint16)(i00 + mGridWidth);
+		Ogre::uint16 i11 = i10 + 1;
+
+		float z00 = top[c], z01 = top[c+1], z10 = bottom[c], z11 = bottom[c+1];
+		float zMin = std::min(std::min(z00, z01), std::min(z10, z11));
+		float zMax = std::max(std::max(z00, z01), std::max(z10, z11));
+
+		//holes and depth discontinuities (object silhouettes) do not occlude
+		if (zMin <= 0 || zMax - zMin > zMin * DepthOcclusion::maxJumpRatio)
+		{
+			index[0] = index[1] = index[2] = index[3] = index[4] = index[5] = i00;
+			continue;
+		}
+
+		index[0] = i00; index[1] = i10; index[2] = i01;
+		index[3] = i01; index[4] = i10; index[5] = i11;
+	}
+}
+
+void DepthOcclusion::uploadDirtyRows()
+{
+	//vertices of the dirty grid rows
+	size_t vertexSize = 3 * sizeof(float);
+	size_t vertexOffset = mDirtyRowBegin * mGridWidth * vertexSize;
+	size_t vertexLength = (mDirtyRowEnd - mDirtyRowBegin) * mGridWidth * vertexSize;
+	mVertexBuffer->writeData(vertexOffset, vertexLength, &mVertices[mDirtyRowBegin * mGridWidth * 3], mDirtyRowBegin == 0 && mDirtyRowEnd == mGridHeight);
+
+	//indices of the cell rows around them
+	int cellBegin = std::max(0, mDirtyRowBegin - 1);
+	int cellEnd = std::min(mGridHeight - 1, mDirtyRowEnd);
+	if (cellBegin >= cellEnd)
+		return;
+	size_t cellRowLength = (mGridWidth - 1) * 6;
+	mIndexBuffer->writeData(cellBegin * cellRowLength * sizeof(Ogre::uint16), 
+		(cellEnd - cellBegin) * cellRowLength * sizeof(Ogre::uint16), 
+		&mIndices[cellBegin * cellRowLength], 
+		cellBegin == 0 && cellEnd == mGridHeight - 1);
+}
+
+void DepthOcclusion::setVisible(bool visible)
+{
+	if (mEntity)
+		mEntity->setVisible(visible);
+}
+
+bool DepthOcclusion::isVisible() const
+{
+	return mEntity != NULL && mEntity->isVisible();
+}
+
+int DepthOcclusion::getGridStep() const
+{
+	return mGridStep;
+}
+
+int DepthOcclusion::getGridWidth() const
+{
+	return mGridWidth;
+}
+
+int DepthOcclusion::getGridHeight() const
+{
+	return mGridHeight;
+}
+
+const float* DepthOcclusion::getVertices() const
+{
+	return mVertices.empty() ? NULL : &mVertices[0];
+}
+
+const Ogre::uint16* DepthOcclusion::getIndices() const
+{
+	return mIndices.empty() ? NULL : &mIndices[0];
+}
+
+bool DepthOcclusion::isCellOccluder(int cellX, int cellY) const
+{
+	const Ogre::uint16* index = &mIndices[(cellY*(mGridWidth - 1) + cellX)*6];
+	return index[0] != index[1];
+}
+
+int DepthOcclusion::getDirtyRowBegin() const
+{
+	return mDirtyRowBegin;
+}
+
+int DepthOcclusion::getDirtyRowEnd() const
+{
+	return mDirtyRowEnd;
+}
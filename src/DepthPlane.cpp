@@ -0,0 +1,158 @@
+#include "DepthPlane.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define DEPTHPLANE_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+DepthPlane::DepthPlane()
+{
+	valid = false;
+	samples = 0;
+	a = b = c = 0.0f;
+	rmsError = 0.0f;
+}
+
+DepthPlaneFitter::DepthPlaneFitter()
+{
+	mInvFx = mInvFy = 1.0f;
+	mCx = mCy = 0.0f;
+}
+
+void DepthPlaneFitter::setIntrinsics(float fx, float fy, float cx, float cy)
+{
+	mInvFx = 1.0f / fx;
+	mInvFy = 1.0f / fy;
+	mCx = cx;
+	mCy = cy;
+}
+
+void DepthPlaneFitter::clear()
+{
+	mX.clear();
+	mY.clear();
+	mZ.clear();
+}
+
+void DepthPlaneFitter::addSample(float x, float y, float z)
+{
+	mX.push_back(x);
+	mY.push_back(y);
+	mZ.push_back(z);
+}
+
+void DepthPlaneFitter::addRow(const unsigned short* row, int v, int x0, int x1, int step)
+{
+	const float yRay = (v - mCy) * mInvFy;
+	for (int u=x0; u<=x1; u+=step)
+	{
+		float z = row[u];
+		if (z <= 0.0f)
+			continue;
+		addSample((u - mCx) * mInvFx * z, yRay * z, z);
+	}
+}
+
+int DepthPlaneFitter::getSampleCount() const
+{
+	return (int)mZ.size();
+}
+
+//Second order moments of the samples around (mx, my, mz), m[] = { XX, XY, YY, XZ, YZ, ZZ }
+static void accumulateCenteredMoments(const float* xs, const float* ys, const float* zs, int n, double mx, double my, double mz, double m[6])
+{
+	int i = 0;
+	double acc[6] = {0};
+
+#if DEPTHPLANE_USE_SSE2
+	const __m128d vmx = _mm_set1_pd(mx);
+	const __m128d vmy = _mm_set1_pd(my);
+	const __m128d vmz = _mm_set1_pd(mz);
+	__m128d s[6];
+	for (int k=0; k<6; ++k)
+		s[k] = _mm_setzero_pd();
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d x = _mm_sub_pd(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(xs + i)))), vmx);
+		__m128d y = _mm_sub_pd(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(ys + i)))), vmy);
+		__m128d z = _mm_sub_pd(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(zs + i)))), vmz);
+		s[0] = _mm_add_pd(s[0], _mm_mul_pd(x, x));
+		s[1] = _mm_add_pd(s[1], _mm_mul_pd(x, y));
+		s[2] = _mm_add_pd(s[2], _mm_mul_pd(y, y));
+		s[3] = _mm_add_pd(s[3], _mm_mul_pd(x, z));
+		s[4] = _mm_add_pd(s[4], _mm_mul_pd(y, z));
+		s[5] = _mm_add_pd(s[5], _mm_mul_pd(z, z));
+	}
+
+	for (int k=0; k<6; ++k)
+	{
+		double lanes[2];
+		_mm_storeu_pd(lanes, s[k]);
+		acc[k] = lanes[0] + lanes[1];
+	}
+#endif
+
+	for (; i<n; ++i)
+	{
+		double x = xs[i] - mx;
+		double y = ys[i] - my;
+		double z = zs[i] - mz;
+		acc[0] += x*x;
+		acc[1] += x*y;
+		acc[2] += y*y;
+		acc[3] += x*z;
+		acc[4] += y*z;
+		acc[5] += z*z;
+	}
+
+	for (int k=0; k<6; ++k)
+		m[k] = acc[k];
+}
+
+bool DepthPlaneFitter::fit(DepthPlane& plane, int minSamples, float maxRmsError) const
+{
+	plane = DepthPlane();
+	plane.samples = getSampleCount();
+	if (plane.samples < std::max(3, minSamples))
+		return false;
+
+	const int count = plane.samples;
+	double mx = 0, my = 0, mz = 0;
+	for (int i=0; i<count; ++i)
+	{
+		mx += mX[i];
+		my += mY[i];
+		mz += mZ[i];
+	}
+	mx /= count;
+	my /= count;
+	mz /= count;
+
+	double m[6];
+	accumulateCenteredMoments(&mX[0], &mY[0], &mZ[0], count, mx, my, mz, m);
+	const double cxx = m[0] / count, cxy = m[1] / count, cyy = m[2] / count;
+	const double cxz = m[3] / count, cyz = m[4] / count, czz = m[5] / count;
+
+	//the determinant has the unit of the squared spread, compare it to it: samples along a line
+	//(a marker seen edge-on, a single scanline) are rejected whatever their distance or size
+	const double det = cxx*cyy - cxy*cxy;
+	const double spread = cxx + cyy;
+	if (spread <= 0 || det <= 1e-6 * spread*spread)
+		return false;
+
+	const double a = ( cyy*cxz - cxy*cyz) / det;
+	const double b = (-cxy*cxz + cxx*cyz) / det;
+	const double residual = czz - a*cxz - b*cyz;
+
+	plane.a = (float)a;
+	plane.b = (float)b;
+	plane.c = (float)(mz - a*mx - b*my);
+	plane.rmsError = (float)std::sqrt(std::max(0.0, residual));
+	plane.valid = plane.rmsError <= maxRmsError;
+
+	return plane.valid;
+}
@@ -0,0 +1,323 @@
+#include "AudioRing.h"
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define AUDIO_RING_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace Kinect;
+
+static const XnFloat SAMPLE_SCALE = 1.0f / 32768.0f;
+
+// x86 keeps the order of stores and of loads already, only the compiler must not move the
+// sample accesses across the index accesses
+static inline XnUInt32 LoadAcquire(const volatile XnUInt32* pIndex)
+{
+#ifdef _MSC_VER
+	XnUInt32 nValue = *pIndex;
+	_ReadWriteBarrier();
+	return nValue;
+#else
+	return __atomic_load_n(pIndex, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void StoreRelease(volatile XnUInt32* pIndex, XnUInt32 nValue)
+{
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+	*pIndex = nValue;
+#else
+	__atomic_store_n(pIndex, nValue, __ATOMIC_RELEASE);
+#endif
+}
+
+AudioRing::AudioRing()
+{
+	m_nMask = 0;
+	m_nWrite = 0;
+	m_nRead = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void AudioRing::Init(XnUInt32 nCapacity)
+{
+	XnUInt32 nSize = 1;
+	while (nSize < nCapacity)
+		nSize <<= 1;
+	m_Samples.assign(nSize, 0.0f);
+	m_nMask = nSize - 1;
+	Reset();
+}
+
+void AudioRing::Reset()
+{
+	m_nWrite = 0;
+	m_nRead = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+XnUInt32 AudioRing::GetFree() const
+{
+	return GetCapacity() - (m_nWrite - LoadAcquire(&m_nRead));
+}
+
+XnUInt32 AudioRing::GetAvailable() const
+{
+	return LoadAcquire(&m_nWrite) - m_nRead;
+}
+
+XnUInt32 AudioRing::Write(const XnFloat* pSamples, XnUInt32 nCount)
+{
+	if (m_Samples.empty())
+		return 0;
+
+	const XnUInt32 nWrite = m_nWrite;
+	const XnUInt32 nFree = GetCapacity() - (nWrite - LoadAcquire(&m_nRead));
+	XnUInt32 nWritten = nCount;
+	if (nWritten > nFree)
+	{
+		nWritten = nFree;
+		m_Stats.nOverruns++;
+		m_Stats.nDroppedSamples += nCount - nFree;
+	}
+
+	// at most two runs, up to the end of the buffer and from its start
+	const XnUInt32 nStart = nWrite & m_nMask;
+	const XnUInt32 nFirst = XN_MIN(nWritten, GetCapacity() - nStart);
+	memcpy(&m_Samples[nStart], pSamples, nFirst * sizeof(XnFloat));
+	if (nWritten > nFirst)
+		memcpy(&m_Samples[0], pSamples + nFirst, (nWritten - nFirst) * sizeof(XnFloat));
+
+	StoreRelease(&m_nWrite, nWrite + nWritten);
+	return nWritten;
+}
+
+XnUInt32 AudioRing::Read(XnFloat* pDest, XnUInt32 nCount)
+{
+	const XnUInt32 nRead = m_nRead;
+	const XnUInt32 nAvailable = LoadAcquire(&m_nWrite) - nRead;
+	XnUInt32 nCopied = nCount;
+	if (nCopied > nAvailable)
+	{
+		nCopied = nAvailable;
+		m_Stats.nUnderruns++;
+		m_Stats.nMissingSamples += nCount - nAvailable;
+	}
+
+	if (nCopied > 0)
+	{
+		const XnUInt32 nStart = nRead & m_nMask;
+		const XnUInt32 nFirst = XN_MIN(nCopied, GetCapacity() - nStart);
+		memcpy(pDest, &m_Samples[nStart], nFirst * sizeof(XnFloat));
+		if (nCopied > nFirst)
+			memcpy(pDest + nFirst, &m_Samples[0], (nCopied - nFirst) * sizeof(XnFloat));
+	}
+
+	StoreRelease(&m_nRead, nRead + nCopied);
+	return nCopied;
+}
+
+XnUInt32 AudioRing::Discard(XnUInt32 nCount)
+{
+	const XnUInt32 nRead = m_nRead;
+	const XnUInt32 nAvailable = LoadAcquire(&m_nWrite) - nRead;
+	const XnUInt32 nDropped = XN_MIN(nCount, nAvailable);
+	StoreRelease(&m_nRead, nRead + nDropped);
+	return nDropped;
+}
+
+AudioStream::AudioStream()
+{
+	m_nChannels = 0;
+	m_nSampleRate = 0;
+	m_nUnderruns = 0;
+	m_nMissingFrames = 0;
+	m_nOverruns = 0;
+	m_nDroppedFrames = 0;
+}
+
+void AudioStream::Init(XnUInt32 nChannels, XnUInt32 nSampleRate, XnUInt32 nCapacityFrames)
+{
+	m_nChannels = XN_MIN(nChannels, (XnUInt32)MAX_CHANNELS);
+	m_nSampleRate = nSampleRate;
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+		m_Channels[c].Init(nCapacityFrames);
+	m_nUnderruns = 0;
+	m_nMissingFrames = 0;
+	m_nOverruns = 0;
+	m_nDroppedFrames = 0;
+}
+
+void AudioStream::Reset()
+{
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+		m_Channels[c].Reset();
+	m_nUnderruns = 0;
+	m_nMissingFrames = 0;
+	m_nOverruns = 0;
+	m_nDroppedFrames = 0;
+}
+
+XnUInt32 AudioStream::Push(const XnInt16* pInterleaved, XnUInt32 nFrames)
+{
+	if (m_nChannels == 0)
+		return 0;
+
+	XnFloat* pBlock[MAX_CHANNELS];
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+		pBlock[c] = m_Block[c];
+
+	XnUInt32 nTaken = 0;
+	for (XnUInt32 nDone = 0; nDone < nFrames; nDone += BLOCK_FRAMES)
+	{
+		const XnUInt32 nCount = XN_MIN(nFrames - nDone, (XnUInt32)BLOCK_FRAMES);
+		Deinterleave(pInterleaved + nDone * m_nChannels, nCount, m_nChannels, pBlock);
+		// the reader frees the channels one after the other, write them all as far as the
+		// fullest one has room so they stay aligned
+		// XN_MIN evaluates its arguments twice, the indices are loaded once
+		XnUInt32 nFit = nCount;
+		for (XnUInt32 c = 0; c < m_nChannels; c++)
+		{
+			const XnUInt32 nFree = m_Channels[c].GetFree();
+			nFit = XN_MIN(nFit, nFree);
+		}
+		if (nFit < nCount)
+		{
+			m_nOverruns++;
+			m_nDroppedFrames += nCount - nFit;
+		}
+		for (XnUInt32 c = 0; c < m_nChannels; c++)
+			m_Channels[c].Write(m_Block[c], nFit);
+		nTaken += nFit;
+	}
+	return nTaken;
+}
+
+XnUInt32 AudioStream::GetAvailable() const
+{
+	if (m_nChannels == 0)
+		return 0;
+
+	XnUInt32 nAvailable = m_Channels[0].GetAvailable();
+	for (XnUInt32 c = 1; c < m_nChannels; c++)
+	{
+		const XnUInt32 nChannelAvailable = m_Channels[c].GetAvailable();
+		nAvailable = XN_MIN(nAvailable, nChannelAvailable);
+	}
+	return nAvailable;
+}
+
+XnUInt32 AudioStream::Read(XnFloat* const* pDest, XnUInt32 nFrames)
+{
+	// the channels are written one after the other, read only what all of them have
+	const XnUInt32 nAvailable = GetAvailable();
+	const XnUInt32 nCount = XN_MIN(nFrames, nAvailable);
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+		m_Channels[c].Read(pDest[c], nCount);
+
+	if (nCount < nFrames)
+	{
+		m_nUnderruns++;
+		m_nMissingFrames += nFrames - nCount;
+	}
+	return nCount;
+}
+
+XnUInt32 AudioStream::Trim(XnUInt32 nKeepFrames)
+{
+	const XnUInt32 nAvailable = GetAvailable();
+	if (nAvailable <= nKeepFrames)
+		return 0;
+
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+		m_Channels[c].Discard(nAvailable - nKeepFrames);
+	return nAvailable - nKeepFrames;
+}
+
+AudioRingStats AudioStream::GetStats() const
+{
+	AudioRingStats total;
+	memset(&total, 0, sizeof(total));
+	total.nOverruns = m_nOverruns;
+	total.nDroppedSamples = m_nDroppedFrames * m_nChannels;
+	total.nUnderruns = m_nUnderruns;
+	total.nMissingSamples = m_nMissingFrames * m_nChannels;
+	for (XnUInt32 c = 0; c < m_nChannels; c++)
+	{
+		const AudioRingStats& stats = m_Channels[c].GetStats();
+		total.nOverruns += stats.nOverruns;
+		total.nDroppedSamples += stats.nDroppedSamples;
+		total.nUnderruns += stats.nUnderruns;
+		total.nMissingSamples += stats.nMissingSamples;
+	}
+	return total;
+}
+
+void AudioStream::DeinterleaveReference(const XnInt16* pSrc, XnUInt32 nFrames, XnUInt32 nChannels, XnFloat* const* pDest)
+{
+	for (XnUInt32 i = 0; i < nFrames; i++)
+		for (XnUInt32 c = 0; c < nChannels; c++)
+			pDest[c][i] = pSrc[i * nChannels + c] * SAMPLE_SCALE;
+}
+
+void AudioStream::Deinterleave(const XnInt16* pSrc, XnUInt32 nFrames, XnUInt32 nChannels, XnFloat* const* pDest)
+{
+	XnUInt32 i = 0;
+
+#if AUDIO_RING_USE_SSE2
+	// samples are widened to 32 bit by putting them in the high half and shifting back down
+	const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+	if (nChannels == 1)
+	{
+		for (; i + 8 <= nFrames; i += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(pSrc + i));
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(pDest[0] + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(pDest[0] + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+	}
+	else if (nChannels == 2)
+	{
+		for (; i + 4 <= nFrames; i += 4)
+		{
+			// L0 R0 L1 R1 L2 R2 L3 R3
+			__m128i v = _mm_loadu_si128((const __m128i*)(pSrc + 2 * i));
+			__m128i left = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+			__m128i right = _mm_srai_epi32(v, 16);
+			_mm_storeu_ps(pDest[0] + i, _mm_mul_ps(_mm_cvtepi32_ps(left), scale));
+			_mm_storeu_ps(pDest[1] + i, _mm_mul_ps(_mm_cvtepi32_ps(right), scale));
+		}
+	}
+	else if (nChannels == 4)
+	{
+		for (; i + 4 <= nFrames; i += 4)
+		{
+			// frames 0 and 1, frames 2 and 3, four channels each
+			__m128i a = _mm_loadu_si128((const __m128i*)(pSrc + 4 * i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(pSrc + 4 * i + 8));
+			// 0c0 2c0 0c1 2c1 0c2 2c2 0c3 2c3 and 1c0 3c0 1c1 3c1...
+			__m128i t0 = _mm_unpacklo_epi16(a, b);
+			__m128i t1 = _mm_unpackhi_epi16(a, b);
+			// the four frames of channels 0 and 1, of channels 2 and 3
+			__m128i c01 = _mm_unpacklo_epi16(t0, t1);
+			__m128i c23 = _mm_unpackhi_epi16(t0, t1);
+			_mm_storeu_ps(pDest[0] + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(c01, c01), 16)), scale));
+			_mm_storeu_ps(pDest[1] + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(c01, c01), 16)), scale));
+			_mm_storeu_ps(pDest[2] + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(c23, c23), 16)), scale));
+			_mm_storeu_ps(pDest[3] + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(c23, c23), 16)), scale));
+		}
+	}
+#endif
+
+	for (; i < nFrames; i++)
+		for (XnUInt32 c = 0; c < nChannels; c++)
+			pDest[c][i] = pSrc[i * nChannels + c] * SAMPLE_SCALE;
+}
@@ -0,0 +1,131 @@
+#ifndef _AudioRing
+#define _AudioRing
+
+#include <XnTypes.h>
+#include <vector>
+
+namespace Kinect
+{
+
+/// @brief Counters of an AudioRing since Init. The writer keeps the overrun ones and the reader
+/// the underrun ones, the other thread reads a recent value.
+struct AudioRingStats
+{
+	XnUInt32 nOverruns;         ///< @brief writes that did not fit whole
+	XnUInt64 nDroppedSamples;   ///< @brief samples those writes lost
+	XnUInt32 nUnderruns;        ///< @brief reads that found fewer samples than asked for
+	XnUInt64 nMissingSamples;   ///< @brief samples those reads were short of
+};
+
+/// @brief Lock-free ring of the float samples of one channel, for one writer thread and one
+/// reader thread.
+///
+/// The writer only moves the write index and the reader only the read index. Each side
+/// publishes its index with release order after touching the samples and loads the other one
+/// with acquire order, so neither ever waits. The capacity is a power of two and the indices
+/// run free: the fill level is their difference. Nothing is allocated after Init.
+///
+/// A write that does not fit keeps the samples already queued and drops the rest of its own,
+/// the writer never takes samples away from the reader. A reader that wants a bounded latency
+/// drops what it is behind by with Discard.
+class AudioRing
+{
+public:
+	AudioRing();
+
+	/// @param nCapacity samples, rounded up to a power of two
+	void Init(XnUInt32 nCapacity);
+	/// @brief Empties the ring and clears the counters, only while neither side runs.
+	void Reset();
+
+	/// @brief Writer side.
+	/// @return samples written, fewer than nCount on an overrun
+	XnUInt32 Write(const XnFloat* pSamples, XnUInt32 nCount);
+	XnUInt32 GetFree() const;
+
+	/// @brief Reader side.
+	/// @return samples read, fewer than nCount on an underrun
+	XnUInt32 Read(XnFloat* pDest, XnUInt32 nCount);
+	/// @brief Reader side, drops up to nCount of the oldest samples without counting an underrun.
+	/// @return samples dropped
+	XnUInt32 Discard(XnUInt32 nCount);
+	XnUInt32 GetAvailable() const;
+
+	XnUInt32 GetCapacity() const { return (XnUInt32)m_Samples.size(); }
+	const AudioRingStats& GetStats() const { return m_Stats; }
+
+private:
+	std::vector<XnFloat> m_Samples;
+	XnUInt32 m_nMask;
+	AudioRingStats m_Stats;
+
+	// a cache line each, the two threads do not write the same line
+	XnUInt8 m_Pad0[64];
+	volatile XnUInt32 m_nWrite;
+	XnUInt8 m_Pad1[64];
+	volatile XnUInt32 m_nRead;
+	XnUInt8 m_Pad2[64];
+};
+
+/// @brief The microphone channels of a device, one AudioRing each, fed with interleaved 16 bit
+/// PCM on the acquisition thread.
+///
+/// Push de-interleaves the samples to float in [-1, 1), BLOCK_FRAMES at a time through a buffer
+/// of its own, then writes every channel. The reader side reads all channels over the same
+/// frames; a consumer of a single channel (a voice detector on one microphone) may instead read
+/// GetChannel(i) on its own thread, one reader per ring.
+class AudioStream
+{
+public:
+	enum
+	{
+		MAX_CHANNELS = 4,
+		BLOCK_FRAMES = 1024,
+	};
+
+	AudioStream();
+
+	/// @param nCapacityFrames frames each channel holds, rounded up to a power of two
+	void Init(XnUInt32 nChannels, XnUInt32 nSampleRate, XnUInt32 nCapacityFrames);
+	void Reset();
+
+	/// @brief Writer side. On an overrun the frames of a block that do not fit are dropped, a
+	/// later block may fit again once the reader caught up.
+	/// @return frames every channel took, fewer than nFrames on an overrun
+	XnUInt32 Push(const XnInt16* pInterleaved, XnUInt32 nFrames);
+
+	/// @brief Reader side, frames queued on every channel.
+	XnUInt32 GetAvailable() const;
+	/// @brief Reader side, reads the same frames of every channel to pDest[channel].
+	/// @return frames read, fewer than nFrames on an underrun
+	XnUInt32 Read(XnFloat* const* pDest, XnUInt32 nFrames);
+	/// @brief Reader side, drops the oldest frames so at most nKeepFrames stay queued: the
+	/// latency of the next Read is then at most nKeepFrames / sample rate.
+	/// @return frames dropped
+	XnUInt32 Trim(XnUInt32 nKeepFrames);
+
+	AudioRing& GetChannel(XnUInt32 nChannel) { return m_Channels[nChannel]; }
+	XnUInt32 GetChannels() const { return m_nChannels; }
+	XnUInt32 GetSampleRate() const { return m_nSampleRate; }
+	/// @brief Overruns of Push and underruns of Read, with those of readers of single channels.
+	AudioRingStats GetStats() const;
+
+	/// @brief pDest[c][i] = pSrc[i * nChannels + c] / 32768. SSE2 for 1, 2 and 4 channels, with
+	/// the exact results of DeinterleaveReference.
+	static void Deinterleave(const XnInt16* pSrc, XnUInt32 nFrames, XnUInt32 nChannels, XnFloat* const* pDest);
+	static void DeinterleaveReference(const XnInt16* pSrc, XnUInt32 nFrames, XnUInt32 nChannels, XnFloat* const* pDest);
+
+private:
+	AudioRing m_Channels[MAX_CHANNELS];
+	XnUInt32 m_nChannels;
+	XnUInt32 m_nSampleRate;
+	XnUInt32 m_nOverruns;
+	XnUInt64 m_nDroppedFrames;
+	XnUInt32 m_nUnderruns;
+	XnUInt64 m_nMissingFrames;
+	XnFloat m_Block[MAX_CHANNELS][BLOCK_FRAMES];
+};
+
+}
+
+#endif
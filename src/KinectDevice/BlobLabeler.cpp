@@ -0,0 +1,317 @@
+#include "BlobLabeler.h"
+#include <string.h>
+
+using namespace Kinect;
+
+void BlobStats::Resize(XnUInt32 nSize)
+{
+	nCount = nSize;
+	nLabel.resize(nSize);
+	nArea.resize(nSize);
+	nMinX.resize(nSize);
+	nMinY.resize(nSize);
+	nMaxX.resize(nSize);
+	nMaxY.resize(nSize);
+	fCenterX.resize(nSize);
+	fCenterY.resize(nSize);
+	nMinDepth.resize(nSize);
+	fMeanDepth.resize(nSize);
+}
+
+// true when the 8 mask bytes from pMask are all background
+static inline bool IsEmptySpan(const XnUInt8* pMask)
+{
+	XnUInt64 nSpan;
+	memcpy(&nSpan, pMask, sizeof(nSpan));
+	return nSpan == 0;
+}
+
+BlobLabeler::BlobLabeler()
+{
+	m_nMinArea = 200;
+	m_nBandHeight = 32;
+
+	m_nXRes = 0;
+	m_nYRes = 0;
+	m_nBands = 0;
+	m_nLabelsPerRow = 0;
+	m_nComponents = 0;
+	m_Blobs.Resize(0);
+	m_Components.Resize(0);
+}
+
+void BlobLabeler::Init(XnUInt32 nXRes, XnUInt32 nYRes, XnUInt32 nBandHeight)
+{
+	m_nXRes = nXRes;
+	m_nYRes = nYRes;
+	m_nBandHeight = nBandHeight > 0 ? nBandHeight : 1;
+	m_nBands = (nYRes + m_nBandHeight - 1) / m_nBandHeight;
+	// with 4 connectivity a row can start at most one new label every two pixels
+	m_nLabelsPerRow = (nXRes + 1) / 2;
+
+	const XnUInt32 nMaxLabels = nYRes*m_nLabelsPerRow + 1;
+	m_Labels.assign(nXRes*nYRes, 0);
+	m_Parents.assign(nMaxLabels, 0);
+	m_BandEnd.assign(m_nBands, 0);
+
+	m_Area.assign(nMaxLabels, 0);
+	m_SumX.assign(nMaxLabels, 0);
+	m_SumY.assign(nMaxLabels, 0);
+	m_SumDepth.assign(nMaxLabels, 0);
+	m_DepthCount.assign(nMaxLabels, 0);
+	m_MinX.assign(nMaxLabels, 0);
+	m_MinY.assign(nMaxLabels, 0);
+	m_MaxX.assign(nMaxLabels, 0);
+	m_MaxY.assign(nMaxLabels, 0);
+	m_MinDepth.assign(nMaxLabels, 0);
+
+	m_nComponents = 0;
+	m_Blobs.Resize(0);
+}
+
+XnUInt32 BlobLabeler::FindRoot(XnUInt32 nLabel)
+{
+	XnUInt32 nRoot = nLabel;
+	while (m_Parents[nRoot] != nRoot)
+		nRoot = m_Parents[nRoot];
+	// path compression
+	while (m_Parents[nLabel] != nRoot)
+	{
+		XnUInt32 nNext = m_Parents[nLabel];
+		m_Parents[nLabel] = nRoot;
+		nLabel = nNext;
+	}
+	return nRoot;
+}
+
+void BlobLabeler::Union(XnUInt32 nLabel1, XnUInt32 nLabel2)
+{
+	XnUInt32 nRoot1 = FindRoot(nLabel1);
+	XnUInt32 nRoot2 = FindRoot(nLabel2);
+	// the smallest label stays the root, Flatten relies on it
+	if (nRoot1 < nRoot2)
+		m_Parents[nRoot2] = nRoot1;
+	else if (nRoot2 < nRoot1)
+		m_Parents[nRoot1] = nRoot2;
+}
+
+XnUInt32 BlobLabeler::Label(const XnUInt8* pMask, const XnDepthPixel* pDepth)
+{
+	m_nComponents = 0;
+	m_Blobs.Resize(0);
+	if (m_Labels.empty() || pMask == NULL)
+		return 0;
+
+#pragma omp parallel for
+	for (int nBand = 0; nBand < (int)m_nBands; nBand++)
+		LabelBand(pMask, pDepth, nBand);
+
+	MergeBands(pMask);
+	Flatten();
+	Reduce();
+
+#pragma omp parallel for
+	for (int nBand = 0; nBand < (int)m_nBands; nBand++)
+		RelabelBand(pMask, nBand);
+
+	return m_Blobs.nCount;
+}
+
+void BlobLabeler::LabelBand(const XnUInt8* pMask, const XnDepthPixel* pDepth, XnUInt32 nBand)
+{
+	const XnUInt32 nXRes = m_nXRes;
+	const XnUInt32 nBegin = nBand*m_nBandHeight;
+	const XnUInt32 nEnd = nBegin + m_nBandHeight < m_nYRes ? nBegin + m_nBandHeight : m_nYRes;
+	XnUInt32 nNext = nBegin*m_nLabelsPerRow + 1;
+	XnUInt32* pLabels = &m_Labels[0];
+
+	for (XnUInt32 y = nBegin; y < nEnd; y++)
+	{
+		const XnUInt8* pMaskRow = pMask + y*nXRes;
+		XnUInt32* pLabelRow = pLabels + y*nXRes;
+		// the row above belongs to another band for the first row, MergeBands connects them
+		const XnUInt32* pUpRow = y > nBegin ? pLabelRow - nXRes : NULL;
+
+		for (XnUInt32 x = 0; x < nXRes; x++)
+		{
+			if (x + 8 <= nXRes && (x & 7) == 0 && IsEmptySpan(pMaskRow + x))
+			{
+				memset(pLabelRow + x, 0, 8*sizeof(XnUInt32));
+				x += 7;
+				continue;
+			}
+			if (pMaskRow[x] == 0)
+			{
+				pLabelRow[x] = 0;
+				continue;
+			}
+
+			XnUInt32 nLeft = x > 0 ? pLabelRow[x - 1] : 0;
+			XnUInt32 nUp = pUpRow != NULL ? pUpRow[x] : 0;
+			XnUInt32 nLabel;
+
+			if (nLeft == 0 && nUp == 0)
+			{
+				nLabel = nNext++;
+				m_Parents[nLabel] = nLabel;
+				m_Area[nLabel] = 0;
+				m_SumX[nLabel] = 0;
+				m_SumY[nLabel] = 0;
+				m_SumDepth[nLabel] = 0;
+				m_DepthCount[nLabel] = 0;
+				m_MinX[nLabel] = m_MaxX[nLabel] = (XnUInt16)x;
+				m_MinY[nLabel] = m_MaxY[nLabel] = (XnUInt16)y;
+				m_MinDepth[nLabel] = 0xffff;
+			}
+			else if (nLeft == 0)
+			{
+				nLabel = nUp;
+			}
+			else
+			{
+				nLabel = nLeft;
+				if (nUp != 0 && nUp != nLeft)
+					Union(nLeft, nUp);
+			}
+
+			pLabelRow[x] = nLabel;
+			m_Area[nLabel]++;
+			m_SumX[nLabel] += x;
+			m_SumY[nLabel] += y;
+			if (x < m_MinX[nLabel]) m_MinX[nLabel] = (XnUInt16)x;
+			if (x > m_MaxX[nLabel]) m_MaxX[nLabel] = (XnUInt16)x;
+			if (y > m_MaxY[nLabel]) m_MaxY[nLabel] = (XnUInt16)y;
+
+			XnDepthPixel nDepth = pDepth != NULL ? pDepth[y*nXRes + x] : 0;
+			if (nDepth != 0)
+			{
+				m_SumDepth[nLabel] += nDepth;
+				m_DepthCount[nLabel]++;
+				if (nDepth < m_MinDepth[nLabel]) m_MinDepth[nLabel] = nDepth;
+			}
+		}
+	}
+
+	m_BandEnd[nBand] = nNext;
+}
+
+void BlobLabeler::MergeBands(const XnUInt8* pMask)
+{
+	for (XnUInt32 nBand = 1; nBand < m_nBands; nBand++)
+	{
+		const XnUInt32 nRow = nBand*m_nBandHeight*m_nXRes;
+		for (XnUInt32 x = 0; x < m_nXRes; x++)
+		{
+			if (x + 8 <= m_nXRes && (x & 7) == 0 && IsEmptySpan(pMask + nRow + x))
+			{
+				x += 7;
+				continue;
+			}
+			if (pMask[nRow + x] != 0 && pMask[nRow + x - m_nXRes] != 0)
+				Union(m_Labels[nRow + x], m_Labels[nRow + x - m_nXRes]);
+		}
+	}
+}
+
+void BlobLabeler::Flatten()
+{
+	// a non root label always points to a smaller label, so walking the labels in increasing order
+	// finds the final label of the parent already written in m_Parents
+	XnUInt32 nComponents = 0;
+	for (XnUInt32 nBand = 0; nBand < m_nBands; nBand++)
+	{
+		for (XnUInt32 nLabel = nBand*m_nBandHeight*m_nLabelsPerRow + 1; nLabel < m_BandEnd[nBand]; nLabel++)
+		{
+			if (m_Parents[nLabel] == nLabel)
+				m_Parents[nLabel] = ++nComponents;
+			else
+				m_Parents[nLabel] = m_Parents[m_Parents[nLabel]];
+		}
+	}
+	m_nComponents = nComponents;
+}
+
+void BlobLabeler::Reduce()
+{
+	const XnUInt32 nSize = m_nComponents + 1;
+	m_Components.Resize(nSize);
+	m_ComponentSumX.assign(nSize, 0);
+	m_ComponentSumY.assign(nSize, 0);
+	m_ComponentSumDepth.assign(nSize, 0);
+	m_ComponentDepthCount.assign(nSize, 0);
+	for (XnUInt32 nComponent = 0; nComponent < nSize; nComponent++)
+	{
+		m_Components.nArea[nComponent] = 0;
+		m_Components.nMinDepth[nComponent] = 0xffff;
+	}
+
+	for (XnUInt32 nBand = 0; nBand < m_nBands; nBand++)
+	{
+		for (XnUInt32 nLabel = nBand*m_nBandHeight*m_nLabelsPerRow + 1; nLabel < m_BandEnd[nBand]; nLabel++)
+		{
+			XnUInt32 nComponent = m_Parents[nLabel];
+			if (m_Components.nArea[nComponent] == 0)
+			{
+				m_Components.nMinX[nComponent] = m_MinX[nLabel];
+				m_Components.nMinY[nComponent] = m_MinY[nLabel];
+				m_Components.nMaxX[nComponent] = m_MaxX[nLabel];
+				m_Components.nMaxY[nComponent] = m_MaxY[nLabel];
+			}
+			else
+			{
+				if (m_MinX[nLabel] < m_Components.nMinX[nComponent]) m_Components.nMinX[nComponent] = m_MinX[nLabel];
+				if (m_MinY[nLabel] < m_Components.nMinY[nComponent]) m_Components.nMinY[nComponent] = m_MinY[nLabel];
+				if (m_MaxX[nLabel] > m_Components.nMaxX[nComponent]) m_Components.nMaxX[nComponent] = m_MaxX[nLabel];
+				if (m_MaxY[nLabel] > m_Components.nMaxY[nComponent]) m_Components.nMaxY[nComponent] = m_MaxY[nLabel];
+			}
+			m_Components.nArea[nComponent] += m_Area[nLabel];
+			m_ComponentSumX[nComponent] += m_SumX[nLabel];
+			m_ComponentSumY[nComponent] += m_SumY[nLabel];
+			m_ComponentSumDepth[nComponent] += m_SumDepth[nLabel];
+			m_ComponentDepthCount[nComponent] += m_DepthCount[nLabel];
+			if (m_MinDepth[nLabel] < m_Components.nMinDepth[nComponent])
+				m_Components.nMinDepth[nComponent] = m_MinDepth[nLabel];
+		}
+	}
+
+	XnUInt32 nBlobs = 0;
+	m_Blobs.Resize(m_nComponents);
+	for (XnUInt32 nComponent = 1; nComponent < nSize; nComponent++)
+	{
+		XnUInt32 nArea = m_Components.nArea[nComponent];
+		if (nArea < m_nMinArea)
+			continue;
+
+		XnUInt32 nDepthCount = m_ComponentDepthCount[nComponent];
+		m_Blobs.nLabel[nBlobs] = nComponent;
+		m_Blobs.nArea[nBlobs] = nArea;
+		m_Blobs.nMinX[nBlobs] = m_Components.nMinX[nComponent];
+		m_Blobs.nMinY[nBlobs] = m_Components.nMinY[nComponent];
+		m_Blobs.nMaxX[nBlobs] = m_Components.nMaxX[nComponent];
+		m_Blobs.nMaxY[nBlobs] = m_Components.nMaxY[nComponent];
+		m_Blobs.fCenterX[nBlobs] = (XnFloat)m_ComponentSumX[nComponent] / nArea;
+		m_Blobs.fCenterY[nBlobs] = (XnFloat)m_ComponentSumY[nComponent] / nArea;
+		m_Blobs.nMinDepth[nBlobs] = nDepthCount ? m_Components.nMinDepth[nComponent] : 0;
+		m_Blobs.fMeanDepth[nBlobs] = nDepthCount ? (XnFloat)m_ComponentSumDepth[nComponent] / nDepthCount : 0;
+		nBlobs++;
+	}
+	m_Blobs.Resize(nBlobs);
+}
+
+void BlobLabeler::RelabelBand(const XnUInt8* pMask, XnUInt32 nBand)
+{
+	const XnUInt32 nBegin = nBand*m_nBandHeight*m_nXRes;
+	const XnUInt32 nEnd = (nBand + 1)*m_nBandHeight < m_nYRes ? (nBand + 1)*m_nBandHeight*m_nXRes : m_nYRes*m_nXRes;
+	XnUInt32* pLabels = &m_Labels[0];
+
+	for (XnUInt32 i = nBegin; i < nEnd; i++)
+	{
+		if (i + 8 <= nEnd && (i & 7) == 0 && IsEmptySpan(pMask + i))
+		{
+			i += 7;
+			continue;
+		}
+		if (pMask[i] != 0)
+			pLabels[i] = m_Parents[pLabels[i]];
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef _BlobLabeler
+#define _BlobLabeler
+
+#include <XnTypes.h>
+#include <vector>
+
+namespace Kinect
+{
+
+/// @brief Statistics of the labelled blobs, one entry per blob in every array.
+struct BlobStats
+{
+	XnUInt32 nCount;
+	std::vector<XnUInt32> nLabel;       ///< @brief value of the blob pixels in the label map
+	std::vector<XnUInt32> nArea;        ///< @brief number of pixels
+	std::vector<XnUInt16> nMinX, nMinY; ///< @brief bounding box (inclusive)
+	std::vector<XnUInt16> nMaxX, nMaxY;
+	std::vector<XnFloat> fCenterX;      ///< @brief centroid in pixels
+	std::vector<XnFloat> fCenterY;
+	std::vector<XnDepthPixel> nMinDepth; ///< @brief closest valid depth in mm, 0 when no depth
+	std::vector<XnFloat> fMeanDepth;    ///< @brief mean valid depth in mm
+
+	void Resize(XnUInt32 nSize);
+};
+
+/// @brief Two pass union-find connected component labeling (4 connectivity) of a binary mask.
+/// 
+/// The first pass labels row bands independently (in parallel when OpenMP is enabled), each band
+/// drawing provisional labels from its own range and accumulating the statistics per provisional
+/// label. The band boundaries are then merged, the equivalences flattened into consecutive labels
+/// and the statistics reduced per component. The second pass writes the final label map.
+class BlobLabeler
+{
+public:
+	BlobLabeler();
+
+	/// @brief Allocates the label map and tables. Must be called before the first Label.
+	/// @param nBandHeight rows per parallel band, the label ranges of the bands are laid out from it
+	void Init(XnUInt32 nXRes, XnUInt32 nYRes, XnUInt32 nBandHeight = 32);
+
+	/// @brief Labels the non zero pixels of pMask. pDepth is optional, used for the depth statistics.
+	/// @return number of blobs of at least m_nMinArea pixels
+	XnUInt32 Label(const XnUInt8* pMask, const XnDepthPixel* pDepth);
+
+	/// @brief Component label of every pixel, 0 for the background. Small components keep their label.
+	const XnUInt32* GetLabelMap() const { return m_Labels.empty() ? NULL : &m_Labels[0]; }
+	const BlobStats& GetBlobs() const { return m_Blobs; }
+	XnUInt32 GetComponentCount() const { return m_nComponents; }
+
+	XnUInt32 GetXRes() const { return m_nXRes; }
+	XnUInt32 GetYRes() const { return m_nYRes; }
+	XnUInt32 GetBandHeight() const { return m_nBandHeight; }
+
+	XnUInt32 m_nMinArea;      ///< @brief smaller components are not reported
+
+private:
+	void LabelBand(const XnUInt8* pMask, const XnDepthPixel* pDepth, XnUInt32 nBand);
+	void MergeBands(const XnUInt8* pMask);
+	void Flatten();
+	void Reduce();
+	void RelabelBand(const XnUInt8* pMask, XnUInt32 nBand);
+	XnUInt32 FindRoot(XnUInt32 nLabel);
+	void Union(XnUInt32 nLabel1, XnUInt32 nLabel2);
+
+	XnUInt32 m_nXRes;
+	XnUInt32 m_nYRes;
+	XnUInt32 m_nBandHeight;
+	XnUInt32 m_nBands;
+	XnUInt32 m_nLabelsPerRow;
+	XnUInt32 m_nComponents;
+
+	std::vector<XnUInt32> m_Labels;
+	std::vector<XnUInt32> m_Parents;
+	std::vector<XnUInt32> m_BandEnd;   ///< @brief next free provisional label of every band
+
+	// statistics per provisional label, each band only touches its own label range
+	std::vector<XnUInt32> m_Area;
+	std::vector<XnUInt32> m_SumX;
+	std::vector<XnUInt32> m_SumY;
+	std::vector<XnUInt64> m_SumDepth;   ///< @brief a band may hold a whole frame, 640x480 pixels of up to 65535 mm
+	std::vector<XnUInt32> m_DepthCount;
+	std::vector<XnUInt16> m_MinX, m_MinY, m_MaxX, m_MaxY;
+	std::vector<XnDepthPixel> m_MinDepth;
+
+	// statistics per component
+	std::vector<XnUInt64> m_ComponentSumX;
+	std::vector<XnUInt64> m_ComponentSumY;
+	std::vector<XnUInt64> m_ComponentSumDepth;
+	std::vector<XnUInt32> m_ComponentDepthCount;
+	BlobStats m_Components;
+	BlobStats m_Blobs;
+};
+
+}
+#endif
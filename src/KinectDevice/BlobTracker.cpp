@@ -0,0 +1,130 @@
+#include "BlobTracker.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace Kinect;
+
+BlobTracker::BlobTracker()
+{
+	m_fMaxDistance = 60.0f;
+	m_fMaxDepthGap = 300.0f;
+	m_fVelocitySmoothing = 0.5f;
+	m_nMaxMissedFrames = 5;
+	m_nNextID = 1;
+}
+
+void BlobTracker::Reset()
+{
+	m_Tracks.clear();
+	m_BlobTrack.clear();
+	m_nNextID = 1;
+}
+
+const TrackedBlob* BlobTracker::GetTrackOfBlob(XnUInt32 nBlob) const
+{
+	if (nBlob >= m_BlobTrack.size() || m_BlobTrack[nBlob] < 0)
+		return NULL;
+	return &m_Tracks[m_BlobTrack[nBlob]];
+}
+
+void BlobTracker::Update(const BlobStats& blobs)
+{
+	const XnFloat fMaxDistance2 = m_fMaxDistance*m_fMaxDistance;
+
+	// predicted positions
+	for (size_t nTrack = 0; nTrack < m_Tracks.size(); nTrack++)
+	{
+		TrackedBlob& track = m_Tracks[nTrack];
+		track.fX += track.fVelocityX;
+		track.fY += track.fVelocityY;
+		track.nBlob = -1;
+	}
+
+	// candidate pairs within the gates, closest first
+	m_Matches.clear();
+	for (XnUInt32 nTrack = 0; nTrack < m_Tracks.size(); nTrack++)
+	{
+		const TrackedBlob& track = m_Tracks[nTrack];
+		for (XnUInt32 nBlob = 0; nBlob < blobs.nCount; nBlob++)
+		{
+			XnFloat dx = blobs.fCenterX[nBlob] - track.fX;
+			XnFloat dy = blobs.fCenterY[nBlob] - track.fY;
+			Match match;
+			match.fDistance2 = dx*dx + dy*dy;
+			if (match.fDistance2 > fMaxDistance2)
+				continue;
+			if (track.fDepth > 0 && blobs.fMeanDepth[nBlob] > 0 && fabsf(blobs.fMeanDepth[nBlob] - track.fDepth) > m_fMaxDepthGap)
+				continue;
+			match.nTrack = nTrack;
+			match.nBlob = nBlob;
+			m_Matches.push_back(match);
+		}
+	}
+	std::sort(m_Matches.begin(), m_Matches.end());
+
+	m_BlobTrack.assign(blobs.nCount, -1);
+	m_TrackMatched.assign(m_Tracks.size(), 0);
+	for (size_t nMatch = 0; nMatch < m_Matches.size(); nMatch++)
+	{
+		const Match& match = m_Matches[nMatch];
+		if (m_TrackMatched[match.nTrack] || m_BlobTrack[match.nBlob] >= 0)
+			continue;
+		m_TrackMatched[match.nTrack] = 1;
+		m_BlobTrack[match.nBlob] = (XnInt32)match.nTrack;
+
+		TrackedBlob& track = m_Tracks[match.nTrack];
+		// the velocity is measured from the last matched position, over the frames the track coasted
+		XnFloat fFrames = (XnFloat)(track.nMissedFrames + 1);
+		XnFloat fPreviousX = track.fX - fFrames*track.fVelocityX;
+		XnFloat fPreviousY = track.fY - fFrames*track.fVelocityY;
+		XnFloat fX = blobs.fCenterX[match.nBlob];
+		XnFloat fY = blobs.fCenterY[match.nBlob];
+		track.fVelocityX += m_fVelocitySmoothing*((fX - fPreviousX)/fFrames - track.fVelocityX);
+		track.fVelocityY += m_fVelocitySmoothing*((fY - fPreviousY)/fFrames - track.fVelocityY);
+		track.fX = fX;
+		track.fY = fY;
+		track.fDepth = blobs.fMeanDepth[match.nBlob];
+		track.nArea = blobs.nArea[match.nBlob];
+		track.nBlob = (XnInt32)match.nBlob;
+		track.nAge++;
+		track.nMissedFrames = 0;
+	}
+
+	// tracks not seen for too long are dropped, the others coast
+	size_t nKept = 0;
+	for (size_t nTrack = 0; nTrack < m_Tracks.size(); nTrack++)
+	{
+		TrackedBlob& track = m_Tracks[nTrack];
+		if (!m_TrackMatched[nTrack])
+		{
+			track.nAge++;
+			if (++track.nMissedFrames > m_nMaxMissedFrames)
+				continue;
+		}
+		if (track.nBlob >= 0)
+			m_BlobTrack[track.nBlob] = (XnInt32)nKept;
+		m_Tracks[nKept++] = track;
+	}
+	m_Tracks.resize(nKept);
+
+	// new tracks for the unmatched blobs
+	for (XnUInt32 nBlob = 0; nBlob < blobs.nCount; nBlob++)
+	{
+		if (m_BlobTrack[nBlob] >= 0)
+			continue;
+
+		TrackedBlob track;
+		track.nID = m_nNextID++;
+		track.nBlob = (XnInt32)nBlob;
+		track.fX = blobs.fCenterX[nBlob];
+		track.fY = blobs.fCenterY[nBlob];
+		track.fDepth = blobs.fMeanDepth[nBlob];
+		track.fVelocityX = 0;
+		track.fVelocityY = 0;
+		track.nArea = blobs.nArea[nBlob];
+		track.nAge = 0;
+		track.nMissedFrames = 0;
+		m_BlobTrack[nBlob] = (XnInt32)m_Tracks.size();
+		m_Tracks.push_back(track);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef _BlobTracker
+#define _BlobTracker
+
+#include "BlobLabeler.h"
+
+namespace Kinect
+{
+
+/// @brief A blob followed from frame to frame.
+struct TrackedBlob
+{
+	XnUInt32 nID;             ///< @brief stable identifier, never reused
+	XnInt32 nBlob;            ///< @brief index in the BlobStats of the last Update, -1 when not seen this frame
+	XnFloat fX, fY;           ///< @brief centroid in pixels
+	XnFloat fDepth;           ///< @brief mean depth in mm
+	XnFloat fVelocityX;       ///< @brief pixels per frame
+	XnFloat fVelocityY;
+	XnUInt32 nArea;
+	XnUInt32 nAge;            ///< @brief frames since the blob appeared
+	XnUInt32 nMissedFrames;   ///< @brief consecutive frames without a match
+};
+
+/// @brief Assigns stable IDs to the blobs of consecutive frames.
+/// 
+/// Every track predicts its position with a constant velocity model, then the closest
+/// (track, blob) pairs within the distance and depth gates are matched greedily. Unmatched
+/// blobs start new tracks, unmatched tracks coast on their prediction and are dropped after
+/// m_nMaxMissedFrames frames.
+class BlobTracker
+{
+public:
+	BlobTracker();
+
+	void Reset();
+	void Update(const BlobStats& blobs);
+
+	const std::vector<TrackedBlob>& GetTracks() const { return m_Tracks; }
+
+	/// @brief The track matched with blob nBlob in the last Update, NULL if none.
+	const TrackedBlob* GetTrackOfBlob(XnUInt32 nBlob) const;
+
+	XnFloat m_fMaxDistance;        ///< @brief pixels between the prediction and the blob centroid
+	XnFloat m_fMaxDepthGap;        ///< @brief mm between the track and the blob mean depth
+	XnFloat m_fVelocitySmoothing;  ///< @brief weight of the new velocity measure
+	XnUInt32 m_nMaxMissedFrames;
+
+private:
+	struct Match
+	{
+		XnFloat fDistance2;
+		XnUInt32 nTrack;
+		XnUInt32 nBlob;
+		bool operator<(const Match& other) const { return fDistance2 < other.fDistance2; }
+	};
+
+	std::vector<TrackedBlob> m_Tracks;
+	std::vector<Match> m_Matches;
+	std::vector<XnInt32> m_BlobTrack;
+	std::vector<XnUInt8> m_TrackMatched;
+	XnUInt32 m_nNextID;
+};
+
+}
+#endif
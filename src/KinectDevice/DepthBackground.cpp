@@ -0,0 +1,186 @@
+#include "DepthBackground.h"
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define DEPTH_BACKGROUND_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace Kinect;
+
+static const XnInt16 INITIAL_NOISE = 4;
+
+DepthBackgroundModel::DepthBackgroundModel()
+{
+	m_nMinThreshold = 30;
+	m_nNoiseFactor = 3;
+	m_nDepthFactor = 16;
+	m_nLearningShift = 5;
+	m_nLearningFrames = 30;
+	m_nMinBlobArea = 200;
+
+	m_nXRes = 0;
+	m_nYRes = 0;
+	m_nFrames = 0;
+	m_nForegroundCount = 0;
+	m_pLastDepth = NULL;
+}
+
+void DepthBackgroundModel::Init(XnUInt32 nXRes, XnUInt32 nYRes)
+{
+	m_nXRes = nXRes;
+	m_nYRes = nYRes;
+	m_Background.assign(nXRes*nYRes, 0);
+	m_Noise.assign(nXRes*nYRes, INITIAL_NOISE);
+	m_Mask.assign(nXRes*nYRes, 0);
+	m_Labeler.Init(nXRes, nYRes);
+	Reset();
+}
+
+void DepthBackgroundModel::Reset()
+{
+	if (!m_Background.empty())
+	{
+		memset(&m_Background[0], 0, m_Background.size()*sizeof(XnInt16));
+		memset(&m_Mask[0], 0, m_Mask.size());
+		for (size_t i = 0; i < m_Noise.size(); i++)
+			m_Noise[i] = INITIAL_NOISE;
+	}
+	m_nFrames = 0;
+	m_nForegroundCount = 0;
+	m_pLastDepth = NULL;
+	m_Blobs.clear();
+}
+
+void DepthBackgroundModel::Update(const XnDepthPixel* pDepth)
+{
+	if (m_Background.empty() || pDepth == NULL)
+		return;
+
+	m_nForegroundCount = 0;
+	UpdateRows(pDepth, 0, m_nYRes);
+	m_pLastDepth = pDepth;
+	m_nFrames++;
+}
+
+void DepthBackgroundModel::UpdateRows(const XnDepthPixel* pDepth, XnUInt32 nBegin, XnUInt32 nEnd)
+{
+	const XnBool bLearning = IsLearning();
+	const XnUInt32 nEndIndex = nEnd*m_nXRes;
+	XnUInt32 i = nBegin*m_nXRes;
+	XnUInt32 nForeground = 0;
+
+	XnInt16* pBackground = &m_Background[0];
+	XnInt16* pNoise = &m_Noise[0];
+	XnUInt8* pMask = &m_Mask[0];
+
+#if DEPTH_BACKGROUND_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i minThreshold = _mm_set1_epi16((short)m_nMinThreshold);
+	const __m128i noiseFactor = _mm_set1_epi16((short)m_nNoiseFactor);
+	const __m128i depthFactor = _mm_set1_epi16((short)(m_nDepthFactor << 6)); // mulhi: (bg * factor * 64) >> 16 = bg * factor / 1024
+	const __m128i initialNoise = _mm_set1_epi16(INITIAL_NOISE);
+	const __m128i learningMask = bLearning ? zero : _mm_set1_epi16(-1);
+	const __m128i shift = _mm_cvtsi32_si128(m_nLearningShift);
+
+	for (; i + 8 <= nEndIndex; i += 8)
+	{
+		// Kinect depth never exceeds 15 bits, signed 16 bits lanes are safe
+		__m128i depth = _mm_loadu_si128((const __m128i*)(pDepth + i));
+		__m128i background = _mm_loadu_si128((const __m128i*)(pBackground + i));
+		__m128i noise = _mm_loadu_si128((const __m128i*)(pNoise + i));
+
+		__m128i valid = _mm_cmpgt_epi16(depth, zero);
+		__m128i backgroundValid = _mm_cmpgt_epi16(background, zero);
+		__m128i diff = _mm_sub_epi16(depth, background);
+
+		__m128i threshold = _mm_adds_epu16(minThreshold, _mm_mullo_epi16(noise, noiseFactor));
+		threshold = _mm_adds_epu16(threshold, _mm_mulhi_epu16(background, depthFactor));
+
+		// closer than the background: foreground
+		__m128i foreground = _mm_and_si128(_mm_and_si128(valid, backgroundValid), _mm_cmpgt_epi16(_mm_sub_epi16(background, depth), threshold));
+		// farther than the background (or no background yet): the background was hidden, take the new depth
+		__m128i behind = _mm_and_si128(valid, _mm_or_si128(_mm_andnot_si128(backgroundValid, _mm_set1_epi16(-1)), _mm_cmpgt_epi16(diff, threshold)));
+		// within the threshold: running average of the depth and of the noise
+		__m128i match = _mm_andnot_si128(_mm_or_si128(foreground, behind), _mm_and_si128(valid, backgroundValid));
+
+		__m128i absDiff = _mm_max_epi16(diff, _mm_sub_epi16(zero, diff));
+		__m128i averaged = _mm_add_epi16(background, _mm_sra_epi16(diff, shift));
+		__m128i averagedNoise = _mm_add_epi16(noise, _mm_sra_epi16(_mm_sub_epi16(absDiff, noise), shift));
+
+		__m128i keep = _mm_andnot_si128(_mm_or_si128(match, behind), _mm_set1_epi16(-1));
+		background = _mm_or_si128(_mm_or_si128(_mm_and_si128(match, averaged), _mm_and_si128(behind, depth)), _mm_and_si128(keep, background));
+		noise = _mm_or_si128(_mm_or_si128(_mm_and_si128(match, averagedNoise), _mm_and_si128(behind, initialNoise)), _mm_and_si128(keep, noise));
+
+		_mm_storeu_si128((__m128i*)(pBackground + i), background);
+		_mm_storeu_si128((__m128i*)(pNoise + i), noise);
+
+		__m128i mask = _mm_packs_epi16(_mm_and_si128(foreground, learningMask), zero);
+		_mm_storel_epi64((__m128i*)(pMask + i), mask);
+
+		int bits = _mm_movemask_epi8(mask) & 0xff;
+		for (; bits != 0; bits &= bits - 1)
+			nForeground++;
+	}
+#endif
+
+	for (; i < nEndIndex; i++)
+	{
+		XnInt16 depth = (XnInt16)pDepth[i];
+		XnInt16 background = pBackground[i];
+		XnInt16 noise = pNoise[i];
+		pMask[i] = 0;
+
+		if (depth <= 0)
+			continue;
+
+		XnInt32 threshold = m_nMinThreshold + noise*m_nNoiseFactor + ((background*m_nDepthFactor) >> 10);
+		XnInt32 diff = depth - background;
+
+		if (background <= 0 || diff > threshold)
+		{
+			pBackground[i] = depth;
+			pNoise[i] = INITIAL_NOISE;
+		}
+		else if (-diff > threshold)
+		{
+			if (!bLearning)
+			{
+				pMask[i] = 255;
+				nForeground++;
+			}
+		}
+		else
+		{
+			XnInt32 absDiff = diff < 0 ? -diff : diff;
+			pBackground[i] = (XnInt16)(background + (diff >> m_nLearningShift));
+			pNoise[i] = (XnInt16)(noise + ((absDiff - noise) >> m_nLearningShift));
+		}
+	}
+
+	m_nForegroundCount += nForeground;
+}
+
+void DepthBackgroundModel::ExtractBlobs()
+{
+	if (m_Mask.empty())
+		return;
+
+	m_Labeler.m_nMinArea = m_nMinBlobArea;
+	m_Labeler.Label(&m_Mask[0], m_pLastDepth);
+
+	const BlobStats& stats = m_Labeler.GetBlobs();
+	m_Blobs.resize(stats.nCount);
+	for (XnUInt32 i = 0; i < stats.nCount; i++)
+	{
+		DepthBlob& blob = m_Blobs[i];
+		blob.nArea = stats.nArea[i];
+		blob.nMinX = stats.nMinX[i];
+		blob.nMinY = stats.nMinY[i];
+		blob.nMaxX = stats.nMaxX[i];
+		blob.nMaxY = stats.nMaxY[i];
+		blob.fCenterX = stats.fCenterX[i];
+		blob.fCenterY = stats.fCenterY[i];
+		blob.fMeanDepth = stats.fMeanDepth[i];
+	}
+}
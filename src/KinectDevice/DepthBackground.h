@@ -0,0 +1,84 @@
+#ifndef _DepthBackground
+#define _DepthBackground
+
+#include <XnTypes.h>
+#include <vector>
+#include "BlobLabeler.h"
+
+namespace Kinect
+{
+
+/// @brief A connected group of foreground pixels, a copy of one entry of GetBlobStats.
+struct DepthBlob
+{
+	XnUInt32 nArea;                        ///< @brief number of pixels
+	XnUInt16 nMinX, nMinY, nMaxX, nMaxY;   ///< @brief bounding box (inclusive)
+	XnFloat fCenterX, fCenterY;            ///< @brief centroid in pixels
+	XnFloat fMeanDepth;                    ///< @brief mean depth in mm
+};
+
+/// @brief Per pixel background model over the depth stream.
+/// 
+/// The background is the farthest depth seen consistently at each pixel. It follows slow
+/// changes with an integer running average, jumps back as soon as something farther is seen
+/// (foreground present while learning), and keeps a per pixel noise estimate. A pixel is
+/// foreground when it is closer than the background by more than a noise adaptive threshold:
+/// minThreshold + noiseFactor * noise + background * depthFactor / 1024.
+/// 
+/// Unlike the xn::UserGenerator labels it needs no NITE and segments any object.
+class DepthBackgroundModel
+{
+public:
+	DepthBackgroundModel();
+
+	/// @brief Allocates the model. Must be called before the first Update.
+	void Init(XnUInt32 nXRes, XnUInt32 nYRes);
+
+	/// @brief Forgets the background, the next frames are used to learn it again.
+	void Reset();
+
+	/// @brief Updates the model with a new depth frame and computes the foreground mask.
+	void Update(const XnDepthPixel* pDepth);
+
+	/// @brief Labels the foreground mask into blobs of at least m_nMinBlobArea pixels.
+	void ExtractBlobs();
+
+	/// @brief 255 for foreground pixels, 0 otherwise.
+	const XnUInt8* GetForegroundMask() const { return m_Mask.empty() ? NULL : &m_Mask[0]; }
+	const XnDepthPixel* GetBackground() const { return m_Background.empty() ? NULL : (const XnDepthPixel*)&m_Background[0]; }
+	/// @brief The blobs one struct each, GetBlobStats has them one array per field.
+	const std::vector<DepthBlob>& GetBlobs() const { return m_Blobs; }
+	const BlobStats& GetBlobStats() const { return m_Labeler.GetBlobs(); }
+	BlobLabeler& GetLabeler() { return m_Labeler; }
+	XnUInt32 GetForegroundCount() const { return m_nForegroundCount; }
+	XnBool IsLearning() const { return m_nFrames < m_nLearningFrames; }
+
+	XnUInt32 GetXRes() const { return m_nXRes; }
+	XnUInt32 GetYRes() const { return m_nYRes; }
+
+	XnUInt16 m_nMinThreshold;     ///< @brief mm, lower bound of the foreground threshold
+	XnUInt16 m_nNoiseFactor;      ///< @brief multiplier of the noise estimate
+	XnUInt16 m_nDepthFactor;      ///< @brief depth proportional part of the threshold, in 1/1024
+	XnUInt16 m_nLearningShift;    ///< @brief running average rate is 1/2^shift
+	XnUInt32 m_nLearningFrames;   ///< @brief frames with no foreground output after a reset
+	XnUInt32 m_nMinBlobArea;      ///< @brief smaller blobs are dropped
+
+private:
+	void UpdateRows(const XnDepthPixel* pDepth, XnUInt32 nBegin, XnUInt32 nEnd);
+
+	XnUInt32 m_nXRes;
+	XnUInt32 m_nYRes;
+	XnUInt32 m_nFrames;
+	XnUInt32 m_nForegroundCount;
+	const XnDepthPixel* m_pLastDepth;
+
+	std::vector<XnInt16> m_Background;   ///< @brief depth fits in 15 bits so the SIMD pass can use signed arithmetic
+	std::vector<XnInt16> m_Noise;
+	std::vector<XnUInt8> m_Mask;
+
+	BlobLabeler m_Labeler;
+	std::vector<DepthBlob> m_Blobs;
+};
+
+}
+#endif
@@ -0,0 +1,491 @@
+#include "DepthFilter.h"
+#include "Chrono.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define DEPTH_FILTER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace Kinect;
+
+// 25 comparators sorting network for 9 values
+static const int s_SortNetwork[25][2] =
+{
+	{0,1},{3,4},{6,7},{1,2},{4,5},{7,8},{0,1},{3,4},{6,7},{0,3},{3,6},{0,3},{1,4},
+	{4,7},{1,4},{2,5},{5,8},{2,5},{1,3},{5,7},{2,6},{4,6},{2,4},{2,3},{5,6}
+};
+
+static const XnFloat MIN_RANGE_SIGMA = 2.0f;
+
+DepthFilter::DepthFilter()
+{
+	m_bBypass = FALSE;
+	m_bScalar = FALSE;
+	m_bHoleFill = TRUE;
+	m_bBilateral = TRUE;
+	m_bTemporal = TRUE;
+
+	m_nMinValidNeighbours = 4;
+	m_fSpatialSigma = 1.5f;
+	m_fRangeSigma = 6.0f;
+	m_fTemporalAlpha = 0.4f;
+	m_fMotionGate = 0.03f;
+	m_nHoleHoldFrames = 3;
+	m_fBudget = 10.0;
+	m_nBandHeight = 32;
+
+	m_nXRes = 0;
+	m_nYRes = 0;
+	m_nFrames = 0;
+	m_fKernelSigma = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void DepthFilter::Init(XnUInt32 nXRes, XnUInt32 nYRes)
+{
+	m_nXRes = nXRes;
+	m_nYRes = nYRes;
+	m_Buffer[0].assign(nXRes*nYRes, 0);
+	m_Buffer[1].assign(nXRes*nYRes, 0);
+	m_Output.assign(nXRes*nYRes, 0);
+	m_TemporalDepth.assign(nXRes*nYRes, 0.0f);
+	m_TemporalAge.assign(nXRes*nYRes, 0.0f);
+	Reset();
+}
+
+void DepthFilter::Reset()
+{
+	if (!m_TemporalDepth.empty())
+	{
+		memset(&m_TemporalDepth[0], 0, m_TemporalDepth.size()*sizeof(XnFloat));
+		memset(&m_TemporalAge[0], 0, m_TemporalAge.size()*sizeof(XnFloat));
+	}
+	m_nFrames = 0;
+	m_fHoleFillCost = 0;
+	m_fBilateralCost = 0;
+	m_fTemporalCost = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void DepthFilter::UpdateSpatialKernel()
+{
+	if (m_fKernelSigma == m_fSpatialSigma)
+		return;
+
+	m_fKernelSigma = m_fSpatialSigma;
+	for (int dy = -2; dy <= 2; dy++)
+	{
+		for (int dx = -2; dx <= 2; dx++)
+		{
+			m_SpatialKernel[(dy+2)*5 + dx+2] = expf(-(dx*dx + dy*dy) / (2.0f*m_fSpatialSigma*m_fSpatialSigma));
+		}
+	}
+}
+
+static XnUInt32 CountHoles(const XnDepthPixel* pDepth, XnUInt32 nCount)
+{
+	XnUInt32 nHoles = 0;
+	XnUInt32 i = 0;
+#if DEPTH_FILTER_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= nCount; i += 8)
+	{
+		__m128i holes = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(pDepth + i)), zero);
+		int bits = _mm_movemask_epi8(holes);
+		for (; bits != 0; bits &= bits - 1)
+			nHoles++;
+	}
+	nHoles /= 2; // two mask bits per 16 bits lane
+#endif
+	for (; i < nCount; i++)
+	{
+		if (pDepth[i] == 0)
+			nHoles++;
+	}
+	return nHoles;
+}
+
+XnBool DepthFilter::FitsInBudget(XnDouble fElapsed, XnDouble fAverageCost)
+{
+	if (fElapsed + fAverageCost <= m_fBudget)
+		return TRUE;
+	m_Stats.nSkippedStages++;
+	return FALSE;
+}
+
+void DepthFilter::Process(const XnDepthPixel* pInput, XnDepthPixel* pOutput)
+{
+	const XnUInt32 nCount = m_nXRes*m_nYRes;
+	if (m_bBypass || nCount == 0)
+	{
+		if (pInput != pOutput)
+			memcpy(pOutput, pInput, nCount*sizeof(XnDepthPixel));
+		return;
+	}
+
+	UpdateSpatialKernel();
+
+	Chrono chrono(true);
+	m_Stats.nSkippedStages = 0;
+	m_Stats.fHoleFillTime = m_Stats.fBilateralTime = m_Stats.fTemporalTime = 0;
+	m_Stats.nHolesIn = CountHoles(pInput, nCount);
+
+	const int nBands = (int)((m_nYRes + m_nBandHeight - 1) / m_nBandHeight);
+	const XnDepthPixel* pSource = pInput;
+	int nTarget = 0;
+	XnDouble fStart;
+
+	if (m_bHoleFill && FitsInBudget(chrono.getPreciseTimeElapsed(), m_fHoleFillCost))
+	{
+		fStart = chrono.getPreciseTimeElapsed();
+		XnDepthPixel* pTarget = &m_Buffer[nTarget][0];
+#pragma omp parallel for
+		for (int nBand = 0; nBand < nBands; nBand++)
+		{
+			XnUInt32 nBegin = nBand*m_nBandHeight;
+			XnUInt32 nEnd = nBegin + m_nBandHeight < m_nYRes ? nBegin + m_nBandHeight : m_nYRes;
+			HoleFillRows(pSource, pTarget, nBegin, nEnd);
+		}
+		pSource = pTarget;
+		nTarget ^= 1;
+		m_Stats.fHoleFillTime = chrono.getPreciseTimeElapsed() - fStart;
+		m_fHoleFillCost = m_fHoleFillCost ? 0.9*m_fHoleFillCost + 0.1*m_Stats.fHoleFillTime : m_Stats.fHoleFillTime;
+	}
+
+	if (m_bBilateral && FitsInBudget(chrono.getPreciseTimeElapsed(), m_fBilateralCost))
+	{
+		fStart = chrono.getPreciseTimeElapsed();
+		XnDepthPixel* pTarget = &m_Buffer[nTarget][0];
+#pragma omp parallel for
+		for (int nBand = 0; nBand < nBands; nBand++)
+		{
+			XnUInt32 nBegin = nBand*m_nBandHeight;
+			XnUInt32 nEnd = nBegin + m_nBandHeight < m_nYRes ? nBegin + m_nBandHeight : m_nYRes;
+			BilateralRows(pSource, pTarget, nBegin, nEnd);
+		}
+		pSource = pTarget;
+		nTarget ^= 1;
+		m_Stats.fBilateralTime = chrono.getPreciseTimeElapsed() - fStart;
+		m_fBilateralCost = m_fBilateralCost ? 0.9*m_fBilateralCost + 0.1*m_Stats.fBilateralTime : m_Stats.fBilateralTime;
+	}
+
+	if (m_bTemporal && FitsInBudget(chrono.getPreciseTimeElapsed(), m_fTemporalCost))
+	{
+		// the temporal stage is pointwise, it can write straight into the output
+		fStart = chrono.getPreciseTimeElapsed();
+		XnFloat fNoise = 0;
+		XnUInt32 nStill = 0;
+#pragma omp parallel for reduction(+:fNoise, nStill)
+		for (int nBand = 0; nBand < nBands; nBand++)
+		{
+			XnUInt32 nBegin = nBand*m_nBandHeight;
+			XnUInt32 nEnd = nBegin + m_nBandHeight < m_nYRes ? nBegin + m_nBandHeight : m_nYRes;
+			XnUInt32 nBandStill = 0;
+			fNoise += TemporalRows(pSource, pOutput, nBegin, nEnd, &nBandStill);
+			nStill += nBandStill;
+		}
+		pSource = pOutput;
+		m_Stats.fTemporalNoise = nStill ? fNoise / nStill : 0;
+		m_Stats.fTemporalTime = chrono.getPreciseTimeElapsed() - fStart;
+		m_fTemporalCost = m_fTemporalCost ? 0.9*m_fTemporalCost + 0.1*m_Stats.fTemporalTime : m_Stats.fTemporalTime;
+	}
+
+	if (pSource != pOutput)
+		memcpy(pOutput, pSource, nCount*sizeof(XnDepthPixel));
+
+	m_Stats.nHolesOut = CountHoles(pOutput, nCount);
+	m_Stats.fTotalTime = chrono.getPreciseTimeElapsed();
+	m_nFrames++;
+}
+
+const XnDepthPixel* DepthFilter::Process(const XnDepthPixel* pInput)
+{
+	if (m_Output.empty())
+		return NULL;
+	Process(pInput, &m_Output[0]);
+	return &m_Output[0];
+}
+
+void DepthFilter::HoleFillRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd)
+{
+	const XnUInt32 nXRes = m_nXRes;
+	for (XnUInt32 y = nBegin; y < nEnd; y++)
+	{
+		const XnDepthPixel* pRow = pInput + y*nXRes;
+		XnDepthPixel* pOut = pOutput + y*nXRes;
+
+		// border rows and columns are not filled
+		if (y == 0 || y == m_nYRes - 1)
+		{
+			memcpy(pOut, pRow, nXRes*sizeof(XnDepthPixel));
+			continue;
+		}
+		pOut[0] = pRow[0];
+		pOut[nXRes - 1] = pRow[nXRes - 1];
+
+		XnUInt32 x = 1;
+#if DEPTH_FILTER_USE_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i hole = _mm_set1_epi16(0x7fff);
+		const __m128i nine = _mm_set1_epi16(9);
+		for (; !m_bScalar && x + 8 <= nXRes - 1; x += 8)
+		{
+			__m128i center = _mm_loadu_si128((const __m128i*)(pRow + x));
+			__m128i centerHoles = _mm_cmpeq_epi16(center, zero);
+			if (_mm_movemask_epi8(centerHoles) == 0)
+			{
+				_mm_storeu_si128((__m128i*)(pOut + x), center);
+				continue;
+			}
+
+			// holes sort last, the median of the valid values is then at (nValid - 1) / 2
+			__m128i v[9];
+			__m128i nValid = nine;
+			for (int k = 0; k < 9; k++)
+			{
+				const XnDepthPixel* p = pRow + (k/3 - 1)*(int)nXRes + (int)x + (k%3 - 1);
+				__m128i value = _mm_loadu_si128((const __m128i*)p);
+				__m128i isHole = _mm_cmpeq_epi16(value, zero);
+				nValid = _mm_add_epi16(nValid, isHole);
+				v[k] = _mm_or_si128(value, _mm_and_si128(isHole, hole));
+			}
+			for (int k = 0; k < 25; k++)
+			{
+				__m128i a = v[s_SortNetwork[k][0]];
+				__m128i b = v[s_SortNetwork[k][1]];
+				v[s_SortNetwork[k][0]] = _mm_min_epi16(a, b);
+				v[s_SortNetwork[k][1]] = _mm_max_epi16(a, b);
+			}
+
+			__m128i filled = zero;
+			for (XnUInt32 n = m_nMinValidNeighbours > 0 ? m_nMinValidNeighbours : 1; n <= 9; n++)
+			{
+				__m128i select = _mm_cmpeq_epi16(nValid, _mm_set1_epi16((short)n));
+				filled = _mm_or_si128(filled, _mm_and_si128(select, v[(n - 1)/2]));
+			}
+
+			__m128i result = _mm_or_si128(_mm_andnot_si128(centerHoles, center), _mm_and_si128(centerHoles, filled));
+			_mm_storeu_si128((__m128i*)(pOut + x), result);
+		}
+#endif
+		for (; x < nXRes - 1; x++)
+		{
+			if (pRow[x] != 0)
+			{
+				pOut[x] = pRow[x];
+				continue;
+			}
+
+			XnDepthPixel values[9];
+			XnUInt32 nValid = 0;
+			for (int k = 0; k < 9; k++)
+			{
+				XnDepthPixel value = pRow[(k/3 - 1)*(int)nXRes + (int)x + (k%3 - 1)];
+				if (value != 0)
+					values[nValid++] = value;
+			}
+			pOut[x] = 0;
+			if (nValid == 0 || nValid < m_nMinValidNeighbours)
+				continue;
+
+			// insertion sort, at most 8 values
+			for (XnUInt32 i = 1; i < nValid; i++)
+			{
+				XnDepthPixel value = values[i];
+				XnUInt32 j = i;
+				for (; j > 0 && values[j - 1] > value; j--)
+					values[j] = values[j - 1];
+				values[j] = value;
+			}
+			pOut[x] = values[(nValid - 1)/2];
+		}
+	}
+}
+
+void DepthFilter::BilateralRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd)
+{
+	const XnUInt32 nXRes = m_nXRes;
+	const XnFloat fRangeScale = m_fRangeSigma / 1e6f; // sigma = m_fRangeSigma * (depth in m)^2
+
+	for (XnUInt32 y = nBegin; y < nEnd; y++)
+	{
+		const XnDepthPixel* pRow = pInput + y*nXRes;
+		XnDepthPixel* pOut = pOutput + y*nXRes;
+
+		if (y < 2 || y + 2 >= m_nYRes)
+		{
+			memcpy(pOut, pRow, nXRes*sizeof(XnDepthPixel));
+			continue;
+		}
+		pOut[0] = pRow[0];
+		pOut[1] = pRow[1];
+		pOut[nXRes - 2] = pRow[nXRes - 2];
+		pOut[nXRes - 1] = pRow[nXRes - 1];
+
+		XnUInt32 x = 2;
+#if DEPTH_FILTER_USE_SSE2
+		const __m128i zeroi = _mm_setzero_si128();
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 rangeScale = _mm_set1_ps(fRangeScale);
+		const __m128 minSigma = _mm_set1_ps(MIN_RANGE_SIGMA);
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; !m_bScalar && x + 4 <= nXRes - 2; x += 4)
+		{
+			__m128 center = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(pRow + x)), zeroi));
+			__m128 centerValid = _mm_cmpgt_ps(center, zero);
+			if (_mm_movemask_ps(centerValid) == 0)
+			{
+				_mm_storel_epi64((__m128i*)(pOut + x), zeroi);
+				continue;
+			}
+
+			__m128 sigma = _mm_max_ps(_mm_mul_ps(_mm_mul_ps(center, center), rangeScale), minSigma);
+			__m128 invSigma2 = _mm_div_ps(one, _mm_mul_ps(sigma, sigma));
+			__m128 sumWeight = zero;
+			__m128 sumDepth = zero;
+
+			for (int k = 0; k < 25; k++)
+			{
+				const XnDepthPixel* p = pRow + (k/5 - 2)*(int)nXRes + (int)x + (k%5 - 2);
+				__m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p), zeroi));
+				__m128 dz = _mm_sub_ps(value, center);
+				// 1 / (1 + dz^2 / sigma^2) range weight, cheaper than a gaussian and as edge preserving;
+				// a true division, not _mm_rcp_ps, so that the lanes match the scalar loop
+				__m128 weight = _mm_div_ps(_mm_set1_ps(m_SpatialKernel[k]), _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(dz, dz), invSigma2)));
+				weight = _mm_and_ps(weight, _mm_cmpgt_ps(value, zero));
+				sumWeight = _mm_add_ps(sumWeight, weight);
+				sumDepth = _mm_add_ps(sumDepth, _mm_mul_ps(weight, value));
+			}
+
+			// the center weight is never 0 for a valid center
+			__m128 result = _mm_and_ps(_mm_div_ps(sumDepth, _mm_max_ps(sumWeight, _mm_set1_ps(1e-6f))), centerValid);
+			// rounded half up like the scalar loop, not to even
+			__m128i packed = _mm_cvttps_epi32(_mm_add_ps(result, half));
+			packed = _mm_packs_epi32(packed, packed);
+			_mm_storel_epi64((__m128i*)(pOut + x), packed);
+		}
+#endif
+		for (; x < nXRes - 2; x++)
+		{
+			XnFloat center = pRow[x];
+			if (center == 0)
+			{
+				pOut[x] = 0;
+				continue;
+			}
+
+			XnFloat sigma = center*center*fRangeScale;
+			if (sigma < MIN_RANGE_SIGMA)
+				sigma = MIN_RANGE_SIGMA;
+			XnFloat invSigma2 = 1.0f / (sigma*sigma);
+			XnFloat sumWeight = 0, sumDepth = 0;
+
+			for (int k = 0; k < 25; k++)
+			{
+				XnFloat value = pRow[(k/5 - 2)*(int)nXRes + (int)x + (k%5 - 2)];
+				if (value == 0)
+					continue;
+				XnFloat dz = value - center;
+				XnFloat weight = m_SpatialKernel[k] / (1.0f + dz*dz*invSigma2);
+				sumWeight += weight;
+				sumDepth += weight*value;
+			}
+			pOut[x] = (XnDepthPixel)(sumDepth / sumWeight + 0.5f);
+		}
+	}
+}
+
+XnFloat DepthFilter::TemporalRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd, XnUInt32* pnStill)
+{
+	const XnUInt32 nEndIndex = nEnd*m_nXRes;
+	XnUInt32 i = nBegin*m_nXRes;
+	XnFloat* pState = &m_TemporalDepth[0];
+	XnFloat* pAge = &m_TemporalAge[0];
+	XnFloat fNoise = 0;
+	XnUInt32 nStill = 0;
+
+#if DEPTH_FILTER_USE_SSE2
+	const __m128i zeroi = _mm_setzero_si128();
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 alpha = _mm_set1_ps(m_fTemporalAlpha);
+	const __m128 gate = _mm_set1_ps(m_fMotionGate);
+	const __m128 holdFrames = _mm_set1_ps((XnFloat)m_nHoleHoldFrames);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 noise = zero;
+	__m128i stillCount = zeroi;
+
+	for (; !m_bScalar && i + 4 <= nEndIndex; i += 4)
+	{
+		__m128 depth = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(pInput + i)), zeroi));
+		__m128 state = _mm_loadu_ps(pState + i);
+		__m128 age = _mm_loadu_ps(pAge + i);
+
+		__m128 valid = _mm_cmpgt_ps(depth, zero);
+		__m128 stateValid = _mm_cmpgt_ps(state, zero);
+		__m128 delta = _mm_sub_ps(depth, state);
+		__m128 absDelta = _mm_and_ps(delta, absMask);
+		__m128 still = _mm_and_ps(_mm_and_ps(valid, stateValid), _mm_cmple_ps(absDelta, _mm_mul_ps(gate, state)));
+
+		// still: average, moving or new: restart from the new depth, hole: hold the state for a few frames
+		__m128 averaged = _mm_add_ps(state, _mm_mul_ps(alpha, delta));
+		__m128 held = _mm_and_ps(state, _mm_cmplt_ps(age, holdFrames));
+		__m128 result = _mm_or_ps(_mm_and_ps(still, averaged), _mm_andnot_ps(still, depth));
+		result = _mm_or_ps(_mm_and_ps(valid, result), _mm_andnot_ps(valid, held));
+
+		age = _mm_andnot_ps(valid, _mm_add_ps(age, one));
+		noise = _mm_add_ps(noise, _mm_and_ps(still, _mm_and_ps(_mm_sub_ps(result, state), absMask)));
+		stillCount = _mm_sub_epi32(stillCount, _mm_castps_si128(still));
+
+		_mm_storeu_ps(pState + i, result);
+		_mm_storeu_ps(pAge + i, age);
+		__m128i packed = _mm_cvttps_epi32(_mm_add_ps(result, half));
+		_mm_storel_epi64((__m128i*)(pOutput + i), _mm_packs_epi32(packed, packed));
+	}
+
+	XnFloat lanes[4];
+	_mm_storeu_ps(lanes, noise);
+	fNoise = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	XnUInt32 stillLanes[4];
+	_mm_storeu_si128((__m128i*)stillLanes, stillCount);
+	nStill = stillLanes[0] + stillLanes[1] + stillLanes[2] + stillLanes[3];
+#endif
+
+	for (; i < nEndIndex; i++)
+	{
+		XnFloat depth = pInput[i];
+		XnFloat state = pState[i];
+		XnFloat result;
+
+		if (depth > 0)
+		{
+			XnFloat delta = depth - state;
+			if (state > 0 && fabsf(delta) <= m_fMotionGate*state)
+			{
+				result = state + m_fTemporalAlpha*delta;
+				fNoise += fabsf(result - state);
+				nStill++;
+			}
+			else
+			{
+				result = depth;
+			}
+			pAge[i] = 0;
+		}
+		else
+		{
+			result = pAge[i] < m_nHoleHoldFrames ? state : 0;
+			pAge[i] += 1;
+		}
+
+		pState[i] = result;
+		pOutput[i] = (XnDepthPixel)(result + 0.5f);
+	}
+
+	*pnStill = nStill;
+	return fNoise;
+}
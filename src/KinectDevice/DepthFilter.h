@@ -0,0 +1,95 @@
+#ifndef _DepthFilter
+#define _DepthFilter
+
+#include <XnTypes.h>
+#include <vector>
+
+namespace Kinect
+{
+
+/// @brief Timing (ms) and quality figures of the last filtered frame.
+struct DepthFilterStats
+{
+	XnDouble fHoleFillTime;
+	XnDouble fBilateralTime;
+	XnDouble fTemporalTime;
+	XnDouble fTotalTime;
+	XnUInt32 nHolesIn;          ///< @brief zero depth pixels before filtering
+	XnUInt32 nHolesOut;         ///< @brief zero depth pixels after filtering
+	XnFloat fTemporalNoise;     ///< @brief mean absolute frame to frame change (mm) of the static pixels
+	XnUInt32 nSkippedStages;    ///< @brief stages dropped to stay within the budget
+};
+
+/// @brief Denoising stage applied to the raw depth map before it is parsed.
+/// 
+/// Three stages, each one can be disabled:
+/// - hole filling: a zero pixel takes the median of the valid pixels of its 3x3 neighbourhood
+/// - bilateral: 5x5 spatial gaussian with a depth dependent range weight, keeps object edges
+/// - temporal: exponential average with motion gating, the average restarts when the depth
+///   moves by more than the gate, holes keep the last depth for a few frames
+/// 
+/// Every stage works on row bands (split across threads when OpenMP is enabled) with SSE2
+/// inner loops. A stage is skipped when its average cost would exceed the frame budget.
+///
+/// The SSE2 loops give the exact output of the scalar ones (m_bScalar) for depths below 32768,
+/// as long as the compiler does not contract the float operations into FMAs.
+class DepthFilter
+{
+public:
+	DepthFilter();
+
+	void Init(XnUInt32 nXRes, XnUInt32 nYRes);
+	void Reset();
+
+	/// @brief Filters pInput into pOutput. Both may point to the same buffer.
+	void Process(const XnDepthPixel* pInput, XnDepthPixel* pOutput);
+	/// @brief Filters pInput into a buffer of the filter, the input is left untouched.
+	/// @return the filtered map, valid until the next Process, NULL before Init
+	const XnDepthPixel* Process(const XnDepthPixel* pInput);
+	const XnDepthPixel* GetOutput() const { return m_Output.empty() ? NULL : &m_Output[0]; }
+
+	const DepthFilterStats& GetStats() const { return m_Stats; }
+	XnUInt32 GetXRes() const { return m_nXRes; }
+	XnUInt32 GetYRes() const { return m_nYRes; }
+
+	XnBool m_bBypass;             ///< @brief copy the input untouched
+	XnBool m_bScalar;             ///< @brief scalar loops only, the reference of the SSE2 ones
+	XnBool m_bHoleFill;
+	XnBool m_bBilateral;
+	XnBool m_bTemporal;
+
+	XnUInt32 m_nMinValidNeighbours;  ///< @brief hole filling needs at least this many valid pixels around
+	XnFloat m_fSpatialSigma;         ///< @brief pixels
+	XnFloat m_fRangeSigma;           ///< @brief mm at 1 m, grows with the square of the depth
+	XnFloat m_fTemporalAlpha;        ///< @brief weight of the new frame
+	XnFloat m_fMotionGate;           ///< @brief relative depth change considered as motion
+	XnUInt32 m_nHoleHoldFrames;      ///< @brief frames a hole keeps its last depth
+	XnDouble m_fBudget;              ///< @brief ms per frame
+	XnUInt32 m_nBandHeight;          ///< @brief rows per parallel band
+
+private:
+	void HoleFillRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd);
+	void BilateralRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd);
+	XnFloat TemporalRows(const XnDepthPixel* pInput, XnDepthPixel* pOutput, XnUInt32 nBegin, XnUInt32 nEnd, XnUInt32* pnStill);
+	XnBool FitsInBudget(XnDouble fElapsed, XnDouble fAverageCost);
+	void UpdateSpatialKernel();
+
+	XnUInt32 m_nXRes;
+	XnUInt32 m_nYRes;
+	XnUInt32 m_nFrames;
+
+	std::vector<XnDepthPixel> m_Buffer[2];
+	std::vector<XnDepthPixel> m_Output;
+	std::vector<XnFloat> m_TemporalDepth;
+	std::vector<XnFloat> m_TemporalAge;
+	XnFloat m_SpatialKernel[25];
+	XnFloat m_fKernelSigma;
+
+	XnDouble m_fHoleFillCost;
+	XnDouble m_fBilateralCost;
+	XnDouble m_fTemporalCost;
+	DepthFilterStats m_Stats;
+};
+
+}
+#endif
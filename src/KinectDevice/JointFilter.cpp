@@ -0,0 +1,378 @@
+#include "JointFilter.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define JOINT_FILTER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const XnFloat TWO_PI = 6.28318531f;
+static const XnFloat DEFAULT_DELTA_TIME = 1.0f / 30.0f;
+
+JointFilter::JointFilter()
+{
+	static const JointFilterParams defaults[JOINT_GROUP_COUNT] =
+	{
+		// min cutoff, beta, derivative cutoff, max prediction
+		{ 0.5f, 0.002f, 1.0f, 0.05f },    // torso
+		{ 1.0f, 0.004f, 1.0f, 0.05f },    // head
+		{ 1.0f, 0.006f, 1.0f, 0.066f },   // arms
+		{ 1.5f, 0.010f, 1.0f, 0.066f },   // hands
+		{ 1.0f, 0.004f, 1.0f, 0.05f },    // legs
+	};
+	memcpy(m_Params, defaults, sizeof(m_Params));
+
+	m_fMinConfidence = 0.5f;
+	m_bCollectStats = FALSE;
+	Reset();
+}
+
+void JointFilter::Reset()
+{
+	m_nSlots = 0;
+	m_nTimestamp = 0;
+	memset(m_UserIDs, 0, sizeof(m_UserIDs));
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+	{
+		ResetSlot(nSlot);
+		UpdateSlotParams(nSlot);
+	}
+	ResetStats();
+}
+
+void JointFilter::ResetStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_fRawJitterSum = m_fJitterSum = m_fLagSum = 0;
+}
+
+JointGroup JointFilter::GetJointGroup(XnSkeletonJoint eJoint)
+{
+	switch (eJoint)
+	{
+	case XN_SKEL_HEAD:
+	case XN_SKEL_NECK:
+		return JOINT_GROUP_HEAD;
+	case XN_SKEL_LEFT_COLLAR:
+	case XN_SKEL_LEFT_SHOULDER:
+	case XN_SKEL_LEFT_ELBOW:
+	case XN_SKEL_RIGHT_COLLAR:
+	case XN_SKEL_RIGHT_SHOULDER:
+	case XN_SKEL_RIGHT_ELBOW:
+		return JOINT_GROUP_ARMS;
+	case XN_SKEL_LEFT_WRIST:
+	case XN_SKEL_LEFT_HAND:
+	case XN_SKEL_LEFT_FINGERTIP:
+	case XN_SKEL_RIGHT_WRIST:
+	case XN_SKEL_RIGHT_HAND:
+	case XN_SKEL_RIGHT_FINGERTIP:
+		return JOINT_GROUP_HANDS;
+	case XN_SKEL_LEFT_HIP:
+	case XN_SKEL_LEFT_KNEE:
+	case XN_SKEL_LEFT_ANKLE:
+	case XN_SKEL_LEFT_FOOT:
+	case XN_SKEL_RIGHT_HIP:
+	case XN_SKEL_RIGHT_KNEE:
+	case XN_SKEL_RIGHT_ANKLE:
+	case XN_SKEL_RIGHT_FOOT:
+		return JOINT_GROUP_LEGS;
+	default:
+		return JOINT_GROUP_TORSO;
+	}
+}
+
+void JointFilter::SetParams(JointGroup eGroup, const JointFilterParams& params)
+{
+	m_Params[eGroup] = params;
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+		UpdateSlotParams(nSlot);
+}
+
+void JointFilter::UpdateSlotParams(XnUInt32 nSlot)
+{
+	for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+	{
+		const JointFilterParams& params = m_Params[GetJointGroup((XnSkeletonJoint)(nJoint + 1))];
+		XnUInt32 nIndex = nSlot*SKELETON_JOINT_COUNT + nJoint;
+		m_MinCutoff[nIndex] = params.fMinCutoff;
+		m_Beta[nIndex] = params.fBeta;
+		m_DerivativeCutoff[nIndex] = params.fDerivativeCutoff;
+		m_MaxPrediction[nIndex] = params.fMaxPrediction;
+	}
+}
+
+void JointFilter::ResetSlot(XnUInt32 nSlot)
+{
+	XnUInt32 nBegin = nSlot*SKELETON_JOINT_COUNT;
+	for (XnUInt32 nIndex = nBegin; nIndex < nBegin + SKELETON_JOINT_COUNT; nIndex++)
+	{
+		m_RawX[nIndex] = m_RawY[nIndex] = m_RawZ[nIndex] = 0;
+		m_Confidence[nIndex] = 0;
+		m_X[nIndex] = m_Y[nIndex] = m_Z[nIndex] = 0;
+		m_SpeedX[nIndex] = m_SpeedY[nIndex] = m_SpeedZ[nIndex] = 0;
+		m_PredictedX[nIndex] = m_PredictedY[nIndex] = m_PredictedZ[nIndex] = 0;
+		m_Valid[nIndex] = 0;
+	}
+	m_HistoryFrames[nSlot] = 0;
+}
+
+XnInt32 JointFilter::FindUser(XnUserID nUserID) const
+{
+	if (nUserID == 0)
+		return -1;
+	for (XnUInt32 nSlot = 0; nSlot < m_nSlots; nSlot++)
+	{
+		if (m_UserIDs[nSlot] == nUserID)
+			return (XnInt32)nSlot;
+	}
+	return -1;
+}
+
+void JointFilter::Update(const SkeletonSnapshot& snapshot)
+{
+	if (snapshot.GetTimestamp() == m_nTimestamp && m_nTimestamp != 0)
+		return; // no new frame
+
+	XnFloat fDeltaTime = m_nTimestamp != 0 ? (XnFloat)((XnInt64)(snapshot.GetTimestamp() - m_nTimestamp)) / 1e6f : 0;
+	if (fDeltaTime <= 0 || fDeltaTime > 0.5f)
+		fDeltaTime = DEFAULT_DELTA_TIME;
+	m_nTimestamp = snapshot.GetTimestamp();
+
+	// users no longer tracked free their slot
+	for (XnUInt32 nSlot = 0; nSlot < m_nSlots; nSlot++)
+	{
+		if (m_UserIDs[nSlot] != 0 && !snapshot.IsTracking(m_UserIDs[nSlot]))
+		{
+			m_UserIDs[nSlot] = 0;
+			ResetSlot(nSlot);
+		}
+	}
+
+	// copy the snapshot joints in the filter slots, new users take a free slot
+	for (XnUInt32 nUser = 0; nUser < snapshot.GetUserCount(); nUser++)
+	{
+		XnUserID nUserID = snapshot.GetUserID(nUser);
+		XnInt32 nSlot = FindUser(nUserID);
+		if (nSlot < 0)
+		{
+			for (nSlot = 0; nSlot < SKELETON_MAX_USERS && m_UserIDs[nSlot] != 0; nSlot++)
+				;
+			if (nSlot == SKELETON_MAX_USERS)
+				continue;
+			m_UserIDs[nSlot] = nUserID;
+			ResetSlot(nSlot);
+		}
+
+		const XnPoint3D* pPositions = snapshot.GetPositions() + nUser*SKELETON_JOINT_COUNT;
+		const XnFloat* pConfidences = snapshot.GetPositionConfidences() + nUser*SKELETON_JOINT_COUNT;
+		XnUInt32 nBegin = nSlot*SKELETON_JOINT_COUNT;
+		for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+		{
+			m_RawX[nBegin + nJoint] = pPositions[nJoint].X;
+			m_RawY[nBegin + nJoint] = pPositions[nJoint].Y;
+			m_RawZ[nBegin + nJoint] = pPositions[nJoint].Z;
+			m_Confidence[nBegin + nJoint] = snapshot.IsJointActive((XnSkeletonJoint)(nJoint + 1)) ? pConfidences[nJoint] : 0;
+		}
+	}
+
+	m_nSlots = 0;
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+	{
+		if (m_UserIDs[nSlot] != 0)
+			m_nSlots = nSlot + 1;
+	}
+
+	UpdateTables(m_nSlots*SKELETON_JOINT_COUNT, fDeltaTime);
+	Predict(0);
+
+	if (m_bCollectStats)
+		UpdateStats();
+}
+
+void JointFilter::UpdateTables(XnUInt32 nCount, XnFloat fDeltaTime)
+{
+	XnUInt32 i = 0;
+
+	// smoothing factor of a first order low pass at cutoff fc: r / (1 + r), r = 2 pi fc dt
+#if JOINT_FILTER_USE_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 rate = _mm_set1_ps(1.0f / fDeltaTime);
+	const __m128 twoPiDt = _mm_set1_ps(TWO_PI*fDeltaTime);
+	const __m128 minConfidence = _mm_set1_ps(m_fMinConfidence);
+
+	for (; i + 4 <= nCount; i += 4)
+	{
+		__m128 rawX = _mm_loadu_ps(m_RawX + i), rawY = _mm_loadu_ps(m_RawY + i), rawZ = _mm_loadu_ps(m_RawZ + i);
+		__m128 x = _mm_loadu_ps(m_X + i), y = _mm_loadu_ps(m_Y + i), z = _mm_loadu_ps(m_Z + i);
+		__m128 speedX = _mm_loadu_ps(m_SpeedX + i), speedY = _mm_loadu_ps(m_SpeedY + i), speedZ = _mm_loadu_ps(m_SpeedZ + i);
+		__m128 valid = _mm_cmpgt_ps(_mm_loadu_ps(m_Valid + i), zero);
+		__m128 confident = _mm_cmpge_ps(_mm_loadu_ps(m_Confidence + i), minConfidence);
+
+		// speed estimate
+		__m128 r = _mm_mul_ps(twoPiDt, _mm_loadu_ps(m_DerivativeCutoff + i));
+		__m128 alpha = _mm_div_ps(r, _mm_add_ps(one, r));
+		speedX = _mm_add_ps(speedX, _mm_mul_ps(alpha, _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(rawX, x), rate), speedX)));
+		speedY = _mm_add_ps(speedY, _mm_mul_ps(alpha, _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(rawY, y), rate), speedY)));
+		speedZ = _mm_add_ps(speedZ, _mm_mul_ps(alpha, _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(rawZ, z), rate), speedZ)));
+
+		// the cutoff follows the speed
+		__m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(speedX, speedX), _mm_mul_ps(speedY, speedY)), _mm_mul_ps(speedZ, speedZ)));
+		__m128 cutoff = _mm_add_ps(_mm_loadu_ps(m_MinCutoff + i), _mm_mul_ps(_mm_loadu_ps(m_Beta + i), speed));
+		r = _mm_mul_ps(twoPiDt, cutoff);
+		alpha = _mm_div_ps(r, _mm_add_ps(one, r));
+		__m128 filteredX = _mm_add_ps(x, _mm_mul_ps(alpha, _mm_sub_ps(rawX, x)));
+		__m128 filteredY = _mm_add_ps(y, _mm_mul_ps(alpha, _mm_sub_ps(rawY, y)));
+		__m128 filteredZ = _mm_add_ps(z, _mm_mul_ps(alpha, _mm_sub_ps(rawZ, z)));
+
+		// first sighting: start from the raw position; low confidence: hold still
+		__m128 update = _mm_and_ps(confident, valid);
+		__m128 start = _mm_andnot_ps(valid, confident);
+		__m128 hold = _mm_andnot_ps(_mm_or_ps(update, start), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+		_mm_storeu_ps(m_X + i, _mm_or_ps(_mm_or_ps(_mm_and_ps(update, filteredX), _mm_and_ps(start, rawX)), _mm_and_ps(hold, x)));
+		_mm_storeu_ps(m_Y + i, _mm_or_ps(_mm_or_ps(_mm_and_ps(update, filteredY), _mm_and_ps(start, rawY)), _mm_and_ps(hold, y)));
+		_mm_storeu_ps(m_Z + i, _mm_or_ps(_mm_or_ps(_mm_and_ps(update, filteredZ), _mm_and_ps(start, rawZ)), _mm_and_ps(hold, z)));
+		_mm_storeu_ps(m_SpeedX + i, _mm_and_ps(update, speedX));
+		_mm_storeu_ps(m_SpeedY + i, _mm_and_ps(update, speedY));
+		_mm_storeu_ps(m_SpeedZ + i, _mm_and_ps(update, speedZ));
+		_mm_storeu_ps(m_Valid + i, _mm_and_ps(_mm_or_ps(valid, confident), one));
+	}
+#endif
+
+	for (; i < nCount; i++)
+	{
+		if (m_Confidence[i] < m_fMinConfidence)
+		{
+			m_SpeedX[i] = m_SpeedY[i] = m_SpeedZ[i] = 0;
+			continue;
+		}
+		if (m_Valid[i] == 0)
+		{
+			m_X[i] = m_RawX[i];
+			m_Y[i] = m_RawY[i];
+			m_Z[i] = m_RawZ[i];
+			m_SpeedX[i] = m_SpeedY[i] = m_SpeedZ[i] = 0;
+			m_Valid[i] = 1;
+			continue;
+		}
+
+		XnFloat r = TWO_PI*fDeltaTime*m_DerivativeCutoff[i];
+		XnFloat alpha = r / (1 + r);
+		m_SpeedX[i] += alpha*((m_RawX[i] - m_X[i]) / fDeltaTime - m_SpeedX[i]);
+		m_SpeedY[i] += alpha*((m_RawY[i] - m_Y[i]) / fDeltaTime - m_SpeedY[i]);
+		m_SpeedZ[i] += alpha*((m_RawZ[i] - m_Z[i]) / fDeltaTime - m_SpeedZ[i]);
+
+		XnFloat fSpeed = sqrtf(m_SpeedX[i]*m_SpeedX[i] + m_SpeedY[i]*m_SpeedY[i] + m_SpeedZ[i]*m_SpeedZ[i]);
+		r = TWO_PI*fDeltaTime*(m_MinCutoff[i] + m_Beta[i]*fSpeed);
+		alpha = r / (1 + r);
+		m_X[i] += alpha*(m_RawX[i] - m_X[i]);
+		m_Y[i] += alpha*(m_RawY[i] - m_Y[i]);
+		m_Z[i] += alpha*(m_RawZ[i] - m_Z[i]);
+	}
+}
+
+void JointFilter::Predict(XnFloat fHorizon)
+{
+	const XnUInt32 nCount = m_nSlots*SKELETON_JOINT_COUNT;
+	XnUInt32 i = 0;
+
+#if JOINT_FILTER_USE_SSE2
+	const __m128 horizon = _mm_set1_ps(fHorizon > 0 ? fHorizon : 0);
+	for (; i + 4 <= nCount; i += 4)
+	{
+		__m128 dt = _mm_min_ps(horizon, _mm_loadu_ps(m_MaxPrediction + i));
+		_mm_storeu_ps(m_PredictedX + i, _mm_add_ps(_mm_loadu_ps(m_X + i), _mm_mul_ps(dt, _mm_loadu_ps(m_SpeedX + i))));
+		_mm_storeu_ps(m_PredictedY + i, _mm_add_ps(_mm_loadu_ps(m_Y + i), _mm_mul_ps(dt, _mm_loadu_ps(m_SpeedY + i))));
+		_mm_storeu_ps(m_PredictedZ + i, _mm_add_ps(_mm_loadu_ps(m_Z + i), _mm_mul_ps(dt, _mm_loadu_ps(m_SpeedZ + i))));
+	}
+#endif
+
+	for (; i < nCount; i++)
+	{
+		XnFloat dt = fHorizon > 0 ? fHorizon : 0;
+		if (dt > m_MaxPrediction[i])
+			dt = m_MaxPrediction[i];
+		m_PredictedX[i] = m_X[i] + dt*m_SpeedX[i];
+		m_PredictedY[i] = m_Y[i] + dt*m_SpeedY[i];
+		m_PredictedZ[i] = m_Z[i] + dt*m_SpeedZ[i];
+	}
+}
+
+XnBool JointFilter::GetJointPosition(XnUserID nUserID, XnSkeletonJoint eJoint, XnPoint3D& position, XnBool bPredicted) const
+{
+	XnInt32 nSlot = FindUser(nUserID);
+	if (nSlot < 0 || (XnUInt32)eJoint < 1 || (XnUInt32)eJoint > SKELETON_JOINT_COUNT)
+		return FALSE;
+
+	XnUInt32 nIndex = SkeletonSnapshot::Index(nSlot, eJoint);
+	if (m_Valid[nIndex] == 0)
+		return FALSE;
+
+	position.X = bPredicted ? m_PredictedX[nIndex] : m_X[nIndex];
+	position.Y = bPredicted ? m_PredictedY[nIndex] : m_Y[nIndex];
+	position.Z = bPredicted ? m_PredictedZ[nIndex] : m_Z[nIndex];
+	return TRUE;
+}
+
+// second differences measure the jitter, the raw to filtered distance measures the lag
+void JointFilter::UpdateStats()
+{
+	XnFloat* pRaw1[3] = { m_History[0][0], m_History[0][1], m_History[0][2] };
+	XnFloat* pRaw2[3] = { m_History[1][0], m_History[1][1], m_History[1][2] };
+	XnFloat* pFiltered1[3] = { m_History[2][0], m_History[2][1], m_History[2][2] };
+	XnFloat* pFiltered2[3] = { m_History[3][0], m_History[3][1], m_History[3][2] };
+	const XnFloat* pRaw[3] = { m_RawX, m_RawY, m_RawZ };
+	const XnFloat* pFiltered[3] = { m_X, m_Y, m_Z };
+
+	for (XnUInt32 nSlot = 0; nSlot < m_nSlots; nSlot++)
+	{
+		if (m_UserIDs[nSlot] == 0)
+			continue;
+
+		for (XnUInt32 i = nSlot*SKELETON_JOINT_COUNT; i < (nSlot + 1)*SKELETON_JOINT_COUNT; i++)
+		{
+			if (m_Confidence[i] < m_fMinConfidence)
+				continue;
+
+			XnFloat fRawJitter = 0, fJitter = 0, fLag = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				XnFloat d = pRaw[c][i] - 2*pRaw1[c][i] + pRaw2[c][i];
+				fRawJitter += d*d;
+				d = pFiltered[c][i] - 2*pFiltered1[c][i] + pFiltered2[c][i];
+				fJitter += d*d;
+				d = pRaw[c][i] - pFiltered[c][i];
+				fLag += d*d;
+			}
+
+			if (m_HistoryFrames[nSlot] >= 2)
+			{
+				m_fRawJitterSum += sqrtf(fRawJitter);
+				m_fJitterSum += sqrtf(fJitter);
+				m_fLagSum += sqrtf(fLag);
+				m_Stats.nSamples++;
+			}
+		}
+
+		for (XnUInt32 i = nSlot*SKELETON_JOINT_COUNT; i < (nSlot + 1)*SKELETON_JOINT_COUNT; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				pRaw2[c][i] = pRaw1[c][i];
+				pRaw1[c][i] = pRaw[c][i];
+				pFiltered2[c][i] = pFiltered1[c][i];
+				pFiltered1[c][i] = pFiltered[c][i];
+			}
+		}
+		m_HistoryFrames[nSlot]++;
+	}
+
+	if (m_Stats.nSamples > 0)
+	{
+		m_Stats.fRawJitter = (XnFloat)(m_fRawJitterSum / m_Stats.nSamples);
+		m_Stats.fJitter = (XnFloat)(m_fJitterSum / m_Stats.nSamples);
+		m_Stats.fLag = (XnFloat)(m_fLagSum / m_Stats.nSamples);
+	}
+}
@@ -0,0 +1,114 @@
+#ifndef _JointFilter
+#define _JointFilter
+
+#include "SkeletonSnapshot.h"
+
+/// @brief Joints sharing the same filter tuning.
+enum JointGroup
+{
+	JOINT_GROUP_TORSO,
+	JOINT_GROUP_HEAD,
+	JOINT_GROUP_ARMS,
+	JOINT_GROUP_HANDS,
+	JOINT_GROUP_LEGS,
+	JOINT_GROUP_COUNT
+};
+
+/// @brief One Euro filter tuning of a joint group.
+struct JointFilterParams
+{
+	XnFloat fMinCutoff;        ///< @brief Hz, cutoff at rest: lower removes more jitter
+	XnFloat fBeta;             ///< @brief cutoff increase per mm/s: higher reduces the lag of fast moves
+	XnFloat fDerivativeCutoff; ///< @brief Hz, cutoff of the speed estimate
+	XnFloat fMaxPrediction;    ///< @brief seconds, longest forward prediction
+};
+
+/// @brief Lag against jitter figures, averaged over the updates since the last ResetStats.
+struct JointFilterStats
+{
+	XnUInt32 nSamples;
+	XnFloat fRawJitter;        ///< @brief mm, mean second difference of the raw positions
+	XnFloat fJitter;           ///< @brief mm, mean second difference of the filtered positions
+	XnFloat fLag;              ///< @brief mm, mean distance between the raw and filtered positions
+};
+
+/// @brief One Euro filter and forward prediction of the skeleton joints.
+/// 
+/// Replaces the NITE skeleton smoothing, which adds a constant lag. Each joint position goes
+/// through a low pass filter whose cutoff rises with the joint speed: still joints are smoothed
+/// hard, fast joints follow with little lag. The filtered speed then extrapolates the joints to
+/// the render time.
+/// 
+/// The state is kept in slot * SKELETON_JOINT_COUNT + (joint - 1) tables like the SkeletonSnapshot,
+/// with one array per coordinate, so a frame costs one SSE pass over all the joints of all the
+/// users. A user keeps its filter slot while it stays tracked, the slots do not follow the
+/// snapshot ones.
+class JointFilter
+{
+public:
+	JointFilter();
+
+	void Reset();
+
+	/// @brief Filters the joints of a new snapshot, at the snapshot timestamp.
+	void Update(const SkeletonSnapshot& snapshot);
+
+	/// @brief Extrapolates the filtered joints fHorizon seconds after the last snapshot.
+	void Predict(XnFloat fHorizon);
+
+	static JointGroup GetJointGroup(XnSkeletonJoint eJoint);
+	const JointFilterParams& GetParams(JointGroup eGroup) const { return m_Params[eGroup]; }
+	void SetParams(JointGroup eGroup, const JointFilterParams& params);
+
+	/// @brief Filter slots in use are below GetSlotCount, a free slot has a user ID of 0.
+	XnUInt32 GetSlotCount() const { return m_nSlots; }
+	XnUserID GetUserID(XnUInt32 nSlot) const { return m_UserIDs[nSlot]; }
+	XnInt32 FindUser(XnUserID nUserID) const;
+
+	/// @brief Filtered (or predicted) position of a joint, FALSE if the user is not tracked.
+	XnBool GetJointPosition(XnUserID nUserID, XnSkeletonJoint eJoint, XnPoint3D& position, XnBool bPredicted = TRUE) const;
+
+	const JointFilterStats& GetStats() const { return m_Stats; }
+	void ResetStats();
+
+	XnFloat m_fMinConfidence;   ///< @brief joints below keep their last filtered position
+	XnBool m_bCollectStats;
+
+private:
+	enum { TABLE_SIZE = SKELETON_MAX_USERS*SKELETON_JOINT_COUNT };
+
+	void UpdateTables(XnUInt32 nCount, XnFloat fDeltaTime);
+	void UpdateStats();
+	void ResetSlot(XnUInt32 nSlot);
+	void UpdateSlotParams(XnUInt32 nSlot);
+
+	XnUInt32 m_nSlots;
+	XnUserID m_UserIDs[SKELETON_MAX_USERS];
+	XnUInt64 m_nTimestamp;
+	JointFilterParams m_Params[JOINT_GROUP_COUNT];
+
+	// input of the current update, in the filter slots
+	XnFloat m_RawX[TABLE_SIZE], m_RawY[TABLE_SIZE], m_RawZ[TABLE_SIZE];
+	XnFloat m_Confidence[TABLE_SIZE];
+
+	// filter state
+	XnFloat m_X[TABLE_SIZE], m_Y[TABLE_SIZE], m_Z[TABLE_SIZE];
+	XnFloat m_SpeedX[TABLE_SIZE], m_SpeedY[TABLE_SIZE], m_SpeedZ[TABLE_SIZE];
+	XnFloat m_Valid[TABLE_SIZE];   ///< @brief 1 once the joint was seen, 0 otherwise
+
+	// parameters expanded per joint so the filter pass needs no lookup
+	XnFloat m_MinCutoff[TABLE_SIZE];
+	XnFloat m_Beta[TABLE_SIZE];
+	XnFloat m_DerivativeCutoff[TABLE_SIZE];
+	XnFloat m_MaxPrediction[TABLE_SIZE];
+
+	XnFloat m_PredictedX[TABLE_SIZE], m_PredictedY[TABLE_SIZE], m_PredictedZ[TABLE_SIZE];
+
+	// previous frames for the statistics
+	XnFloat m_History[4][3][TABLE_SIZE];
+	XnUInt32 m_HistoryFrames[SKELETON_MAX_USERS];
+	JointFilterStats m_Stats;
+	XnDouble m_fRawJitterSum, m_fJitterSum, m_fLagSum;
+};
+
+#endif
@@ -1,45 +1,35 @@
 #pragma once
 #include <cstdlib>
-#include <gl/glut.h>
 
 // Helper-struct
 struct KRGBColor 
 {
-	KRGBColor(float _r, float _g, float _b){
-		r = _r;
-		g = _g;
-		b = _b;
-	}
-
-	KRGBColor(){
-		r = 0;
-		g = 0;
-		b = 0;
-	}
-
 	float r;
 	float g;
 	float b;
+	// 1 for opaque
+	float a;
 };
 
-class KVertex
+// A colored vertex. Plain data without constructors or virtuals, so an array of vertices can be
+// handed to OpenGL as one interleaved vertex array: the position at offset 0, the color after it.
+struct KVertex
 {
-public:
-	KVertex(void);
-	KVertex(float x, float y, float z, KRGBColor color);
-	~KVertex(void);
-
-	// Makes glVertex3f and glColor3f
-	void paintVertex(void);
-
-	// sets the color
-	void setColor(float r, float g, float b);
-
 	// Saves the coordinates of the vertex
 	float mX,mY,mZ;
 
-	//Saves the color of the 
+	//Saves the color of the vertex
 	KRGBColor mColor;
-	
 };
 
+inline KRGBColor makeColor(float r, float g, float b, float a = 1.0f)
+{
+	KRGBColor color = { r, g, b, a };
+	return color;
+}
+
+inline KVertex makeVertex(float x, float y, float z, KRGBColor color)
+{
+	KVertex vertex = { x, y, z, color };
+	return vertex;
+}
@@ -65,6 +65,25 @@ KinectDevice::KinectDevice()
 	m_hCalibrationCallbacks = NULL;
 	m_pPrimary = NULL;
 	mIsWorking=false; 
+	mDepthRegistered = false;
+	mForegroundEnabled = true;
+	mBackgroundModel.Init(KINECT_DEPTH_WIDTH, KINECT_DEPTH_HEIGHT);
+	mDepthFilterEnabled = false;
+	m_SmoothingDelta = 0;
+	mSkeletonTrack = NULL;
+	mSkeletonTrackTimestamp = 0;
+	mDepthFilter.Init(KINECT_DEPTH_WIDTH, KINECT_DEPTH_HEIGHT);
+	memset(&mFrameTime, 0, sizeof(mFrameTime));
+	mUserBufferLabels.SetPalette(oniColors, nColors, oniColors[nColors]);
+
+	// left hand more than 6 cm to the right of the right hand, both at the same height
+	static const PoseCondition endPose[] =
+	{
+		{ XN_SKEL_LEFT_HAND, XN_SKEL_RIGHT_HAND, POSE_AXIS_X, POSE_GREATER, 60 },
+		{ XN_SKEL_LEFT_HAND, XN_SKEL_RIGHT_HAND, POSE_AXIS_Y, POSE_ABS_LESS, 300 },
+	};
+	mEndPoseRule = mPoseRules.AddRule("EndPose", endPose, 2, 2.0);
+	mPoseRules.SetSensorClock(&mSensorClock);
 
 	RawDepthToMeters1();
 	CreateRainbowPallet();
@@ -101,11 +120,28 @@ XnStatus KinectDevice::initPrimeSensor()
 
 		// Init OpenNI nodes and register callback Procedure to OpenNI
 		m_HandsGenerator.SetSmoothing(1);
+		// the skeleton is smoothed by mJointFilter only, NITE smoothing on top would add its lag
+		m_UserGenerator.GetSkeletonCap().SetSmoothing(0.0f);
 		//m_UserGenerator.RegisterUserCallbacks(SinbadCharacterController::NewUser, SinbadCharacterController::LostUser, this, m_hUserCallbacks);
 		//m_UserGenerator.GetPoseDetectionCap().RegisterToPoseCallbacks(SinbadCharacterController::PoseDetected, SinbadCharacterController::PoseLost, this, m_hPoseCallbacks);
 #if SHOW_DEPTH
 		m_DepthGenerator.GetMirrorCap().SetMirror(m_front);
+		setDepthRegistration(mDepthRegistered);
 #endif
+		// the microphones are optional, the XML may not ask for an audio node
+		if (m_Context.FindExistingNode(XN_NODE_TYPE_AUDIO, m_AudioGenerator) == XN_STATUS_OK)
+		{
+			XnWaveOutputMode waveMode;
+			rc = m_AudioGenerator.GetWaveOutputMode(waveMode);
+			if (rc != XN_STATUS_OK)
+			{
+				// without its format the samples cannot be split into channels, run without audio
+				printf("Kinect GetWaveOutputMode failed: %s\n", xnGetStatusString(rc));
+				m_AudioGenerator.Release();
+			}
+			else if (!mAudioFile.IsOpen())
+				mAudioStream.Init(waveMode.nChannels, waveMode.nSampleRate, waveMode.nSampleRate / 2);
+		}
 		// Make sure OpenNI nodes start generating
 		rc = m_Context.StartGeneratingAll();
 		CHECK_RC(rc, "Kinect StartGenerating Context to Ogre");
@@ -113,8 +149,6 @@ XnStatus KinectDevice::initPrimeSensor()
 			mIsWorking=true; 
 		m_candidateID = 0;
 		m_pStartPoseDetector = new StartPoseDetector(3.0);
-		m_pEndPoseDetector = new EndPoseDetector(m_UserGenerator, 2.0);
-		m_pEndPoseDetector->SetUserId(m_candidateID);
 
 		return XN_STATUS_OK;
 }
@@ -128,9 +162,13 @@ bool KinectDevice::Update()
 	readFrame();
 	//parse data to texture
 	ParseUserTexture(&sceneMetaData, true);
+	// the depth only kernels take the filtered map when the filter runs, the one mixing depth
+	// with the user labels keeps the raw map the labels were computed on
+	xn::DepthMetaData* pDepthMetaData = mDepthFilterEnabled ? &filteredDepthMetaData : &depthMetaData;
+	ParseForegroundData(pDepthMetaData);
 	ParseColorDepthData(&depthMetaData,&sceneMetaData,&imageMetaData);
-	ParseColoredDepthData(&depthMetaData,DepthColoringType::COLOREDDEPTH);
-	Parse3DDepthData(&depthMetaData);
+	ParseColoredDepthData(pDepthMetaData,DepthColoringType::COLOREDDEPTH);
+	Parse3DDepthData(pDepthMetaData);
 	return UpdateColorDepthTexture();
 }
 
@@ -179,80 +217,106 @@ void KinectDevice::ParseUserTexture(xn::SceneMetaData *sceneMetaData, bool m_fro
 
 	// Get label map 
 	const XnLabel* pUsersLBLs = sceneMetaData->Data();
+
+	// rows of the pose progress bars, the same for the whole frame; the end pose of the candidate
+	// comes from the pose rules evaluated on the snapshot of the frame
+	const double endPoseProgress = m_candidateID != 0 && mEndPoseRule >= 0 ? mPoseRules.GetProgress(mEndPoseRule, m_candidateID) : 0;
+	const double startPoseRow = KINECT_DEPTH_HEIGHT*(1 - m_pStartPoseDetector->GetDetectionPercent());
+	const double endPoseRow = KINECT_DEPTH_HEIGHT*endPoseProgress;
+
+#if SHOW_DEPTH
+	// label -> color for this frame, if we have a candidate, filter out the rest
+	// and only draw the box of the candidate
+	const UserRegion* pCandidate = NULL;
+	if (m_candidateID == 0)
+	{
+		mUserLabels.SetPalette(g_UsersColors, sizeof(g_UsersColors)/sizeof(unsigned int), GetColorForUser(0));
+	}
+	else
+	{
+		mUserLabels.Fill(0);
+		pCandidate = mUserIndex.FindUser(m_candidateID);
+	}
+#endif
 		
 	for (size_t j = 0; j < KINECT_DEPTH_HEIGHT; j++)
 	{
 		pDest = static_cast<unsigned char*>(pixelBox.data) + j*pixelBox.rowPitch*4;
 #if SHOW_DEPTH
-		for(size_t i = 0; i < KINECT_DEPTH_WIDTH; i++)
-#elif SHOW_BAR
-		for(size_t i = 0; i < 50; i++)
-#endif
+		if (m_candidateID != 0)
 		{
-			// fix i if we are mirrored
-			uint fixed_i = i;
-			if(!m_front)
-			{
-				fixed_i = KINECT_DEPTH_WIDTH - i;
-			}
+			memset(pDest, 0, KINECT_DEPTH_WIDTH*4);
+			if (pCandidate == NULL || j < pCandidate->nMinY || j > pCandidate->nMaxY)
+				continue;
 
-			// determine color
-#if SHOW_DEPTH
-			unsigned int color = GetColorForUser(pUsersLBLs[j*KINECT_DEPTH_WIDTH + fixed_i]);
-
-			// if we have a candidate, filter out the rest
-			if (m_candidateID != 0)
-			{
-				if  (m_candidateID == pUsersLBLs[j*KINECT_DEPTH_WIDTH + fixed_i])
-				{
-					color = GetColorForUser(1);
-					if( j > KINECT_DEPTH_HEIGHT*(1 - m_pStartPoseDetector->GetDetectionPercent()))
-					{
-						//highlight user
-						color |= 0xFF070707;
-					}
-					if( j < KINECT_DEPTH_HEIGHT*(m_pEndPoseDetector->GetDetectionPercent()))
-					{	
-						//hide user
-						color &= 0x20F0F0F0;
-					}
-				}
-				else
-				{
-					color = 0;
-				}
-			}
-#elif SHOW_BAR
-			// RED. kinda.
-			unsigned int color = 0x80FF0000;
-			if( j > KINECT_DEPTH_HEIGHT*(1 - m_pStartPoseDetector->GetDetectionPercent()))
+			unsigned int color = GetColorForUser(1);
+			if (j > startPoseRow)
 			{
 				//highlight user
 				color |= 0xFF070707;
 			}
-			if( j < KINECT_DEPTH_HEIGHT*(m_pEndPoseDetector->GetDetectionPercent()))
+			if (j < endPoseRow)
 			{	
 				//hide user
 				color &= 0x20F0F0F0;
 			}
+			mUserLabels.SetColor(m_candidateID, color);
 
-			if ((m_pStartPoseDetector->GetDetectionPercent() == 1) ||
-				(m_pEndPoseDetector->GetDetectionPercent() == 1))
-			{
-				color = 0;
-			}
-#endif
-				
+			// columns of the box, mirrored when we are not in front
+			XnUInt32 nFirst = m_front ? pCandidate->nMinX : KINECT_DEPTH_WIDTH - 1 - pCandidate->nMaxX;
+			mUserLabels.RenderRow(pUsersLBLs + j*KINECT_DEPTH_WIDTH + pCandidate->nMinX, (XnUInt32*)pDest + nFirst, pCandidate->GetWidth(), !m_front);
+			continue;
+		}
+
+		// mirrored when we are not in front
+		mUserLabels.RenderRow(pUsersLBLs + j*KINECT_DEPTH_WIDTH, (XnUInt32*)pDest, KINECT_DEPTH_WIDTH, !m_front);
+#elif SHOW_BAR
+		// RED. kinda.
+		unsigned int color = 0x80FF0000;
+		if (j > startPoseRow)
+		{
+			//highlight user
+			color |= 0xFF070707;
+		}
+		if (j < endPoseRow)
+		{	
+			//hide user
+			color &= 0x20F0F0F0;
+		}
+
+		if ((m_pStartPoseDetector->GetDetectionPercent() == 1) ||
+			(endPoseProgress == 1))
+		{
+			color = 0;
+		}
+
+		for(size_t i = 0; i < 50; i++)
+		{
 			// write to output buffer
 			*((unsigned int*)pDest) = color;
 			pDest+=4;
 		}
+#endif
 	}
 	// Unlock the pixel buffer
 	pixelBuffer->unlock();
 #endif // SHOW_DEPTH
 }
 
+//Update the depth background model, foreground mask, blobs and blob tracks
+void KinectDevice::ParseForegroundData(xn::DepthMetaData *depthMetaData)
+{
+	if (!mForegroundEnabled || !m_DepthGenerator.IsValid())
+		return;
+
+	if (depthMetaData->XRes() != mBackgroundModel.GetXRes() || depthMetaData->YRes() != mBackgroundModel.GetYRes())
+		mBackgroundModel.Init(depthMetaData->XRes(), depthMetaData->YRes());
+
+	mBackgroundModel.Update(depthMetaData->Data());
+	mBackgroundModel.ExtractBlobs();
+	mBlobTracker.Update(mBackgroundModel.GetBlobStats());
+}
+
 //convertDepthToRGB function
 void KinectDevice::ParseColoredDepthData(xn::DepthMetaData *depthMetaData,DepthColoringType DepthColoring)
 {
@@ -588,51 +652,40 @@ void KinectDevice::ParseColorDepthData(xn::DepthMetaData *depthMetaData,
 	}
 	
 	const XnLabel* pLabels = sceneMetaData->Data();
-	XnLabel label;
 
 	for (int i = 0; i < KINECT_DEPTH_WIDTH * KINECT_DEPTH_HEIGHT; i++)
 	{			
 		nValue = pDepth[i];
-		label = pLabels[i];
-		XnUInt32 nColorID = label % nColors;
-		if (label == 0)
-		{
-			nColorID = nColors;
-		}
-
-		if (nValue != 0) 
-		{
-			nHistValue = depthHist[nValue];
-			mDepthBuffer[i] = nHistValue;
-
-			mUserBuffer[i * 3 + 0] = 255 * oniColors[nColorID][0];
-			mUserBuffer[i * 3 + 1] = 255 * oniColors[nColorID][1];
-			mUserBuffer[i * 3 + 2] = 255 * oniColors[nColorID][2];
-		}
-		else 
-		{
-			mDepthBuffer[i] = 0;
-
-			mUserBuffer[i * 3 + 0] = 0;
-			mUserBuffer[i * 3 + 1] = 0;
-			mUserBuffer[i * 3 + 2] = 0;
-		}
+		nHistValue = depthHist[nValue];
+		mDepthBuffer[i] = nValue != 0 ? nHistValue : 0;
 	}
 
-	const XnRGB24Pixel* pImageRow = imageMetaData->RGB24Data(); // - g_imageMD.YOffset();
+	// user colors through the label table, black where there is no depth
+	mUserBufferLabels.RenderRowRGB(pLabels, pDepth, NULL, mUserBuffer, KINECT_DEPTH_WIDTH * KINECT_DEPTH_HEIGHT);
 
-	for (XnUInt y = 0; y < Kinect::colorHeight; ++y)
+	if (imageMetaData->PixelFormat() == XN_PIXEL_FORMAT_YUV422)
+	{
+		// same byte order as the RGB24 copy below
+		YUV422Converter::Convert(imageMetaData->Data(), Kinect::colorWidth*2, mColorBuffer, Kinect::colorWidth*3,
+			Kinect::colorWidth, Kinect::colorHeight, YUV422_UYVY, RGB_LAYOUT_RGB);
+	}
+	else
 	{
-		const XnRGB24Pixel* pImage = pImageRow; // + g_imageMD.XOffset();
+		const XnRGB24Pixel* pImageRow = imageMetaData->RGB24Data(); // - g_imageMD.YOffset();
 
-		for (XnUInt x = 0; x < Kinect::colorWidth; ++x, ++pImage)
+		for (XnUInt y = 0; y < Kinect::colorHeight; ++y)
 		{
-			int index = (y*Kinect::colorWidth + x)*3;
-			mColorBuffer[index + 2] = (unsigned char) pImage->nBlue;
-			mColorBuffer[index + 1] = (unsigned char) pImage->nGreen;
-			mColorBuffer[index + 0] = (unsigned char) pImage->nRed;
+			const XnRGB24Pixel* pImage = pImageRow; // + g_imageMD.XOffset();
+
+			for (XnUInt x = 0; x < Kinect::colorWidth; ++x, ++pImage)
+			{
+				int index = (y*Kinect::colorWidth + x)*3;
+				mColorBuffer[index + 2] = (unsigned char) pImage->nBlue;
+				mColorBuffer[index + 1] = (unsigned char) pImage->nGreen;
+				mColorBuffer[index + 0] = (unsigned char) pImage->nRed;
+			}
+			pImageRow += Kinect::colorWidth;
 		}
-		pImageRow += Kinect::colorWidth;
 	}
 
 	//copy the data to pixelbox
@@ -926,6 +979,7 @@ void KinectDevice::closeDevice()
 
 void KinectDevice::shutdown()
 {
+	recordSkeletonTrack(NULL);
 	if (mIsWorking)
 		closeDevice();
 	mIsWorking = false;
@@ -933,6 +987,56 @@ void KinectDevice::shutdown()
 	mDepthTexture.setNull();
 	mColoredDepthTexture.setNull();
 }
+void KinectDevice::AudioReceived()
+{
+	// OpenNI hands out interleaved 16 bit PCM
+	const XnUInt32 nChannels = audioMetaData.NumberOfChannels();
+	if (nChannels != mAudioStream.GetChannels() || audioMetaData.BitsPerSample() != 16)
+		return;
+	mAudioStream.Push((const XnInt16*)audioMetaData.Data(), audioMetaData.DataSize() / (2 * nChannels));
+}
+
+void KinectDevice::setDepthRegistration(bool registered)
+{
+	mDepthRegistered = registered;
+#if SHOW_DEPTH
+	if (!m_DepthGenerator.IsValid() || !m_DepthGenerator.IsCapabilitySupported(XN_CAPABILITY_ALTERNATIVE_VIEW_POINT))
+		return;
+	if (registered)
+		m_DepthGenerator.GetAlternativeViewPointCap().SetViewPoint(m_ImageGenerator);
+	else
+		m_DepthGenerator.GetAlternativeViewPointCap().ResetViewPoint();
+#endif
+}
+
+XnStatus KinectDevice::openAudioFile(const char* fileName)
+{
+	XnStatus rc = mAudioFile.Open(fileName);
+	CHECK_RC(rc, "Open audio file");
+	mAudioStream.Init(mAudioFile.GetChannels(), mAudioFile.GetSampleRate(), mAudioFile.GetSampleRate() / 2);
+	return XN_STATUS_OK;
+}
+
+XnStatus KinectDevice::recordSkeletonTrack(const char* fileName)
+{
+	if (mSkeletonTrack != NULL)
+	{
+		fclose(mSkeletonTrack);
+		mSkeletonTrack = NULL;
+	}
+	if (fileName == NULL)
+		return XN_STATUS_OK;
+
+	mSkeletonTrack = fopen(fileName, "w");
+	if (mSkeletonTrack == NULL)
+	{
+		printf("Open skeleton track failed: %s\n", fileName);
+		return XN_STATUS_OS_FILE_OPEN_FAILED;
+	}
+	mSkeletonTrackTimestamp = 0;
+	return XN_STATUS_OK;
+}
+
 void KinectDevice::readFrame()
 {
 	XnStatus rc = XN_STATUS_OK;
@@ -951,9 +1055,29 @@ void KinectDevice::readFrame()
 		printf("Error: %s\n", xnGetStatusString(rc));
 	}
 
+	// stamp the frame once, everything reading this frame shares these times
+	mFrameTime.acquireTime = TimeService::now();
+	xn::Generator* pClockSource = m_DepthGenerator.IsValid() ? (xn::Generator*)&m_DepthGenerator : (xn::Generator*)&m_ImageGenerator;
+	if (pClockSource->IsValid() && pClockSource->GetTimestamp() != mFrameTime.sensorTime)
+	{
+		mFrameTime.sensorTime = pClockSource->GetTimestamp();
+		mFrameTime.frameID = pClockSource->GetFrameID();
+		mSensorClock.observe(mFrameTime.sensorTime, mFrameTime.acquireTime);
+		mFrameTime.hostTime = mSensorClock.toHost(mFrameTime.sensorTime);
+	}
+
 	if (m_DepthGenerator.IsValid())
 	{
 		m_DepthGenerator.GetMetaData(depthMetaData);
+		if (mDepthFilterEnabled)
+		{
+			if (depthMetaData.XRes() != mDepthFilter.GetXRes() || depthMetaData.YRes() != mDepthFilter.GetYRes())
+				mDepthFilter.Init(depthMetaData.XRes(), depthMetaData.YRes());
+
+			// the raw map stays in depthMetaData, it is the one NITE labels and skeletons come from
+			const XnDepthPixel* pFiltered = mDepthFilter.Process(depthMetaData.Data());
+			filteredDepthMetaData.InitFrom(depthMetaData, depthMetaData.XRes(), depthMetaData.YRes(), pFiltered);
+		}
 	}
 
 	if (m_ImageGenerator.IsValid())
@@ -969,10 +1093,25 @@ void KinectDevice::readFrame()
 	if (m_AudioGenerator.IsValid())
 	{
 		m_AudioGenerator.GetMetaData(audioMetaData);
+		if (audioMetaData.IsDataNew() && !mAudioFile.IsOpen())
+			AudioReceived();
+	}
+	if (mAudioFile.IsOpen())
+	{
+		mAudioFile.Pump(mAudioStream);
 	}
 	if (m_UserGenerator.IsValid())
 	{
 		m_UserGenerator.GetUserPixels(0, sceneMetaData);
+		mUserIndex.Build(sceneMetaData.Data(), sceneMetaData.XRes(), sceneMetaData.YRes());
+		mSkeletonSnapshot.Update(m_UserGenerator, &m_DepthGenerator);
+		mJointFilter.Update(mSkeletonSnapshot);
+		mPoseRules.Update(mSkeletonSnapshot);
+		if (mSkeletonTrack != NULL && mSkeletonSnapshot.GetTimestamp() != mSkeletonTrackTimestamp)
+		{
+			mSkeletonSnapshot.Write(mSkeletonTrack);
+			mSkeletonTrackTimestamp = mSkeletonSnapshot.GetTimestamp();
+		}
 	}
 }
 
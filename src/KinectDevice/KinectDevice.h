@@ -7,6 +7,18 @@
 #include <XnV3DVector.h>
 #include "UserSelector.h"
 #include "SkeletonPoseDetector.h"
+#include "SkeletonSnapshot.h"
+#include "JointFilter.h"
+#include "PoseRuleEngine.h"
+#include "TimeService.h"
+#include "DepthBackground.h"
+#include "BlobTracker.h"
+#include "DepthFilter.h"
+#include "LabelRenderer.h"
+#include "UserIndex.h"
+#include "YUV422Converter.h"
+#include "AudioRing.h"
+#include "WavAudioSource.h"
 #include "Ogre.h"
 
 namespace Kinect
@@ -102,8 +114,6 @@ public:
 	//void RemoveListener(KinectListener *K);
 	//std::vector<KinectListener *> mListeners;
 		
-	CRITICAL_SECTION mListenersLock;
-		
 	void *mInternalData;
 	
 	void DrawGLUTDepthMapTexture();
@@ -117,6 +127,7 @@ public:
 
 	//functions about handle the texture and buffer, not classify yet
 	void ParseUserTexture(xn::SceneMetaData *sceneMetaData,	bool m_front);
+	void ParseForegroundData(xn::DepthMetaData *depthMetaData);
 	void ParseColorDepthData(xn::DepthMetaData *depthMetaData,
 							xn::SceneMetaData *sceneMetaData,
 							xn::ImageMetaData *imageMetaData);
@@ -189,6 +200,10 @@ public:
 	{
 		return m_DepthGenerator.IsValid() ? &depthMetaData : NULL;
 	}
+	const xn::DepthMetaData* getFilteredDepthMetaData()
+	{
+		return m_DepthGenerator.IsValid() && mDepthFilterEnabled ? &filteredDepthMetaData : NULL;
+	}
 	const xn::ImageMetaData* getImageMetaData()
 	{
 		return m_ImageGenerator.IsValid() ? &imageMetaData : NULL;
@@ -232,6 +247,113 @@ public:
 	{
 		return mColoredDepthBuffer; 
 	}
+
+	//times of the last frame, stamped once in readFrame
+	const FrameTime& getFrameTime() const
+	{
+		return mFrameTime;
+	}
+
+	//mapping of the sensor timestamps to TimeService::now
+	const SensorClock& getSensorClock() const
+	{
+		return mSensorClock;
+	}
+
+	//skeletons of all tracked users, fetched once per frame in readFrame
+	const SkeletonSnapshot& getSkeletonSnapshot() const
+	{
+		return mSkeletonSnapshot;
+	}
+
+	//box, pixel count and runs of every user of the scene label map, built once per frame
+	const UserIndex& getUserIndex() const
+	{
+		return mUserIndex;
+	}
+
+	//filtered skeletons, call Predict with the render latency before reading them
+	JointFilter& getJointFilter()
+	{
+		return mJointFilter;
+	}
+
+	//lag and jitter of the joint filter, collected while getJointFilter().m_bCollectStats is set
+	const JointFilterStats& getJointFilterStats() const
+	{
+		return mJointFilter.GetStats();
+	}
+
+	//pose rules evaluated on every snapshot, read the events of the frame after Update
+	PoseRuleEngine& getPoseRules()
+	{
+		return mPoseRules;
+	}
+
+	//rule of the crossed hands end pose (the test of EndPoseDetector), drives the end pose bar
+	XnInt32 getEndPoseRule() const
+	{
+		return mEndPoseRule;
+	}
+
+	//depth based segmentation, works without NITE and for any object
+	DepthBackgroundModel& getBackgroundModel()
+	{
+		return mBackgroundModel;
+	}
+
+	//foreground blobs with stable IDs, an input path that does not need the NITE hands generator
+	const BlobTracker& getBlobTracker() const
+	{
+		return mBlobTracker;
+	}
+
+	void setForegroundEnabled(bool enabled)
+	{
+		mForegroundEnabled = enabled;
+	}
+
+	//denoising of the depth map in readFrame, off by default; it writes a copy and leaves the raw
+	//map to NITE and getDepthMetaData, GetStats gives its timings
+	DepthFilter& getDepthFilter()
+	{
+		return mDepthFilter;
+	}
+
+	void setDepthFilterEnabled(bool enabled)
+	{
+		mDepthFilterEnabled = enabled;
+	}
+
+	//depth registered on the color camera viewpoint, off by default: only the consumers that
+	//overlay depth on the video need it, and it applies to every consumer of the depth node
+	void setDepthRegistration(bool registered);
+
+	bool isDepthRegistered() const
+	{
+		return mDepthRegistered;
+	}
+
+	//microphone samples, one ring per channel filled in readFrame; playback, voice detection
+	//or beamforming read it on their own thread
+	AudioStream& getAudioStream()
+	{
+		return mAudioStream;
+	}
+
+	//plays a 16 bit PCM WAV file into the audio stream instead of the microphones, call it
+	//before initPrimeSensor, or alone with pumpAudioFile when there is no device
+	XnStatus openAudioFile(const char* fileName);
+
+	//pushes the due samples of the audio file, readFrame does it when a device runs
+	void pumpAudioFile()
+	{
+		mAudioFile.Pump(mAudioStream);
+	}
+
+	//writes every new skeleton snapshot to a track file, the input of the joint filter replay
+	//in test/JointFilterTest; NULL closes the track
+	XnStatus recordSkeletonTrack(const char* fileName);
 private:
 
 	xn::Device m_Device;
@@ -239,6 +361,7 @@ private:
 	xn::Context m_Context;
 	xn::ScriptNode m_scriptNode;
 	bool mIsWorking;
+	bool mDepthRegistered;
 
 	//xnCallback hands
 	XnCallbackHandle m_hPoseCallbacks;
@@ -265,20 +388,31 @@ private:
 	XnVSelectableSlider1D* m_pQuitSSlider;
 	
 	//skeleton
-	double m_SmoothingFactor;
 	int m_SmoothingDelta;
 	StartPoseDetector * m_pStartPoseDetector;
-	EndPoseDetector * m_pEndPoseDetector;
+	SkeletonSnapshot mSkeletonSnapshot;
+	JointFilter mJointFilter;
+	FILE* mSkeletonTrack;
+	XnUInt64 mSkeletonTrackTimestamp;
+	PoseRuleEngine mPoseRules;
+	XnInt32 mEndPoseRule;
 	
+	SensorClock mSensorClock;
+	FrameTime mFrameTime;
+
 	//Kinect MetaData
 	xn::SceneMetaData sceneMetaData;
 	xn::DepthMetaData depthMetaData;
+	xn::DepthMetaData filteredDepthMetaData;
 	xn::ImageMetaData imageMetaData;
 	xn::IRMetaData irMetaData;
 	xn::AudioMetaData audioMetaData;
 	
 	//User buffer&texture for Ogre
 	Ogre::TexturePtr mUserTexture;
+	LabelRenderer mUserLabels;         //label colors of mUserTexture, rebuilt every frame
+	LabelRenderer mUserBufferLabels;   //label colors of mUserBuffer
+	UserIndex mUserIndex;
 	Ogre::MaterialPtr mUserMaterial;
 	Ogre::PixelBox   mUserPixelBox;
 	bool             mUserTextureAvailable;
@@ -309,7 +443,13 @@ private:
 	unsigned char	mUserBuffer[KINECT_COLOR_WIDTH * KINECT_COLOR_HEIGHT * 3]; // also tmpeary colore pixel for Ogre
 	unsigned char   mColoredDepthBuffer[KINECT_DEPTH_WIDTH * KINECT_DEPTH_HEIGHT * 3]; //also tempeary colored depth pixel for Ogre
 	unsigned char   m3DDepthBuffer[KINECT_DEPTH_WIDTH * KINECT_DEPTH_HEIGHT * 3]; //also tempeary colored depth pixel for Ogre
-	float mAudioBuffer[KINECT_MICROPHONE_COUNT][KINECT_AUDIO_BUFFER_LENGTH];
+	AudioStream mAudioStream;
+	WavAudioSource mAudioFile;
+	DepthBackgroundModel mBackgroundModel;
+	BlobTracker mBlobTracker;
+	bool mForegroundEnabled;
+	DepthFilter mDepthFilter;
+	bool mDepthFilterEnabled;
 	float depthHist[KINECT_MAX_DEPTH];
 	XnUInt8 PalletIntsR [256];
 	XnUInt8 PalletIntsG [256];
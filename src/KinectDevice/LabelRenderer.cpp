@@ -0,0 +1,137 @@
+#include "LabelRenderer.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define LABEL_RENDERER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+LabelRenderer::LabelRenderer()
+{
+	Fill(0);
+}
+
+void LabelRenderer::SetPalette(const XnUInt32* pColors, XnUInt32 nColors, XnUInt32 nBackground)
+{
+	m_Table[0] = nBackground;
+	for (XnUInt32 i = 1; i < TABLE_SIZE; i++)
+		m_Table[i] = pColors[i % nColors];
+}
+
+void LabelRenderer::SetPalette(const XnFloat (*pColors)[3], XnUInt32 nColors, const XnFloat* pBackground)
+{
+	XnUInt32 packed[TABLE_SIZE];
+	for (XnUInt32 i = 0; i < nColors && i < TABLE_SIZE; i++)
+		packed[i] = PackRGB((XnUInt8)(255*pColors[i][0]), (XnUInt8)(255*pColors[i][1]), (XnUInt8)(255*pColors[i][2]));
+	SetPalette(packed, nColors, PackRGB((XnUInt8)(255*pBackground[0]), (XnUInt8)(255*pBackground[1]), (XnUInt8)(255*pBackground[2])));
+}
+
+void LabelRenderer::Fill(XnUInt32 nColor)
+{
+	for (XnUInt32 i = 0; i < TABLE_SIZE; i++)
+		m_Table[i] = nColor;
+}
+
+void LabelRenderer::RenderRow(const XnLabel* pLabels, XnUInt32* pDest, XnUInt32 nCount, XnBool bMirror) const
+{
+	const XnUInt32* pTable = m_Table;
+	XnUInt32 i = 0;
+
+#if LABEL_RENDERER_USE_SSE2
+	// there is no gather, the SIMD part is the masking, the run test and the stores
+	const __m128i labelMask = _mm_set1_epi16(TABLE_SIZE - 1);
+	for (; i + 8 <= nCount; i += 8)
+	{
+		__m128i labels;
+		if (bMirror)
+		{
+			labels = _mm_loadu_si128((const __m128i*)(pLabels + nCount - i - 8));
+			labels = _mm_shufflelo_epi16(labels, _MM_SHUFFLE(0, 1, 2, 3));
+			labels = _mm_shufflehi_epi16(labels, _MM_SHUFFLE(0, 1, 2, 3));
+			labels = _mm_shuffle_epi32(labels, _MM_SHUFFLE(1, 0, 3, 2));
+		}
+		else
+		{
+			labels = _mm_loadu_si128((const __m128i*)(pLabels + i));
+		}
+		labels = _mm_and_si128(labels, labelMask);
+
+		__m128i first = _mm_shuffle_epi32(_mm_shufflelo_epi16(labels, 0), 0);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(labels, first)) == 0xFFFF)
+		{
+			__m128i color = _mm_set1_epi32((int)pTable[_mm_extract_epi16(labels, 0)]);
+			_mm_storeu_si128((__m128i*)(pDest + i), color);
+			_mm_storeu_si128((__m128i*)(pDest + i + 4), color);
+			continue;
+		}
+
+		__m128i low = _mm_setr_epi32((int)pTable[_mm_extract_epi16(labels, 0)], (int)pTable[_mm_extract_epi16(labels, 1)],
+			(int)pTable[_mm_extract_epi16(labels, 2)], (int)pTable[_mm_extract_epi16(labels, 3)]);
+		__m128i high = _mm_setr_epi32((int)pTable[_mm_extract_epi16(labels, 4)], (int)pTable[_mm_extract_epi16(labels, 5)],
+			(int)pTable[_mm_extract_epi16(labels, 6)], (int)pTable[_mm_extract_epi16(labels, 7)]);
+		_mm_storeu_si128((__m128i*)(pDest + i), low);
+		_mm_storeu_si128((__m128i*)(pDest + i + 4), high);
+	}
+#endif
+
+	if (bMirror)
+	{
+		const XnLabel* pSource = pLabels + nCount - 1;
+		for (; i < nCount; i++)
+			pDest[i] = pTable[pSource[-(XnInt32)i] & (TABLE_SIZE - 1)];
+		return;
+	}
+
+	// unrolled, the lookups are independent loads
+	for (; i + 4 <= nCount; i += 4)
+	{
+		XnUInt32 c0 = pTable[pLabels[i] & (TABLE_SIZE - 1)];
+		XnUInt32 c1 = pTable[pLabels[i + 1] & (TABLE_SIZE - 1)];
+		XnUInt32 c2 = pTable[pLabels[i + 2] & (TABLE_SIZE - 1)];
+		XnUInt32 c3 = pTable[pLabels[i + 3] & (TABLE_SIZE - 1)];
+		pDest[i] = c0;
+		pDest[i + 1] = c1;
+		pDest[i + 2] = c2;
+		pDest[i + 3] = c3;
+	}
+	for (; i < nCount; i++)
+		pDest[i] = pTable[pLabels[i] & (TABLE_SIZE - 1)];
+}
+
+void LabelRenderer::RenderRowReference(const XnLabel* pLabels, XnUInt32* pDest, XnUInt32 nCount, XnBool bMirror) const
+{
+	for (XnUInt32 i = 0; i < nCount; i++)
+	{
+		XnLabel nLabel = bMirror ? pLabels[nCount - 1 - i] : pLabels[i];
+		pDest[i] = GetColor(nLabel);
+	}
+}
+
+void LabelRenderer::RenderRowRGB(const XnLabel* pLabels, const XnDepthPixel* pDepth, const XnFloat* pShade, XnUInt8* pDest, XnUInt32 nCount) const
+{
+	const XnUInt8* pTable = (const XnUInt8*)m_Table;
+	if (pShade == NULL)
+	{
+		for (XnUInt32 i = 0; i < nCount; i++, pDest += 3)
+		{
+			// all ones where there is depth, the color goes through the mask without a branch
+			XnUInt8 nMask = (XnUInt8)(0 - (pDepth[i] != 0));
+			const XnUInt8* pColor = pTable + 4*(pLabels[i] & (TABLE_SIZE - 1));
+			pDest[0] = pColor[0] & nMask;
+			pDest[1] = pColor[1] & nMask;
+			pDest[2] = pColor[2] & nMask;
+		}
+		return;
+	}
+
+	for (XnUInt32 i = 0; i < nCount; i++, pDest += 3)
+	{
+		// pShade[0] is 0, pixels without depth come out black
+		XnUInt32 nShade = (XnUInt32)pShade[pDepth[i]];
+		const XnUInt8* pColor = pTable + 4*(pLabels[i] & (TABLE_SIZE - 1));
+		// x / 255 for x up to 256 * 255
+		XnUInt32 r = nShade*pColor[0], g = nShade*pColor[1], b = nShade*pColor[2];
+		pDest[0] = (XnUInt8)((r + 1 + (r >> 8)) >> 8);
+		pDest[1] = (XnUInt8)((g + 1 + (g >> 8)) >> 8);
+		pDest[2] = (XnUInt8)((b + 1 + (b >> 8)) >> 8);
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef _LabelRenderer
+#define _LabelRenderer
+
+#include <XnTypes.h>
+#include <string.h>
+
+/// @brief Draws user label maps through a label to color lookup table.
+///
+/// The table holds one 32 bit pixel per label, built once per frame (or once for a fixed
+/// palette), so drawing a pixel is a single lookup instead of a modulo, compares and float
+/// multiplies. Labels wrap at TABLE_SIZE, far above the number of users NITE tracks.
+/// For the RGB24 outputs an entry is read as its R, G, B bytes in memory order, see PackRGB.
+/// RenderRow takes 8 labels per SSE2 step, a step of a single label (background, inside a user)
+/// is stored as one broadcast color; it gives exactly the pixels of RenderRowReference.
+class LabelRenderer
+{
+public:
+	enum { TABLE_SIZE = 256 };
+
+	LabelRenderer();
+
+	/// @brief Label i gets pColors[i % nColors], label 0 gets nBackground.
+	void SetPalette(const XnUInt32* pColors, XnUInt32 nColors, XnUInt32 nBackground);
+	/// @brief Same with 0 to 1 RGB colors, packed by PackRGB.
+	void SetPalette(const XnFloat (*pColors)[3], XnUInt32 nColors, const XnFloat* pBackground);
+	void Fill(XnUInt32 nColor);
+
+	void SetColor(XnLabel nLabel, XnUInt32 nColor) { m_Table[nLabel & (TABLE_SIZE - 1)] = nColor; }
+	XnUInt32 GetColor(XnLabel nLabel) const { return m_Table[nLabel & (TABLE_SIZE - 1)]; }
+	const XnUInt32* GetTable() const { return m_Table; }
+
+	/// @brief 32 bit pixels, read right to left when bMirror is set.
+	void RenderRow(const XnLabel* pLabels, XnUInt32* pDest, XnUInt32 nCount, XnBool bMirror) const;
+	/// @brief Plain per pixel implementation, the reference of the SIMD path.
+	void RenderRowReference(const XnLabel* pLabels, XnUInt32* pDest, XnUInt32 nCount, XnBool bMirror) const;
+
+	/// @brief RGB24 pixels, black where there is no depth.
+	/// @param pShade optional, a pixel is pShade[depth] (0 to 255, a depth histogram) times its 0 to 1 color
+	void RenderRowRGB(const XnLabel* pLabels, const XnDepthPixel* pDepth, const XnFloat* pShade, XnUInt8* pDest, XnUInt32 nCount) const;
+
+	static XnUInt32 PackRGB(XnUInt8 nRed, XnUInt8 nGreen, XnUInt8 nBlue, XnUInt8 nAlpha = 0xFF)
+	{
+		XnUInt8 bytes[4] = { nRed, nGreen, nBlue, nAlpha };
+		XnUInt32 nColor;
+		memcpy(&nColor, bytes, sizeof(nColor));
+		return nColor;
+	}
+
+private:
+	XnUInt32 m_Table[TABLE_SIZE];
+};
+
+#endif
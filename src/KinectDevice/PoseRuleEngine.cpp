@@ -0,0 +1,295 @@
+#include "PoseRuleEngine.h"
+#include <math.h>
+#include <string.h>
+
+PoseRuleEngine::PoseRuleEngine()
+{
+	m_fMinConfidence = 0.5f;
+	m_nConditions = 0;
+	m_nTimestamp = 0;
+	m_fTime = 0;
+	m_pClock = NULL;
+	memset(m_UserIDs, 0, sizeof(m_UserIDs));
+}
+
+XnInt32 PoseRuleEngine::AddCondition(const PoseCondition& condition)
+{
+	for (XnUInt32 i = 0; i < m_nConditions; i++)
+	{
+		const PoseCondition& other = m_Conditions[i];
+		if (other.eJointA == condition.eJointA && other.eJointB == condition.eJointB &&
+			other.eAxis == condition.eAxis && other.eCompare == condition.eCompare &&
+			other.fThreshold == condition.fThreshold)
+		{
+			return (XnInt32)i;
+		}
+	}
+
+	if (m_nConditions == MAX_CONDITIONS)
+		return -1;
+
+	m_Conditions[m_nConditions] = condition;
+	m_ConditionJoints[m_nConditions] = (1u << (condition.eJointA - 1)) | (1u << (condition.eJointB - 1));
+	return (XnInt32)m_nConditions++;
+}
+
+XnInt32 PoseRuleEngine::AddRule(const XnChar* strName, const PoseCondition* pConditions, XnUInt32 nConditions,
+	XnDouble fHoldTime, XnDouble fGraceTime)
+{
+	if (nConditions == 0)
+		return -1;
+	for (XnUInt32 i = 0; i < nConditions; i++)
+	{
+		if ((XnUInt32)pConditions[i].eJointA < 1 || (XnUInt32)pConditions[i].eJointA > SKELETON_JOINT_COUNT ||
+			(XnUInt32)pConditions[i].eJointB < 1 || (XnUInt32)pConditions[i].eJointB > SKELETON_JOINT_COUNT)
+		{
+			return -1;
+		}
+	}
+
+	Rule rule;
+	rule.strName = strName;
+	rule.nMask = 0;
+	rule.fHoldTime = fHoldTime;
+	rule.fGraceTime = fGraceTime;
+	// when the table fills up, the conditions already added for this rule stay unused in it
+	for (XnUInt32 i = 0; i < nConditions; i++)
+	{
+		XnInt32 nCondition = AddCondition(pConditions[i]);
+		if (nCondition < 0)
+			return -1;
+		rule.nMask |= (XnUInt64)1 << nCondition;
+	}
+
+	// the states are stored slot by slot, spread them for the new rule
+	const XnUInt32 nRules = (XnUInt32)m_Rules.size();
+	RuleState outState = { RULE_OUT, 0, 0 };
+	std::vector<RuleState> states(SKELETON_MAX_USERS*(nRules + 1), outState);
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS && nRules > 0; nSlot++)
+	{
+		for (XnUInt32 nRule = 0; nRule < nRules; nRule++)
+			states[nSlot*(nRules + 1) + nRule] = m_States[nSlot*nRules + nRule];
+	}
+	m_States.swap(states);
+	m_Rules.push_back(rule);
+	return (XnInt32)nRules;
+}
+
+void PoseRuleEngine::RemoveAllRules()
+{
+	m_Rules.clear();
+	m_States.clear();
+	m_Events.clear();
+	m_nConditions = 0;
+	memset(m_UserIDs, 0, sizeof(m_UserIDs));
+}
+
+XnInt32 PoseRuleEngine::FindRule(const XnChar* strName) const
+{
+	for (XnUInt32 nRule = 0; nRule < m_Rules.size(); nRule++)
+	{
+		if (m_Rules[nRule].strName == strName)
+			return (XnInt32)nRule;
+	}
+	return -1;
+}
+
+void PoseRuleEngine::Reset()
+{
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+	{
+		if (m_UserIDs[nSlot] != 0)
+			ExitSlot(nSlot);
+		m_UserIDs[nSlot] = 0;
+	}
+}
+
+void PoseRuleEngine::Update(const SkeletonSnapshot& snapshot)
+{
+	if (snapshot.GetTimestamp() == m_nTimestamp && m_nTimestamp != 0)
+	{
+		m_Events.clear();
+		return; // no new frame
+	}
+	m_Events.clear();
+
+	// a recording looped, the poses in progress cannot be timed any more
+	if (snapshot.GetTimestamp() < m_nTimestamp)
+		Reset();
+	m_nTimestamp = snapshot.GetTimestamp();
+	m_fTime = m_pClock != NULL ? TimeService::toSeconds(m_pClock->toHost(m_nTimestamp)) : (XnDouble)m_nTimestamp / 1e6;
+
+	if (m_Rules.empty())
+		return;
+
+	// users no longer tracked leave their poses
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+	{
+		if (m_UserIDs[nSlot] != 0 && !snapshot.IsTracking(m_UserIDs[nSlot]))
+		{
+			ExitSlot(nSlot);
+			m_UserIDs[nSlot] = 0;
+		}
+	}
+
+	for (XnUInt32 nUser = 0; nUser < snapshot.GetUserCount(); nUser++)
+	{
+		XnUserID nUserID = snapshot.GetUserID(nUser);
+		XnUInt32 nSlot;
+		for (nSlot = 0; nSlot < SKELETON_MAX_USERS && m_UserIDs[nSlot] != nUserID; nSlot++)
+			;
+		if (nSlot == SKELETON_MAX_USERS)
+		{
+			// new user, its states were left out by ExitSlot
+			for (nSlot = 0; nSlot < SKELETON_MAX_USERS && m_UserIDs[nSlot] != 0; nSlot++)
+				;
+			if (nSlot == SKELETON_MAX_USERS)
+				continue;
+			m_UserIDs[nSlot] = nUserID;
+		}
+
+		XnUInt64 nTrue, nUnknown;
+		EvaluateConditions(snapshot, nUser, nTrue, nUnknown);
+		UpdateRules(nSlot, nTrue, nUnknown);
+	}
+}
+
+void PoseRuleEngine::EvaluateConditions(const SkeletonSnapshot& snapshot, XnUInt32 nUser, XnUInt64& nTrue, XnUInt64& nUnknown) const
+{
+	const XnPoint3D* pPositions = snapshot.GetPositions() + nUser*SKELETON_JOINT_COUNT;
+	const XnFloat* pConfidences = snapshot.GetPositionConfidences() + nUser*SKELETON_JOINT_COUNT;
+
+	XnUInt32 nJoints = 0;
+	for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+	{
+		if (snapshot.IsJointActive((XnSkeletonJoint)(nJoint + 1)) && pConfidences[nJoint] >= m_fMinConfidence)
+			nJoints |= 1u << nJoint;
+	}
+
+	nTrue = 0;
+	nUnknown = 0;
+	for (XnUInt32 i = 0; i < m_nConditions; i++)
+	{
+		const XnUInt64 nBit = (XnUInt64)1 << i;
+		if ((m_ConditionJoints[i] & ~nJoints) != 0)
+		{
+			nUnknown |= nBit;
+			continue;
+		}
+
+		const PoseCondition& condition = m_Conditions[i];
+		const XnPoint3D& a = pPositions[condition.eJointA - 1];
+		const XnPoint3D& b = pPositions[condition.eJointB - 1];
+		XnFloat fValue;
+		switch (condition.eAxis)
+		{
+		case POSE_AXIS_X: fValue = a.X - b.X; break;
+		case POSE_AXIS_Y: fValue = a.Y - b.Y; break;
+		case POSE_AXIS_Z: fValue = a.Z - b.Z; break;
+		default:
+			fValue = sqrtf((a.X - b.X)*(a.X - b.X) + (a.Y - b.Y)*(a.Y - b.Y) + (a.Z - b.Z)*(a.Z - b.Z));
+			break;
+		}
+
+		XnBool bTrue;
+		switch (condition.eCompare)
+		{
+		case POSE_LESS:        bTrue = fValue < condition.fThreshold; break;
+		case POSE_GREATER:     bTrue = fValue > condition.fThreshold; break;
+		case POSE_ABS_LESS:    bTrue = fabsf(fValue) < condition.fThreshold; break;
+		default:               bTrue = fabsf(fValue) > condition.fThreshold; break;
+		}
+		if (bTrue)
+			nTrue |= nBit;
+	}
+}
+
+void PoseRuleEngine::UpdateRules(XnUInt32 nSlot, XnUInt64 nTrue, XnUInt64 nUnknown)
+{
+	const XnUInt32 nRules = (XnUInt32)m_Rules.size();
+	RuleState* pStates = &m_States[nSlot*nRules];
+	for (XnUInt32 nRule = 0; nRule < nRules; nRule++)
+	{
+		const Rule& rule = m_Rules[nRule];
+		RuleState& state = pStates[nRule];
+		XnBool bInPose = (rule.nMask & nTrue) == rule.nMask;
+		XnBool bOutOfPose = (rule.nMask & ~nTrue & ~nUnknown) != 0;
+
+		if (state.eState == RULE_OUT)
+		{
+			if (!bInPose)
+				continue;
+			state.eState = RULE_ENTERED;
+			state.fEnterTime = m_fTime;
+			state.fLastSeenTime = m_fTime;
+			PushEvent(POSE_EVENT_ENTER, nRule, m_UserIDs[nSlot], state.fEnterTime);
+		}
+		else if (bOutOfPose || (!bInPose && m_fTime - state.fLastSeenTime > rule.fGraceTime))
+		{
+			PushEvent(POSE_EVENT_EXIT, nRule, m_UserIDs[nSlot], state.fEnterTime);
+			state.eState = RULE_OUT;
+			continue;
+		}
+		else if (bInPose)
+		{
+			state.fLastSeenTime = m_fTime;
+		}
+
+		if (state.eState == RULE_ENTERED && m_fTime - state.fEnterTime >= rule.fHoldTime)
+		{
+			state.eState = RULE_HELD;
+			PushEvent(POSE_EVENT_HOLD, nRule, m_UserIDs[nSlot], state.fEnterTime);
+		}
+	}
+}
+
+void PoseRuleEngine::ExitSlot(XnUInt32 nSlot)
+{
+	const XnUInt32 nRules = (XnUInt32)m_Rules.size();
+	for (XnUInt32 nRule = 0; nRule < nRules; nRule++)
+	{
+		RuleState& state = m_States[nSlot*nRules + nRule];
+		if (state.eState != RULE_OUT)
+			PushEvent(POSE_EVENT_EXIT, nRule, m_UserIDs[nSlot], state.fEnterTime);
+		state.eState = RULE_OUT;
+	}
+}
+
+void PoseRuleEngine::PushEvent(PoseEventType eType, XnUInt32 nRule, XnUserID nUserID, XnDouble fEnterTime)
+{
+	PoseEvent event;
+	event.eType = eType;
+	event.nRule = nRule;
+	event.nUserID = nUserID;
+	event.fDuration = m_fTime - fEnterTime;
+	m_Events.push_back(event);
+}
+
+const PoseRuleEngine::RuleState* PoseRuleEngine::GetState(XnUInt32 nRule, XnUserID nUserID) const
+{
+	if (nUserID == 0 || nRule >= m_Rules.size())
+		return NULL;
+	for (XnUInt32 nSlot = 0; nSlot < SKELETON_MAX_USERS; nSlot++)
+	{
+		if (m_UserIDs[nSlot] == nUserID)
+			return &m_States[nSlot*m_Rules.size() + nRule];
+	}
+	return NULL;
+}
+
+XnBool PoseRuleEngine::IsInPose(XnUInt32 nRule, XnUserID nUserID) const
+{
+	const RuleState* pState = GetState(nRule, nUserID);
+	return pState != NULL && pState->eState != RULE_OUT;
+}
+
+XnDouble PoseRuleEngine::GetProgress(XnUInt32 nRule, XnUserID nUserID) const
+{
+	const RuleState* pState = GetState(nRule, nUserID);
+	if (pState == NULL || pState->eState == RULE_OUT)
+		return 0;
+	if (pState->eState == RULE_HELD || m_Rules[nRule].fHoldTime <= 0)
+		return 1;
+	XnDouble fProgress = (m_fTime - pState->fEnterTime) / m_Rules[nRule].fHoldTime;
+	return fProgress < 1 ? fProgress : 1;
+}
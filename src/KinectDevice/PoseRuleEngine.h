@@ -0,0 +1,143 @@
+#ifndef _PoseRuleEngine
+#define _PoseRuleEngine
+
+#include <vector>
+#include <string>
+#include "SkeletonSnapshot.h"
+#include "TimeService.h"
+
+/// @brief Component of jointA - jointB a PoseCondition tests.
+enum PoseAxis
+{
+	POSE_AXIS_X,
+	POSE_AXIS_Y,
+	POSE_AXIS_Z,
+	POSE_AXIS_DISTANCE,    ///< @brief distance between the two joints
+};
+
+enum PoseCompare
+{
+	POSE_LESS,             ///< @brief value < threshold
+	POSE_GREATER,          ///< @brief value > threshold
+	POSE_ABS_LESS,         ///< @brief |value| < threshold
+	POSE_ABS_GREATER,      ///< @brief |value| > threshold
+};
+
+/// @brief One predicate of a pose rule, on the real world positions of two joints (mm).
+struct PoseCondition
+{
+	XnSkeletonJoint eJointA;
+	XnSkeletonJoint eJointB;
+	PoseAxis eAxis;
+	PoseCompare eCompare;
+	XnFloat fThreshold;
+};
+
+enum PoseEventType
+{
+	POSE_EVENT_ENTER,      ///< @brief all the conditions of the rule became true
+	POSE_EVENT_HOLD,       ///< @brief the pose was kept for the hold time of the rule
+	POSE_EVENT_EXIT,       ///< @brief the pose was left, or the user lost
+};
+
+struct PoseEvent
+{
+	PoseEventType eType;
+	XnUInt32 nRule;
+	XnUserID nUserID;
+	XnDouble fDuration;    ///< @brief seconds since the pose was entered
+};
+
+/// @brief Declarative pose detection over the SkeletonSnapshot.
+///
+/// A rule is a conjunction of PoseConditions plus a hold time. Update evaluates all the rules
+/// for all the users of a snapshot in one pass, at the snapshot timestamp mapped to the
+/// TimeService clock by the SensorClock of the device, so every rule and every detector timed
+/// with GetTime shares one clock and no timer is read per check. Identical conditions of different rules
+/// are stored once: each user costs one test per distinct condition, giving a bit mask, and one
+/// mask compare per rule. The transitions of the frame are reported as PoseEvents.
+///
+/// Conditions on a joint below m_fMinConfidence are unknown: a pose keeps its state while its
+/// conditions are unknown, for at most the grace time of the rule.
+class PoseRuleEngine
+{
+public:
+	enum { MAX_CONDITIONS = 64 };    ///< @brief distinct conditions over all the rules
+
+	PoseRuleEngine();
+
+	/// @brief Adds a rule, the conditions are copied.
+	/// @return index of the rule, -1 if the condition table is full
+	XnInt32 AddRule(const XnChar* strName, const PoseCondition* pConditions, XnUInt32 nConditions,
+		XnDouble fHoldTime, XnDouble fGraceTime = 0.25);
+	void RemoveAllRules();
+
+	XnUInt32 GetRuleCount() const { return (XnUInt32)m_Rules.size(); }
+	const XnChar* GetRuleName(XnUInt32 nRule) const { return m_Rules[nRule].strName.c_str(); }
+	/// @brief Index of a rule, -1 if there is no rule of that name.
+	XnInt32 FindRule(const XnChar* strName) const;
+
+	/// @brief Maps the snapshot timestamps to TimeService time. Without a clock (replays of a
+	/// recorded track) the time is the sensor timestamp in seconds.
+	void SetSensorClock(const SensorClock* pClock) { m_pClock = pClock; }
+
+	/// @brief Evaluates the rules on a new snapshot, the events of the previous update are cleared.
+	void Update(const SkeletonSnapshot& snapshot);
+	/// @brief Forgets the users, an exit event is emitted for every pose in progress.
+	void Reset();
+
+	XnUInt32 GetEventCount() const { return (XnUInt32)m_Events.size(); }
+	const PoseEvent& GetEvent(XnUInt32 nEvent) const { return m_Events[nEvent]; }
+
+	XnBool IsInPose(XnUInt32 nRule, XnUserID nUserID) const;
+	/// @brief Time in pose over the hold time, from 0 to 1 (same meaning as PoseDetectorBase::GetDetectionPercent).
+	XnDouble GetProgress(XnUInt32 nRule, XnUserID nUserID) const;
+	/// @brief Seconds on the TimeService clock, time of the last snapshot evaluated.
+	XnDouble GetTime() const { return m_fTime; }
+
+	XnFloat m_fMinConfidence;
+
+private:
+	enum RuleStateType
+	{
+		RULE_OUT,
+		RULE_ENTERED,
+		RULE_HELD,
+	};
+
+	struct Rule
+	{
+		std::string strName;
+		XnUInt64 nMask;         ///< @brief bits of the distinct conditions the rule needs
+		XnDouble fHoldTime;
+		XnDouble fGraceTime;
+	};
+
+	struct RuleState
+	{
+		XnUInt32 eState;
+		XnDouble fEnterTime;
+		XnDouble fLastSeenTime;  ///< @brief last time all the conditions were known and true
+	};
+
+	XnInt32 AddCondition(const PoseCondition& condition);
+	void EvaluateConditions(const SkeletonSnapshot& snapshot, XnUInt32 nUser, XnUInt64& nTrue, XnUInt64& nUnknown) const;
+	void UpdateRules(XnUInt32 nSlot, XnUInt64 nTrue, XnUInt64 nUnknown);
+	void ExitSlot(XnUInt32 nSlot);
+	void PushEvent(PoseEventType eType, XnUInt32 nRule, XnUserID nUserID, XnDouble fEnterTime);
+	const RuleState* GetState(XnUInt32 nRule, XnUserID nUserID) const;
+
+	std::vector<Rule> m_Rules;
+	XnUInt32 m_nConditions;
+	PoseCondition m_Conditions[MAX_CONDITIONS];
+	XnUInt32 m_ConditionJoints[MAX_CONDITIONS];   ///< @brief bit joint - 1 set for the joints a condition reads
+
+	XnUserID m_UserIDs[SKELETON_MAX_USERS];
+	std::vector<RuleState> m_States;              ///< @brief slot * rule count + rule
+	std::vector<PoseEvent> m_Events;
+	XnUInt64 m_nTimestamp;
+	XnDouble m_fTime;
+	const SensorClock* m_pClock;
+};
+
+#endif
@@ -0,0 +1,310 @@
+#include "ReplayDecoder.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Kinect;
+
+static XnUInt32 GetProcessorCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long nCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return nCount > 0 ? (XnUInt32)nCount : 1;
+#endif
+}
+
+ReplayDecoder::ReplayDecoder()
+{
+	m_nFrames = 0;
+	m_nFirstFrame = 1;
+	m_nNextFrame = 1;
+	m_nFirstHeld = 1;
+	m_nLastError = XN_STATUS_OK;
+	m_bStop = false;
+	m_hLock = NULL;
+	m_hFrameReady = NULL;
+}
+
+ReplayDecoder::~ReplayDecoder()
+{
+	Close();
+}
+
+XnStatus ReplayDecoder::OpenWorker(Worker* pWorker, const XnChar* strFileName, XnProductionNodeType nodeType)
+{
+	XnStatus rc = pWorker->context.Init();
+	XN_IS_STATUS_OK(rc);
+	rc = pWorker->context.OpenFileRecording(strFileName, pWorker->player);
+	XN_IS_STATUS_OK(rc);
+	rc = pWorker->player.SetRepeat(FALSE);
+	XN_IS_STATUS_OK(rc);
+	rc = pWorker->player.SetPlaybackSpeed(XN_PLAYBACK_SPEED_FASTEST);
+	XN_IS_STATUS_OK(rc);
+	return pWorker->context.FindExistingNode(nodeType, pWorker->generator);
+}
+
+XnStatus ReplayDecoder::Open(const XnChar* strFileName, XnProductionNodeType nodeType, XnUInt32 nFirstFrame, XnUInt32 nThreads, XnUInt32 nQueueSize)
+{
+	Close();
+
+	if (nThreads == 0)
+		nThreads = GetProcessorCount();
+	if (nQueueSize == 0)
+		nQueueSize = 2 * CHUNK_FRAMES * nThreads;
+
+	XnStatus rc = xnOSCreateCriticalSection(&m_hLock);
+	if (rc == XN_STATUS_OK)
+		rc = xnOSCreateEvent(&m_hFrameReady, FALSE);
+
+	for (XnUInt32 i = 0; i < nThreads && rc == XN_STATUS_OK; i++)
+	{
+		Worker* pWorker = new Worker;
+		pWorker->pDecoder = this;
+		pWorker->nIndex = i;
+		pWorker->hWake = NULL;
+		pWorker->hThread = NULL;
+		m_Workers.push_back(pWorker);
+		rc = OpenWorker(pWorker, strFileName, nodeType);
+		if (rc == XN_STATUS_OK)
+			rc = xnOSCreateEvent(&pWorker->hWake, FALSE);
+	}
+
+	if (rc == XN_STATUS_OK)
+		rc = m_Workers[0]->player.GetNumFrames(m_Workers[0]->generator.GetName(), m_nFrames);
+
+	if (rc != XN_STATUS_OK)
+	{
+		Close();
+		return rc;
+	}
+
+	m_Slots.resize(nQueueSize);
+	for (XnUInt32 i = 0; i < nQueueSize; i++)
+		m_Slots[i].bReady = false;
+	m_nFirstFrame = XN_MAX(nFirstFrame, 1);
+	m_nNextFrame = m_nFirstFrame;
+	m_nFirstHeld = m_nFirstFrame;
+	m_nLastError = XN_STATUS_OK;
+	m_bStop = false;
+
+	for (XnUInt32 i = 0; i < m_Workers.size() && rc == XN_STATUS_OK; i++)
+		rc = xnOSCreateThread(WorkerThread, m_Workers[i], &m_Workers[i]->hThread);
+
+	if (rc != XN_STATUS_OK)
+		Close();
+	return rc;
+}
+
+void ReplayDecoder::Close()
+{
+	if (m_hLock != NULL)
+	{
+		xnOSEnterCriticalSection(&m_hLock);
+		m_bStop = true;
+		xnOSLeaveCriticalSection(&m_hLock);
+	}
+
+	for (size_t i = 0; i < m_Workers.size(); i++)
+	{
+		if (m_Workers[i]->hWake != NULL)
+			xnOSSetEvent(m_Workers[i]->hWake);
+	}
+
+	for (size_t i = 0; i < m_Workers.size(); i++)
+	{
+		Worker* pWorker = m_Workers[i];
+		if (pWorker->hThread != NULL)
+		{
+			xnOSWaitForThreadExit(pWorker->hThread, XN_WAIT_INFINITE);
+			xnOSCloseThread(&pWorker->hThread);
+		}
+		if (pWorker->hWake != NULL)
+			xnOSCloseEvent(&pWorker->hWake);
+		pWorker->generator.Release();
+		pWorker->player.Release();
+		pWorker->context.Release();
+		delete pWorker;
+	}
+	m_Workers.clear();
+	m_Slots.clear();
+
+	if (m_hFrameReady != NULL)
+	{
+		xnOSCloseEvent(&m_hFrameReady);
+		m_hFrameReady = NULL;
+	}
+	if (m_hLock != NULL)
+	{
+		xnOSCloseCriticalSection(&m_hLock);
+		m_hLock = NULL;
+	}
+	m_nFrames = 0;
+}
+
+const ReplayFrame* ReplayDecoder::Next(XnUInt32 nTimeout)
+{
+	if (!IsOpen())
+		return NULL;
+
+	const XnUInt32 nQueueSize = (XnUInt32)m_Slots.size();
+
+	// the frame returned by the previous call is done with, its slot can take a new frame
+	bool bReleased = false;
+	xnOSEnterCriticalSection(&m_hLock);
+	if (m_nFirstHeld < m_nNextFrame)
+	{
+		m_Slots[(m_nFirstHeld - 1) % nQueueSize].bReady = false;
+		m_nFirstHeld = m_nNextFrame;
+		bReleased = true;
+	}
+	xnOSLeaveCriticalSection(&m_hLock);
+
+	if (bReleased)
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			xnOSSetEvent(m_Workers[i]->hWake);
+	}
+
+	if (m_nNextFrame > m_nFrames)
+		return NULL;
+
+	Slot& slot = m_Slots[(m_nNextFrame - 1) % nQueueSize];
+	for (;;)
+	{
+		xnOSEnterCriticalSection(&m_hLock);
+		bool bReady = slot.bReady;
+		XnStatus nError = m_nLastError;
+		xnOSLeaveCriticalSection(&m_hLock);
+
+		if (bReady)
+			break;
+		if (nError != XN_STATUS_OK)
+			return NULL;
+		if (xnOSWaitEvent(m_hFrameReady, nTimeout) != XN_STATUS_OK)
+			return NULL;
+	}
+
+	m_nNextFrame++;
+	return &slot.frame;
+}
+
+XnUInt32 ReplayDecoder::GetReadyCount()
+{
+	if (!IsOpen())
+		return 0;
+
+	XnUInt32 nReady = 0;
+	xnOSEnterCriticalSection(&m_hLock);
+	for (size_t i = 0; i < m_Slots.size(); i++)
+	{
+		if (m_Slots[i].bReady)
+			nReady++;
+	}
+	xnOSLeaveCriticalSection(&m_hLock);
+
+	// the frame the reader holds is not waiting any more
+	return (m_nFirstHeld < m_nNextFrame && nReady > 0) ? nReady - 1 : nReady;
+}
+
+bool ReplayDecoder::WaitForSlot(Worker* pWorker, XnUInt32 nFrame)
+{
+	for (;;)
+	{
+		xnOSEnterCriticalSection(&m_hLock);
+		bool bFits = nFrame < m_nFirstHeld + m_Slots.size();
+		bool bStop = m_bStop;
+		xnOSLeaveCriticalSection(&m_hLock);
+
+		if (bStop)
+			return false;
+		if (bFits)
+			return true;
+		xnOSWaitEvent(pWorker->hWake, XN_WAIT_INFINITE);
+	}
+}
+
+void ReplayDecoder::Decode(Worker* pWorker)
+{
+	const XnUInt32 nThreads = (XnUInt32)m_Workers.size();
+	const XnUInt32 nQueueSize = (XnUInt32)m_Slots.size();
+	const XnChar* strName = pWorker->generator.GetName();
+	XnStatus rc = XN_STATUS_OK;
+
+	for (XnUInt32 nChunk = pWorker->nIndex; rc == XN_STATUS_OK; nChunk += nThreads)
+	{
+		XnUInt32 nFirst = m_nFirstFrame + nChunk * CHUNK_FRAMES;
+		if (nFirst > m_nFrames)
+			break;
+		XnUInt32 nLast = XN_MIN(nFirst + CHUNK_FRAMES - 1, m_nFrames);
+
+		if (!WaitForSlot(pWorker, nFirst))
+			return;
+
+		// one seek per chunk, then the frames of the chunk are read in order
+		XnUInt32 nPosition = 0;
+		rc = pWorker->player.SeekToFrame(strName, nFirst, XN_PLAYER_SEEK_SET);
+		if (rc == XN_STATUS_OK)
+			rc = pWorker->player.TellFrame(strName, nPosition);
+
+		for (XnUInt32 nFrame = nFirst; nFrame <= nLast && rc == XN_STATUS_OK; nFrame++)
+		{
+			if (!WaitForSlot(pWorker, nFrame))
+				return;
+
+			// right after the seek the node may already hold the frame
+			if (nPosition < nFrame)
+			{
+				rc = pWorker->context.WaitOneUpdateAll(pWorker->generator);
+				if (rc == XN_STATUS_OK)
+					rc = pWorker->player.TellFrame(strName, nPosition);
+				if (rc == XN_STATUS_OK && nPosition != nFrame)
+					rc = XN_STATUS_ERROR;
+				if (rc != XN_STATUS_OK)
+					break;
+			}
+
+			// no other thread writes the slot: its next frame is a whole queue later, and only
+			// fits once this one has been read
+			Slot& slot = m_Slots[(nFrame - 1) % nQueueSize];
+			const XnUInt8* pData = (const XnUInt8*)pWorker->generator.GetData();
+			slot.buffer.assign(pData, pData + pWorker->generator.GetDataSize());
+
+			XnMapOutputMode mode;
+			pWorker->generator.GetMapOutputMode(mode);
+			slot.frame.nFrame = nFrame;
+			slot.frame.nFrameID = pWorker->generator.GetFrameID();
+			slot.frame.nTimestamp = pWorker->generator.GetTimestamp();
+			slot.frame.nXRes = mode.nXRes;
+			slot.frame.nYRes = mode.nYRes;
+			slot.frame.nDataSize = (XnUInt32)slot.buffer.size();
+			slot.frame.pData = slot.buffer.empty() ? NULL : &slot.buffer[0];
+
+			xnOSEnterCriticalSection(&m_hLock);
+			slot.bReady = true;
+			xnOSLeaveCriticalSection(&m_hLock);
+			xnOSSetEvent(m_hFrameReady);
+		}
+	}
+
+	if (rc != XN_STATUS_OK)
+	{
+		xnOSEnterCriticalSection(&m_hLock);
+		m_nLastError = rc;
+		xnOSLeaveCriticalSection(&m_hLock);
+		xnOSSetEvent(m_hFrameReady);
+	}
+}
+
+XN_THREAD_PROC ReplayDecoder::WorkerThread(XN_THREAD_PARAM pCookie)
+{
+	Worker* pWorker = (Worker*)pCookie;
+	pWorker->pDecoder->Decode(pWorker);
+	XN_THREAD_PROC_RETURN(XN_STATUS_OK);
+}
@@ -0,0 +1,100 @@
+#ifndef _ReplayDecoder
+#define _ReplayDecoder
+
+#include <XnCppWrapper.h>
+#include <XnOS.h>
+#include <vector>
+
+namespace Kinect
+{
+
+/// @brief A decoded frame of a recorded map node.
+struct ReplayFrame
+{
+	XnUInt32 nFrame;        ///< @brief position in the recording, from 1 like the player
+	XnUInt32 nFrameID;
+	XnUInt64 nTimestamp;
+	XnUInt32 nXRes;
+	XnUInt32 nYRes;
+	XnUInt32 nDataSize;
+	const XnUInt8* pData;
+};
+
+/// @brief Decodes the frames of one node of a recording ahead of the reader, on several threads.
+///
+/// A player decodes one frame at a time on the thread that reads it. Here every decoder thread
+/// opens the recording in a context of its own, with the player at full speed, and decodes
+/// chunks of CHUNK_FRAMES consecutive frames: thread k of N takes chunks k, k + N, k + 2N... Frames
+/// are therefore produced out of order; frame f is written to slot (f - 1) % queue size, so
+/// Next hands them out in recording order. A thread waits when the frame it decodes next is a
+/// whole queue ahead of the reader, which bounds the memory to the queue size in frames.
+///
+/// Meant for batch processing of recordings, where decoding rather than the processing of the
+/// frames is the bottleneck.
+class ReplayDecoder
+{
+public:
+	enum { CHUNK_FRAMES = 8 };
+
+	ReplayDecoder();
+	~ReplayDecoder();
+
+	/// @param nodeType XN_NODE_TYPE_DEPTH, XN_NODE_TYPE_IMAGE or XN_NODE_TYPE_IR
+	/// @param nFirstFrame frame to start from, from 1
+	/// @param nThreads decoder threads, 0 for one per core
+	/// @param nQueueSize frames decoded ahead of the reader, 0 for two chunks per thread
+	XnStatus Open(const XnChar* strFileName, XnProductionNodeType nodeType, XnUInt32 nFirstFrame = 1, XnUInt32 nThreads = 0, XnUInt32 nQueueSize = 0);
+	void Close();
+	bool IsOpen() const { return !m_Workers.empty(); }
+
+	/// @brief Next frame in recording order, valid until the next call. Waits up to nTimeout
+	/// milliseconds for it to be decoded.
+	/// @return NULL at the end of the recording, on a decoding error or when it timed out
+	const ReplayFrame* Next(XnUInt32 nTimeout = XN_WAIT_INFINITE);
+
+	XnUInt32 GetFrameCount() const { return m_nFrames; }
+	XnUInt32 GetThreadCount() const { return (XnUInt32)m_Workers.size(); }
+	/// @brief Frames decoded and waiting to be read.
+	XnUInt32 GetReadyCount();
+	XnStatus GetLastError() const { return m_nLastError; }
+
+private:
+	struct Slot
+	{
+		ReplayFrame frame;
+		std::vector<XnUInt8> buffer;
+		bool bReady;
+	};
+
+	struct Worker
+	{
+		ReplayDecoder* pDecoder;
+		XnUInt32 nIndex;
+		xn::Context context;
+		xn::Player player;
+		xn::MapGenerator generator;
+		XN_EVENT_HANDLE hWake;
+		XN_THREAD_HANDLE hThread;
+	};
+
+	static XN_THREAD_PROC WorkerThread(XN_THREAD_PARAM pCookie);
+	void Decode(Worker* pWorker);
+	/// @brief Waits until frame nFrame fits in the queue, false when closing.
+	bool WaitForSlot(Worker* pWorker, XnUInt32 nFrame);
+	XnStatus OpenWorker(Worker* pWorker, const XnChar* strFileName, XnProductionNodeType nodeType);
+
+	std::vector<Worker*> m_Workers;
+	std::vector<Slot> m_Slots;
+	XnUInt32 m_nFrames;
+	XnUInt32 m_nFirstFrame;
+	XnUInt32 m_nNextFrame;          ///< @brief frame returned by the next call to Next
+	XnUInt32 m_nFirstHeld;          ///< @brief oldest frame whose slot is not free yet, the one the reader holds
+	XnStatus m_nLastError;
+	bool m_bStop;
+	XN_CRITICAL_SECTION_HANDLE m_hLock;
+	XN_EVENT_HANDLE m_hFrameReady;
+};
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include <math.h>
 #include <XnCppWrapper.h>
+#include "TimeService.h"
 
 enum PoseDetectionResult
 {
@@ -37,11 +38,7 @@ enum PoseDetectionResult
 
 static double GetCurrentTimeInSeconds()
 {
-    LONGLONG time,freq;
-    QueryPerformanceCounter((LARGE_INTEGER *)&time);
-    QueryPerformanceFrequency((LARGE_INTEGER *)&freq);
-    double d_time = ((double)time) / ((double)freq);
-	return d_time;
+	return TimeService::nowSeconds();
 }
 
 class PoseDetectorBase
@@ -75,7 +72,12 @@ public:
 	}
 	virtual PoseDetectionResult checkPoseDuration()
 	{
-		double curTime = GetCurrentTimeInSeconds();
+		return checkPoseDuration(GetCurrentTimeInSeconds());
+	}
+	// curTime is the time of the frame being checked, in seconds, e.g. PoseRuleEngine::GetTime()
+	// so that all the detectors of a frame agree on the time
+	virtual PoseDetectionResult checkPoseDuration(double curTime)
+	{
 		switch(checkPose())
 		{
 		case IN_POSE_FOR_LITTLE_TIME: //falling through
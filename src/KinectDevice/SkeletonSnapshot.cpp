@@ -0,0 +1,176 @@
+#include "SkeletonSnapshot.h"
+#include <string.h>
+
+SkeletonSnapshot::SkeletonSnapshot()
+{
+	Clear();
+}
+
+void SkeletonSnapshot::Clear()
+{
+	m_nUsers = 0;
+	m_nTimestamp = 0;
+	m_nFrameID = 0;
+	m_bProjective = FALSE;
+	memset(m_bJointActive, 0, sizeof(m_bJointActive));
+}
+
+XnInt32 SkeletonSnapshot::FindUser(XnUserID nUserID) const
+{
+	for (XnUInt32 nSlot = 0; nSlot < m_nUsers; nSlot++)
+	{
+		if (m_UserIDs[nSlot] == nUserID)
+			return (XnInt32)nSlot;
+	}
+	return -1;
+}
+
+XnStatus SkeletonSnapshot::Update(xn::UserGenerator& userGenerator, xn::DepthGenerator* pDepthGenerator)
+{
+	m_nUsers = 0;
+	m_bProjective = FALSE;
+	if (!userGenerator.IsValid() || !userGenerator.IsCapabilitySupported(XN_CAPABILITY_SKELETON))
+		return XN_STATUS_INVALID_OPERATION;
+
+	xn::SkeletonCapability skeletonCap = userGenerator.GetSkeletonCap();
+	m_nTimestamp = userGenerator.GetTimestamp();
+	m_nFrameID = userGenerator.GetFrameID();
+
+	for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+		m_bJointActive[nJoint] = skeletonCap.IsJointActive((XnSkeletonJoint)(nJoint + 1));
+
+	XnUserID users[SKELETON_MAX_USERS];
+	XnUInt16 nUsers = SKELETON_MAX_USERS;
+	XnStatus rc = userGenerator.GetUsers(users, nUsers);
+	if (rc != XN_STATUS_OK)
+		return rc;
+
+	for (XnUInt16 nUser = 0; nUser < nUsers; nUser++)
+	{
+		if (!skeletonCap.IsTracking(users[nUser]))
+			continue;
+
+		XnUInt32 nSlot = m_nUsers++;
+		m_UserIDs[nSlot] = users[nUser];
+
+		for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+		{
+			XnUInt32 nIndex = nSlot*SKELETON_JOINT_COUNT + nJoint;
+			XnSkeletonJointTransformation joint;
+			if (!m_bJointActive[nJoint] ||
+				skeletonCap.GetSkeletonJoint(users[nUser], (XnSkeletonJoint)(nJoint + 1), joint) != XN_STATUS_OK)
+			{
+				memset(&joint, 0, sizeof(joint));
+			}
+
+			m_Positions[nIndex] = joint.position.position;
+			m_PositionConfidences[nIndex] = joint.position.fConfidence;
+			m_Orientations[nIndex] = joint.orientation.orientation;
+			m_OrientationConfidences[nIndex] = joint.orientation.fConfidence;
+		}
+	}
+
+	// one conversion for all the joints of all the users
+	if (m_nUsers > 0 && pDepthGenerator != NULL && pDepthGenerator->IsValid())
+	{
+		rc = pDepthGenerator->ConvertRealWorldToProjective(m_nUsers*SKELETON_JOINT_COUNT, m_Positions, m_ProjectivePositions);
+		if (rc != XN_STATUS_OK)
+			return rc;
+		m_bProjective = TRUE;
+	}
+
+	return XN_STATUS_OK;
+}
+
+XnStatus SkeletonSnapshot::Write(FILE* pFile) const
+{
+	XnUInt32 nActiveMask = 0;
+	for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+	{
+		if (m_bJointActive[nJoint])
+			nActiveMask |= 1 << nJoint;
+	}
+	fprintf(pFile, "skeleton %llu %u %u %x\n", (unsigned long long)m_nTimestamp, m_nFrameID, m_nUsers, nActiveMask);
+
+	for (XnUInt32 nSlot = 0; nSlot < m_nUsers; nSlot++)
+	{
+		fprintf(pFile, "%u", m_UserIDs[nSlot]);
+		for (XnUInt32 nIndex = nSlot*SKELETON_JOINT_COUNT; nIndex < (nSlot + 1)*SKELETON_JOINT_COUNT; nIndex++)
+		{
+			fprintf(pFile, " %.2f %.2f %.2f %.3f", m_Positions[nIndex].X, m_Positions[nIndex].Y, m_Positions[nIndex].Z,
+				m_PositionConfidences[nIndex]);
+		}
+		fprintf(pFile, "\n");
+	}
+
+	return ferror(pFile) ? XN_STATUS_ERROR : XN_STATUS_OK;
+}
+
+XnStatus SkeletonSnapshot::Read(FILE* pFile)
+{
+	Clear();
+
+	unsigned long long nTimestamp = 0;
+	unsigned int nFrameID = 0, nUsers = 0, nActiveMask = 0;
+	int nFields = fscanf(pFile, " skeleton %llu %u %u %x", &nTimestamp, &nFrameID, &nUsers, &nActiveMask);
+	if (nFields == EOF)
+		return XN_STATUS_EOF;
+	if (nFields != 4 || nUsers > SKELETON_MAX_USERS)
+		return XN_STATUS_CORRUPT_FILE;
+
+	m_nTimestamp = nTimestamp;
+	m_nFrameID = nFrameID;
+	for (XnUInt32 nJoint = 0; nJoint < SKELETON_JOINT_COUNT; nJoint++)
+		m_bJointActive[nJoint] = (nActiveMask >> nJoint) & 1;
+
+	static const XnMatrix3X3 identity = {{ 1, 0, 0, 0, 1, 0, 0, 0, 1 }};
+	for (XnUInt32 nSlot = 0; nSlot < nUsers; nSlot++)
+	{
+		unsigned int nUserID = 0;
+		if (fscanf(pFile, "%u", &nUserID) != 1)
+			return XN_STATUS_CORRUPT_FILE;
+		m_UserIDs[nSlot] = nUserID;
+
+		for (XnUInt32 nIndex = nSlot*SKELETON_JOINT_COUNT; nIndex < (nSlot + 1)*SKELETON_JOINT_COUNT; nIndex++)
+		{
+			XnPoint3D& position = m_Positions[nIndex];
+			if (fscanf(pFile, "%f %f %f %f", &position.X, &position.Y, &position.Z, &m_PositionConfidences[nIndex]) != 4)
+				return XN_STATUS_CORRUPT_FILE;
+			m_Orientations[nIndex] = identity;
+			m_OrientationConfidences[nIndex] = 0;
+		}
+		m_nUsers = nSlot + 1;
+	}
+
+	return XN_STATUS_OK;
+}
+
+XnStatus SkeletonSnapshot::GetSkeletonJoint(XnUserID nUserID, XnSkeletonJoint eJoint, XnSkeletonJointTransformation& joint) const
+{
+	XnInt32 nSlot = FindUser(nUserID);
+	if (nSlot < 0)
+		return XN_STATUS_NO_SUCH_USER;
+	if ((XnUInt32)eJoint < 1 || (XnUInt32)eJoint > SKELETON_JOINT_COUNT || !m_bJointActive[eJoint - 1])
+		return XN_STATUS_BAD_PARAM;
+
+	XnUInt32 nIndex = Index(nSlot, eJoint);
+	joint.position.position = m_Positions[nIndex];
+	joint.position.fConfidence = m_PositionConfidences[nIndex];
+	joint.orientation.orientation = m_Orientations[nIndex];
+	joint.orientation.fConfidence = m_OrientationConfidences[nIndex];
+	return XN_STATUS_OK;
+}
+
+XnStatus SkeletonSnapshot::GetSkeletonJointPosition(XnUserID nUserID, XnSkeletonJoint eJoint, XnSkeletonJointPosition& joint) const
+{
+	XnInt32 nSlot = FindUser(nUserID);
+	if (nSlot < 0)
+		return XN_STATUS_NO_SUCH_USER;
+	if ((XnUInt32)eJoint < 1 || (XnUInt32)eJoint > SKELETON_JOINT_COUNT || !m_bJointActive[eJoint - 1])
+		return XN_STATUS_BAD_PARAM;
+
+	XnUInt32 nIndex = Index(nSlot, eJoint);
+	joint.position = m_Positions[nIndex];
+	joint.fConfidence = m_PositionConfidences[nIndex];
+	return XN_STATUS_OK;
+}
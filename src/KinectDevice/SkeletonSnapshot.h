@@ -0,0 +1,84 @@
+#ifndef _SkeletonSnapshot
+#define _SkeletonSnapshot
+
+#include <XnCppWrapper.h>
+#include <stdio.h>
+
+enum
+{
+	SKELETON_JOINT_COUNT = 24,   ///< @brief XN_SKEL_HEAD (1) to XN_SKEL_RIGHT_FOOT (24)
+	SKELETON_MAX_USERS = 15,
+};
+
+/// @brief Per frame copy of the skeletons of all tracked users.
+/// 
+/// Update fetches every active joint of every tracked user once, right after the generators
+/// were updated. Consumers then read the tables instead of querying the skeleton capability
+/// joint by joint. The tables are structures of arrays indexed by
+/// slot * SKELETON_JOINT_COUNT + (joint - 1), a slot being the position of the user in the
+/// snapshot. All the positions are also converted to projective coordinates in a single call.
+class SkeletonSnapshot
+{
+public:
+	SkeletonSnapshot();
+
+	/// @brief Fetches the skeletons. pDepthGenerator is optional, used for the projective positions.
+	XnStatus Update(xn::UserGenerator& userGenerator, xn::DepthGenerator* pDepthGenerator);
+
+	/// @brief Forgets all users, e.g. when the generators stopped.
+	void Clear();
+
+	/// @brief Appends the positions of the snapshot to a skeleton track, a text file with one
+	/// "skeleton <timestamp> <frame> <users> <active joint mask>" line per snapshot followed by one
+	/// "<user> x y z confidence ..." line per user. Orientations are not kept.
+	XnStatus Write(FILE* pFile) const;
+
+	/// @brief Reads the next snapshot of a skeleton track, to replay it to the consumers offline.
+	/// The orientations are identities and the projective positions are not available.
+	/// @return XN_STATUS_EOF at the end of the track, XN_STATUS_CORRUPT_FILE for a bad line
+	XnStatus Read(FILE* pFile);
+
+	XnUInt32 GetUserCount() const { return m_nUsers; }
+	XnUserID GetUserID(XnUInt32 nSlot) const { return m_UserIDs[nSlot]; }
+	/// @brief Slot of a tracked user, -1 if the user is not tracked.
+	XnInt32 FindUser(XnUserID nUserID) const;
+	XnBool IsTracking(XnUserID nUserID) const { return FindUser(nUserID) >= 0; }
+	XnBool IsJointActive(XnSkeletonJoint eJoint) const { return m_bJointActive[eJoint - 1]; }
+
+	/// @brief Timestamp (microseconds) and frame of the user generator data the snapshot holds.
+	XnUInt64 GetTimestamp() const { return m_nTimestamp; }
+	XnUInt32 GetFrameID() const { return m_nFrameID; }
+
+	static XnUInt32 Index(XnUInt32 nSlot, XnSkeletonJoint eJoint) { return nSlot*SKELETON_JOINT_COUNT + (eJoint - 1); }
+
+	/// @name JointTables
+	/// @{
+	const XnPoint3D* GetPositions() const { return m_Positions; }
+	/// @brief NULL when the positions of this snapshot were not converted (no depth generator, or the conversion failed).
+	const XnPoint3D* GetProjectivePositions() const { return m_bProjective ? m_ProjectivePositions : NULL; }
+	const XnFloat* GetPositionConfidences() const { return m_PositionConfidences; }
+	const XnMatrix3X3* GetOrientations() const { return m_Orientations; }
+	const XnFloat* GetOrientationConfidences() const { return m_OrientationConfidences; }
+	/// @}
+
+	/// @brief Same results as the skeleton capability queries, from the snapshot.
+	/// @return XN_STATUS_NO_SUCH_USER if the user is not tracked, XN_STATUS_BAD_PARAM for an inactive joint
+	XnStatus GetSkeletonJoint(XnUserID nUserID, XnSkeletonJoint eJoint, XnSkeletonJointTransformation& joint) const;
+	XnStatus GetSkeletonJointPosition(XnUserID nUserID, XnSkeletonJoint eJoint, XnSkeletonJointPosition& joint) const;
+
+private:
+	XnUInt32 m_nUsers;
+	XnUInt64 m_nTimestamp;
+	XnUInt32 m_nFrameID;
+	XnBool m_bProjective;   ///< @brief the projective table holds the positions of this snapshot
+	XnUserID m_UserIDs[SKELETON_MAX_USERS];
+	XnBool m_bJointActive[SKELETON_JOINT_COUNT];
+
+	XnPoint3D m_Positions[SKELETON_MAX_USERS*SKELETON_JOINT_COUNT];
+	XnPoint3D m_ProjectivePositions[SKELETON_MAX_USERS*SKELETON_JOINT_COUNT];
+	XnFloat m_PositionConfidences[SKELETON_MAX_USERS*SKELETON_JOINT_COUNT];
+	XnMatrix3X3 m_Orientations[SKELETON_MAX_USERS*SKELETON_JOINT_COUNT];
+	XnFloat m_OrientationConfidences[SKELETON_MAX_USERS*SKELETON_JOINT_COUNT];
+};
+
+#endif
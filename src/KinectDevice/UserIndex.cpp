@@ -0,0 +1,186 @@
+#include "UserIndex.h"
+#include <XnStatusCodes.h>
+#include <string.h>
+
+namespace Kinect
+{
+
+enum
+{
+	ENCODED_HEADER_SIZE = 14,   // label, box, run count
+	ENCODED_RUN_SIZE = 6,
+};
+
+static void PutUInt16(std::vector<XnUInt8>& buffer, XnUInt16 nValue)
+{
+	buffer.push_back((XnUInt8)(nValue & 0xFF));
+	buffer.push_back((XnUInt8)(nValue >> 8));
+}
+
+static XnUInt16 GetUInt16(const XnUInt8* pData)
+{
+	return (XnUInt16)(pData[0] | (pData[1] << 8));
+}
+
+UserIndex::UserIndex()
+{
+	m_nXRes = 0;
+	m_nYRes = 0;
+	Clear();
+}
+
+void UserIndex::Clear()
+{
+	m_Regions.clear();
+	for (size_t i = 0; i < m_Runs.size(); i++)
+		m_Runs[i].clear();
+	m_nLastLabel = 0;
+	m_nLastSlot = 0;
+}
+
+XnUInt32 UserIndex::GetSlot(XnLabel nLabel)
+{
+	if (nLabel == m_nLastLabel)
+		return m_nLastSlot;
+
+	XnUInt32 nSlot;
+	for (nSlot = 0; nSlot < m_Regions.size() && m_Regions[nSlot].nLabel != nLabel; nSlot++)
+		;
+	if (nSlot == m_Regions.size())
+	{
+		UserRegion region;
+		region.nLabel = nLabel;
+		region.nPixels = 0;
+		region.nMinX = region.nMinY = 0xFFFF;
+		region.nMaxX = region.nMaxY = 0;
+		region.pRuns = NULL;
+		region.nRuns = 0;
+		m_Regions.push_back(region);
+		if (m_Runs.size() < m_Regions.size())
+			m_Runs.resize(m_Regions.size());
+	}
+
+	m_nLastLabel = nLabel;
+	m_nLastSlot = nSlot;
+	return nSlot;
+}
+
+void UserIndex::Build(const XnLabel* pLabels, XnUInt32 nXRes, XnUInt32 nYRes)
+{
+	Clear();
+	m_nXRes = nXRes;
+	m_nYRes = nYRes;
+
+	for (XnUInt32 y = 0; y < nYRes; y++)
+	{
+		const XnLabel* pRow = pLabels + y*nXRes;
+		XnUInt32 x = 0;
+		while (x < nXRes)
+		{
+			// skip the background four labels at a time, most of a frame is background
+			for (; x + 4 <= nXRes; x += 4)
+			{
+				XnUInt64 nFour;
+				memcpy(&nFour, pRow + x, sizeof(nFour));
+				if (nFour != 0)
+					break;
+			}
+			while (x < nXRes && pRow[x] == 0)
+				x++;
+			if (x == nXRes)
+				break;
+
+			XnLabel nLabel = pRow[x];
+			XnUInt32 nBegin = x;
+			while (x < nXRes && pRow[x] == nLabel)
+				x++;
+
+			XnUInt32 nSlot = GetSlot(nLabel);
+			LabelRun run = { (XnUInt16)y, (XnUInt16)nBegin, (XnUInt16)(x - nBegin) };
+			m_Runs[nSlot].push_back(run);
+
+			UserRegion& region = m_Regions[nSlot];
+			region.nPixels += x - nBegin;
+			if (nBegin < region.nMinX) region.nMinX = (XnUInt16)nBegin;
+			if (x - 1 > region.nMaxX) region.nMaxX = (XnUInt16)(x - 1);
+			if (y < region.nMinY) region.nMinY = (XnUInt16)y;
+			region.nMaxY = (XnUInt16)y;
+		}
+	}
+
+	for (XnUInt32 nSlot = 0; nSlot < m_Regions.size(); nSlot++)
+	{
+		m_Regions[nSlot].pRuns = &m_Runs[nSlot][0];
+		m_Regions[nSlot].nRuns = (XnUInt32)m_Runs[nSlot].size();
+	}
+}
+
+const UserRegion* UserIndex::FindUser(XnLabel nLabel) const
+{
+	for (XnUInt32 nSlot = 0; nSlot < m_Regions.size(); nSlot++)
+	{
+		if (m_Regions[nSlot].nLabel == nLabel)
+			return &m_Regions[nSlot];
+	}
+	return NULL;
+}
+
+void UserIndex::FillMask(const UserRegion& region, XnUInt8* pMask, XnUInt32 nStride) const
+{
+	if (region.nPixels == 0)
+		return;
+
+	for (XnUInt32 y = region.nMinY; y <= region.nMaxY; y++)
+		memset(pMask + y*nStride + region.nMinX, 0, region.GetWidth());
+	for (XnUInt32 i = 0; i < region.nRuns; i++)
+	{
+		const LabelRun& run = region.pRuns[i];
+		memset(pMask + run.nY*nStride + run.nX, 255, run.nLength);
+	}
+}
+
+void UserIndex::Encode(const UserRegion& region, std::vector<XnUInt8>& buffer) const
+{
+	buffer.reserve(buffer.size() + ENCODED_HEADER_SIZE + region.nRuns*ENCODED_RUN_SIZE);
+	PutUInt16(buffer, region.nLabel);
+	PutUInt16(buffer, region.nMinX);
+	PutUInt16(buffer, region.nMinY);
+	PutUInt16(buffer, region.nMaxX);
+	PutUInt16(buffer, region.nMaxY);
+	PutUInt16(buffer, (XnUInt16)(region.nRuns & 0xFFFF));
+	PutUInt16(buffer, (XnUInt16)(region.nRuns >> 16));
+	for (XnUInt32 i = 0; i < region.nRuns; i++)
+	{
+		PutUInt16(buffer, region.pRuns[i].nY);
+		PutUInt16(buffer, region.pRuns[i].nX);
+		PutUInt16(buffer, region.pRuns[i].nLength);
+	}
+}
+
+XnStatus UserIndex::Decode(const XnUInt8* pData, XnUInt32 nSize, XnUInt8* pMask, XnUInt32 nXRes, XnUInt32 nYRes, XnUInt32* pUsedSize)
+{
+	if (nSize < ENCODED_HEADER_SIZE)
+		return XN_STATUS_BAD_PARAM;
+
+	XnUInt32 nRuns = GetUInt16(pData + 10) | ((XnUInt32)GetUInt16(pData + 12) << 16);
+	if (nRuns > (nSize - ENCODED_HEADER_SIZE) / ENCODED_RUN_SIZE)
+		return XN_STATUS_BAD_PARAM;
+
+	memset(pMask, 0, nXRes*nYRes);
+	const XnUInt8* pRun = pData + ENCODED_HEADER_SIZE;
+	for (XnUInt32 i = 0; i < nRuns; i++, pRun += ENCODED_RUN_SIZE)
+	{
+		XnUInt32 y = GetUInt16(pRun);
+		XnUInt32 x = GetUInt16(pRun + 2);
+		XnUInt32 nLength = GetUInt16(pRun + 4);
+		if (y >= nYRes || x + nLength > nXRes)
+			return XN_STATUS_BAD_PARAM;
+		memset(pMask + y*nXRes + x, 255, nLength);
+	}
+
+	if (pUsedSize != NULL)
+		*pUsedSize = ENCODED_HEADER_SIZE + nRuns*ENCODED_RUN_SIZE;
+	return XN_STATUS_OK;
+}
+
+}
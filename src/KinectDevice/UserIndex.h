@@ -0,0 +1,81 @@
+#ifndef _UserIndex
+#define _UserIndex
+
+#include <XnTypes.h>
+#include <vector>
+
+namespace Kinect
+{
+
+/// @brief Horizontal run of pixels of one user in the label map.
+struct LabelRun
+{
+	XnUInt16 nY;
+	XnUInt16 nX;       ///< @brief first pixel
+	XnUInt16 nLength;
+};
+
+/// @brief Pixels of one user of the label map.
+struct UserRegion
+{
+	XnLabel nLabel;
+	XnUInt32 nPixels;
+	XnUInt16 nMinX, nMinY;   ///< @brief bounding box (inclusive)
+	XnUInt16 nMaxX, nMaxY;
+	const LabelRun* pRuns;   ///< @brief runs of the user, in row order
+	XnUInt32 nRuns;
+
+	XnUInt32 GetWidth() const { return nPixels != 0 ? nMaxX - nMinX + 1 : 0; }
+	XnUInt32 GetHeight() const { return nPixels != 0 ? nMaxY - nMinY + 1 : 0; }
+};
+
+/// @brief Per frame index of the users of a scene label map.
+///
+/// Build sweeps the label map once and cuts every row into runs of equal labels, skipping the
+/// background several pixels at a time. Each user gets its pixel count, bounding box and run
+/// length encoded mask, so the consumers of a single user only visit the rows and columns of its
+/// box, or just its runs, instead of the whole map.
+///
+/// Encode turns the runs of a user into a compact silhouette (a few KB instead of a full map)
+/// that Decode expands back into a mask, e.g. to send the user outline over the network.
+class UserIndex
+{
+public:
+	UserIndex();
+
+	/// @brief Indexes a label map of nXRes * nYRes labels.
+	void Build(const XnLabel* pLabels, XnUInt32 nXRes, XnUInt32 nYRes);
+	void Clear();
+
+	XnUInt32 GetUserCount() const { return (XnUInt32)m_Regions.size(); }
+	const UserRegion& GetUser(XnUInt32 nIndex) const { return m_Regions[nIndex]; }
+	/// @brief Region of a label, NULL when the label has no pixel in the frame.
+	const UserRegion* FindUser(XnLabel nLabel) const;
+
+	XnUInt32 GetXRes() const { return m_nXRes; }
+	XnUInt32 GetYRes() const { return m_nYRes; }
+
+	/// @brief Writes 255 on the pixels of the user and 0 elsewhere, only inside the box of the user.
+	/// @param pMask mask of the full frame size, nStride bytes per row
+	void FillMask(const UserRegion& region, XnUInt8* pMask, XnUInt32 nStride) const;
+
+	/// @brief Appends the silhouette of a user to buffer.
+	void Encode(const UserRegion& region, std::vector<XnUInt8>& buffer) const;
+	/// @brief Expands an encoded silhouette into a 0 / 255 mask of nXRes * nYRes bytes (cleared first).
+	/// @return XN_STATUS_BAD_PARAM if the data is truncated or does not fit the mask
+	static XnStatus Decode(const XnUInt8* pData, XnUInt32 nSize, XnUInt8* pMask, XnUInt32 nXRes, XnUInt32 nYRes, XnUInt32* pUsedSize = NULL);
+
+private:
+	XnUInt32 GetSlot(XnLabel nLabel);
+
+	XnUInt32 m_nXRes;
+	XnUInt32 m_nYRes;
+	std::vector<UserRegion> m_Regions;
+	std::vector< std::vector<LabelRun> > m_Runs;   ///< @brief runs of every region, kept between frames
+	XnLabel m_nLastLabel;
+	XnUInt32 m_nLastSlot;
+};
+
+}
+
+#endif
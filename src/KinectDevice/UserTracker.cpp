@@ -63,7 +63,8 @@ XnUInt32 UserTracker::s_nColors = 10;
 
 UserTracker::UserTracker(int argc, char **argv, XnUInt64 timeSpanForExitPose) : m_bValid(FALSE), 
                                                                                 m_timeSpanForExitPose(timeSpanForExitPose),
-                                                                                m_pExitPoseDetector(NULL)
+                                                                                m_pExitPoseDetector(NULL),
+                                                                                m_pClock(NULL)
 {
     m_bRecord=FALSE;
     XnStatus nRetVal = XN_STATUS_OK;
@@ -224,10 +225,15 @@ void UserTracker::FillTexture(unsigned char* pTexBuf, XnUInt16 nTexWidth, XnUInt
 
     CalcHistogram(pDepth, xRes, yRes);
 
-    XnDepthPixel nValue; // will hold temporary pixel values. 
-
     const XnLabel* pLabels = GetUsersPixelsData(); // holds a label map, i.e. the label (user ID) for each pixel
 
+    // the color of each label, the background gets its own color only if bDrawBackground is true.
+    m_LabelRenderer.SetPalette(s_Colors, s_nColors, s_Colors[s_nColors]);
+    if (!bDrawBackground)
+    {
+        m_LabelRenderer.SetColor(0, 0);
+    }
+
     // Prepare the texture map, i.e. go over all relevant elements and set their value based
     // on the depth and user.
     // NOTE: we go over the original map and the assumption is that the texture size is equal or larger
@@ -236,40 +242,12 @@ void UserTracker::FillTexture(unsigned char* pTexBuf, XnUInt16 nTexWidth, XnUInt
     // in the initialization is probably 0). 
     for (XnUInt16 nY=0; nY<yRes; nY++)
     {
-        for (XnUInt16 nX=0; nX < xRes; nX++)
-        {
-            // init to 0 (just in case we don't have better data.
-            pTexBuf[0] = 0;
-            pTexBuf[1] = 0;
-            pTexBuf[2] = 0;
-            // if pLabels is 0 it is background. Therefore we only set the color of the background
-            // if bDrawBackground is true.
-            if (bDrawBackground || *pLabels != 0)
-            {
-                nValue = *pDepth; // the depth of the current pixel
-                XnLabel label = *pLabels; // the label of the current pixel
-                XnUInt32 nColorID = label % s_nColors; // the color for the current label
-                if (label == 0)
-                {
-                    nColorID = s_nColors; // special background color
-                }
-
-                if (nValue != 0)
-                {
-                    XnFloat newValue = s_pDepthHist[nValue]; // translate to the multiplier from the histogram
-
-                    pTexBuf[0] = (unsigned char)(newValue * s_Colors[nColorID][0]); 
-                    pTexBuf[1] = (unsigned char)(newValue * s_Colors[nColorID][1]);
-                    pTexBuf[2] = (unsigned char)(newValue * s_Colors[nColorID][2]);
-                }
-            }
+        // the histogram is the multiplier of the label color, 0 for pixels without depth
+        m_LabelRenderer.RenderRowRGB(pLabels, pDepth, s_pDepthHist, pTexBuf, xRes);
 
-            pDepth++;
-            pLabels++;
-            pTexBuf+=3; // each element is RGB so we move 3 at a time.
-        }
-
-        pTexBuf += (nTexWidth - xRes) *3; // move to the next line
+        pDepth += xRes;
+        pLabels += xRes;
+        pTexBuf += nTexWidth * 3; // move to the next line, each element is RGB
     }
 }
 
@@ -293,7 +271,17 @@ XnFloat UserTracker::GetExitPoseState(XnUserID nUserId)
     {
         return 0.0f;
     }
-    tmpTime=m_UserGenerator.GetTimestamp()-tmpTime;
+    if(m_pClock!=NULL)
+    {
+        // the pose started at a sensor time, how long ago is read on the application clock
+        XnUInt64 startTime=m_pClock->toHost(tmpTime);
+        XnUInt64 nowTime=TimeService::now();
+        tmpTime=nowTime>startTime ? (nowTime-startTime)/1000 : 0;
+    }
+    else
+    {
+        tmpTime=m_UserGenerator.GetTimestamp()-tmpTime;
+    }
     if(tmpTime>=m_timeSpanForExitPose)
     {
         return 1.0f;
@@ -341,10 +329,10 @@ XnStatus UserTracker::GetLimbs(XnUserID nUserID, XnPoint3D *pLimbs,XnFloat *pCon
     };
     static XnUInt16 MaxNumLimbs=16;
 
-	if (!m_UserGenerator.GetSkeletonCap().IsTracking(nUserID))
-	{
-		return XN_STATUS_NO_SUCH_USER;
-	}
+    if (!m_UserGenerator.GetSkeletonCap().IsTracking(nUserID))
+    {
+        return XN_STATUS_NO_SUCH_USER;
+    }
 
     XnUInt16 limbCount=0;
     XnSkeletonJointPosition joint1, joint2;
@@ -371,9 +359,11 @@ XnStatus UserTracker::GetLimbs(XnUserID nUserID, XnPoint3D *pLimbs,XnFloat *pCon
         pLimbs[(limbCount*2)+1] = joint2.position;
         limbCount++;
     }
-	
+
+    // the real world positions read above are converted in one call
     if(limbCount>0)
         m_DepthGenerator.ConvertRealWorldToProjective(limbCount*2, pLimbs, pLimbs);
+
     numLimbs=limbCount;
     return XN_STATUS_OK;
 }
@@ -33,6 +33,8 @@
 #include "TrackingInitializer.h"
 #include "ExitPoseDetector.h"
 #include "KVertex.h"
+#include "LabelRenderer.h"
+#include "TimeService.h"
 //---------------------------------------------------------------------------
 // Code
 //---------------------------------------------------------------------------
@@ -149,6 +151,13 @@ public:
     /// @}
 	KVertex getHeadPosition(XnUserID nUserID);
 
+    /// @brief Times the exit pose on the TimeService clock instead of the user generator
+    /// timestamps, so the progress also moves between two sensor frames.
+    /// 
+    /// @param pClock The mapping of the sensor timestamps (KinectDevice::getSensorClock), NULL to
+    ///               go back to the sensor time.
+    void SetSensorClock(const SensorClock* pClock) { m_pClock = pClock; }
+
 protected:
     /// @brief Internal method calculate the cumulative histogram. 
     /// 
@@ -182,6 +191,8 @@ protected:
 
     ExitPoseDetector *m_pExitPoseDetector; ///< @brief a pointer to the exit pose detector (used to exit the game with a pose).
     XnUInt64 m_timeSpanForExitPose; ///< @brief the time (in microseconds) to hold the exit pose for exiting
+    const SensorClock* m_pClock; ///< @brief maps the exit pose timestamps to TimeService time, not owned
+    LabelRenderer m_LabelRenderer; ///< @brief user colors used by FillTexture
 private:
     static float* s_pDepthHist; ///< @brief The cumulative histogram. This is created each frame from scratch.
     static XnFloat s_Colors[][3]; ///< @brief The list of colors
@@ -0,0 +1,134 @@
+#include "WavAudioSource.h"
+#include "TimeService.h"
+#include <string.h>
+
+using namespace Kinect;
+
+WavAudioSource::WavAudioSource()
+{
+	m_bLoop = true;
+	m_nChannels = 0;
+	m_nSampleRate = 0;
+	m_nFrames = 0;
+	Rewind();
+}
+
+static XnUInt32 ReadLE32(const XnUInt8* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((XnUInt32)p[3] << 24);
+}
+
+static XnUInt16 ReadLE16(const XnUInt8* p)
+{
+	return (XnUInt16)(p[0] | (p[1] << 8));
+}
+
+XnStatus WavAudioSource::Open(const XnChar* strFileName)
+{
+	Close();
+
+	XnUInt32 nFileSize = 0;
+	XnStatus rc = xnOSGetFileSize(strFileName, &nFileSize);
+	XN_IS_STATUS_OK(rc);
+	if (nFileSize < 12)
+		return XN_STATUS_CORRUPT_FILE;
+
+	std::vector<XnUInt8> file(nFileSize);
+	rc = xnOSLoadFile(strFileName, &file[0], nFileSize);
+	XN_IS_STATUS_OK(rc);
+
+	const XnUInt8* pFile = &file[0];
+	if (memcmp(pFile, "RIFF", 4) != 0 || memcmp(pFile + 8, "WAVE", 4) != 0)
+		return XN_STATUS_CORRUPT_FILE;
+
+	// chunks in any order, the ones other than "fmt " and "data" are skipped
+	XnUInt32 nChannels = 0;
+	XnUInt32 nSampleRate = 0;
+	const XnUInt8* pData = NULL;
+	XnUInt32 nDataSize = 0;
+	for (XnUInt32 nPos = 12; nPos + 8 <= nFileSize; )
+	{
+		const XnUInt8* pChunk = pFile + nPos;
+		XnUInt32 nChunkSize = ReadLE32(pChunk + 4);
+		if (nChunkSize > nFileSize - nPos - 8)
+			nChunkSize = nFileSize - nPos - 8;
+
+		if (memcmp(pChunk, "fmt ", 4) == 0 && nChunkSize >= 16)
+		{
+			// PCM, or WAVE_FORMAT_EXTENSIBLE with a PCM sub format
+			XnUInt16 nFormat = ReadLE16(pChunk + 8);
+			if (nFormat == 0xFFFE && nChunkSize >= 26)
+				nFormat = ReadLE16(pChunk + 8 + 24);
+			if (nFormat != 1 || ReadLE16(pChunk + 8 + 14) != 16)
+				return XN_STATUS_CORRUPT_FILE;
+			nChannels = ReadLE16(pChunk + 8 + 2);
+			nSampleRate = ReadLE32(pChunk + 8 + 4);
+		}
+		else if (memcmp(pChunk, "data", 4) == 0)
+		{
+			pData = pChunk + 8;
+			nDataSize = nChunkSize;
+		}
+
+		// chunks are padded to an even size
+		nPos += 8 + nChunkSize + (nChunkSize & 1);
+	}
+
+	if (nChannels == 0 || nChannels > AudioStream::MAX_CHANNELS || nSampleRate == 0 || pData == NULL)
+		return XN_STATUS_CORRUPT_FILE;
+
+	m_nFrames = nDataSize / (2 * nChannels);
+	if (m_nFrames == 0)
+		return XN_STATUS_CORRUPT_FILE;
+
+	// the samples are little endian, like the hosts this runs on
+	m_Samples.resize(m_nFrames * nChannels);
+	memcpy(&m_Samples[0], pData, m_Samples.size() * sizeof(XnInt16));
+	m_nChannels = nChannels;
+	m_nSampleRate = nSampleRate;
+	Rewind();
+	return XN_STATUS_OK;
+}
+
+void WavAudioSource::Close()
+{
+	m_Samples.clear();
+	m_nChannels = 0;
+	m_nSampleRate = 0;
+	m_nFrames = 0;
+	Rewind();
+}
+
+void WavAudioSource::Rewind()
+{
+	m_nPosition = 0;
+	m_nPushed = 0;
+	m_nStartTime = 0;
+}
+
+XnUInt32 WavAudioSource::Pump(AudioStream& stream)
+{
+	if (!IsOpen() || stream.GetChannels() != m_nChannels)
+		return 0;
+
+	XnUInt64 nNow = TimeService::now();
+	if (m_nStartTime == 0)
+		m_nStartTime = nNow;
+	// whole seconds apart, so that the product does not overflow
+	XnUInt64 nElapsed = nNow - m_nStartTime;
+	XnUInt64 nDue = nElapsed / 1000000000 * m_nSampleRate + nElapsed % 1000000000 * m_nSampleRate / 1000000000 - m_nPushed;
+
+	XnUInt32 nPushed = 0;
+	while (nDue > 0 && !IsFinished())
+	{
+		if (m_nPosition >= m_nFrames)
+			m_nPosition = 0;
+		XnUInt32 nCount = (XnUInt32)XN_MIN(nDue, (XnUInt64)(m_nFrames - m_nPosition));
+		stream.Push(&m_Samples[m_nPosition * m_nChannels], nCount);
+		m_nPosition += nCount;
+		m_nPushed += nCount;
+		nPushed += nCount;
+		nDue -= nCount;
+	}
+	return nPushed;
+}
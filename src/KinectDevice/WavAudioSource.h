@@ -0,0 +1,53 @@
+#ifndef _WavAudioSource
+#define _WavAudioSource
+
+#include <XnOS.h>
+#include <vector>
+#include "AudioRing.h"
+
+namespace Kinect
+{
+
+/// @brief Plays a 16 bit PCM WAV file into an AudioStream in real time, a stand-in for the
+/// microphones where there is no device, to test the audio consumers on Linux.
+///
+/// The file is loaded whole by Open. Pump pushes the frames that are due on TimeService::now
+/// since its first call, so it can be called at any rate from the thread that would acquire
+/// the device audio.
+class WavAudioSource
+{
+public:
+	WavAudioSource();
+
+	/// @return XN_STATUS_CORRUPT_FILE when it is no 16 bit PCM WAV file
+	XnStatus Open(const XnChar* strFileName);
+	void Close();
+	bool IsOpen() const { return !m_Samples.empty(); }
+
+	/// @brief Pushes the frames due since the first call. The stream must have the channels of
+	/// the file, see GetChannels.
+	/// @return frames pushed, the ones an overrun dropped included
+	XnUInt32 Pump(AudioStream& stream);
+	/// @brief Starts from the first frame again, the clock restarts on the next Pump.
+	void Rewind();
+
+	XnUInt32 GetChannels() const { return m_nChannels; }
+	XnUInt32 GetSampleRate() const { return m_nSampleRate; }
+	XnUInt32 GetFrameCount() const { return m_nFrames; }
+	bool IsFinished() const { return !m_bLoop && m_nPosition >= m_nFrames; }
+
+	bool m_bLoop;   ///< @brief starts over at the end of the file, true by default
+
+private:
+	std::vector<XnInt16> m_Samples;
+	XnUInt32 m_nChannels;
+	XnUInt32 m_nSampleRate;
+	XnUInt32 m_nFrames;
+	XnUInt32 m_nPosition;       ///< @brief next frame to push
+	XnUInt64 m_nPushed;         ///< @brief frames pushed since the clock started
+	XnUInt64 m_nStartTime;      ///< @brief TimeService::now of the first Pump, 0 before it
+};
+
+}
+
+#endif
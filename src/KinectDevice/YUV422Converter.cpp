@@ -0,0 +1,146 @@
+#include "YUV422Converter.h"
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define YUV422_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace Kinect;
+
+static inline XnUInt8 ClampToByte(XnInt32 nValue)
+{
+	return (XnUInt8)(nValue < 0 ? 0 : (nValue > 255 ? 255 : nValue));
+}
+
+static inline void StorePixel(XnUInt8* pDest, XnInt32 nC, XnInt32 nD, XnInt32 nE, RGBLayout eOutput)
+{
+	XnUInt8 r = ClampToByte((298*nC + 409*nE + 128) >> 8);
+	XnUInt8 g = ClampToByte((298*nC - 100*nD - 208*nE + 128) >> 8);
+	XnUInt8 b = ClampToByte((298*nC + 516*nD + 128) >> 8);
+	switch (eOutput)
+	{
+	case RGB_LAYOUT_RGB:  pDest[0] = r; pDest[1] = g; pDest[2] = b; break;
+	case RGB_LAYOUT_BGR:  pDest[0] = b; pDest[1] = g; pDest[2] = r; break;
+	case RGB_LAYOUT_RGBA: pDest[0] = r; pDest[1] = g; pDest[2] = b; pDest[3] = 255; break;
+	case RGB_LAYOUT_BGRA: pDest[0] = b; pDest[1] = g; pDest[2] = r; pDest[3] = 255; break;
+	}
+}
+
+void YUV422Converter::ConvertRowReference(const XnUInt8* pYUV, XnUInt8* pDest, XnUInt32 nWidth, YUV422Layout eInput, RGBLayout eOutput)
+{
+	const XnUInt32 nBytesPerPixel = GetBytesPerPixel(eOutput);
+	const XnUInt32 nY0 = eInput == YUV422_UYVY ? 1 : 0;
+	const XnUInt32 nU = eInput == YUV422_UYVY ? 0 : 1;
+
+	for (XnUInt32 x = 0; x + 2 <= nWidth; x += 2, pYUV += 4)
+	{
+		XnInt32 nD = pYUV[nU] - 128;
+		XnInt32 nE = pYUV[nU + 2] - 128;
+		StorePixel(pDest, pYUV[nY0] - 16, nD, nE, eOutput);
+		pDest += nBytesPerPixel;
+		StorePixel(pDest, pYUV[nY0 + 2] - 16, nD, nE, eOutput);
+		pDest += nBytesPerPixel;
+	}
+}
+
+#if YUV422_USE_SSE2
+// R, G and B of 8 pixels as bytes in the low half of each register
+static inline void ConvertEight(__m128i yuv, YUV422Layout eInput, __m128i& r, __m128i& g, __m128i& b)
+{
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	__m128i y, uv;
+	if (eInput == YUV422_UYVY)
+	{
+		y = _mm_srli_epi16(yuv, 8);
+		uv = _mm_and_si128(yuv, lowBytes);
+	}
+	else
+	{
+		y = _mm_and_si128(yuv, lowBytes);
+		uv = _mm_srli_epi16(yuv, 8);
+	}
+
+	// uv holds U0 V0 U1 V1 U2 V2 U3 V3, each pair of pixels takes its U and V
+	__m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+	__m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+	__m128i c = _mm_sub_epi16(y, _mm_set1_epi16(16));
+	__m128i d = _mm_sub_epi16(u, _mm_set1_epi16(128));
+	__m128i e = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+	// the products need 32 bits, pmaddwd sums two 16 bit products of interleaved operands
+	const __m128i coefR = _mm_set1_epi32((409 << 16) | 298);                    // C, E
+	const __m128i coefG1 = _mm_set1_epi32((XnInt32)(((XnUInt32)(-100 & 0xFFFF) << 16) | 298));  // C, D
+	const __m128i coefG2 = _mm_set1_epi32(((XnUInt32)128 << 16) | (-208 & 0xFFFF)); // E, 1
+	const __m128i coefB = _mm_set1_epi32((516 << 16) | 298);                    // C, D
+	const __m128i round = _mm_set1_epi32(128);
+	const __m128i one = _mm_set1_epi16(1);
+
+	__m128i ceLo = _mm_unpacklo_epi16(c, e), ceHi = _mm_unpackhi_epi16(c, e);
+	__m128i cdLo = _mm_unpacklo_epi16(c, d), cdHi = _mm_unpackhi_epi16(c, d);
+	__m128i e1Lo = _mm_unpacklo_epi16(e, one), e1Hi = _mm_unpackhi_epi16(e, one);
+
+	__m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceLo, coefR), round), 8);
+	__m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceHi, coefR), round), 8);
+	__m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, coefG1), _mm_madd_epi16(e1Lo, coefG2)), 8);
+	__m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, coefG1), _mm_madd_epi16(e1Hi, coefG2)), 8);
+	__m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, coefB), round), 8);
+	__m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, coefB), round), 8);
+
+	// saturating packs clamp to 0..255
+	r = _mm_packus_epi16(_mm_packs_epi32(rLo, rHi), _mm_setzero_si128());
+	g = _mm_packus_epi16(_mm_packs_epi32(gLo, gHi), _mm_setzero_si128());
+	b = _mm_packus_epi16(_mm_packs_epi32(bLo, bHi), _mm_setzero_si128());
+}
+#endif
+
+void YUV422Converter::ConvertRow(const XnUInt8* pYUV, XnUInt8* pDest, XnUInt32 nWidth, YUV422Layout eInput, RGBLayout eOutput)
+{
+	XnUInt32 x = 0;
+#if YUV422_USE_SSE2
+	const XnUInt32 nBytesPerPixel = GetBytesPerPixel(eOutput);
+	const XnBool bSwap = eOutput == RGB_LAYOUT_BGR || eOutput == RGB_LAYOUT_BGRA;
+	const __m128i alpha = _mm_set1_epi8((char)0xFF);
+	for (; x + 8 <= nWidth; x += 8, pYUV += 16, pDest += 8*nBytesPerPixel)
+	{
+		__m128i r, g, b;
+		ConvertEight(_mm_loadu_si128((const __m128i*)pYUV), eInput, r, g, b);
+		if (bSwap)
+		{
+			__m128i t = r;
+			r = b;
+			b = t;
+		}
+
+		__m128i rg = _mm_unpacklo_epi8(r, g);
+		__m128i ba = _mm_unpacklo_epi8(b, alpha);
+		__m128i pixels0 = _mm_unpacklo_epi16(rg, ba);
+		__m128i pixels1 = _mm_unpackhi_epi16(rg, ba);
+		if (nBytesPerPixel == 4)
+		{
+			_mm_storeu_si128((__m128i*)pDest, pixels0);
+			_mm_storeu_si128((__m128i*)(pDest + 16), pixels1);
+		}
+		else
+		{
+			// no byte shuffle in SSE2, drop the alpha bytes while copying out
+			XnUInt8 four[32];
+			_mm_storeu_si128((__m128i*)four, pixels0);
+			_mm_storeu_si128((__m128i*)(four + 16), pixels1);
+			for (XnUInt32 i = 0; i < 8; i++)
+				memcpy(pDest + 3*i, four + 4*i, 3);
+		}
+	}
+#endif
+	if (x < nWidth)
+		ConvertRowReference(pYUV, pDest, nWidth - x, eInput, eOutput);
+}
+
+void YUV422Converter::Convert(const XnUInt8* pYUV, XnUInt32 nYUVStride, XnUInt8* pDest, XnUInt32 nDestStride,
+	XnUInt32 nWidth, XnUInt32 nHeight, YUV422Layout eInput, RGBLayout eOutput)
+{
+#pragma omp parallel for
+	for (int y = 0; y < (int)nHeight; y++)
+		ConvertRow(pYUV + y*nYUVStride, pDest + y*nDestStride, nWidth, eInput, eOutput);
+}
@@ -0,0 +1,52 @@
+#ifndef _YUV422Converter
+#define _YUV422Converter
+
+#include <XnTypes.h>
+
+namespace Kinect
+{
+
+/// @brief Byte order of a YUV 4:2:2 macro pixel (two pixels sharing U and V).
+enum YUV422Layout
+{
+	YUV422_UYVY,    ///< @brief U Y0 V Y1, the OpenNI XN_PIXEL_FORMAT_YUV422 and Kinect camera order
+	YUV422_YUYV,    ///< @brief Y0 U Y1 V
+};
+
+enum RGBLayout
+{
+	RGB_LAYOUT_RGB,
+	RGB_LAYOUT_BGR,
+	RGB_LAYOUT_RGBA,    ///< @brief alpha is 255
+	RGB_LAYOUT_BGRA,
+};
+
+/// @brief YUV 4:2:2 to RGB conversion, ITU-R BT.601 studio range in 8 bit fixed point:
+///
+/// C = Y - 16, D = U - 128, E = V - 128
+/// R = (298 C + 409 E + 128) >> 8
+/// G = (298 C - 100 D - 208 E + 128) >> 8
+/// B = (298 C + 516 D + 128) >> 8
+///
+/// clamped to 0..255. The SSE2 path converts 8 pixels per step with 32 bit products, so it gives
+/// exactly the results of ConvertRowReference. Other CPUs use the scalar path.
+class YUV422Converter
+{
+public:
+	/// @brief Converts nWidth pixels (nWidth / 2 macro pixels, an odd last pixel is left as is).
+	static void ConvertRow(const XnUInt8* pYUV, XnUInt8* pDest, XnUInt32 nWidth, YUV422Layout eInput, RGBLayout eOutput);
+
+	/// @brief Converts an image, rows are split across threads when OpenMP is enabled.
+	/// @param nYUVStride, nDestStride bytes per row
+	static void Convert(const XnUInt8* pYUV, XnUInt32 nYUVStride, XnUInt8* pDest, XnUInt32 nDestStride,
+		XnUInt32 nWidth, XnUInt32 nHeight, YUV422Layout eInput, RGBLayout eOutput);
+
+	/// @brief Plain per pixel implementation, the reference of the SIMD path.
+	static void ConvertRowReference(const XnUInt8* pYUV, XnUInt8* pDest, XnUInt32 nWidth, YUV422Layout eInput, RGBLayout eOutput);
+
+	static XnUInt32 GetBytesPerPixel(RGBLayout eOutput) { return eOutput == RGB_LAYOUT_RGB || eOutput == RGB_LAYOUT_BGR ? 3 : 4; }
+};
+
+}
+
+#endif
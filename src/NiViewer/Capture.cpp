@@ -23,6 +23,7 @@
 // Includes
 // --------------------------------
 #include "Capture.h"
+#include "CaptureQueue.h"
 #include "Device.h"
 #include "Draw.h"
 #include <XnCppWrapper.h>
@@ -68,7 +69,6 @@ typedef struct NodeCapturingData
 typedef struct CapturingData
 {
 	NodeCapturingData nodes[CAPTURE_NODE_COUNT];
-	Recorder* pRecorder;
 	char csFileName[XN_FILE_MAX_PATH];
 	XnUInt32 nStartOn; // time to start, in seconds
 	bool bSkipFirstFrame;
@@ -176,26 +176,17 @@ bool isCapturing()
 	if (nRetVal != XN_STATUS_OK)														\
 	{																					\
 		displayMessage("Failed to %s: %s\n", what, xnGetStatusString(rc));				\
-		delete g_Capture.pRecorder;														\
-		g_Capture.pRecorder = NULL;														\
+		captureQueueClose();															\
 		return false;																	\
 	}
 
 bool captureOpenWriteDevice()
 {
 	XnStatus nRetVal = XN_STATUS_OK;
-	NodeInfoList recordersList;
-	nRetVal = g_Context.EnumerateProductionTrees(XN_NODE_TYPE_RECORDER, NULL, recordersList);
-	START_CAPTURE_CHECK_RC(nRetVal, "Enumerate recorders");
-	// take first
-	NodeInfo chosen = *recordersList.Begin();
 
-	g_Capture.pRecorder = new Recorder;
-	nRetVal = g_Context.CreateProductionTree(chosen, *g_Capture.pRecorder);
-	START_CAPTURE_CHECK_RC(nRetVal, "Create recorder");
-
-	nRetVal = g_Capture.pRecorder->SetDestination(XN_RECORD_MEDIUM_FILE, g_Capture.csFileName);
-	START_CAPTURE_CHECK_RC(nRetVal, "Set output file");
+	// records on a thread of its own, see CaptureQueue.h
+	nRetVal = captureQueueOpen(g_Capture.csFileName);
+	START_CAPTURE_CHECK_RC(nRetVal, "Open recorder");
 
 	return true;
 }
@@ -249,7 +240,7 @@ void captureStart(int nDelay)
 	if (g_Capture.csFileName[0] == 0)
 		return;
 
-	if (g_Capture.pRecorder == NULL)
+	if (!captureQueueIsOpen())
 	{
 		if (!captureOpenWriteDevice())
 			return;
@@ -265,12 +256,7 @@ void captureStart(int nDelay)
 
 void captureCloseWriteDevice()
 {
-	if (g_Capture.pRecorder != NULL)
-	{
-		g_Capture.pRecorder->Release();
-		delete g_Capture.pRecorder;
-		g_Capture.pRecorder = NULL;
-	}
+	captureQueueClose();
 }
 
 void captureRestart(int)
@@ -320,13 +306,13 @@ XnStatus captureFrame()
 				// add all captured nodes
 				if (getDevice() != NULL)
 				{
-					nRetVal = g_Capture.pRecorder->AddNodeToRecording(*getDevice(), XN_CODEC_UNCOMPRESSED);
+					nRetVal = captureQueueAddDevice(*getDevice());
 					START_CAPTURE_CHECK_RC(nRetVal, "add device node");
 				}
 
 				if (isDepthOn() && (g_Capture.nodes[CAPTURE_DEPTH_NODE].captureFormat != CODEC_DONT_CAPTURE))
 				{
-					nRetVal = g_Capture.pRecorder->AddNodeToRecording(*getDepthGenerator(), g_Capture.nodes[CAPTURE_DEPTH_NODE].captureFormat);
+					nRetVal = captureQueueAddNode(*getDepthGenerator(), g_Capture.nodes[CAPTURE_DEPTH_NODE].captureFormat);
 					START_CAPTURE_CHECK_RC(nRetVal, "add depth node");
 					g_Capture.nodes[CAPTURE_DEPTH_NODE].bRecording = TRUE;
 					g_Capture.nodes[CAPTURE_DEPTH_NODE].pGenerator = getDepthGenerator();
@@ -334,7 +320,7 @@ XnStatus captureFrame()
 
 				if (isImageOn() && (g_Capture.nodes[CAPTURE_IMAGE_NODE].captureFormat != CODEC_DONT_CAPTURE))
 				{
-					nRetVal = g_Capture.pRecorder->AddNodeToRecording(*getImageGenerator(), g_Capture.nodes[CAPTURE_IMAGE_NODE].captureFormat);
+					nRetVal = captureQueueAddNode(*getImageGenerator(), g_Capture.nodes[CAPTURE_IMAGE_NODE].captureFormat);
 					START_CAPTURE_CHECK_RC(nRetVal, "add image node");
 					g_Capture.nodes[CAPTURE_IMAGE_NODE].bRecording = TRUE;
 					g_Capture.nodes[CAPTURE_IMAGE_NODE].pGenerator = getImageGenerator();
@@ -342,7 +328,7 @@ XnStatus captureFrame()
 
 				if (isIROn() && (g_Capture.nodes[CAPTURE_IR_NODE].captureFormat != CODEC_DONT_CAPTURE))
 				{
-					nRetVal = g_Capture.pRecorder->AddNodeToRecording(*getIRGenerator(), g_Capture.nodes[CAPTURE_IR_NODE].captureFormat);
+					nRetVal = captureQueueAddNode(*getIRGenerator(), g_Capture.nodes[CAPTURE_IR_NODE].captureFormat);
 					START_CAPTURE_CHECK_RC(nRetVal, "add IR stream");
 					g_Capture.nodes[CAPTURE_IR_NODE].bRecording = TRUE;
 					g_Capture.nodes[CAPTURE_IR_NODE].pGenerator = getIRGenerator();
@@ -350,7 +336,7 @@ XnStatus captureFrame()
 
 				if (isAudioOn() && (g_Capture.nodes[CAPTURE_AUDIO_NODE].captureFormat != CODEC_DONT_CAPTURE))
 				{
-					nRetVal = g_Capture.pRecorder->AddNodeToRecording(*getAudioGenerator(), g_Capture.nodes[CAPTURE_AUDIO_NODE].captureFormat);
+					nRetVal = captureQueueAddNode(*getAudioGenerator(), g_Capture.nodes[CAPTURE_AUDIO_NODE].captureFormat);
 					START_CAPTURE_CHECK_RC(nRetVal, "add Audio stream");
 					g_Capture.nodes[CAPTURE_AUDIO_NODE].bRecording = TRUE;
 					g_Capture.nodes[CAPTURE_AUDIO_NODE].pGenerator = getAudioGenerator();
@@ -361,13 +347,13 @@ XnStatus captureFrame()
 
 	if (g_Capture.State == CAPTURING)
 	{
-		// There isn't a real need to call Record() here, as the WaitXUpdateAll() call already makes sure
-		// recording is performed.
-		nRetVal = g_Capture.pRecorder->Record();
+		// only copies the new data, it is compressed and written by the recording thread
+		bool bQueued = false;
+		nRetVal = captureQueuePush(&bQueued);
 		XN_IS_STATUS_OK(nRetVal);
 
-		// count recorded frames
-		for (int i = 0; i < CAPTURE_NODE_COUNT; ++i)
+		// count the frames that made it to the queue, the dropped ones are counted by the queue
+		for (int i = 0; i < CAPTURE_NODE_COUNT && bQueued; ++i)
 		{
 			if (g_Capture.nodes[i].bRecording && g_Capture.nodes[i].pGenerator->IsDataNew())
 				g_Capture.nodes[i].nCapturedFrames++;
@@ -376,27 +362,21 @@ XnStatus captureFrame()
 	return XN_STATUS_OK;
 }
 
-void captureSetFormat(XnCodecID* pMember, XnCodecID newFormat, ProductionNode &node)
+void captureSetFormat(XnCodecID* pMember, XnCodecID newFormat, Generator &node)
 {
 	if (*pMember == newFormat)
 		return;
 
-	if (g_Capture.pRecorder != NULL)
+	if (captureQueueIsOpen())
 	{
-		// check if it was off before
-		if (*pMember == CODEC_DONT_CAPTURE)
-		{
-			g_Capture.pRecorder->AddNodeToRecording(node, newFormat);
-		}
 		// check if it is off now
-		else if (newFormat == CODEC_DONT_CAPTURE)
+		if (newFormat == CODEC_DONT_CAPTURE)
 		{
-			g_Capture.pRecorder->RemoveNodeFromRecording(node);
+			captureQueueRemoveNode(node);
 		}
-		else // just a change in compression
+		else // on again, or just a change in compression
 		{
-			g_Capture.pRecorder->RemoveNodeFromRecording(node);
-			g_Capture.pRecorder->AddNodeToRecording(node, newFormat);
+			captureQueueAddNode(node, newFormat);
 		}
 	}
 
@@ -477,6 +457,12 @@ void getCaptureMessage(char* pMessage)
 					nChars += sprintf(pMessage + nChars, "%s-%d ", g_Capture.nodes[i].pGenerator->GetName(), g_Capture.nodes[i].nCapturedFrames);
 				}
 			}
+
+			// a queue that keeps filling up means the disk can't keep up, frames are dropped once it is full
+			CaptureQueueStatistics queue;
+			captureQueueGetStatistics(&queue);
+			sprintf(pMessage + nChars, "\nQueue: %u/%u (max %u) Written: %u Dropped: %u",
+				queue.nQueued, queue.nCapacity, queue.nMaxQueued, queue.nRecorded, queue.nDropped);
 		}
 		break;
 	default:
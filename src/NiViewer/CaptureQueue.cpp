@@ -0,0 +1,695 @@
+// --------------------------------
+// Includes
+// --------------------------------
+#include "CaptureQueue.h"
+#include <XnOS.h>
+#include <XnPropNames.h>
+using namespace xn;
+
+// --------------------------------
+// Defines
+// --------------------------------
+// depth, image, IR and audio
+#define CAPTURE_QUEUE_MAX_NODES 4
+
+#define CAPTURE_QUEUE_CHECK_RC(rc)														\
+	if (rc != XN_STATUS_OK)																\
+	{																					\
+		captureQueueClose();															\
+		return rc;																		\
+	}
+
+// --------------------------------
+// Types
+// --------------------------------
+// the state changes of a node that are watched and forwarded to its mock
+typedef enum
+{
+	CAPTURE_QUEUE_MIRROR_CHANGE,
+	CAPTURE_QUEUE_MAP_OUTPUT_MODE_CHANGE,
+	CAPTURE_QUEUE_CROPPING_CHANGE,
+	CAPTURE_QUEUE_VIEW_POINT_CHANGE,
+	CAPTURE_QUEUE_FIELD_OF_VIEW_CHANGE,
+	CAPTURE_QUEUE_PIXEL_FORMAT_CHANGE,
+	CAPTURE_QUEUE_WAVE_OUTPUT_MODE_CHANGE,
+	CAPTURE_QUEUE_CHANGE_COUNT
+} CaptureQueueChange;
+
+typedef struct
+{
+	XnProductionNodeType type;
+	XnBool bMirrorSupported;
+	XnBool bMirror;
+	XnBool bCroppingSupported;
+	XnCropping cropping;
+	XnMapOutputMode mapOutputMode;
+	XnFieldOfView fieldOfView;
+	XnPixelFormat pixelFormat;
+	XnWaveOutputMode waveOutputMode;
+} CaptureQueueProperties;
+
+typedef struct
+{
+	// set by the UI thread, written under g_hRecordLock
+	bool bActive;
+	XnUInt32 nGeneration;		// changes with every add and remove of the node
+	Generator node;				// the captured generator
+	XnCodecID codec;
+
+	// used by the UI thread only
+	bool bPropertiesChanged;	// since the last data of the node was queued, set by the change callbacks
+	XnCallbackHandle hChangeCallbacks[CAPTURE_QUEUE_CHANGE_COUNT];
+
+	// used by the recording thread only
+	ProductionNode mock;		// copy of the node in the record context
+	XnUInt32 nMockGeneration;	// generation of the node the mock was made for
+	XnProductionNodeType type;
+} CaptureQueueNode;
+
+typedef struct
+{
+	XnUInt32 nGeneration;		// of the node when the data was queued
+	XnUInt32 nFrameID;
+	XnUInt64 nTimestamp;
+	XnUInt32 nDataSize;			// 0 when the node had no new data
+	XnUInt32 nBufferSize;
+	XnUInt8* pBuffer;
+	bool bProperties;			// the node changed since its last queued data, set the mock first
+	CaptureQueueProperties properties;
+} CaptureQueueData;
+
+typedef struct
+{
+	CaptureQueueData data[CAPTURE_QUEUE_MAX_NODES];
+} CaptureQueueSlot;
+
+// --------------------------------
+// Global Variables
+// --------------------------------
+Context g_RecordContext;
+Recorder g_QueueRecorder;
+CaptureQueueNode g_QueueNodes[CAPTURE_QUEUE_MAX_NODES];
+ProductionNode g_QueueDevice;		// set by the UI thread under g_hRecordLock
+ProductionNode g_QueueDeviceMock;	// recording thread only
+CaptureQueueSlot g_QueueSlots[CAPTURE_QUEUE_SLOTS];
+bool g_bQueueOpen = false;
+
+// ring state, statistics, the last recording error and the stop request are guarded by g_hQueueLock
+XnUInt32 g_nQueueHead = 0;
+XnUInt32 g_nQueueTail = 0;
+CaptureQueueStatistics g_QueueStatistics;
+XnStatus g_nQueueError = XN_STATUS_OK;
+bool g_bQueueStop = false;
+XN_CRITICAL_SECTION_HANDLE g_hQueueLock = NULL;
+
+// the node table is guarded by g_hRecordLock, the recorder and the mock nodes are only used by the
+// recording thread (and by captureQueueClose once it is gone)
+XN_CRITICAL_SECTION_HANDLE g_hRecordLock = NULL;
+
+XN_EVENT_HANDLE g_hQueueEvent = NULL;
+XN_THREAD_HANDLE g_hQueueThread = NULL;
+
+// --------------------------------
+// Code
+// --------------------------------
+static void XN_CALLBACK_TYPE captureQueueOnChange(ProductionNode& /*node*/, void* pCookie)
+{
+	((CaptureQueueNode*)pCookie)->bPropertiesChanged = true;
+}
+
+// The callbacks are called by the thread changing the node, the UI thread
+static void captureQueueRegisterChanges(CaptureQueueNode* pNode)
+{
+	XnCallbackHandle* phCallbacks = pNode->hChangeCallbacks;
+	Generator& node = pNode->node;
+	XnProductionNodeType type = node.GetInfo().GetDescription().Type;
+
+	if (node.IsCapabilitySupported(XN_CAPABILITY_MIRROR))
+	{
+		node.GetMirrorCap().RegisterToMirrorChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_MIRROR_CHANGE]);
+	}
+	if (node.IsCapabilitySupported(XN_CAPABILITY_ALTERNATIVE_VIEW_POINT))
+	{
+		node.GetAlternativeViewPointCap().RegisterToViewPointChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_VIEW_POINT_CHANGE]);
+	}
+
+	if (type == XN_NODE_TYPE_DEPTH || type == XN_NODE_TYPE_IMAGE || type == XN_NODE_TYPE_IR)
+	{
+		MapGenerator mapGenerator(node.GetHandle());
+		mapGenerator.RegisterToMapOutputModeChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_MAP_OUTPUT_MODE_CHANGE]);
+		if (mapGenerator.IsCapabilitySupported(XN_CAPABILITY_CROPPING))
+		{
+			mapGenerator.GetCroppingCap().RegisterToCroppingChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_CROPPING_CHANGE]);
+		}
+	}
+
+	if (type == XN_NODE_TYPE_DEPTH)
+	{
+		DepthGenerator(node.GetHandle()).RegisterToFieldOfViewChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_FIELD_OF_VIEW_CHANGE]);
+	}
+	else if (type == XN_NODE_TYPE_IMAGE)
+	{
+		ImageGenerator(node.GetHandle()).RegisterToPixelFormatChange(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_PIXEL_FORMAT_CHANGE]);
+	}
+	else if (type == XN_NODE_TYPE_AUDIO)
+	{
+		AudioGenerator(node.GetHandle()).RegisterToWaveOutputModeChanges(captureQueueOnChange, pNode, phCallbacks[CAPTURE_QUEUE_WAVE_OUTPUT_MODE_CHANGE]);
+	}
+
+	// the first queued data also carries the properties, in case they changed before the mock was made
+	pNode->bPropertiesChanged = true;
+}
+
+static void captureQueueUnregisterChanges(CaptureQueueNode* pNode)
+{
+	XnCallbackHandle* phCallbacks = pNode->hChangeCallbacks;
+	Generator& node = pNode->node;
+
+	if (phCallbacks[CAPTURE_QUEUE_MIRROR_CHANGE] != NULL)
+		node.GetMirrorCap().UnregisterFromMirrorChange(phCallbacks[CAPTURE_QUEUE_MIRROR_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_VIEW_POINT_CHANGE] != NULL)
+		node.GetAlternativeViewPointCap().UnregisterFromViewPointChange(phCallbacks[CAPTURE_QUEUE_VIEW_POINT_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_MAP_OUTPUT_MODE_CHANGE] != NULL)
+		MapGenerator(node.GetHandle()).UnregisterFromMapOutputModeChange(phCallbacks[CAPTURE_QUEUE_MAP_OUTPUT_MODE_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_CROPPING_CHANGE] != NULL)
+		MapGenerator(node.GetHandle()).GetCroppingCap().UnregisterFromCroppingChange(phCallbacks[CAPTURE_QUEUE_CROPPING_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_FIELD_OF_VIEW_CHANGE] != NULL)
+		DepthGenerator(node.GetHandle()).UnregisterFromFieldOfViewChange(phCallbacks[CAPTURE_QUEUE_FIELD_OF_VIEW_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_PIXEL_FORMAT_CHANGE] != NULL)
+		ImageGenerator(node.GetHandle()).UnregisterFromPixelFormatChange(phCallbacks[CAPTURE_QUEUE_PIXEL_FORMAT_CHANGE]);
+	if (phCallbacks[CAPTURE_QUEUE_WAVE_OUTPUT_MODE_CHANGE] != NULL)
+		AudioGenerator(node.GetHandle()).UnregisterFromWaveOutputModeChanges(phCallbacks[CAPTURE_QUEUE_WAVE_OUTPUT_MODE_CHANGE]);
+
+	xnOSMemSet(phCallbacks, 0, sizeof(pNode->hChangeCallbacks));
+	pNode->bPropertiesChanged = false;
+}
+
+// Read on the UI thread, with the data they apply to
+static void captureQueueGetProperties(Generator& node, CaptureQueueProperties* pProperties)
+{
+	xnOSMemSet(pProperties, 0, sizeof(CaptureQueueProperties));
+	pProperties->type = node.GetInfo().GetDescription().Type;
+
+	pProperties->bMirrorSupported = node.IsCapabilitySupported(XN_CAPABILITY_MIRROR);
+	if (pProperties->bMirrorSupported)
+	{
+		pProperties->bMirror = node.GetMirrorCap().IsMirrored();
+	}
+
+	switch (pProperties->type)
+	{
+	case XN_NODE_TYPE_DEPTH:
+		DepthGenerator(node.GetHandle()).GetFieldOfView(pProperties->fieldOfView);
+		break;
+	case XN_NODE_TYPE_IMAGE:
+		pProperties->pixelFormat = ImageGenerator(node.GetHandle()).GetPixelFormat();
+		break;
+	case XN_NODE_TYPE_AUDIO:
+		AudioGenerator(node.GetHandle()).GetWaveOutputMode(pProperties->waveOutputMode);
+		return;
+	default:
+		break;
+	}
+
+	MapGenerator mapGenerator(node.GetHandle());
+	mapGenerator.GetMapOutputMode(pProperties->mapOutputMode);
+	pProperties->bCroppingSupported = mapGenerator.IsCapabilitySupported(XN_CAPABILITY_CROPPING);
+	if (pProperties->bCroppingSupported)
+	{
+		mapGenerator.GetCroppingCap().GetCropping(pProperties->cropping);
+	}
+}
+
+// Mock nodes take the properties by name, the recorder writes each change in the recording
+static XnStatus captureQueueSetMockProperties(CaptureQueueNode* pNode, const CaptureQueueProperties* pProperties)
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+	ProductionNode& mock = pNode->mock;
+
+	if (pProperties->bMirrorSupported)
+	{
+		nRetVal = mock.SetIntProperty(XN_PROP_MIRROR, pProperties->bMirror);
+		XN_IS_STATUS_OK(nRetVal);
+	}
+
+	if (pProperties->type == XN_NODE_TYPE_AUDIO)
+	{
+		return mock.SetGeneralProperty(XN_PROP_WAVE_OUTPUT_MODE, sizeof(XnWaveOutputMode), &pProperties->waveOutputMode);
+	}
+
+	nRetVal = mock.SetGeneralProperty(XN_PROP_MAP_OUTPUT_MODE, sizeof(XnMapOutputMode), &pProperties->mapOutputMode);
+	XN_IS_STATUS_OK(nRetVal);
+
+	if (pProperties->bCroppingSupported)
+	{
+		nRetVal = mock.SetGeneralProperty(XN_PROP_CROPPING, sizeof(XnCropping), &pProperties->cropping);
+		XN_IS_STATUS_OK(nRetVal);
+	}
+
+	if (pProperties->type == XN_NODE_TYPE_DEPTH)
+	{
+		// a view point change shows in the recording as the field of view it gives the depth
+		nRetVal = mock.SetGeneralProperty(XN_PROP_FIELD_OF_VIEW, sizeof(XnFieldOfView), &pProperties->fieldOfView);
+	}
+	else if (pProperties->type == XN_NODE_TYPE_IMAGE)
+	{
+		nRetVal = mock.SetIntProperty(XN_PROP_PIXEL_FORMAT, pProperties->pixelFormat);
+	}
+
+	return nRetVal;
+}
+
+static XnStatus captureQueueSetMockData(CaptureQueueNode* pNode, const CaptureQueueData* pData)
+{
+	XnNodeHandle hMock = pNode->mock.GetHandle();
+	switch (pNode->type)
+	{
+	case XN_NODE_TYPE_DEPTH:
+		return xnMockDepthSetData(hMock, pData->nFrameID, pData->nTimestamp, pData->nDataSize, (const XnDepthPixel*)pData->pBuffer);
+	case XN_NODE_TYPE_IMAGE:
+		return xnMockImageSetData(hMock, pData->nFrameID, pData->nTimestamp, pData->nDataSize, pData->pBuffer);
+	case XN_NODE_TYPE_IR:
+		return xnMockIRSetData(hMock, pData->nFrameID, pData->nTimestamp, pData->nDataSize, (const XnIRPixel*)pData->pBuffer);
+	case XN_NODE_TYPE_AUDIO:
+		return xnMockAudioSetData(hMock, pData->nFrameID, pData->nTimestamp, pData->nDataSize, pData->pBuffer);
+	default:
+		return XN_STATUS_BAD_NODE_TYPE;
+	}
+}
+
+// Brings the recorder up to date with the nodes added and removed by the UI thread
+static XnStatus captureQueueUpdateNodes()
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+	Generator nodes[CAPTURE_QUEUE_MAX_NODES];
+	XnUInt32 nGenerations[CAPTURE_QUEUE_MAX_NODES];
+	XnCodecID codecs[CAPTURE_QUEUE_MAX_NODES];
+
+	// only the node table is read under the lock, the UI never waits for the recorder
+	xnOSEnterCriticalSection(&g_hRecordLock);
+	ProductionNode device = g_QueueDevice;
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		nGenerations[i] = g_QueueNodes[i].nGeneration;
+		codecs[i] = g_QueueNodes[i].codec;
+		if (g_QueueNodes[i].bActive)
+		{
+			nodes[i] = g_QueueNodes[i].node;
+		}
+	}
+	xnOSLeaveCriticalSection(&g_hRecordLock);
+
+	// the device is added once, it has no data and only its properties are recorded
+	if (device.IsValid() && !g_QueueDeviceMock.IsValid())
+	{
+		nRetVal = g_RecordContext.CreateMockNodeBasedOn(device, device.GetName(), g_QueueDeviceMock);
+		if (nRetVal == XN_STATUS_OK)
+		{
+			nRetVal = g_QueueRecorder.AddNodeToRecording(g_QueueDeviceMock, XN_CODEC_UNCOMPRESSED);
+		}
+		if (nRetVal != XN_STATUS_OK)
+		{
+			g_QueueDeviceMock.Release();
+		}
+	}
+
+	// stale mocks go first, a node added again in another entry takes the same name
+	bool bChanged[CAPTURE_QUEUE_MAX_NODES];
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		CaptureQueueNode* pNode = &g_QueueNodes[i];
+		bChanged[i] = (pNode->nMockGeneration != nGenerations[i]);
+		pNode->nMockGeneration = nGenerations[i];
+		if (bChanged[i] && pNode->mock.IsValid())
+		{
+			g_QueueRecorder.RemoveNodeFromRecording(pNode->mock);
+			pNode->mock.Release();
+		}
+	}
+
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		CaptureQueueNode* pNode = &g_QueueNodes[i];
+		if (!bChanged[i] || !nodes[i].IsValid())
+			continue;
+
+		// same name as the captured node, so the player recreates it under its original name
+		XnStatus nNodeRetVal = g_RecordContext.CreateMockNodeBasedOn(nodes[i], nodes[i].GetName(), pNode->mock);
+		if (nNodeRetVal == XN_STATUS_OK)
+		{
+			pNode->type = nodes[i].GetInfo().GetDescription().Type;
+			nNodeRetVal = g_QueueRecorder.AddNodeToRecording(pNode->mock, codecs[i]);
+		}
+
+		if (nNodeRetVal != XN_STATUS_OK)
+		{
+			pNode->mock.Release();
+			nRetVal = nNodeRetVal;
+		}
+	}
+
+	return nRetVal;
+}
+
+static XnStatus captureQueueRecordSlot(CaptureQueueSlot* pSlot)
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+
+	// data queued for a node since removed or added again belongs to another generation, it is skipped
+	bool bRecord[CAPTURE_QUEUE_MAX_NODES];
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		CaptureQueueNode* pNode = &g_QueueNodes[i];
+		bRecord[i] = pNode->mock.IsValid() && pSlot->data[i].nDataSize != 0 && pSlot->data[i].nGeneration == pNode->nMockGeneration;
+	}
+
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES && nRetVal == XN_STATUS_OK; ++i)
+	{
+		if (bRecord[i] && pSlot->data[i].bProperties)
+		{
+			nRetVal = captureQueueSetMockProperties(&g_QueueNodes[i], &pSlot->data[i].properties);
+		}
+		if (bRecord[i] && nRetVal == XN_STATUS_OK)
+		{
+			nRetVal = captureQueueSetMockData(&g_QueueNodes[i], &pSlot->data[i]);
+		}
+	}
+
+	if (nRetVal == XN_STATUS_OK)
+	{
+		// compresses the new data of the mock nodes and writes it
+		nRetVal = g_QueueRecorder.Record();
+	}
+
+	return nRetVal;
+}
+
+static XN_THREAD_PROC captureQueueThread(XN_THREAD_PARAM)
+{
+	bool bStop = false;
+	while (!bStop)
+	{
+		xnOSWaitEvent(g_hQueueEvent, XN_WAIT_INFINITE);
+
+		// record everything queued, also when asked to stop, so no queued frame is lost
+		for (;;)
+		{
+			// nodes added or removed since the last frame, also when nothing is queued
+			XnStatus nNodesRetVal = captureQueueUpdateNodes();
+
+			xnOSEnterCriticalSection(&g_hQueueLock);
+			XnUInt32 nQueued = g_QueueStatistics.nQueued;
+			XnUInt32 nSlot = g_nQueueTail;
+			bStop = g_bQueueStop;
+			if (nNodesRetVal != XN_STATUS_OK)
+				g_nQueueError = nNodesRetVal;
+			xnOSLeaveCriticalSection(&g_hQueueLock);
+
+			if (nQueued == 0)
+				break;
+
+			XnStatus nRetVal = captureQueueRecordSlot(&g_QueueSlots[nSlot]);
+
+			xnOSEnterCriticalSection(&g_hQueueLock);
+			g_nQueueTail = (g_nQueueTail + 1) % CAPTURE_QUEUE_SLOTS;
+			--g_QueueStatistics.nQueued;
+			if (nRetVal == XN_STATUS_OK)
+				++g_QueueStatistics.nRecorded;
+			else
+				g_nQueueError = nRetVal;
+			xnOSLeaveCriticalSection(&g_hQueueLock);
+		}
+	}
+
+	XN_THREAD_PROC_RETURN(XN_STATUS_OK);
+}
+
+XnStatus captureQueueOpen(const XnChar* csFileName)
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+
+	captureQueueClose();
+
+	nRetVal = g_RecordContext.Init();
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	nRetVal = g_QueueRecorder.Create(g_RecordContext);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	nRetVal = g_QueueRecorder.SetDestination(XN_RECORD_MEDIUM_FILE, csFileName);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	xnOSMemSet(&g_QueueStatistics, 0, sizeof(g_QueueStatistics));
+	g_QueueStatistics.nCapacity = CAPTURE_QUEUE_SLOTS;
+	g_nQueueHead = 0;
+	g_nQueueTail = 0;
+	g_nQueueError = XN_STATUS_OK;
+	g_bQueueStop = false;
+
+	nRetVal = xnOSCreateCriticalSection(&g_hQueueLock);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	nRetVal = xnOSCreateCriticalSection(&g_hRecordLock);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	nRetVal = xnOSCreateEvent(&g_hQueueEvent, FALSE);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	nRetVal = xnOSCreateThread(captureQueueThread, NULL, &g_hQueueThread);
+	CAPTURE_QUEUE_CHECK_RC(nRetVal);
+
+	g_bQueueOpen = true;
+	return XN_STATUS_OK;
+}
+
+void captureQueueClose()
+{
+	if (g_hQueueThread != NULL)
+	{
+		xnOSEnterCriticalSection(&g_hQueueLock);
+		g_bQueueStop = true;
+		xnOSLeaveCriticalSection(&g_hQueueLock);
+		xnOSSetEvent(g_hQueueEvent);
+		xnOSWaitForThreadExit(g_hQueueThread, XN_WAIT_INFINITE);
+		xnOSCloseThread(&g_hQueueThread);
+		g_hQueueThread = NULL;
+	}
+
+	if (g_hQueueEvent != NULL)
+	{
+		xnOSCloseEvent(&g_hQueueEvent);
+		g_hQueueEvent = NULL;
+	}
+
+	if (g_hRecordLock != NULL)
+	{
+		xnOSCloseCriticalSection(&g_hRecordLock);
+		g_hRecordLock = NULL;
+	}
+
+	if (g_hQueueLock != NULL)
+	{
+		xnOSCloseCriticalSection(&g_hQueueLock);
+		g_hQueueLock = NULL;
+	}
+
+	// the recorder goes first, it references the mock nodes
+	g_QueueRecorder.Release();
+	g_QueueDeviceMock.Release();
+	g_QueueDevice.Release();
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		if (g_QueueNodes[i].bActive)
+		{
+			captureQueueUnregisterChanges(&g_QueueNodes[i]);
+		}
+		g_QueueNodes[i].bActive = false;
+		g_QueueNodes[i].mock.Release();
+		g_QueueNodes[i].nMockGeneration = g_QueueNodes[i].nGeneration;
+		g_QueueNodes[i].node.Release();
+	}
+	g_RecordContext.Release();
+
+	for (int nSlot = 0; nSlot < CAPTURE_QUEUE_SLOTS; ++nSlot)
+	{
+		for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+		{
+			CaptureQueueData* pData = &g_QueueSlots[nSlot].data[i];
+			if (pData->pBuffer != NULL)
+			{
+				xnOSFreeAligned(pData->pBuffer);
+			}
+			xnOSMemSet(pData, 0, sizeof(CaptureQueueData));
+		}
+	}
+
+	g_bQueueOpen = false;
+}
+
+bool captureQueueIsOpen()
+{
+	return g_bQueueOpen;
+}
+
+XnStatus captureQueueAddNode(Generator& node, XnCodecID codec)
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+
+	if (!g_bQueueOpen)
+		return XN_STATUS_NOT_INIT;
+
+	// adding a node again just changes its codec
+	nRetVal = captureQueueRemoveNode(node);
+	if (nRetVal != XN_STATUS_OK && nRetVal != XN_STATUS_NO_MATCH)
+		return nRetVal;
+
+	int nIndex = 0;
+	while (nIndex < CAPTURE_QUEUE_MAX_NODES && g_QueueNodes[nIndex].bActive)
+		++nIndex;
+
+	if (nIndex == CAPTURE_QUEUE_MAX_NODES)
+		return XN_STATUS_NO_MATCH;
+
+	// the recording thread makes the mock node and adds it to the recorder
+	CaptureQueueNode* pNode = &g_QueueNodes[nIndex];
+	xnOSEnterCriticalSection(&g_hRecordLock);
+	pNode->node = node;
+	pNode->codec = codec;
+	pNode->bActive = true;
+	++pNode->nGeneration;
+	xnOSLeaveCriticalSection(&g_hRecordLock);
+
+	captureQueueRegisterChanges(pNode);
+
+	xnOSSetEvent(g_hQueueEvent);
+	return XN_STATUS_OK;
+}
+
+XnStatus captureQueueAddDevice(ProductionNode& device)
+{
+	if (!g_bQueueOpen)
+		return XN_STATUS_NOT_INIT;
+
+	// the recording thread makes the mock node and adds it to the recorder
+	xnOSEnterCriticalSection(&g_hRecordLock);
+	g_QueueDevice = device;
+	xnOSLeaveCriticalSection(&g_hRecordLock);
+
+	xnOSSetEvent(g_hQueueEvent);
+	return XN_STATUS_OK;
+}
+
+XnStatus captureQueueRemoveNode(Generator& node)
+{
+	if (!g_bQueueOpen)
+		return XN_STATUS_NOT_INIT;
+
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES; ++i)
+	{
+		CaptureQueueNode* pNode = &g_QueueNodes[i];
+		if (pNode->bActive && pNode->node.GetHandle() == node.GetHandle())
+		{
+			captureQueueUnregisterChanges(pNode);
+
+			xnOSEnterCriticalSection(&g_hRecordLock);
+			pNode->bActive = false;
+			++pNode->nGeneration;
+			pNode->node.Release();
+			xnOSLeaveCriticalSection(&g_hRecordLock);
+
+			xnOSSetEvent(g_hQueueEvent);
+			return XN_STATUS_OK;
+		}
+	}
+
+	return XN_STATUS_NO_MATCH;
+}
+
+XnStatus captureQueuePush(bool* pbQueued)
+{
+	*pbQueued = false;
+	if (!g_bQueueOpen)
+		return XN_STATUS_OK;
+
+	xnOSEnterCriticalSection(&g_hQueueLock);
+	bool bFull = (g_QueueStatistics.nQueued == CAPTURE_QUEUE_SLOTS);
+	XnUInt32 nSlot = g_nQueueHead;
+	XnStatus nRetVal = g_nQueueError;
+	g_nQueueError = XN_STATUS_OK;
+	xnOSLeaveCriticalSection(&g_hQueueLock);
+
+	// the slot at the head is not read by the recording thread until it is queued. The node table is
+	// only changed by this thread, it is read without the lock.
+	bool bNewData = false;
+	for (int i = 0; i < CAPTURE_QUEUE_MAX_NODES && !bFull; ++i)
+	{
+		CaptureQueueData* pData = &g_QueueSlots[nSlot].data[i];
+		pData->nDataSize = 0;
+
+		Generator& node = g_QueueNodes[i].node;
+		if (!g_QueueNodes[i].bActive || !node.IsDataNew())
+			continue;
+
+		XnUInt32 nDataSize = node.GetDataSize();
+		if (nDataSize > pData->nBufferSize)
+		{
+			// slots are allocated by the first frames, they only grow when a frame is bigger (e.g. audio)
+			if (pData->pBuffer != NULL)
+			{
+				xnOSFreeAligned(pData->pBuffer);
+			}
+			pData->pBuffer = (XnUInt8*)xnOSMallocAligned(nDataSize, XN_DEFAULT_MEM_ALIGN);
+			pData->nBufferSize = (pData->pBuffer != NULL) ? nDataSize : 0;
+			if (pData->pBuffer == NULL)
+				return XN_STATUS_ALLOC_FAILED;
+		}
+
+		xnOSMemCopy(pData->pBuffer, node.GetData(), nDataSize);
+		pData->nDataSize = nDataSize;
+		pData->nGeneration = g_QueueNodes[i].nGeneration;
+		pData->nFrameID = node.GetFrameID();
+		pData->nTimestamp = node.GetTimestamp();
+		pData->bProperties = g_QueueNodes[i].bPropertiesChanged;
+		if (pData->bProperties)
+		{
+			captureQueueGetProperties(node, &pData->properties);
+			g_QueueNodes[i].bPropertiesChanged = false;
+		}
+		bNewData = true;
+	}
+
+	xnOSEnterCriticalSection(&g_hQueueLock);
+	if (bFull)
+	{
+		++g_QueueStatistics.nDropped;
+	}
+	else if (bNewData)
+	{
+		g_nQueueHead = (g_nQueueHead + 1) % CAPTURE_QUEUE_SLOTS;
+		++g_QueueStatistics.nQueued;
+		if (g_QueueStatistics.nQueued > g_QueueStatistics.nMaxQueued)
+			g_QueueStatistics.nMaxQueued = g_QueueStatistics.nQueued;
+		*pbQueued = true;
+	}
+	xnOSLeaveCriticalSection(&g_hQueueLock);
+
+	if (bNewData)
+	{
+		xnOSSetEvent(g_hQueueEvent);
+	}
+
+	return nRetVal;
+}
+
+void captureQueueGetStatistics(CaptureQueueStatistics* pStatistics)
+{
+	if (!g_bQueueOpen)
+	{
+		xnOSMemSet(pStatistics, 0, sizeof(CaptureQueueStatistics));
+		return;
+	}
+
+	xnOSEnterCriticalSection(&g_hQueueLock);
+	*pStatistics = g_QueueStatistics;
+	xnOSLeaveCriticalSection(&g_hQueueLock);
+}
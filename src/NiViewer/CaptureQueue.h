@@ -0,0 +1,54 @@
+#ifndef __CAPTURE_QUEUE_H__
+#define __CAPTURE_QUEUE_H__
+
+// --------------------------------
+// Includes
+// --------------------------------
+#include <XnCppWrapper.h>
+
+// --------------------------------
+// Defines
+// --------------------------------
+// one second of frames at 30 FPS
+#define CAPTURE_QUEUE_SLOTS 30
+
+// --------------------------------
+// Types
+// --------------------------------
+typedef struct
+{
+	XnUInt32 nQueued;		// frames waiting to be recorded
+	XnUInt32 nMaxQueued;	// most frames waiting at once since the queue was opened
+	XnUInt32 nCapacity;
+	XnUInt32 nRecorded;		// frames written by the recording thread
+	XnUInt32 nDropped;		// frames lost because the queue was full
+} CaptureQueueStatistics;
+
+// --------------------------------
+// Function Declarations
+// --------------------------------
+// The recorder lives in a context of its own, on mock copies of the captured generators, and records
+// on a dedicated thread. The draw loop only copies the new data of each frame into a free slot of a
+// ring of preallocated buffers, so compression and file writes never stall it. When the disk can't
+// keep up the ring fills and frames are dropped (and counted) instead of blocking.
+XnStatus captureQueueOpen(const XnChar* csFileName);
+void captureQueueClose();
+bool captureQueueIsOpen();
+
+// Nodes are added to and removed from the recording by the recording thread, before the next frame it
+// records. Data queued for a node before it was removed or added again is not recorded.
+//
+// Changes of the mirror, output mode, cropping, view point (the depth field of view), pixel format and
+// wave output mode of an added node are forwarded to its mock with the next data queued for it, so
+// the recording switches at the same frame as the captured node.
+XnStatus captureQueueAddNode(xn::Generator& node, XnCodecID codec);
+XnStatus captureQueueRemoveNode(xn::Generator& node);
+// The device node has no data, only its properties (serial number, ...) are recorded
+XnStatus captureQueueAddDevice(xn::ProductionNode& device);
+
+// Queues the new data of all the added nodes as one frame, *pbQueued tells whether it was (false when
+// there was no new data or the queue was full). Returns the last error of the recording thread.
+XnStatus captureQueuePush(bool* pbQueued);
+void captureQueueGetStatistics(CaptureQueueStatistics* pStatistics);
+
+#endif //__CAPTURE_QUEUE_H__
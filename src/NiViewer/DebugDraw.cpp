@@ -0,0 +1,171 @@
+// --------------------------------
+// Includes
+// --------------------------------
+#include "DebugDraw.h"
+#include "Draw.h"
+#if (XN_PLATFORM == XN_PLATFORM_MACOSX)
+	#include <GLUT/glut.h>
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+	#include <GL/glut.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// --------------------------------
+// Types
+// --------------------------------
+typedef struct
+{
+	void* pFont;
+	int nX;
+	int nY;
+	KRGBColor Color;
+	// in g_DebugDrawChars
+	size_t nOffset;
+} DebugDrawText;
+
+// vertex buffer objects (GL_ARB_vertex_buffer_object), loaded at run time
+typedef struct
+{
+	bool bLoaded;
+	bool bSupported;
+	PFNGLGENBUFFERSARBPROC glGenBuffers;
+	PFNGLBINDBUFFERARBPROC glBindBuffer;
+	PFNGLBUFFERDATAARBPROC glBufferData;
+} XnVertexBufferFunctions;
+
+// --------------------------------
+// Global Variables
+// --------------------------------
+const GLenum g_aDebugDrawModes[DEBUG_DRAW_PRIMITIVE_COUNT] = { GL_POINTS, GL_LINES, GL_QUADS };
+// order of drawing, later ones are on top
+const DebugDrawPrimitive g_aDebugDrawOrder[DEBUG_DRAW_PRIMITIVE_COUNT] = { DEBUG_DRAW_QUADS, DEBUG_DRAW_LINES, DEBUG_DRAW_POINTS };
+
+// kept from frame to frame, so their memory is only allocated while the overlays grow
+std::vector<KVertex> g_DebugDrawVertices[DEBUG_DRAW_PRIMITIVE_COUNT];
+std::vector<DebugDrawText> g_DebugDrawTexts;
+std::vector<char> g_DebugDrawChars;
+
+XnVertexBufferFunctions g_VBO = {0};
+GLuint g_anDebugDrawBuffers[DEBUG_DRAW_PRIMITIVE_COUNT] = {0};
+
+// --------------------------------
+// Code
+// --------------------------------
+static void debugDrawLoadBufferFunctions()
+{
+	if (g_VBO.bLoaded)
+		return;
+
+	g_VBO.bLoaded = true;
+
+	const char* csExtensions = (const char*)glGetString(GL_EXTENSIONS);
+	if (csExtensions == NULL || strstr(csExtensions, "GL_ARB_vertex_buffer_object") == NULL)
+		return;
+
+	g_VBO.glGenBuffers = (PFNGLGENBUFFERSARBPROC)GetGLProcAddress("glGenBuffersARB");
+	g_VBO.glBindBuffer = (PFNGLBINDBUFFERARBPROC)GetGLProcAddress("glBindBufferARB");
+	g_VBO.glBufferData = (PFNGLBUFFERDATAARBPROC)GetGLProcAddress("glBufferDataARB");
+
+	g_VBO.bSupported = (g_VBO.glGenBuffers != NULL && g_VBO.glBindBuffer != NULL && g_VBO.glBufferData != NULL);
+	if (g_VBO.bSupported)
+	{
+		g_VBO.glGenBuffers(DEBUG_DRAW_PRIMITIVE_COUNT, g_anDebugDrawBuffers);
+	}
+}
+
+void debugDrawVertices(DebugDrawPrimitive primitive, const KVertex* pVertices, int nCount)
+{
+	g_DebugDrawVertices[primitive].insert(g_DebugDrawVertices[primitive].end(), pVertices, pVertices + nCount);
+}
+
+void debugDrawPoint(float fX, float fY, KRGBColor color)
+{
+	g_DebugDrawVertices[DEBUG_DRAW_POINTS].push_back(makeVertex(fX, fY, 0, color));
+}
+
+void debugDrawLine(float fX1, float fY1, float fX2, float fY2, KRGBColor color)
+{
+	std::vector<KVertex>& vertices = g_DebugDrawVertices[DEBUG_DRAW_LINES];
+	vertices.push_back(makeVertex(fX1, fY1, 0, color));
+	vertices.push_back(makeVertex(fX2, fY2, 0, color));
+}
+
+void debugDrawRect(float fLeft, float fTop, float fRight, float fBottom, KRGBColor color)
+{
+	std::vector<KVertex>& vertices = g_DebugDrawVertices[DEBUG_DRAW_QUADS];
+	vertices.push_back(makeVertex(fLeft, fTop, 0, color));
+	vertices.push_back(makeVertex(fRight, fTop, 0, color));
+	vertices.push_back(makeVertex(fRight, fBottom, 0, color));
+	vertices.push_back(makeVertex(fLeft, fBottom, 0, color));
+}
+
+void debugDrawText(void* pFont, int nX, int nY, KRGBColor color, const char* csText)
+{
+	DebugDrawText text = { pFont, nX, nY, color, g_DebugDrawChars.size() };
+	g_DebugDrawTexts.push_back(text);
+	g_DebugDrawChars.insert(g_DebugDrawChars.end(), csText, csText + strlen(csText) + 1);
+}
+
+void debugDrawFlush()
+{
+	debugDrawLoadBufferFunctions();
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glPointSize(1);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	for (int i = 0; i < DEBUG_DRAW_PRIMITIVE_COUNT; ++i)
+	{
+		DebugDrawPrimitive primitive = g_aDebugDrawOrder[i];
+		std::vector<KVertex>& vertices = g_DebugDrawVertices[primitive];
+		if (vertices.empty())
+			continue;
+
+		// with a buffer object the pointers are offsets in it, otherwise they point at the array
+		const char* pBase = (const char*)&vertices[0];
+		if (g_VBO.bSupported)
+		{
+			g_VBO.glBindBuffer(GL_ARRAY_BUFFER_ARB, g_anDebugDrawBuffers[primitive]);
+			g_VBO.glBufferData(GL_ARRAY_BUFFER_ARB, vertices.size() * sizeof(KVertex), &vertices[0], GL_STREAM_DRAW_ARB);
+			pBase = NULL;
+		}
+
+		glVertexPointer(3, GL_FLOAT, sizeof(KVertex), pBase + offsetof(KVertex, mX));
+		glColorPointer(4, GL_FLOAT, sizeof(KVertex), pBase + offsetof(KVertex, mColor));
+		glDrawArrays(g_aDebugDrawModes[primitive], 0, (GLsizei)vertices.size());
+
+		vertices.clear();
+	}
+
+	if (g_VBO.bSupported)
+	{
+		g_VBO.glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisable(GL_BLEND);
+
+	// bitmap text cannot go through a vertex array, but it needs no state changes between strings
+	// other than the color, which is taken by glRasterPos
+	for (size_t i = 0; i < g_DebugDrawTexts.size(); ++i)
+	{
+		const DebugDrawText& text = g_DebugDrawTexts[i];
+		glColor4f(text.Color.r, text.Color.g, text.Color.b, text.Color.a);
+		glRasterPos2i(text.nX, text.nY);
+		for (const char* pChar = &g_DebugDrawChars[text.nOffset]; *pChar != '\0'; ++pChar)
+		{
+			glutBitmapCharacter(text.pFont, *pChar);
+		}
+	}
+
+	g_DebugDrawTexts.clear();
+	g_DebugDrawChars.clear();
+}
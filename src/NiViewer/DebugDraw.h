@@ -0,0 +1,39 @@
+#ifndef __DEBUG_DRAW_H__
+#define __DEBUG_DRAW_H__
+
+// --------------------------------
+// Includes
+// --------------------------------
+#include "../KinectDevice/KVertex.h"
+
+// --------------------------------
+// Types
+// --------------------------------
+typedef enum
+{
+	DEBUG_DRAW_POINTS,
+	DEBUG_DRAW_LINES,
+	DEBUG_DRAW_QUADS,
+	DEBUG_DRAW_PRIMITIVE_COUNT
+} DebugDrawPrimitive;
+
+// --------------------------------
+// Function Declarations
+// --------------------------------
+// Overlays are not drawn vertex by vertex. They are appended to one vertex array per primitive type
+// and debugDrawFlush() draws each array with a single call, quads first, then lines, points and
+// last the text. Points are one pixel, blending is on for everything.
+
+// nCount is a multiple of 2 for lines and of 4 for quads
+void debugDrawVertices(DebugDrawPrimitive primitive, const KVertex* pVertices, int nCount);
+void debugDrawPoint(float fX, float fY, KRGBColor color);
+void debugDrawLine(float fX1, float fY1, float fX2, float fY2, KRGBColor color);
+void debugDrawRect(float fLeft, float fTop, float fRight, float fBottom, KRGBColor color);
+// pFont is a GLUT bitmap font, the text is copied
+void debugDrawText(void* pFont, int nX, int nY, KRGBColor color, const char* csText);
+
+// Draws and clears everything appended so far. Called at the end of a frame, and before an overlay
+// that has to cover what was appended before it.
+void debugDrawFlush();
+
+#endif //__DEBUG_DRAW_H__
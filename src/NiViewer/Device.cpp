@@ -24,6 +24,8 @@
 // --------------------------------
 #include "Device.h"
 #include "Draw.h"
+#include "FrameIndex.h"
+#include "../KinectDevice/ReplayDecoder.h"
 #include <math.h>
 #include <XnLog.h>
 
@@ -61,6 +63,11 @@ AudioMetaData g_AudioMD;
 
 ProductionNode* g_pPrimary = NULL;
 
+// decode-ahead of the depth stream of a recording, see toggleDecodeAhead()
+XnChar g_csRecordingFile[XN_FILE_MAX_PATH] = "";
+Kinect::ReplayDecoder g_DecodeAhead;
+XnUInt32 g_nDecodedFrame = 0;
+
 // --------------------------------
 // Code
 // --------------------------------
@@ -176,6 +183,8 @@ XnStatus openDeviceFile(const char* csFile)
 	XN_IS_STATUS_OK(nRetVal);
 	nRetVal = g_Context.OpenFileRecording(csFile, g_Player);
 	XN_IS_STATUS_OK(nRetVal);
+	xnOSStrCopy(g_csRecordingFile, csFile, XN_FILE_MAX_PATH);
+	frameIndexClear();
 	openCommon();
 
 	return XN_STATUS_OK;
@@ -273,7 +282,9 @@ XnStatus openDeviceFromXmlWithChoice(const char* csXmlFile, EnumerationErrors& e
 
 void closeDevice()
 {
+	g_DecodeAhead.Close();
 	g_Player.Release();
+	frameIndexClear();
 	g_Device.Release();
 	g_Depth.Release();
 	g_Image.Release();
@@ -283,10 +294,53 @@ void closeDevice()
 	g_Context.Release();
 }
 
+void seekToFrame(const XnChar* strNodeName, XnUInt32 nFrame, XnInt32 nDiff);
+Generator* getSeekGenerator();
+
+// The player goes on from the last decoded frame, it is still where decoding ahead started
+static void stopDecodeAhead()
+{
+	XnUInt32 nFrame = 0;
+	g_DecodeAhead.Close();
+	g_Player.TellFrame(g_Depth.GetName(), nFrame);
+	seekToFrame(g_Depth.GetName(), g_nDecodedFrame, (XnInt32)g_nDecodedFrame - (XnInt32)nFrame);
+
+	// the decoded pixels went with the decoder, the depth map is the one of the player again
+	g_Depth.GetMetaData(g_DepthMD);
+}
+
+static void readDecodedFrame()
+{
+	const Kinect::ReplayFrame* pFrame = g_DecodeAhead.Next();
+	if (pFrame == NULL)
+	{
+		XnStatus nRetVal = g_DecodeAhead.GetLastError();
+		stopDecodeAhead();
+		if (nRetVal != XN_STATUS_OK)
+			displayMessage("Decoding ahead failed: %s", xnGetStatusString(nRetVal));
+		else
+			displayMessage("Decoded to the end of the recording");
+		return;
+	}
+
+	// the decoder owns the pixels until the next frame, other streams keep their last frame
+	g_DepthMD.ReAdjust(pFrame->nXRes, pFrame->nYRes, (const XnDepthPixel*)pFrame->pData);
+	g_DepthMD.FrameID() = pFrame->nFrameID;
+	g_DepthMD.Timestamp() = pFrame->nTimestamp;
+	g_nDecodedFrame = pFrame->nFrame;
+	frameIndexAddFrame(g_Depth.GetName(), pFrame->nFrame, pFrame->nTimestamp);
+}
+
 void readFrame()
 {
 	XnStatus rc = XN_STATUS_OK;
 
+	if (g_DecodeAhead.IsOpen())
+	{
+		readDecodedFrame();
+		return;
+	}
+
 	if (g_pPrimary != NULL)
 	{
 		rc = g_Context.WaitOneUpdateAll(*g_pPrimary);
@@ -320,6 +374,17 @@ void readFrame()
 	{
 		g_Audio.GetMetaData(g_AudioMD);
 	}
+
+	// every frame read from the player goes into the frame index, for seeking by time
+	if (g_bIsPlayerOn)
+	{
+		Generator* pGenerator = getSeekGenerator();
+		XnUInt32 nFrame = 0;
+		if (pGenerator != NULL && g_Player.TellFrame(pGenerator->GetName(), nFrame) == XN_STATUS_OK && nFrame != 0)
+		{
+			frameIndexAddFrame(pGenerator->GetName(), nFrame, pGenerator->GetTimestamp());
+		}
+	}
 }
 
 void changeRegistration(int nValue)
@@ -446,58 +511,122 @@ void toggleMirror(int )
 	}
 }
 
-void seekFrame(int nDiff)
+Generator* getSeekGenerator()
+{
+	if (g_pPrimary != NULL)
+	{
+		// always one of the generators, see changePrimaryStream()
+		return (Generator*)g_pPrimary;
+	}
+	else if (g_Depth.IsValid())
+	{
+		return &g_Depth;
+	}
+	else if (g_Image.IsValid())
+	{
+		return &g_Image;
+	}
+	else if (g_IR.IsValid())
+	{
+		return &g_IR;
+	}
+	else if (g_Audio.IsValid())
+	{
+		return &g_Audio;
+	}
+
+	return NULL;
+}
+
+void seekToFrame(const XnChar* strNodeName, XnUInt32 nFrame, XnInt32 nDiff)
 {
 	XnStatus nRetVal = XN_STATUS_OK;
-	if (isPlayerOn())
+
+	// seeking goes back to the player
+	g_DecodeAhead.Close();
+
+	XnUInt64 nStart;
+	xnOSGetHighResTimeStamp(&nStart);
+
+	// when the player knows the frame count the target is clamped to it, otherwise the player is asked
+	// for a relative move. Either way the player finds the frame in the recording.
+	XnUInt32 nNumFrames = 0;
+	if (g_Player.GetNumFrames(strNodeName, nNumFrames) != XN_STATUS_OK)
 	{
-		const XnChar* strNodeName = NULL;
-		if (g_pPrimary != NULL)
-		{
-			strNodeName = g_pPrimary->GetName();
-		}
-		else if (g_Depth.IsValid())
-		{
-			strNodeName = g_Depth.GetName();
-		}
-		else if (g_Image.IsValid())
-		{
-			strNodeName = g_Image.GetName();
-		}
-		else if (g_IR.IsValid())
-		{
-			strNodeName = g_IR.GetName();
-		}
-		else if (g_Audio.IsValid())
-		{
-			strNodeName = g_Audio.GetName();
-		}
+		nNumFrames = 0;
+	}
 
+	if (nNumFrames != 0)
+	{
+		nRetVal = g_Player.SeekToFrame(strNodeName, XN_MIN(XN_MAX(nFrame, 1), nNumFrames), XN_PLAYER_SEEK_SET);
+	}
+	else
+	{
 		nRetVal = g_Player.SeekToFrame(strNodeName, nDiff, XN_PLAYER_SEEK_CUR);
-		if (nRetVal != XN_STATUS_OK)
-		{
-			displayMessage("Failed to seek: %s", xnGetStatusString(nRetVal));
+	}
+
+	if (nRetVal != XN_STATUS_OK)
+	{
+		displayMessage("Failed to seek: %s", xnGetStatusString(nRetVal));
+		return;
+	}
+
+	XnUInt64 nEnd;
+	xnOSGetHighResTimeStamp(&nEnd);
+
+	nRetVal = g_Player.TellFrame(strNodeName, nFrame);
+	if (nRetVal != XN_STATUS_OK)
+	{
+		displayMessage("Failed to tell frame: %s", xnGetStatusString(nRetVal));
+		return;
+	}
+
+	displayMessage("Seeked %s to frame %u/%u (%.1f ms)", strNodeName, nFrame, nNumFrames, (nEnd - nStart) / 1000.0);
+}
+
+void seekFrame(int nDiff)
+{
+	XnStatus nRetVal = XN_STATUS_OK;
+	if (isPlayerOn())
+	{
+		Generator* pGenerator = getSeekGenerator();
+		if (pGenerator == NULL)
 			return;
-		}
 
 		XnUInt32 nFrame = 0;
-		XnUInt32 nNumFrames = 0;
-		nRetVal = g_Player.TellFrame(strNodeName, nFrame);
+		nRetVal = g_Player.TellFrame(pGenerator->GetName(), nFrame);
 		if (nRetVal != XN_STATUS_OK)
 		{
 			displayMessage("Failed to tell frame: %s", xnGetStatusString(nRetVal));
 			return;
 		}
 
-		nRetVal = g_Player.GetNumFrames(strNodeName, nNumFrames);
+		seekToFrame(pGenerator->GetName(), (XnUInt32)XN_MAX((XnInt32)nFrame + nDiff, 1), nDiff);
+	}	
+}
+
+void seekTime(int nSecondsDiff)
+{
+	if (isPlayerOn())
+	{
+		Generator* pGenerator = getSeekGenerator();
+		if (pGenerator == NULL)
+			return;
+
+		// the player seeks by frame, the frame index turns the time into one
+		XnInt64 nTarget = (XnInt64)pGenerator->GetTimestamp() + (XnInt64)nSecondsDiff * 1000000;
+		XnUInt32 nNumFrames = 0;
+		g_Player.GetNumFrames(pGenerator->GetName(), nNumFrames);
+		XnUInt32 nFrame = 0;
+		XnStatus nRetVal = frameIndexFindFrame(pGenerator->GetName(), (XnUInt64)XN_MAX(nTarget, 0), nNumFrames, &nFrame);
 		if (nRetVal != XN_STATUS_OK)
 		{
-			displayMessage("Failed to get number of frames: %s", xnGetStatusString(nRetVal));
+			displayMessage("Failed to find the frame of that time: %s", xnGetStatusString(nRetVal));
 			return;
 		}
 
-		displayMessage("Seeked %s to frame %u/%u", strNodeName, nFrame, nNumFrames);
-	}	
+		seekToFrame(pGenerator->GetName(), nFrame, 0);
+	}
 }
 
 bool isDepthOn()
@@ -631,6 +760,36 @@ void setPlaybackSpeed(int ratioDiff)
 	}
 }
 
+void toggleDecodeAhead(int)
+{
+	if (g_DecodeAhead.IsOpen())
+	{
+		stopDecodeAhead();
+		return;
+	}
+
+	if (!g_Player.IsValid() || !g_Depth.IsValid())
+	{
+		displayMessage("Decoding ahead needs a recording with a depth stream!");
+		return;
+	}
+
+	// the threads read the recording through players of their own, from the current frame on
+	XnUInt32 nFrame = 0;
+	g_Player.TellFrame(g_Depth.GetName(), nFrame);
+	XnStatus nRetVal = g_DecodeAhead.Open(g_csRecordingFile, XN_NODE_TYPE_DEPTH, nFrame + 1);
+	if (nRetVal != XN_STATUS_OK)
+	{
+		displayMessage("Failed to start decoding ahead: %s", xnGetStatusString(nRetVal));
+		return;
+	}
+
+	// stopped before the first decoded frame, the player stays where it is
+	g_nDecodedFrame = nFrame;
+
+	displayMessage("Decoding depth ahead on %u threads", g_DecodeAhead.GetThreadCount());
+}
+
 XnDouble getPlaybackSpeed()
 {
 	if (g_Player.IsValid())
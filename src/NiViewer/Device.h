@@ -77,6 +77,7 @@ void changeRegistration(int nValue);
 void changePrimaryStream(int nValue);
 void toggleMirror(int);
 void seekFrame(int nDiff);
+void seekTime(int nSecondsDiff);
 void toggleDepthState(int nDummy);
 void toggleImageState(int nDummy);
 void toggleIRState(int nDummy);
@@ -98,6 +99,7 @@ void setIRResolution(int res);
 void setIRFPS(int fps);
 void setStreamCropping(MapGenerator* pGenerator, XnCropping* pCropping);
 void setPlaybackSpeed(int ratioDiff);
+void toggleDecodeAhead(int);
 XnDouble getPlaybackSpeed();
 Device* getDevice();
 DepthGenerator* getDepthGenerator();
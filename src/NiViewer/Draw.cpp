@@ -33,29 +33,18 @@
 	#include <GL/gl.h>
 	#include <GL/glut.h>
 #endif
+#if (XN_PLATFORM == XN_PLATFORM_LINUX_X86 || XN_PLATFORM == XN_PLATFORM_LINUX_ARM)
+	#include <GL/glx.h>
+#endif
 #include "Statistics.h"
 #include "MouseInput.h"
-
-#if (XN_PLATFORM == XN_PLATFORM_WIN32)
-	#ifdef __INTEL_COMPILER
-		#include <ia32intrin.h>
-	#else
-		#include <intrin.h>
-	#endif
-#endif
+#include "DebugDraw.h"
+#include "../KinectDevice/YUV422Converter.h"
 
 // --------------------------------
 // Defines
 // --------------------------------
-#define YUV422_U  0
-#define YUV422_Y1 1
-#define YUV422_V  2
-#define YUV422_Y2 3
 #define YUV422_BPP 4
-#define YUV_RED   0
-#define YUV_GREEN 1
-#define YUV_BLUE  2
-#define YUV_ALPHA  3
 #define YUV_RGBA_BPP 4
 
 // --------------------------------
@@ -88,8 +77,27 @@ typedef struct XnTextureMap
 	GLenum nFormat;
 	bool bInitialized;
 	IntPair CurSize;
+	bool bMipmaps;
+	// rows written since the last upload, [nDirtyBegin, nDirtyEnd)
+	int nDirtyBegin;
+	int nDirtyEnd;
+	// uploads alternate between the two buffers, so filling one never waits for the transfer of the other
+	GLuint anPBO[2];
+	int nNextPBO;
 } XnTextureMap;
 
+// pixel buffer objects (GL_ARB_pixel_buffer_object), loaded at run time
+typedef struct
+{
+	bool bLoaded;
+	bool bSupported;
+	PFNGLGENBUFFERSARBPROC glGenBuffers;
+	PFNGLBINDBUFFERARBPROC glBindBuffer;
+	PFNGLBUFFERDATAARBPROC glBufferData;
+	PFNGLMAPBUFFERARBPROC glMapBuffer;
+	PFNGLUNMAPBUFFERARBPROC glUnmapBuffer;
+} XnPixelBufferFunctions;
+
 // --------------------------------
 // Global Variables
 // --------------------------------
@@ -138,6 +146,7 @@ DrawConfigPreset g_Presets[PRESET_COUNT] =
 XnTextureMap g_texDepth = {0};
 XnTextureMap g_texImage = {0};
 XnTextureMap g_texBackground = {0};
+XnPixelBufferFunctions g_PBO = {0};
 
 /* A user message to be displayed. */
 char g_csUserMessage[256];
@@ -159,7 +168,45 @@ int GetPowerOfTwo(int num)
 	return result;
 }
 
-void TextureMapInit(XnTextureMap* pTex, int nSizeX, int nSizeY, unsigned int nBytesPerPixel, int nCurX, int nCurY)
+void* GetGLProcAddress(const char* csName)
+{
+#if (XN_PLATFORM == XN_PLATFORM_WIN32)
+	return (void*)wglGetProcAddress(csName);
+#elif (XN_PLATFORM == XN_PLATFORM_LINUX_X86 || XN_PLATFORM == XN_PLATFORM_LINUX_ARM)
+	return (void*)glXGetProcAddressARB((const GLubyte*)csName);
+#else
+	return NULL;
+#endif
+}
+
+void LoadPixelBufferFunctions()
+{
+	if (g_PBO.bLoaded)
+		return;
+
+	g_PBO.bLoaded = true;
+
+	const char* csExtensions = (const char*)glGetString(GL_EXTENSIONS);
+	if (csExtensions == NULL || strstr(csExtensions, "GL_ARB_pixel_buffer_object") == NULL)
+		return;
+
+	g_PBO.glGenBuffers = (PFNGLGENBUFFERSARBPROC)GetGLProcAddress("glGenBuffersARB");
+	g_PBO.glBindBuffer = (PFNGLBINDBUFFERARBPROC)GetGLProcAddress("glBindBufferARB");
+	g_PBO.glBufferData = (PFNGLBUFFERDATAARBPROC)GetGLProcAddress("glBufferDataARB");
+	g_PBO.glMapBuffer = (PFNGLMAPBUFFERARBPROC)GetGLProcAddress("glMapBufferARB");
+	g_PBO.glUnmapBuffer = (PFNGLUNMAPBUFFERARBPROC)GetGLProcAddress("glUnmapBufferARB");
+
+	g_PBO.bSupported = (g_PBO.glGenBuffers != NULL && g_PBO.glBindBuffer != NULL && g_PBO.glBufferData != NULL &&
+		g_PBO.glMapBuffer != NULL && g_PBO.glUnmapBuffer != NULL);
+}
+
+void TextureMapSetDirty(XnTextureMap* pTex)
+{
+	pTex->nDirtyBegin = 0;
+	pTex->nDirtyEnd = pTex->OrigSize.Y;
+}
+
+void TextureMapInit(XnTextureMap* pTex, int nSizeX, int nSizeY, unsigned int nBytesPerPixel, int nCurX, int nCurY, bool bMipmaps = false)
 {
 	// check if something changed
 	if (pTex->bInitialized && pTex->OrigSize.X == nSizeX && pTex->OrigSize.Y == nSizeY)
@@ -168,12 +215,13 @@ void TextureMapInit(XnTextureMap* pTex, int nSizeX, int nSizeY, unsigned int nBy
 		{
 			// clear map
 			xnOSMemSet(pTex->pMap, 0, pTex->Size.X * pTex->Size.Y * pTex->nBytesPerPixel);
+			TextureMapSetDirty(pTex);
 
 			// update
 			pTex->CurSize.X = nCurX;
 			pTex->CurSize.Y = nCurY;
-			return;
 		}
+		return;
 	}
 
 	// free memory if it was allocated
@@ -196,26 +244,52 @@ void TextureMapInit(XnTextureMap* pTex, int nSizeX, int nSizeY, unsigned int nBy
 		glGenTextures(1, &pTex->nID);
 		glBindTexture(GL_TEXTURE_2D, pTex->nID);
 
-		switch (pTex->nBytesPerPixel)
+		// mipmaps are rebuilt on every upload, only textures drawn minified need them
+		pTex->bMipmaps = bMipmaps;
+		if (pTex->bMipmaps)
 		{
-		case 3:
-			pTex->nFormat = GL_RGB;
-			break;
-		case 4:
-			pTex->nFormat = GL_RGBA;
-			break;
+			glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+		else
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		}
-
-		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+		LoadPixelBufferFunctions();
+		if (g_PBO.bSupported)
+		{
+			g_PBO.glGenBuffers(2, pTex->anPBO);
+		}
+
 		pTex->bInitialized = TRUE;
 	}
+
+	switch (pTex->nBytesPerPixel)
+	{
+	case 3:
+		pTex->nFormat = GL_RGB;
+		break;
+	case 4:
+		pTex->nFormat = GL_RGBA;
+		break;
+	}
+
+	// allocate the texture once, frames only replace its used part
+	glBindTexture(GL_TEXTURE_2D, pTex->nID);
+	glTexImage2D(GL_TEXTURE_2D, 0, pTex->nFormat, pTex->Size.X, pTex->Size.Y, 0, pTex->nFormat, GL_UNSIGNED_BYTE, pTex->pMap);
+	pTex->nDirtyBegin = pTex->nDirtyEnd = 0;
 }
 
+// the line is assumed to be written, and is uploaded by the next TextureMapUpdate
 inline unsigned char* TextureMapGetLine(XnTextureMap* pTex, unsigned int nLine)
 {
+	if ((int)nLine < pTex->nDirtyBegin || pTex->nDirtyBegin == pTex->nDirtyEnd)
+		pTex->nDirtyBegin = nLine;
+	if ((int)nLine >= pTex->nDirtyEnd)
+		pTex->nDirtyEnd = nLine + 1;
+
 	return &pTex->pMap[nLine * pTex->Size.X * pTex->nBytesPerPixel];
 }
 
@@ -235,37 +309,92 @@ void TextureMapSetPixel(XnTextureMap* pTex, int x, int y, int red, int green, in
 
 void TextureMapDrawCursor(XnTextureMap* pTex, IntPair cursor)
 {
-	// marked pixel
-	TextureMapSetPixel(pTex, cursor.X, cursor.Y, 255, 0, 0);
-
-	// top left marker
-	TextureMapSetPixel(pTex, cursor.X-2, cursor.Y-2, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X-2, cursor.Y-1, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X-1, cursor.Y-2, 255, 0, 0);
-
-	// top right marker
-	TextureMapSetPixel(pTex, cursor.X+2, cursor.Y-2, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X+2, cursor.Y-1, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X+1, cursor.Y-2, 255, 0, 0);
-
-	// bottom left marker
-	TextureMapSetPixel(pTex, cursor.X-2, cursor.Y+2, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X-2, cursor.Y+1, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X-1, cursor.Y+2, 255, 0, 0);
-
-	// bottom right marker
-	TextureMapSetPixel(pTex, cursor.X+2, cursor.Y+2, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X+2, cursor.Y+1, 255, 0, 0);
-	TextureMapSetPixel(pTex, cursor.X+1, cursor.Y+2, 255, 0, 0);
+	// the marked pixel, then the top left, top right, bottom left and bottom right markers
+	static const int aMarker[13][2] = 
+	{
+		{ 0, 0 },
+		{ -2, -2 }, { -2, -1 }, { -1, -2 },
+		{ 2, -2 }, { 2, -1 }, { 1, -2 },
+		{ -2, 2 }, { -2, 1 }, { -1, 2 },
+		{ 2, 2 }, { 2, 1 }, { 1, 2 },
+	};
+
+	// only a cursor by the edge of the map needs every pixel checked
+	if (cursor.X < 2 || cursor.Y < 2 || cursor.X + 2 >= (int)pTex->OrigSize.X || cursor.Y + 2 >= (int)pTex->OrigSize.Y)
+	{
+		for (int i = 0; i < 13; ++i)
+			TextureMapSetPixel(pTex, cursor.X + aMarker[i][0], cursor.Y + aMarker[i][1], 255, 0, 0);
+		return;
+	}
+
+	unsigned char* apLines[5];
+	for (int nY = 0; nY < 5; ++nY)
+		apLines[nY] = TextureMapGetLine(pTex, cursor.Y - 2 + nY) + cursor.X * pTex->nBytesPerPixel;
+
+	for (int i = 0; i < 13; ++i)
+	{
+		unsigned char* pPixel = apLines[aMarker[i][1] + 2] + aMarker[i][0] * (int)pTex->nBytesPerPixel;
+		pPixel[0] = 255;
+		pPixel[1] = 0;
+		pPixel[2] = 0;
+
+		if (pTex->nBytesPerPixel > 3)
+			pPixel[3] = 255;
+	}
 }
 
 void TextureMapUpdate(XnTextureMap* pTex)
 {
+	// the power of two padding is never drawn, only the written rows of the original size are uploaded
+	int nBegin = pTex->nDirtyBegin;
+	int nEnd = XN_MIN(pTex->nDirtyEnd, pTex->OrigSize.Y);
+	pTex->nDirtyBegin = pTex->nDirtyEnd = 0;
+	if (nBegin >= nEnd)
+		return;
+
 	// set current texture object
 	glBindTexture(GL_TEXTURE_2D, pTex->nID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	// set the current image to the texture
-	glTexImage2D(GL_TEXTURE_2D, 0, pTex->nFormat, pTex->Size.X, pTex->Size.Y, 0, pTex->nFormat, GL_UNSIGNED_BYTE, pTex->pMap);
+	const unsigned char* pFirstLine = &pTex->pMap[nBegin * pTex->Size.X * pTex->nBytesPerPixel];
+	unsigned int nRowSize = pTex->OrigSize.X * pTex->nBytesPerPixel;
+	int nRows = nEnd - nBegin;
+
+	unsigned char* pBuffer = NULL;
+	if (g_PBO.bSupported)
+	{
+		g_PBO.glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, pTex->anPBO[pTex->nNextPBO]);
+		pTex->nNextPBO = 1 - pTex->nNextPBO;
+
+		// orphan the previous contents, the driver may still be reading them
+		g_PBO.glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, nRowSize * nRows, NULL, GL_STREAM_DRAW_ARB);
+		pBuffer = (unsigned char*)g_PBO.glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		if (pBuffer == NULL)
+		{
+			g_PBO.glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+		}
+	}
+
+	if (pBuffer != NULL)
+	{
+		for (int nY = 0; nY < nRows; ++nY)
+		{
+			xnOSMemCopy(pBuffer + nY * nRowSize, pFirstLine + nY * pTex->Size.X * pTex->nBytesPerPixel, nRowSize);
+		}
+		g_PBO.glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
+
+		// the source is an offset in the bound buffer, the copy to the texture is asynchronous
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, nBegin, pTex->OrigSize.X, nRows, pTex->nFormat, GL_UNSIGNED_BYTE, NULL);
+		g_PBO.glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+	}
+	else
+	{
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, pTex->Size.X);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, nBegin, pTex->OrigSize.X, nRows, pTex->nFormat, GL_UNSIGNED_BYTE, pFirstLine);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
 void TextureMapDraw(XnTextureMap* pTex, IntRect* pLocation)
@@ -279,26 +408,29 @@ void TextureMapDraw(XnTextureMap* pTex, IntRect* pLocation)
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// set drawing mode to rectangles
-	glBegin(GL_QUADS);
+	float fTexRight = (float)pTex->OrigSize.X/(float)pTex->Size.X;
+	float fTexBottom = (float)pTex->OrigSize.Y/(float)pTex->Size.Y;
+
+	// upper left, upper right, bottom right, bottom left
+	const GLfloat aTexCoords[8] = { 0, 0, fTexRight, 0, fTexRight, fTexBottom, 0, fTexBottom };
+	const GLfloat aVertices[8] = 
+	{
+		(GLfloat)pLocation->uLeft, (GLfloat)pLocation->uBottom,
+		(GLfloat)pLocation->uRight, (GLfloat)pLocation->uBottom,
+		(GLfloat)pLocation->uRight, (GLfloat)pLocation->uTop,
+		(GLfloat)pLocation->uLeft, (GLfloat)pLocation->uTop,
+	};
 
 	// set the color of the polygon
 	glColor4f(1, 1, 1, 1);
 
-	// upper left
-	glTexCoord2f(0, 0);
-	glVertex2f(pLocation->uLeft, pLocation->uBottom);
-	// upper right
-	glTexCoord2f((float)pTex->OrigSize.X/(float)pTex->Size.X, 0);
-	glVertex2f(pLocation->uRight, pLocation->uBottom);
-	// bottom right
-	glTexCoord2f((float)pTex->OrigSize.X/(float)pTex->Size.X, (float)pTex->OrigSize.Y/(float)pTex->Size.Y);
-	glVertex2f(pLocation->uRight, pLocation->uTop);
-	// bottom left
-	glTexCoord2f(0, (float)pTex->OrigSize.Y/(float)pTex->Size.Y);
-	glVertex2f(pLocation->uLeft, pLocation->uTop);
-
-	glEnd();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, aVertices);
+	glTexCoordPointer(2, GL_FLOAT, 0, aTexCoords);
+	glDrawArrays(GL_QUADS, 0, 4);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 
 	// turn off texture mapping
 	glDisable(GL_TEXTURE_2D);
@@ -351,16 +483,6 @@ void CreateRainbowPallet()
 	}
 }
 
-void glPrintString(void *font, const char *str)
-{
-	int i,l = (int)strlen(str);
-
-	for(i=0; i<l; i++)
-	{
-		glutBitmapCharacter(font,*str++);
-	}
-}
-
 void drawConfigChanged()
 {
 	// recalculate registration
@@ -519,10 +641,12 @@ void drawInit()
 
 	setPreset(7);
 
-	TextureMapInit(&g_texBackground, 1024, 1024, 3, 1024, 1024);
+	// drawn scaled down to the window, the only texture that needs mipmaps
+	TextureMapInit(&g_texBackground, 1024, 1024, 3, 1024, 1024, true);
 
 	// load background image
 	xnOSLoadFile("..\\..\\..\\Data\\RGBViewer\\back.raw", TextureMapGetLine(&g_texBackground, 0), 1024*1024*3);
+	TextureMapSetDirty(&g_texBackground);
 
 	TextureMapUpdate(&g_texBackground);
 
@@ -598,156 +722,14 @@ void calculateHistogram()
 // --------------------------------
 // Drawing
 // --------------------------------
-#if (XN_PLATFORM == XN_PLATFORM_WIN32)
 
+// the converter has an SSE2 path and a scalar one for the other platforms, both give the same colors
 void YUV422ToRGB888(const XnUInt8* pYUVImage, XnUInt8* pRGBAImage, XnUInt32 nYUVSize, XnUInt32 nRGBSize)
 {
-	const XnUInt8* pYUVLast = pYUVImage + nYUVSize - 8;
-	XnUInt8* pRGBLast = pRGBAImage + nRGBSize - 16;
-
-	const __m128 minus128 = _mm_set_ps1(-128);
-	const __m128 plus113983 = _mm_set_ps1(1.13983F);
-	const __m128 minus039466 = _mm_set_ps1(-0.39466F);
-	const __m128 minus058060 = _mm_set_ps1(-0.58060F);
-	const __m128 plus203211 = _mm_set_ps1(2.03211F);
-	const __m128 zero = _mm_set_ps1(0);
-	const __m128 plus255 = _mm_set_ps1(255);
-
-	// define YUV floats
-	__m128 y;
-	__m128 u;
-	__m128 v;
-
-	__m128 temp;
-
-	// define RGB floats
-	__m128 r;
-	__m128 g;
-	__m128 b;
-
-	// define RGB integers
-	__m128i iR;
-	__m128i iG;
-	__m128i iB;
-
-	XnUInt32* piR = (XnUInt32*)&iR;
-	XnUInt32* piG = (XnUInt32*)&iG;
-	XnUInt32* piB = (XnUInt32*)&iB;
-
-	while (pYUVImage <= pYUVLast && pRGBAImage <= pRGBLast)
-	{
-		// process 4 pixels at once (values should be ordered backwards)
-		y = _mm_set_ps(pYUVImage[YUV422_Y2 + YUV422_BPP], pYUVImage[YUV422_Y1 + YUV422_BPP], pYUVImage[YUV422_Y2], pYUVImage[YUV422_Y1]);
-		u = _mm_set_ps(pYUVImage[YUV422_U + YUV422_BPP],  pYUVImage[YUV422_U + YUV422_BPP],  pYUVImage[YUV422_U],  pYUVImage[YUV422_U]);
-		v = _mm_set_ps(pYUVImage[YUV422_V + YUV422_BPP],  pYUVImage[YUV422_V + YUV422_BPP],  pYUVImage[YUV422_V],  pYUVImage[YUV422_V]);
-
-		u = _mm_add_ps(u, minus128); // u -= 128
-		v = _mm_add_ps(v, minus128); // v -= 128
-
-		/*
-
-		http://en.wikipedia.org/wiki/YUV
-
-		From YUV to RGB:
-		R =     Y + 1.13983 V
-		G =     Y - 0.39466 U - 0.58060 V
-		B =     Y + 2.03211 U
-
-		*/ 
-
-		temp = _mm_mul_ps(plus113983, v);
-		r = _mm_add_ps(y, temp);
-
-		temp = _mm_mul_ps(minus039466, u);
-		g = _mm_add_ps(y, temp);
-		temp = _mm_mul_ps(minus058060, v);
-		g = _mm_add_ps(g, temp);
-
-		temp = _mm_mul_ps(plus203211, u);
-		b = _mm_add_ps(y, temp);
-
-		// make sure no value is smaller than 0
-		r = _mm_max_ps(r, zero);
-		g = _mm_max_ps(g, zero);
-		b = _mm_max_ps(b, zero);
-
-		// make sure no value is bigger than 255
-		r = _mm_min_ps(r, plus255);
-		g = _mm_min_ps(g, plus255);
-		b = _mm_min_ps(b, plus255);
-
-		// convert floats to int16 (there is no conversion to uint8, just to int8).
-		iR = _mm_cvtps_epi32(r);
-		iG = _mm_cvtps_epi32(g);
-		iB = _mm_cvtps_epi32(b);
-
-		// extract the 4 pixels RGB values.
-		// because we made sure values are between 0 and 255, we can just take the lower byte
-		// of each INT16
-		pRGBAImage[0] = piR[0];
-		pRGBAImage[1] = piG[0];
-		pRGBAImage[2] = piB[0];
-		pRGBAImage[3] = 255;
-
-		pRGBAImage[4] = piR[1];
-		pRGBAImage[5] = piG[1];
-		pRGBAImage[6] = piB[1];
-		pRGBAImage[7] = 255;
-
-		pRGBAImage[8] = piR[2];
-		pRGBAImage[9] = piG[2];
-		pRGBAImage[10] = piB[2];
-		pRGBAImage[11] = 255;
-
-		pRGBAImage[12] = piR[3];
-		pRGBAImage[13] = piG[3];
-		pRGBAImage[14] = piB[3];
-		pRGBAImage[15] = 255;
-
-		// advance the streams
-		pYUVImage += 8;
-		pRGBAImage += 16;
-	}
-}
-
-#else // not Win32
-
-void YUV444ToRGBA(XnUInt8 cY, XnUInt8 cU, XnUInt8 cV,
-					XnUInt8& cR, XnUInt8& cG, XnUInt8& cB, XnUInt8& cA)
-{
-	XnInt32 nC = cY - 16;
-	XnInt16 nD = cU - 128;
-	XnInt16 nE = cV - 128;
-
-	nC = nC * 298 + 128;
-
-	cR = XN_MIN(XN_MAX((nC            + 409 * nE) >> 8, 0), 255);
-	cG = XN_MIN(XN_MAX((nC - 100 * nD - 208 * nE) >> 8, 0), 255);
-	cB = XN_MIN(XN_MAX((nC + 516 * nD           ) >> 8, 0), 255);
-	cA = 255;
-}
-
-void YUV422ToRGB888(const XnUInt8* pYUVImage, XnUInt8* pRGBImage, XnUInt32 nYUVSize, XnUInt32 nRGBSize)
-{
-	const XnUInt8* pCurrYUV = pYUVImage;
-	XnUInt8* pCurrRGB = pRGBImage;
-	const XnUInt8* pLastYUV = pYUVImage + nYUVSize - YUV422_BPP;
-	XnUInt8* pLastRGB = pRGBImage + nRGBSize - YUV_RGBA_BPP;
-
-	while (pCurrYUV <= pLastYUV && pCurrRGB <= pLastRGB)
-	{
-		YUV444ToRGBA(pCurrYUV[YUV422_Y1], pCurrYUV[YUV422_U], pCurrYUV[YUV422_V],
-						pCurrRGB[YUV_RED], pCurrRGB[YUV_GREEN], pCurrRGB[YUV_BLUE], pCurrRGB[YUV_ALPHA]);
-		pCurrRGB += YUV_RGBA_BPP;
-		YUV444ToRGBA(pCurrYUV[YUV422_Y2], pCurrYUV[YUV422_U], pCurrYUV[YUV422_V],
-						pCurrRGB[YUV_RED], pCurrRGB[YUV_GREEN], pCurrRGB[YUV_BLUE], pCurrRGB[YUV_ALPHA]);
-		pCurrRGB += YUV_RGBA_BPP;
-		pCurrYUV += YUV422_BPP;
-	}
+	XnUInt32 nPixels = XN_MIN(nYUVSize / YUV422_BPP, nRGBSize / (2*YUV_RGBA_BPP)) * 2;
+	Kinect::YUV422Converter::ConvertRow(pYUVImage, pRGBAImage, nPixels, Kinect::YUV422_UYVY, Kinect::RGB_LAYOUT_RGBA);
 }
 
-#endif
-
 void drawClosedStream(IntRect* pLocation, const char* csStreamName)
 {
 	char csMessage[512];
@@ -758,9 +740,7 @@ void drawClosedStream(IntRect* pLocation, const char* csStreamName)
 	int nXLocation = (pLocation->uRight + pLocation->uLeft - nWidth) / 2;
 	int nYLocation = (pLocation->uTop + pLocation->uBottom) / 2;
 
-	glColor3f(1.0, 0, 0);
-	glRasterPos2i(nXLocation, nYLocation);
-	glPrintString(pFont, csMessage);
+	debugDrawText(pFont, nXLocation, nYLocation, makeColor(1, 0, 0), csMessage);
 }
 
 void drawColorImage(IntRect* pLocation, IntPair* pPointer)
@@ -896,14 +876,12 @@ void drawDepth(IntRect* pLocation, IntPair* pPointer)
 
 		if (g_DrawConfig.Streams.Depth.Coloring == STANDARD_DEVIATION)
 		{
-			XnPixelStatistics* pStatistics = g_PixelStatistics;
-
 			for (XnUInt16 nY = pDepthMD->YOffset(); nY < pDepthMD->YRes() + pDepthMD->YOffset(); nY++)
 			{
 				XnUInt8* pTexture = TextureMapGetLine(&g_texDepth, nY) + pDepthMD->XOffset()*4;
-				for (XnUInt16 nX = 0; nX < pDepthMD->XRes(); nX++, pTexture+=4, pStatistics++)
+				for (XnUInt16 nX = pDepthMD->XOffset(); nX < pDepthMD->XRes() + pDepthMD->XOffset(); nX++, pTexture+=4)
 				{
-					pTexture[0] = pTexture[1] = XN_MIN((int)pStatistics->dStdDev, 255);
+					pTexture[0] = pTexture[1] = XN_MIN((int)statisticsGetStdDev(nX, nY), 255);
 					pTexture[2] = 0;
 					pTexture[3] = g_DrawConfig.Streams.Depth.fTransparency*255;
 				}
@@ -1031,34 +1009,18 @@ void drawPointerMode(IntPair* pPointer)
 	if (pDepthMD != NULL)
 	{
 		// Print the scale black background
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		glBegin(GL_QUADS);
-		glColor4f(0, 0, 0, 0.7);
-		glVertex2i(0, WIN_SIZE_Y); // lower left
-		glVertex2i(WIN_SIZE_X, WIN_SIZE_Y);
-		glVertex2i(WIN_SIZE_X, WIN_SIZE_Y - 135);
-		glVertex2i(0, WIN_SIZE_Y - 135);
-		glEnd();
-
-		glDisable(GL_BLEND);
-
-		// set a large point size (for the scale)
-		glPointSize(15);
+		debugDrawRect(0, WIN_SIZE_Y - 135, WIN_SIZE_X, WIN_SIZE_Y, makeColor(0, 0, 0, 0.7f));
 
-		// Print the scale data
-		glBegin(GL_POINTS);
+		// Print the scale data, as 15 pixel squares
 		for (int i = 0; i < pDepthMD->ZRes(); i+=1)
 		{
 			float fNewColor = g_pDepthHist[i];
 			if ((fNewColor > 0.004) && (fNewColor < 0.996))
 			{
-				glColor3f(fNewColor, fNewColor, 0);
-				glVertex3f(((i/10)*2), WIN_SIZE_Y - 23, 1);
+				float fX = (float)((i/10)*2);
+				debugDrawRect(fX - 7.5f, WIN_SIZE_Y - 23 - 7.5f, fX + 7.5f, WIN_SIZE_Y - 23 + 7.5f, makeColor(fNewColor, fNewColor, 0));
 			}
 		}
-		glEnd();
 
 		// Print the pointer scale data
 		if (pPointer != NULL)
@@ -1072,10 +1034,8 @@ void drawPointerMode(IntPair* pPointer)
 			{
 				nPointerValue = (*pDepthMD)(pointerInDepth.X, pointerInDepth.Y);
 
-				glBegin(GL_POINTS);
-				glColor3f(1,0,0);
-				glVertex3f(10 + ((nPointerValue/10)*2), WIN_SIZE_Y - 70, 1);
-				glEnd();
+				float fX = (float)(10 + ((nPointerValue/10)*2));
+				debugDrawRect(fX - 7.5f, WIN_SIZE_Y - 70 - 7.5f, fX + 7.5f, WIN_SIZE_Y - 70 + 7.5f, makeColor(1, 0, 0));
 			}
 		}
 
@@ -1085,17 +1045,11 @@ void drawPointerMode(IntPair* pPointer)
 			int xPos = i*2 + 10;
 
 			// draw a small line in this position
-			glBegin(GL_LINES);
-			glColor3f(0, 1, 0);
-			glVertex2i(xPos, WIN_SIZE_Y - 54);
-			glVertex2i(xPos, WIN_SIZE_Y - 62);
-			glEnd();
+			debugDrawLine(xPos, WIN_SIZE_Y - 54, xPos, WIN_SIZE_Y - 62, makeColor(0, 1, 0));
 
 			// place a label under, and in the middle of, that line.
 			int chars = sprintf(buf, "%d", i);
-			glColor3f(1,0,0);
-			glRasterPos2i(xPos - chars*nCharWidth/2, WIN_SIZE_Y - 40);
-			glPrintString(GLUT_BITMAP_HELVETICA_18,buf);
+			debugDrawText(GLUT_BITMAP_HELVETICA_18, xPos - chars*nCharWidth/2, WIN_SIZE_Y - 40, makeColor(1, 0, 0), buf);
 		}
 
 		sprintf(buf, "%s - Frame %4u, Timestamp %.3f", getDepthGenerator()->GetInfo().GetInstanceName(), pDepthMD->FrameID(), (double)pDepthMD->Timestamp()/dTimestampDivider);
@@ -1129,18 +1083,16 @@ void drawPointerMode(IntPair* pPointer)
 	}
 
 	int nYLocation = WIN_SIZE_Y - 88;
-	glColor3f(1,0,0);
-	glRasterPos2i(10,nYLocation);
-	glPrintString(GLUT_BITMAP_HELVETICA_18, buf);
+	debugDrawText(GLUT_BITMAP_HELVETICA_18, 10, nYLocation, makeColor(1, 0, 0), buf);
 	nYLocation -= 26;
 
 	if (pPointer != NULL && isStatisticsActive())
 	{
-		XnPixelStatistics* pStatistics = &g_PixelStatistics[pPointer->Y * pDepthMD->XRes() + pPointer->X];
+		XnPixelStatistics statistics;
+		statisticsGetPixel(pPointer->X, pPointer->Y, &statistics);
 		sprintf(buf, "Collected: %3u, Min: %4u Max: %4u Avg: %6.2f StdDev: %6.2f", 
-			pStatistics->nCount, pStatistics->nMin, pStatistics->nMax, pStatistics->dAverage, pStatistics->dStdDev);
-		glRasterPos2i(10,nYLocation);
-		glPrintString(GLUT_BITMAP_HELVETICA_18, buf);
+			statistics.nCount, statistics.nMin, statistics.nMax, statistics.dAverage, statistics.dStdDev);
+		debugDrawText(GLUT_BITMAP_HELVETICA_18, 10, nYLocation, makeColor(1, 0, 0), buf);
 		nYLocation -= 26;
 	}
 
@@ -1163,8 +1115,7 @@ void drawPointerMode(IntPair* pPointer)
 		sprintf(buf, "Pointer Value: %s (X:%d Y:%d) Cutoff: %llu-%llu.", 
 			sPointerValue, pPointer->X, pPointer->Y, nCutOffMin, nCutOffMax);
 
-		glRasterPos2i(10,nYLocation);
-		glPrintString(GLUT_BITMAP_HELVETICA_18, buf);
+		debugDrawText(GLUT_BITMAP_HELVETICA_18, 10, nYLocation, makeColor(1, 0, 0), buf);
 		nYLocation -= 26;
 	}
 }
@@ -1220,25 +1171,12 @@ void drawCenteredMessage(void* font, int y, const char* message, float fRed, flo
 	int nYLocation = y;
 
 	// Draw black background
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glBegin(GL_QUADS);
-	glColor4f(0, 0, 0, 0.6);
-	glVertex2i(nXLocation - 5, nYLocation - nHeight - 5);
-	glVertex2i(nXLocation + nMaxLineLength + 5, nYLocation - nHeight - 5);
-	glVertex2i(nXLocation + nMaxLineLength + 5, nYLocation + nHeight * nLine + 5);
-	glVertex2i(nXLocation - 5, nYLocation + nHeight * nLine + 5);
-	glEnd();
-
-	glDisable(GL_BLEND);
+	debugDrawRect(nXLocation - 5, nYLocation - (int)nHeight - 5, nXLocation + nMaxLineLength + 5, nYLocation + nHeight * nLine + 5, makeColor(0, 0, 0, 0.6f));
 
 	// show message
-	glColor3f(fRed, fGreen, fBlue);
 	for (XnUInt32 i = 0; i < nLine; ++i)
 	{
-		glRasterPos2i(nXLocation + (nMaxLineLength - anLinesWidths[i])/2, nYLocation + i * nHeight);
-		glPrintString(font, aLines[i]);
+		debugDrawText(font, nXLocation + (nMaxLineLength - anLinesWidths[i])/2, nYLocation + i * nHeight, makeColor(fRed, fGreen, fBlue), aLines[i]);
 	}
 }
 
@@ -1262,7 +1200,7 @@ void drawUserMessage()
 
 void printRecordingInfo()
 {
-	char csMessage[256];
+	char csMessage[512];
 	getCaptureMessage(csMessage);
 
 	if (csMessage[0] != 0)
@@ -1296,9 +1234,7 @@ void printHelpGroup(int nXLocation, int* pnYLocation, const char* csGroup)
 
 	getGroupItems(csGroup, aKeys, aDescs, &nCount);
 
-	glColor3f(0, 1, 0);
-	glRasterPos2i(nXLocation, nYLocation);
-	glPrintString(GLUT_BITMAP_TIMES_ROMAN_24, csGroup);
+	debugDrawText(GLUT_BITMAP_TIMES_ROMAN_24, nXLocation, nYLocation, makeColor(0, 1, 0), csGroup);
 	nYLocation += 30;
 
 	for (int i = 0; i < nCount; ++i, nYLocation += 22)
@@ -1314,12 +1250,8 @@ void printHelpGroup(int nXLocation, int* pnYLocation, const char* csGroup)
 			break;
 		}
 
-		glColor3f(1, 0, 0);
-		glRasterPos2i(nXLocation, nYLocation);
-		glPrintString(GLUT_BITMAP_HELVETICA_18, buf);
-
-		glRasterPos2i(nXLocation + 40, nYLocation);
-		glPrintString(GLUT_BITMAP_HELVETICA_18, aDescs[i]);
+		debugDrawText(GLUT_BITMAP_HELVETICA_18, nXLocation, nYLocation, makeColor(1, 0, 0), buf);
+		debugDrawText(GLUT_BITMAP_HELVETICA_18, nXLocation + 40, nYLocation, makeColor(1, 0, 0), aDescs[i]);
 	}
 
 	*pnYLocation = nYLocation + 20;
@@ -1330,17 +1262,9 @@ void drawErrorState()
 	if (g_DrawConfig.strErrorState == NULL)
 		return;
 
-	// place a black rect on entire screen
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);		
-	glBegin(GL_QUADS);
-	glColor4f(0, 0, 0, 0.8);
-	glVertex2i(0, 0);
-	glVertex2i(WIN_SIZE_X, 0);
-	glVertex2i(WIN_SIZE_X, WIN_SIZE_Y);
-	glVertex2i(0, WIN_SIZE_Y);
-	glEnd();
-	glDisable(GL_BLEND);
+	// everything so far goes under the black rect placed on entire screen
+	debugDrawFlush();
+	debugDrawRect(0, 0, WIN_SIZE_X, WIN_SIZE_Y, makeColor(0, 0, 0, 0.8f));
 
 	int nYLocation = WIN_SIZE_Y/2 - 30;
 
@@ -1356,21 +1280,9 @@ void drawHelpScreen()
 	int nXEndLocation = WIN_SIZE_X*7/8;
 	int nYEndLocation = WIN_SIZE_Y*4/5;
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);		
-
-	glBegin(GL_QUADS);
-	glColor4f(0, 0, 0, 0.8);
-	glVertex2i(nXStartLocation, nYStartLocation);
-	glVertex2i(nXStartLocation, nYEndLocation);
-	glVertex2i(nXEndLocation, nYEndLocation);
-	glVertex2i(nXEndLocation, nYStartLocation);
-	glEnd();
-
-	glDisable(GL_BLEND);
-
-	// set color to red
-	glColor3f(1, 0, 0);
+	// everything so far goes under the help
+	debugDrawFlush();
+	debugDrawRect(nXStartLocation, nYStartLocation, nXEndLocation, nYEndLocation, makeColor(0, 0, 0, 0.8f));
 
 	// leave some margins
 	nYStartLocation += 30;
@@ -1397,49 +1309,34 @@ void drawUserInput(bool bCursor)
 	{
 		// draw cursor
 		IntPair cursor = g_DrawUserInput.Cursor;
-		glPointSize(1);
-		glBegin(GL_POINTS);
-		glColor3f(1,0,0);
-		glVertex2i(cursor.X, cursor.Y);
+		KRGBColor red = makeColor(1, 0, 0);
+		debugDrawPoint(cursor.X, cursor.Y, red);
 
 		// upper left marker
-		glVertex2i(cursor.X - 2, cursor.Y - 2);
-		glVertex2i(cursor.X - 2, cursor.Y - 1);
-		glVertex2i(cursor.X - 1, cursor.Y - 2);
+		debugDrawPoint(cursor.X - 2, cursor.Y - 2, red);
+		debugDrawPoint(cursor.X - 2, cursor.Y - 1, red);
+		debugDrawPoint(cursor.X - 1, cursor.Y - 2, red);
 
 		// bottom left marker
-		glVertex2i(cursor.X - 2, cursor.Y + 2);
-		glVertex2i(cursor.X - 2, cursor.Y + 1);
-		glVertex2i(cursor.X - 1, cursor.Y + 2);
+		debugDrawPoint(cursor.X - 2, cursor.Y + 2, red);
+		debugDrawPoint(cursor.X - 2, cursor.Y + 1, red);
+		debugDrawPoint(cursor.X - 1, cursor.Y + 2, red);
 
 		// upper right marker
-		glVertex2i(cursor.X + 2, cursor.Y - 2);
-		glVertex2i(cursor.X + 2, cursor.Y - 1);
-		glVertex2i(cursor.X + 1, cursor.Y - 2);
+		debugDrawPoint(cursor.X + 2, cursor.Y - 2, red);
+		debugDrawPoint(cursor.X + 2, cursor.Y - 1, red);
+		debugDrawPoint(cursor.X + 1, cursor.Y - 2, red);
 
 		// lower right marker
-		glVertex2i(cursor.X + 2, cursor.Y + 2);
-		glVertex2i(cursor.X + 2, cursor.Y + 1);
-		glVertex2i(cursor.X + 1, cursor.Y + 2);
-
-		glEnd();
+		debugDrawPoint(cursor.X + 2, cursor.Y + 2, red);
+		debugDrawPoint(cursor.X + 2, cursor.Y + 1, red);
+		debugDrawPoint(cursor.X + 1, cursor.Y + 2, red);
 	}
 
 	// draw selection frame
 	if (g_DrawUserInput.State == SELECTION_ACTIVE)
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);		
-
-		glBegin(GL_QUADS);
-		glColor4f(1, 0, 0, 0.5);
-		glVertex2i(g_DrawUserInput.Rect.uLeft, g_DrawUserInput.Rect.uTop); // Upper left
-		glVertex2i(g_DrawUserInput.Rect.uRight, g_DrawUserInput.Rect.uTop); // upper right
-		glVertex2i(g_DrawUserInput.Rect.uRight, g_DrawUserInput.Rect.uBottom); // lower right
-		glVertex2i(g_DrawUserInput.Rect.uLeft, g_DrawUserInput.Rect.uBottom); // lower left
-		glEnd();
-
-		glDisable(GL_BLEND);
+		debugDrawRect(g_DrawUserInput.Rect.uLeft, g_DrawUserInput.Rect.uTop, g_DrawUserInput.Rect.uRight, g_DrawUserInput.Rect.uBottom, makeColor(1, 0, 0, 0.5f));
 	}
 }
 
@@ -1480,9 +1377,7 @@ void drawPlaybackSpeed()
 		for (int i = 0; i < len; ++i)
 			width += glutBitmapWidth(GLUT_BITMAP_TIMES_ROMAN_24, strSpeed[i]);
 
-		glColor3f(0, 1, 0);
-		glRasterPos2i(WIN_SIZE_X - width - 3, 30);
-		glPrintString(GLUT_BITMAP_TIMES_ROMAN_24, strSpeed);
+		debugDrawText(GLUT_BITMAP_TIMES_ROMAN_24, WIN_SIZE_X - width - 3, 30, makeColor(0, 1, 0), strSpeed);
 	}
 }
 
@@ -1585,6 +1480,8 @@ void drawFrame()
 	if (g_DrawConfig.bHelp)
 		drawHelpScreen();
 
+	debugDrawFlush();
+
 	glutSwapBuffers();
 }
 
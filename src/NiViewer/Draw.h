@@ -110,4 +110,10 @@ void setDepthDrawing(int nColoring);
 void setImageDrawing(int nColoring);
 void setErrorState(const char* strMessage);
 
+// --------------------------------
+// OpenGL helpers
+// --------------------------------
+// address of an extension function, NULL when it cannot be looked up on this platform
+void* GetGLProcAddress(const char* csName);
+
 #endif //__DRAW_H__
@@ -0,0 +1,136 @@
+// --------------------------------
+// Includes
+// --------------------------------
+#include "FrameIndex.h"
+#include <math.h>
+#include <vector>
+#include <string>
+
+// --------------------------------
+// Types
+// --------------------------------
+typedef struct
+{
+	XnUInt32 nFrame;
+	XnUInt64 nTimestamp;
+} XnFrameIndexEntry;
+
+// the entries of a node are sorted by frame, and so by timestamp
+typedef struct
+{
+	std::string strName;
+	std::vector<XnFrameIndexEntry> entries;
+} FrameIndexNodeData;
+
+// --------------------------------
+// Global Variables
+// --------------------------------
+std::vector<FrameIndexNodeData> g_FrameIndexNodes;
+
+// --------------------------------
+// Code
+// --------------------------------
+static FrameIndexNodeData* frameIndexFindNode(const XnChar* strNodeName)
+{
+	for (XnUInt32 i = 0; i < g_FrameIndexNodes.size(); ++i)
+	{
+		if (g_FrameIndexNodes[i].strName == strNodeName)
+			return &g_FrameIndexNodes[i];
+	}
+	return NULL;
+}
+
+// first entry of a frame at or after nFrame
+static XnUInt32 frameIndexLowerBound(const std::vector<XnFrameIndexEntry>& entries, XnUInt32 nFrame)
+{
+	XnUInt32 nLow = 0;
+	XnUInt32 nHigh = (XnUInt32)entries.size();
+	while (nLow < nHigh)
+	{
+		XnUInt32 nMiddle = (nLow + nHigh) / 2;
+		if (entries[nMiddle].nFrame < nFrame)
+			nLow = nMiddle + 1;
+		else
+			nHigh = nMiddle;
+	}
+	return nLow;
+}
+
+void frameIndexClear()
+{
+	g_FrameIndexNodes.clear();
+}
+
+void frameIndexAddFrame(const XnChar* strNodeName, XnUInt32 nFrame, XnUInt64 nTimestamp)
+{
+	FrameIndexNodeData* pNode = frameIndexFindNode(strNodeName);
+	if (pNode == NULL)
+	{
+		g_FrameIndexNodes.resize(g_FrameIndexNodes.size() + 1);
+		pNode = &g_FrameIndexNodes.back();
+		pNode->strName = strNodeName;
+		// about 10 minutes at 30 FPS before the first reallocation
+		pNode->entries.reserve(18000);
+	}
+
+	// playback mostly goes forward, a frame already seen is not added again
+	std::vector<XnFrameIndexEntry>& entries = pNode->entries;
+	XnUInt32 nPos = (!entries.empty() && entries.back().nFrame < nFrame) ? (XnUInt32)entries.size() : frameIndexLowerBound(entries, nFrame);
+	if (nPos < entries.size() && entries[nPos].nFrame == nFrame)
+		return;
+
+	XnFrameIndexEntry entry = { nFrame, nTimestamp };
+	entries.insert(entries.begin() + nPos, entry);
+}
+
+XnStatus frameIndexFindFrame(const XnChar* strNodeName, XnUInt64 nTimestamp, XnUInt32 nNumFrames, XnUInt32* pnFrame)
+{
+	const FrameIndexNodeData* pNode = frameIndexFindNode(strNodeName);
+	if (pNode == NULL || pNode->entries.empty())
+		return XN_STATUS_NO_MATCH;
+
+	const std::vector<XnFrameIndexEntry>& entries = pNode->entries;
+	const XnFrameIndexEntry& first = entries.front();
+	const XnFrameIndexEntry& last = entries.back();
+
+	// first entry at or after nTimestamp
+	XnUInt32 nLow = 0;
+	XnUInt32 nHigh = (XnUInt32)entries.size();
+	while (nLow < nHigh)
+	{
+		XnUInt32 nMiddle = (nLow + nHigh) / 2;
+		if (entries[nMiddle].nTimestamp < nTimestamp)
+			nLow = nMiddle + 1;
+		else
+			nHigh = nMiddle;
+	}
+
+	XnDouble fFrame;
+	if (nLow > 0 && nLow < entries.size())
+	{
+		// between two frames seen, the frames not seen in between are spread evenly
+		const XnFrameIndexEntry& before = entries[nLow - 1];
+		const XnFrameIndexEntry& after = entries[nLow];
+		fFrame = before.nFrame + (XnDouble)(nTimestamp - before.nTimestamp) * (after.nFrame - before.nFrame) / (after.nTimestamp - before.nTimestamp);
+	}
+	else if (last.nFrame > first.nFrame && last.nTimestamp > first.nTimestamp)
+	{
+		// outside the frames seen, at their mean interval
+		XnDouble fInterval = (XnDouble)(last.nTimestamp - first.nTimestamp) / (last.nFrame - first.nFrame);
+		if (nLow == 0)
+			fFrame = first.nFrame - (XnDouble)(first.nTimestamp - nTimestamp) / fInterval;
+		else
+			fFrame = last.nFrame + (XnDouble)(nTimestamp - last.nTimestamp) / fInterval;
+	}
+	else
+	{
+		fFrame = (nLow == 0) ? first.nFrame : last.nFrame;
+	}
+
+	// a frame at or after the time asked for, not past the ends of the recording
+	fFrame = XN_MAX(ceil(fFrame - 1e-6), 1.0);
+	if (nNumFrames != 0)
+		fFrame = XN_MIN(fFrame, (XnDouble)nNumFrames);
+	*pnFrame = (XnUInt32)fFrame;
+	return XN_STATUS_OK;
+}
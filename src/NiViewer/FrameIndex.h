@@ -0,0 +1,24 @@
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+// --------------------------------
+// Includes
+// --------------------------------
+#include <XnCppWrapper.h>
+
+// --------------------------------
+// Function Declarations
+// --------------------------------
+// A frame index maps the timestamps of a recording to player frames, so the viewer can seek by time.
+// It is built from the player: every frame read during playback adds its position and timestamp.
+// Times between frames seen so far are interpolated, times beyond them are extrapolated at the mean
+// frame interval seen so far. The seek itself is done by the player.
+
+void frameIndexClear();
+// nFrame is the position of the frame in the recording, from 1 like the player does
+void frameIndexAddFrame(const XnChar* strNodeName, XnUInt32 nFrame, XnUInt64 nTimestamp);
+// First frame at or after nTimestamp, clamped to [1, nNumFrames] (0 when the count is unknown).
+// XN_STATUS_NO_MATCH before any frame of the node was added.
+XnStatus frameIndexFindFrame(const XnChar* strNodeName, XnUInt64 nTimestamp, XnUInt32 nNumFrames, XnUInt32* pnFrame);
+
+#endif //__FRAME_INDEX_H__
@@ -193,6 +193,20 @@ void seek(int nDiff)
 	g_bStep = true;
 }
 
+void seekSeconds(int nSecondsDiff)
+{
+	if (!isPlayerOn())
+	{
+		displayMessage("Seeking is only supported in playback mode!");
+		return;
+	}
+
+	seekTime(nSecondsDiff);
+
+	g_bPause = false;
+	g_bStep = true;
+}
+
 void init_opengl()
 {
 	glClearStencil(128);
@@ -338,6 +352,7 @@ void createKeyboardMap()
 			registerKey(';', "Read one frame", step, 0);
 			registerKey('[', "Decrease playback speed", setPlaybackSpeed, -1);
 			registerKey(']', "Increase playback speed", setPlaybackSpeed, 1);
+			registerKey('j', "Start/Stop decoding depth ahead", toggleDecodeAhead, 0);
 		}
 		endKeyboardGroup();
 	}
@@ -527,6 +542,9 @@ void createMenu()
 			createMenuEntry("Start Collecting", statisticsStart, 0);
 			createMenuEntry("Stop Collecting", statisticsStop, 0);
 			createMenuEntry("Clear", statisticsClear, 0);
+			createMenuEntry("Window: All Frames", statisticsSetWindow, 0);
+			createMenuEntry("Window: Last 30 Frames", statisticsSetWindow, 30);
+			createMenuEntry("Window: Last 100 Frames", statisticsSetWindow, 100);
 		}
 		endSubMenu();
 		startSubMenu("Player");
@@ -536,6 +554,9 @@ void createMenu()
 			createMenuEntry("Skip 10 frame forward", seek, 10);
 			createMenuEntry("Skip 1 frame backwards", seek, -1);
 			createMenuEntry("Skip 10 frame backwards", seek, -10);
+			createMenuEntry("Skip 10 seconds forward", seekSeconds, 10);
+			createMenuEntry("Skip 10 seconds backwards", seekSeconds, -10);
+			createMenuEntry("Start/Stop decoding depth ahead", toggleDecodeAhead, 0);
 		}
 		endSubMenu();
 		createMenuEntry("Quit", closeSample, ERR_OK);
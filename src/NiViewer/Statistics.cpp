@@ -27,10 +27,28 @@
 #include "Draw.h"
 #include <math.h>
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define STATISTICS_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
 // --------------------------------
 // Global Variables
 // --------------------------------
-XnPixelStatistics* g_PixelStatistics = NULL;
+// The sums are exact 64 bit integers, so the variance has no accumulated rounding error however long
+// the collection runs. Average and standard deviation are only computed when a pixel is read.
+XnUInt32 g_nStatisticsPixels = 0;
+XnUInt64* g_pStatisticsSum = NULL;
+XnUInt64* g_pStatisticsSumSquare = NULL;
+XnDepthPixel* g_pStatisticsMin = NULL;
+XnDepthPixel* g_pStatisticsMax = NULL;
+XnUInt32 g_nStatisticsFrames = 0;
+
+// Sliding window: the last frames are kept to take them out of the sums when they leave the window
+XnUInt32 g_nStatisticsWindow = 0;
+XnDepthPixel* g_pStatisticsHistory = NULL;
+XnUInt32 g_nStatisticsHistorySize = 0;
+XnUInt32 g_nStatisticsHistoryNext = 0;
 
 enum XnCollectionStatus
 {
@@ -43,15 +61,120 @@ enum XnCollectionStatus
 // --------------------------------
 // Code
 // --------------------------------
+#if STATISTICS_USE_SSE2
+// Adds (or subtracts) 8 depth values and their squares to the sums
+static inline void statisticsAccumulateEight(XnUInt64* pSum, XnUInt64* pSumSquare, __m128i depth, bool bAdd)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// 32 bit squares from the low and high halves of the 16 bit products
+	__m128i squareLow = _mm_mullo_epi16(depth, depth);
+	__m128i squareHigh = _mm_mulhi_epu16(depth, depth);
+
+	__m128i values32[2] = { _mm_unpacklo_epi16(depth, zero), _mm_unpackhi_epi16(depth, zero) };
+	__m128i squares32[2] = { _mm_unpacklo_epi16(squareLow, squareHigh), _mm_unpackhi_epi16(squareLow, squareHigh) };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		__m128i values64[2] = { _mm_unpacklo_epi32(values32[i], zero), _mm_unpackhi_epi32(values32[i], zero) };
+		__m128i squares64[2] = { _mm_unpacklo_epi32(squares32[i], zero), _mm_unpackhi_epi32(squares32[i], zero) };
+		for (int j = 0; j < 2; ++j)
+		{
+			__m128i* pSum2 = (__m128i*)(pSum + 4*i + 2*j);
+			__m128i* pSumSquare2 = (__m128i*)(pSumSquare + 4*i + 2*j);
+			__m128i sum = _mm_loadu_si128(pSum2);
+			__m128i sumSquare = _mm_loadu_si128(pSumSquare2);
+			if (bAdd)
+			{
+				sum = _mm_add_epi64(sum, values64[j]);
+				sumSquare = _mm_add_epi64(sumSquare, squares64[j]);
+			}
+			else
+			{
+				sum = _mm_sub_epi64(sum, values64[j]);
+				sumSquare = _mm_sub_epi64(sumSquare, squares64[j]);
+			}
+			_mm_storeu_si128(pSum2, sum);
+			_mm_storeu_si128(pSumSquare2, sumSquare);
+		}
+	}
+}
+
+// SSE2 only has signed 16 bit min / max, flipping the sign bit makes them unsigned
+static inline __m128i statisticsMinU16(__m128i a, __m128i b)
+{
+	const __m128i sign = _mm_set1_epi16((short)0x8000);
+	return _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+}
+
+static inline __m128i statisticsMaxU16(__m128i a, __m128i b)
+{
+	const __m128i sign = _mm_set1_epi16((short)0x8000);
+	return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+}
+#endif
+
+// Adds a row of nCount pixels starting at pixel nIndex. pOld is the row leaving the sliding window (or NULL).
+// Min and max are only tracked without a window, a window takes them from the kept frames.
+static void statisticsAccumulateRow(XnUInt32 nIndex, XnUInt32 nCount, const XnDepthPixel* pDepth, const XnDepthPixel* pOld)
+{
+	XnUInt64* pSum = g_pStatisticsSum + nIndex;
+	XnUInt64* pSumSquare = g_pStatisticsSumSquare + nIndex;
+	XnDepthPixel* pMin = g_pStatisticsMin + nIndex;
+	XnDepthPixel* pMax = g_pStatisticsMax + nIndex;
+
+	XnUInt32 x = 0;
+#if STATISTICS_USE_SSE2
+	for (; x + 8 <= nCount; x += 8)
+	{
+		__m128i depth = _mm_loadu_si128((const __m128i*)(pDepth + x));
+		statisticsAccumulateEight(pSum + x, pSumSquare + x, depth, true);
+		if (pOld != NULL)
+		{
+			statisticsAccumulateEight(pSum + x, pSumSquare + x, _mm_loadu_si128((const __m128i*)(pOld + x)), false);
+		}
+		else
+		{
+			__m128i* pMin8 = (__m128i*)(pMin + x);
+			__m128i* pMax8 = (__m128i*)(pMax + x);
+			_mm_storeu_si128(pMin8, statisticsMinU16(_mm_loadu_si128(pMin8), depth));
+			_mm_storeu_si128(pMax8, statisticsMaxU16(_mm_loadu_si128(pMax8), depth));
+		}
+	}
+#endif
+	for (; x < nCount; ++x)
+	{
+		XnDepthPixel nDepth = pDepth[x];
+		pSum[x] += nDepth;
+		pSumSquare[x] += (XnUInt32)nDepth * nDepth;
+		if (pOld != NULL)
+		{
+			pSum[x] -= pOld[x];
+			pSumSquare[x] -= (XnUInt32)pOld[x] * pOld[x];
+		}
+		else
+		{
+			if (nDepth < pMin[x])
+				pMin[x] = nDepth;
+			if (nDepth > pMax[x])
+				pMax[x] = nDepth;
+		}
+	}
+}
+
 void statisticsInit()
 {
-	g_PixelStatistics = NULL;
 	g_StatisticsState = NOT_COLLECTING;
+	g_nStatisticsPixels = 0;
 
 	const DepthMetaData* pDepthMD = getDepthMetaData();
 	if (pDepthMD != NULL)
 	{
-		g_PixelStatistics = new XnPixelStatistics[pDepthMD->FullXRes() * pDepthMD->FullYRes()];
+		g_nStatisticsPixels = pDepthMD->FullXRes() * pDepthMD->FullYRes();
+		g_pStatisticsSum = new XnUInt64[g_nStatisticsPixels];
+		g_pStatisticsSumSquare = new XnUInt64[g_nStatisticsPixels];
+		g_pStatisticsMin = new XnDepthPixel[g_nStatisticsPixels];
+		g_pStatisticsMax = new XnDepthPixel[g_nStatisticsPixels];
 	}
 }
 
@@ -65,16 +188,28 @@ void statisticsStart(int)
 		return;
 	}
 
-	int nCount = pDepthMD->FullXRes() * pDepthMD->FullYRes();
-
 	XnDepthPixel nMaxDepth = getDepthGenerator()->GetDeviceMaxDepth();
 
-	XnPixelStatistics* pPixel = g_PixelStatistics;
-	for (int i = 0; i < nCount; ++i, ++pPixel)
+	xnOSMemSet(g_pStatisticsSum, 0, g_nStatisticsPixels * sizeof(XnUInt64));
+	xnOSMemSet(g_pStatisticsSumSquare, 0, g_nStatisticsPixels * sizeof(XnUInt64));
+	xnOSMemSet(g_pStatisticsMax, 0, g_nStatisticsPixels * sizeof(XnDepthPixel));
+	for (XnUInt32 i = 0; i < g_nStatisticsPixels; ++i)
 	{
-		xnOSMemSet(pPixel, 0, sizeof(XnPixelStatistics));
-		pPixel->nMin = nMaxDepth;
+		g_pStatisticsMin[i] = nMaxDepth;
 	}
+	g_nStatisticsFrames = 0;
+
+	if (g_nStatisticsWindow != g_nStatisticsHistorySize)
+	{
+		delete[] g_pStatisticsHistory;
+		g_pStatisticsHistory = NULL;
+		g_nStatisticsHistorySize = g_nStatisticsWindow;
+		if (g_nStatisticsHistorySize != 0)
+		{
+			g_pStatisticsHistory = new XnDepthPixel[g_nStatisticsHistorySize * g_nStatisticsPixels];
+		}
+	}
+	g_nStatisticsHistoryNext = 0;
 
 	g_StatisticsState = SHOULD_COLLECT;
 }
@@ -104,6 +239,16 @@ void statisticsClear(int)
 	g_StatisticsState = NOT_COLLECTING;
 }
 
+void statisticsSetWindow(int nFrames)
+{
+	g_nStatisticsWindow = nFrames;
+
+	if (g_StatisticsState == SHOULD_COLLECT || g_StatisticsState == COLLECTING)
+	{
+		statisticsStart(0);
+	}
+}
+
 void statisticsAddFrame()
 {
 	if (g_StatisticsState == SHOULD_COLLECT)
@@ -116,27 +261,38 @@ void statisticsAddFrame()
 		const DepthMetaData* pDepthMD = getDepthMetaData();
 
 		const XnDepthPixel* pDepth = pDepthMD->Data();
+		const XnUInt32 nXRes = pDepthMD->XRes();
+		const XnUInt32 nFullXRes = pDepthMD->FullXRes();
+		const XnUInt32 nXOffset = pDepthMD->XOffset();
+		const XnUInt32 nYOffset = pDepthMD->YOffset();
 
-		for (XnUInt32 y = pDepthMD->YOffset(); y < pDepthMD->YRes() + pDepthMD->YOffset(); ++y)
+		// once the window is full, the slot of this frame holds the frame leaving the window
+		XnDepthPixel* pSlot = NULL;
+		bool bWindowFull = false;
+		if (g_pStatisticsHistory != NULL)
 		{
-			XnPixelStatistics* pPixel = &g_PixelStatistics[y*pDepthMD->FullXRes() + pDepthMD->XOffset()];
-			for (XnUInt32 x = pDepthMD->XOffset(); x < pDepthMD->XRes() + pDepthMD->XOffset(); ++x, ++pDepth, ++pPixel)
-			{
-				XnDepthPixel nDepth = *pDepth;
-
-				if (nDepth > pPixel->nMax)
-					pPixel->nMax = nDepth;
-
-				if (nDepth < pPixel->nMin)
-					pPixel->nMin = nDepth;
+			pSlot = g_pStatisticsHistory + g_nStatisticsHistoryNext * g_nStatisticsPixels;
+			bWindowFull = (g_nStatisticsFrames == g_nStatisticsHistorySize);
+			g_nStatisticsHistoryNext = (g_nStatisticsHistoryNext + 1) % g_nStatisticsHistorySize;
+		}
 
-				pPixel->nSum += nDepth;
-				pPixel->nSumSquare += (nDepth * nDepth);
-				pPixel->nCount++;
-				pPixel->dAverage = pPixel->nSum / pPixel->nCount;
-				pPixel->dStdDev = sqrt( (1.0/pPixel->nCount) * (pPixel->nSumSquare) - (pPixel->dAverage * pPixel->dAverage) );
+		// rows touch separate pixels, so they are accumulated in parallel
+#pragma omp parallel for
+		for (int y = 0; y < (int)pDepthMD->YRes(); ++y)
+		{
+			XnUInt32 nIndex = (nYOffset + y) * nFullXRes + nXOffset;
+			const XnDepthPixel* pRow = pDepth + y * nXRes;
+			statisticsAccumulateRow(nIndex, nXRes, pRow, bWindowFull ? pSlot + nIndex : NULL);
+			if (pSlot != NULL)
+			{
+				xnOSMemCopy(pSlot + nIndex, pRow, nXRes * sizeof(XnDepthPixel));
 			}
 		}
+
+		if (!bWindowFull)
+		{
+			++g_nStatisticsFrames;
+		}
 	}
 }
 
@@ -155,8 +311,67 @@ void getStatisticsMessage(char* csMessage)
 		break;
 	case COLLECTING:
 	case COLLECTION_ENDED:
-		const DepthMetaData* pDepthMD = getDepthMetaData();
-		sprintf(csMessage, "Collected Statistics for %u frames", g_PixelStatistics[pDepthMD->YOffset()*pDepthMD->FullXRes() + pDepthMD->XOffset()].nCount);
+		if (g_pStatisticsHistory != NULL)
+			sprintf(csMessage, "Collected Statistics for the last %u frames", g_nStatisticsFrames);
+		else
+			sprintf(csMessage, "Collected Statistics for %u frames", g_nStatisticsFrames);
 		break;
 	}
-}
\ No newline at end of file
+}
+
+static double statisticsGetVariance(XnUInt32 nIndex, double* pAverage)
+{
+	double dAverage = (double)g_pStatisticsSum[nIndex] / g_nStatisticsFrames;
+	double dVariance = (double)g_pStatisticsSumSquare[nIndex] / g_nStatisticsFrames - dAverage * dAverage;
+	if (pAverage != NULL)
+	{
+		*pAverage = dAverage;
+	}
+	return (dVariance > 0) ? dVariance : 0;
+}
+
+void statisticsGetPixel(XnUInt32 nX, XnUInt32 nY, XnPixelStatistics* pStatistics)
+{
+	xnOSMemSet(pStatistics, 0, sizeof(XnPixelStatistics));
+
+	const DepthMetaData* pDepthMD = getDepthMetaData();
+	if (pDepthMD == NULL || g_nStatisticsFrames == 0)
+	{
+		return;
+	}
+
+	XnUInt32 nIndex = nY * pDepthMD->FullXRes() + nX;
+	if (nIndex >= g_nStatisticsPixels)
+	{
+		return;
+	}
+
+	pStatistics->nCount = g_nStatisticsFrames;
+	pStatistics->dStdDev = sqrt(statisticsGetVariance(nIndex, &pStatistics->dAverage));
+
+	if (g_pStatisticsHistory != NULL)
+	{
+		pStatistics->nMin = XN_MAX_UINT16;
+		for (XnUInt32 i = 0; i < g_nStatisticsFrames; ++i)
+		{
+			XnDepthPixel nDepth = g_pStatisticsHistory[i * g_nStatisticsPixels + nIndex];
+			pStatistics->nMin = XN_MIN(pStatistics->nMin, nDepth);
+			pStatistics->nMax = XN_MAX(pStatistics->nMax, nDepth);
+		}
+	}
+	else
+	{
+		pStatistics->nMin = g_pStatisticsMin[nIndex];
+		pStatistics->nMax = g_pStatisticsMax[nIndex];
+	}
+}
+
+double statisticsGetStdDev(XnUInt32 nX, XnUInt32 nY)
+{
+	if (g_nStatisticsFrames == 0)
+	{
+		return 0;
+	}
+
+	return sqrt(statisticsGetVariance(nY * getDepthMetaData()->FullXRes() + nX, NULL));
+}
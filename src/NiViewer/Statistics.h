@@ -30,22 +30,16 @@
 // --------------------------------
 // Defines
 // --------------------------------
+// Statistics of one pixel, derived on request from the accumulated sums
 typedef struct
 {
 	int nCount;
 	XnDepthPixel nMin;
 	XnDepthPixel nMax;
-	double nSum;
-	double nSumSquare;
 	double dAverage;
 	double dStdDev;
 } XnPixelStatistics;
 
-// --------------------------------
-// Global Variables
-// --------------------------------
-extern XnPixelStatistics* g_PixelStatistics;
-
 // --------------------------------
 // Function Declarations
 // --------------------------------
@@ -54,8 +48,13 @@ void statisticsStart(int);
 void statisticsStop(int);
 void toggleStatistics(int);
 void statisticsClear(int);
+// Only keeps the last nFrames frames in the statistics (0 for all frames). Restarts a running collection.
+void statisticsSetWindow(int nFrames);
 void statisticsAddFrame();
 bool isStatisticsActive();
 void getStatisticsMessage(char* csMessage);
+// Pixel coordinates are in the full resolution of the depth map
+void statisticsGetPixel(XnUInt32 nX, XnUInt32 nY, XnPixelStatistics* pStatistics);
+double statisticsGetStdDev(XnUInt32 nX, XnUInt32 nY);
 
 #endif //__STATISTICS_H__
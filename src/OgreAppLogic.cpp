@@ -2,6 +2,7 @@
 #include "OgreApp.h"
 #include <Ogre.h>
 #include "Chrono.h"
+#include "TimeService.h"
 #include "StatsFrameListener.h"
 #include <OgrePanelOverlayElement.h>
 #include "KinectDevice.h"
@@ -20,8 +21,11 @@ OgreAppLogic::OgreAppLogic() : mApplication(0)
 	mWebcamBufferL8 = 0;
 	mObjectNode     = 0;
 	mTrackingSystem = 0;
+	mDepthOcclusion = 0;
+	mOcclusionEnabled = true;
 	mStatsFrameListener = 0;
 	mAnimState = 0;
+	mRetargeter = 0;
 
 	mOISListener.mParent = this;
 }
@@ -54,6 +58,8 @@ bool OgreAppLogic::init(void)
 		
 		//init the kinect device
 		mKinectDevice = mKinectDeviceManager[0];
+		//the marker refinement and the occluder read depth at video pixels, nothing else needs the registration
+		mKinectDevice->setDepthRegistration(TrackingSystem::isUsingDepthRefinement || mOcclusionEnabled);
 		if (mKinectDevice->initPrimeSensor() != XN_STATUS_OK)
 			return false;
 		//create texture 
@@ -66,6 +72,10 @@ bool OgreAppLogic::init(void)
 		//init the ArToolkit tracking system
 		initTracking(width, height);
 		createWebcamPlane(width, height, 45000.0f);	
+
+		//real objects in front of the virtual content hide it
+		if (mOcclusionEnabled)
+			createOcclusion(Kinect::depthWidth, Kinect::depthHeight);
 	
 		//mStatsFrameListener = new StatsFrameListener(mApplication->getRenderWindow());
 		//mApplication->getOgreRoot()->addFrameListener(mStatsFrameListener);
@@ -109,8 +119,17 @@ bool OgreAppLogic::update(Ogre::Real deltaTime)
 		//Ogre::PixelBox box(mVideoDevice->getWidth(), mVideoDevice->getHeight(), 1, Ogre::PF_B8G8R8, (void*) mVideoDevice->getBufferData());
 		Ogre::PixelBox box(mKinectDevice->getWidth(), mKinectDevice->getHeight(), 1, Ogre::PF_B8G8R8, (void*) mKinectDevice->getKinectColorBufferData());
 
-		//Tracking using ArToolKitPlus
-		mTrackingSystem->update(box);
+		//Tracking using ArToolKitPlus, refined with the registered depth map when available
+		const xn::DepthMetaData* depthMetaData = mKinectDevice->getDepthMetaData();
+		if (depthMetaData != NULL)
+		{
+			Ogre::PixelBox depthBox(depthMetaData->XRes(), depthMetaData->YRes(), 1, Ogre::PF_L16, (void*) depthMetaData->Data());
+			mTrackingSystem->update(box, depthBox);
+			if (mDepthOcclusion)
+				mDepthOcclusion->update(depthBox);
+		}
+		else
+			mTrackingSystem->update(box);
 
 		if (mTrackingSystem->isPoseComputed())
 		{
@@ -126,6 +145,19 @@ bool OgreAppLogic::update(Ogre::Real deltaTime)
 	if (mAnimState)
 		mAnimState->addTime(deltaTime);
 
+	//drive Sinbad from the tracked skeleton, the filtered joints are predicted from the time the
+	//sensor took the frame to the end of this render frame
+	if (mRetargeter && mKinectDevice)
+	{
+		Ogre::Real horizon = deltaTime;
+		const FrameTime& frameTime = mKinectDevice->getFrameTime();
+		uint64_t now = TimeService::now();
+		if (frameTime.hostTime != 0 && frameTime.hostTime < now)
+			horizon += (Ogre::Real)TimeService::toSeconds(now - frameTime.hostTime);
+		mKinectDevice->getJointFilter().Predict(horizon);
+		mRetargeter->update(mKinectDevice->getSkeletonSnapshot(), &mKinectDevice->getJointFilter(), deltaTime);
+	}
+
 	bool result = processInputs(deltaTime);
 	return result;
 }
@@ -141,6 +173,12 @@ void OgreAppLogic::shutdown(void)
 	delete mTrackingSystem;
 	mTrackingSystem = NULL;
 
+	delete mDepthOcclusion;
+	mDepthOcclusion = NULL;
+
+	delete mRetargeter;
+	mRetargeter = NULL;
+
 	mApplication->getOgreRoot()->removeFrameListener(mStatsFrameListener);
 	delete mStatsFrameListener;
 	mStatsFrameListener = 0;
@@ -174,8 +212,8 @@ void OgreAppLogic::createCamera(void)
 	mCamera->setFarClipDistance(50000);
 	mCamera->setPosition(100, 100, 100);
 	mCamera->lookAt(0, 0, 1);
-	mCamera->setFOVy(Degree(40)); //FOVy camera Ogre = 40?
-	mCamera->setAspectRatio((float) mViewport->getActualWidth() / (float) mViewport->getActualHeight());	
+	//same projection as the Kinect images (and the occluder unprojected from the depth map)
+	DepthOcclusion::setupCamera(mCamera, Kinect::depthWidth, Kinect::depthHeight);
 	mViewport->setCamera(mCamera);
 
 	mCameraNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("cameraNode");
@@ -234,6 +272,10 @@ void OgreAppLogic::createScene(void)
 	mAnimState->setLoop(true);
 	mAnimState->setEnabled(true);
 
+	//the tracked user takes over the dance when found
+	mRetargeter = new SkeletonRetargeter;
+	mRetargeter->addAvatar(ent);
+
 }
 
 ManualObject* OgreAppLogic::createCubeMesh(Ogre::String name, Ogre::String matName) {
@@ -289,11 +331,14 @@ void OgreAppLogic::initTracking(int width, int height)
 
 void OgreAppLogic::createWebcamPlane(int width, int height, Ogre::Real _distanceFromCamera)
 {
-	// Create a prefab plane dedicated to display video
-	float videoAspectRatio = width / (float) height;
+	// Create a prefab plane dedicated to display video, it fills the camera frustum at that distance
+	Ogre::Radian fovY;
+	Ogre::Real aspectRatio;
+	Ogre::Vector2 frustumOffset;
+	DepthOcclusion::getProjection(Kinect::depthWidth, Kinect::depthHeight, fovY, aspectRatio, frustumOffset);
 
-	float planeHeight = 2 * _distanceFromCamera * Ogre::Math::Tan(Degree(26)*0.5); //FOVy webcam = 26?(intrinsic param)
-	float planeWidth = planeHeight * videoAspectRatio;
+	float planeHeight = 2 * _distanceFromCamera * Ogre::Math::Tan(fovY*0.5);
+	float planeWidth = planeHeight * aspectRatio;
 
 	Plane p(Vector3::UNIT_Z, 0.0);
 	MeshManager::getSingleton().createPlane("VerticalPlane", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, p , planeWidth, planeHeight, 1, 1, true, 1, 1, 1, Vector3::UNIT_Y);
@@ -306,7 +351,8 @@ void OgreAppLogic::createWebcamPlane(int width, int height, Ogre::Real _distance
 	node->attachObject(planeEntity);
 
 	// Update position    
-	Vector3 planePos = mCamera->getPosition() + mCamera->getDirection() * _distanceFromCamera;
+	Vector3 planePos = mCamera->getPosition() + mCamera->getDirection() * _distanceFromCamera
+		+ (mCamera->getRight() * frustumOffset.x + mCamera->getUp() * frustumOffset.y) * _distanceFromCamera;
 	node->setPosition(planePos);
 
 	// Update orientation
@@ -316,6 +362,15 @@ void OgreAppLogic::createWebcamPlane(int width, int height, Ogre::Real _distance
 	mObjectNode->setOrientation(mCamera->getOrientation());
 }
 
+void OgreAppLogic::createOcclusion(int depthWidth, int depthHeight)
+{
+	// The occluder lives in camera space, next to the camera on the tracked camera node
+	Ogre::SceneNode* node = mCameraNode->createChildSceneNode("occlusionCameraNode", mCamera->getPosition(), mCamera->getOrientation());
+
+	mDepthOcclusion = new DepthOcclusion;
+	mDepthOcclusion->init(mSceneMgr, node, depthWidth, depthHeight);
+}
+
 void OgreAppLogic::createKinectOverlay(const std::string& colorTextureName, const std::string& depthTextureName, const std::string& coloredDepthTextureName)
 {
 	//Create Color Overlay
@@ -0,0 +1,277 @@
+#include "SkeletonRetargeter.h"
+
+#include <Ogre.h>
+
+using namespace Ogre;
+
+Real SkeletonRetargeter::blendTime        = 0.5f;
+Real SkeletonRetargeter::minConfidence    = 0.5f;
+Real SkeletonRetargeter::translationScale = 0.005f;
+
+//Left joints of the sensor and their right counterparts, for mirrored avatars
+static XnSkeletonJoint mirrorJoint(XnSkeletonJoint joint)
+{
+	switch (joint)
+	{
+	case XN_SKEL_LEFT_SHOULDER:  return XN_SKEL_RIGHT_SHOULDER;
+	case XN_SKEL_RIGHT_SHOULDER: return XN_SKEL_LEFT_SHOULDER;
+	case XN_SKEL_LEFT_ELBOW:     return XN_SKEL_RIGHT_ELBOW;
+	case XN_SKEL_RIGHT_ELBOW:    return XN_SKEL_LEFT_ELBOW;
+	case XN_SKEL_LEFT_HIP:       return XN_SKEL_RIGHT_HIP;
+	case XN_SKEL_RIGHT_HIP:      return XN_SKEL_LEFT_HIP;
+	case XN_SKEL_LEFT_KNEE:      return XN_SKEL_RIGHT_KNEE;
+	case XN_SKEL_RIGHT_KNEE:     return XN_SKEL_LEFT_KNEE;
+	default:                     return joint;
+	}
+}
+
+SkeletonRetargeter::SkeletonRetargeter()
+{}
+
+SkeletonRetargeter::~SkeletonRetargeter()
+{
+	removeAvatars();
+}
+
+void SkeletonRetargeter::setupBone(Avatar& avatar, const String& name, XnSkeletonJoint joint, const Quaternion& rest)
+{
+	//the bone keeps its parent and bind pose, update only replaces its orientation
+	Bone* bone = avatar.entity->getSkeleton()->getBone(name);
+	bone->setManuallyControlled(true);
+
+	mBones.push_back(bone);
+	mBoneHandles.push_back(bone->getHandle());
+	mJoints.push_back(avatar.mirror ? mirrorJoint(joint) : joint);
+	mParents.push_back(mBones.size() - 1);
+	mRestOrientations.push_back(rest);
+	mBindOrientations.push_back(bone->getInitialOrientation());
+	mTargetOrientations.push_back(rest);
+	mOrientations.push_back(bone->getInitialOrientation());
+	avatar.boneCount++;
+}
+
+int SkeletonRetargeter::addAvatar(Entity* entity, XnUserID userID, bool mirror)
+{
+	if (!entity || !entity->hasSkeleton())
+		return -1;
+
+	Avatar avatar;
+	avatar.entity = entity;
+	avatar.userID = userID;
+	avatar.trackedUserID = 0;
+	avatar.mirror = mirror;
+	avatar.weight = 0;
+	avatar.firstBone = mBones.size();
+	avatar.boneCount = 0;
+	avatar.hasOrigTorsoPos = false;
+	avatar.origTorsoPos = Vector3::ZERO;
+
+	//rest pose offsets of the Sinbad rig: orientation of each bone when the sensor joint orientation is identity
+	Quaternion q, q2;
+	Vector3 xAxis, yAxis, zAxis;
+
+	q.FromAngleAxis(Degree(90), Vector3(0, 0, -1));
+	q.ToAxes(xAxis, yAxis, zAxis);
+	q2.FromAngleAxis(Degree(90), xAxis);
+	setupBone(avatar, "Humerus.L", XN_SKEL_LEFT_SHOULDER, q*q2);
+
+	q.FromAngleAxis(Degree(90), Vector3(0, 0, 1));
+	q.ToAxes(xAxis, yAxis, zAxis);
+	q2.FromAngleAxis(Degree(90), xAxis);
+	setupBone(avatar, "Humerus.R", XN_SKEL_RIGHT_SHOULDER, q*q2);
+
+	q.FromAngleAxis(Degree(90), Vector3(0, 0, -1));
+	q2.FromAngleAxis(Degree(45), Vector3(0, -1, 0));
+	setupBone(avatar, "Ulna.L", XN_SKEL_LEFT_ELBOW, q*q2);
+
+	q.FromAngleAxis(Degree(90), Vector3(0, 0, 1));
+	setupBone(avatar, "Ulna.R", XN_SKEL_RIGHT_ELBOW, q*q2.Inverse());
+
+	q.FromAngleAxis(Degree(180), Vector3(0, 1, 0));
+	setupBone(avatar, "Chest", XN_SKEL_TORSO, q);
+	setupBone(avatar, "Stomach", XN_SKEL_TORSO, q);
+
+	q.FromAngleAxis(Degree(180), Vector3(1, 0, 0));
+	q2.FromAngleAxis(Degree(180), Vector3(0, 1, 0));
+	setupBone(avatar, "Thigh.L", XN_SKEL_LEFT_HIP, q*q2);
+	setupBone(avatar, "Thigh.R", XN_SKEL_RIGHT_HIP, q*q2);
+	setupBone(avatar, "Calf.L", XN_SKEL_LEFT_KNEE, q*q2);
+	setupBone(avatar, "Calf.R", XN_SKEL_RIGHT_KNEE, q*q2);
+
+	setupBone(avatar, "Root", XN_SKEL_TORSO, Quaternion::IDENTITY);
+	avatar.root = mBones.back();
+	avatar.rootInitialPosition = avatar.root->getInitialPosition();
+
+	//driven parents of the driven bones, whatever the setup order
+	for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+	{
+		for (size_t p = avatar.firstBone; p < avatar.firstBone + avatar.boneCount; ++p)
+		{
+			if (mBones[p] == mBones[b]->getParent())
+				mParents[b] = p;
+		}
+	}
+
+	mAvatars.push_back(avatar);
+	updateBlendMasks(mAvatars.back());
+	return (int)mAvatars.size() - 1;
+}
+
+void SkeletonRetargeter::removeAvatars()
+{
+	for (size_t i = 0; i < mAvatars.size(); ++i)
+	{
+		Avatar& avatar = mAvatars[i];
+		avatar.weight = 0;
+		updateBlendMasks(avatar);
+		for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+		{
+			mBones[b]->setOrientation(mBindOrientations[b]);
+			mBones[b]->setManuallyControlled(false);
+		}
+	}
+
+	mAvatars.clear();
+	mBones.clear();
+	mBoneHandles.clear();
+	mJoints.clear();
+	mParents.clear();
+	mRestOrientations.clear();
+	mBindOrientations.clear();
+	mTargetOrientations.clear();
+	mOrientations.clear();
+}
+
+Real SkeletonRetargeter::getTrackingWeight(int avatar) const
+{
+	return (avatar >= 0 && avatar < (int)mAvatars.size()) ? mAvatars[avatar].weight : 0;
+}
+
+void SkeletonRetargeter::setAvatarUser(int avatar, XnUserID userID)
+{
+	if (avatar < 0 || avatar >= (int)mAvatars.size())
+		return;
+	mAvatars[avatar].userID = userID;
+	if (userID != mAvatars[avatar].trackedUserID)
+		mAvatars[avatar].trackedUserID = 0;
+}
+
+XnUserID SkeletonRetargeter::getTrackedUser(int avatar) const
+{
+	return (avatar >= 0 && avatar < (int)mAvatars.size()) ? mAvatars[avatar].trackedUserID : 0;
+}
+
+void SkeletonRetargeter::update(const SkeletonSnapshot& snapshot, const JointFilter* filter, Real deltaTime)
+{
+	const Real fade = blendTime > 0 ? deltaTime / blendTime : 1;
+
+	for (size_t i = 0; i < mAvatars.size(); ++i)
+	{
+		Avatar& avatar = mAvatars[i];
+
+		//the avatar follows the user it is bound to; it binds to another one only once faded back
+		//to the animations, so a new user never makes it snap from the pose of the previous one
+		XnInt32 slot = avatar.trackedUserID != 0 ? snapshot.FindUser(avatar.trackedUserID) : -1;
+		if (slot < 0 && avatar.weight <= 0)
+		{
+			avatar.trackedUserID = 0;
+			slot = avatar.userID != 0 ? snapshot.FindUser(avatar.userID) : (snapshot.GetUserCount() > 0 ? 0 : -1);
+			if (slot >= 0)
+				avatar.trackedUserID = snapshot.GetUserID(slot);
+		}
+		avatar.weight = Math::Clamp<Real>(avatar.weight + (slot >= 0 ? fade : -fade), 0, 1);
+		if (slot < 0)
+			avatar.hasOrigTorsoPos = false;
+
+		//joint orientations to bone orientations, sensor axes to Sinbad axes then rest pose offset
+		const XnMatrix3X3* orientations = snapshot.GetOrientations();
+		const XnFloat* confidences = snapshot.GetOrientationConfidences();
+		for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+		{
+			if (slot >= 0)
+			{
+				XnUInt32 index = SkeletonSnapshot::Index(slot, mJoints[b]);
+				if (confidences[index] >= minConfidence)
+				{
+					const XnFloat* m = orientations[index].elements;
+					Matrix3 rotation( m[0], -m[1],  m[2],
+					                 -m[3],  m[4], -m[5],
+					                  m[6], -m[7],  m[8]);
+					mTargetOrientations[b] = Quaternion(rotation)*mRestOrientations[b];
+				}
+			}
+		}
+
+		//skeleton space targets to deltas relative to the parent, blended with the bind pose
+		for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+		{
+			Quaternion parent = Quaternion::IDENTITY;
+			if (mParents[b] != b)
+				parent = mTargetOrientations[mParents[b]];
+			else if (mBones[b]->getParent())
+				parent = mBones[b]->getParent()->_getDerivedOrientation();
+			const Quaternion local = parent.Inverse()*mTargetOrientations[b];
+			mOrientations[b] = Quaternion::nlerp(avatar.weight, mBindOrientations[b], local, true);
+		}
+
+		//root motion relative to the torso position at the first tracked frame, like the calibration pose
+		Vector3 rootOffset = Vector3::ZERO;
+		if (slot >= 0)
+		{
+			XnPoint3D torso;
+			bool hasTorso = false;
+			if (filter)
+				hasTorso = filter->GetJointPosition(avatar.trackedUserID, XN_SKEL_TORSO, torso, TRUE) == TRUE;
+			if (!hasTorso && snapshot.GetPositionConfidences()[SkeletonSnapshot::Index(slot, XN_SKEL_TORSO)] >= minConfidence)
+			{
+				torso = snapshot.GetPositions()[SkeletonSnapshot::Index(slot, XN_SKEL_TORSO)];
+				hasTorso = true;
+			}
+
+			if (hasTorso)
+			{
+				Vector3 torsoPos(avatar.mirror ? torso.X : -torso.X, torso.Y, -torso.Z);
+				if (!avatar.hasOrigTorsoPos)
+				{
+					avatar.origTorsoPos = torsoPos;
+					avatar.hasOrigTorsoPos = true;
+				}
+				rootOffset = (torsoPos - avatar.origTorsoPos)*translationScale;
+			}
+		}
+
+		//manually controlled bones are not reset by the skeleton, the animations would accumulate;
+		//the orientation is relative to the parent, the animations of the parents still move the bone
+		for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+		{
+			Bone* bone = mBones[b];
+			bone->setPosition(bone->getInitialPosition());
+			bone->setScale(bone->getInitialScale());
+			bone->setOrientation(mOrientations[b]);
+		}
+		avatar.root->setPosition(avatar.rootInitialPosition + rootOffset*avatar.weight);
+
+		//every frame, not only when the weight moves: the application enables other animations
+		//(idle, run, ...) at any time and those need the mask too
+		updateBlendMasks(avatar);
+	}
+}
+
+//Driven bones take (1 - weight) of the enabled animations
+void SkeletonRetargeter::updateBlendMasks(const Avatar& avatar)
+{
+	AnimationStateSet* states = avatar.entity->getAllAnimationStates();
+	if (!states)
+		return;
+
+	const size_t boneCount = avatar.entity->getSkeleton()->getNumBones();
+	ConstEnabledAnimationStateIterator it = states->getEnabledAnimationStateIterator();
+	while (it.hasMoreElements())
+	{
+		AnimationState* state = it.getNext();
+		if (!state->hasBlendMask())
+			state->createBlendMask(boneCount, 1.0f);
+		for (size_t b = avatar.firstBone; b < avatar.firstBone + avatar.boneCount; ++b)
+			state->setBlendMaskEntry(mBoneHandles[b], 1.0f - avatar.weight);
+	}
+}
@@ -0,0 +1,83 @@
+#include "TimeService.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _WIN32
+static uint64_t getCounterFrequency()
+{
+	// the frequency is fixed at boot, query it once
+	static LONGLONG freq = 0;
+	if (freq == 0)
+		QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
+	return (uint64_t)freq;
+}
+#endif
+
+uint64_t TimeService::now()
+{
+#ifdef _WIN32
+	LONGLONG counter;
+	QueryPerformanceCounter((LARGE_INTEGER*)&counter);
+	uint64_t freq = getCounterFrequency();
+	// split so counter * 1e9 does not overflow after a few days of uptime
+	return ((uint64_t)counter / freq) * 1000000000ULL + (((uint64_t)counter % freq) * 1000000000ULL) / freq;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+double TimeService::nowSeconds()
+{
+	return toSeconds((int64_t)now());
+}
+
+SensorClock::SensorClock()
+{
+	reset();
+}
+
+void SensorClock::reset()
+{
+	mSamples = 0;
+	mNext = 0;
+	mOffset = 0;
+	mLastLatency = 0;
+	mLastSensorTime = 0;
+	mLastHostTime = 0;
+}
+
+void SensorClock::observe(uint64_t sensorTime, uint64_t hostTime)
+{
+	// the device restarted or a recording looped, the old samples do not apply any more
+	if (mSamples > 0 && sensorTime < mLastSensorTime)
+		reset();
+	mLastSensorTime = sensorTime;
+	mLastHostTime = hostTime;
+
+	int64_t offset = (int64_t)hostTime - (int64_t)(sensorTime * 1000);
+	mOffsets[mNext] = offset;
+	mNext = (mNext + 1) % WINDOW;
+	if (mSamples < WINDOW)
+		mSamples++;
+
+	mOffset = mOffsets[0];
+	for (unsigned int i = 1; i < mSamples; i++)
+	{
+		if (mOffsets[i] < mOffset)
+			mOffset = mOffsets[i];
+	}
+	mLastLatency = offset - mOffset;
+}
+
+uint64_t SensorClock::toHost(uint64_t sensorTime) const
+{
+	if (!isCalibrated())
+		return TimeService::now();
+	return (uint64_t)((int64_t)(sensorTime * 1000) + mOffset);
+}
@@ -3,9 +3,11 @@
 #include "ARToolKitPlus/TrackerMultiMarkerImpl.h"
 
 #include <iostream>
+#include <algorithm>
 #include <OgreQuaternion.h>
 #include <OgreException.h>
 #include <OgrePixelFormat.h>
+#include <OgreMath.h>
 
 using namespace std;
 using namespace Ogre;
@@ -28,11 +30,28 @@ bool TrackingSystem::isUsingHistory             = true;
 bool TrackingSystem::isUsingAutoThreshold       = true;
 int TrackingSystem::threshold                   = 140;
 
+//Kinect color camera intrinsics, the depth map is expected to be registered on it
+bool TrackingSystem::isUsingDepthRefinement     = false;
+float TrackingSystem::depthFx                   = 5.2921508098293293e+02f;
+float TrackingSystem::depthFy                   = 5.2556393630057437e+02f;
+float TrackingSystem::depthCx                   = 3.2894272028759258e+02f;
+float TrackingSystem::depthCy                   = 2.6748068171871557e+02f;
+float TrackingSystem::depthWeight               = 0.8f;
+float TrackingSystem::depthMaxDistanceGap       = 0.1f;
+float TrackingSystem::depthMaxAngleGap          = 20.0f;
+float TrackingSystem::depthMaxRmsError          = 15.0f;
+int TrackingSystem::depthMinSamples             = 64;
+int TrackingSystem::depthSampleStep             = 1;
+
 TrackingSystem::TrackingSystem()
 : mRot180Z(Degree(180.f), Vector3::UNIT_Z)
 {
 	mInitialized = false;
 	mMarkersFound = false;
+	mPoseComputed = false;
+	mPoseRefined = false;
+	mWidth = 0;
+	mHeight = 0;
 
 	mTracker = NULL;
 }
@@ -44,6 +63,8 @@ TrackingSystem::~TrackingSystem()
 
 void TrackingSystem::init(int _width, int _height)
 {
+	mWidth  = _width;
+	mHeight = _height;
 	mTracker = new ARToolKitPlus::TrackerMultiMarkerImpl<6, 6, 6, 1, 8>(_width, _height);
 
 	//
@@ -80,6 +101,9 @@ bool TrackingSystem::update(const Ogre::PixelBox& frame)
 	if (!mInitialized)
 		return false;
 
+	mPoseRefined = false;
+	mDepthPlane = DepthPlane();
+
 	//calc() method return the number of markers found
 	bool found = mTracker->calc((unsigned char*)frame.data) != 0;
 	
@@ -94,10 +118,45 @@ bool TrackingSystem::update(const Ogre::PixelBox& frame)
 	return found;
 }
 
+bool TrackingSystem::update(const Ogre::PixelBox& frame, const Ogre::PixelBox& depthFrame)
+{
+	if (!TrackingSystem::isUsingDepthRefinement || depthFrame.format != Ogre::PF_L16)
+		return update(frame);
+
+	if (!mInitialized)
+		return false;
+
+	mPoseRefined = false;
+	mDepthPlane = DepthPlane();
+
+	bool found = mTracker->calc((unsigned char*)frame.data) != 0;
+
+	if (found)
+	{
+		const ARToolKitPlus::ARMultiMarkerInfoT* config = mTracker->getMultiMarkerConfig();
+		Matrix4 trans = convert(config->trans);
+
+		if (fitDepthPlane(depthFrame))
+			mPoseRefined = refinePoseWithDepth(trans);
+
+		convertPoseToOgreCoordinate(trans);
+		mPoseComputed = true;
+	}
+	else
+		mPoseComputed = false;
+
+	return found;
+}
+
 void TrackingSystem::convertPoseToOgreCoordinate() 
 {
 	const ARToolKitPlus::ARMultiMarkerInfoT* config = mTracker->getMultiMarkerConfig();	
-	Matrix4 invTrans = convert(config->trans).inverseAffine();
+	convertPoseToOgreCoordinate(convert(config->trans));
+}
+
+void TrackingSystem::convertPoseToOgreCoordinate(const Ogre::Matrix4& trans)
+{
+	Matrix4 invTrans = trans.inverseAffine();
 
 	Vector3 invTransPosition = invTrans.getTrans();
 	Quaternion invTransOrientation = invTrans.extractQuaternion();	
@@ -107,6 +166,121 @@ void TrackingSystem::convertPoseToOgreCoordinate()
 	mOrientation = invTransOrientation;	
 }
 
+bool TrackingSystem::fitDepthPlane(const Ogre::PixelBox& depthFrame)
+{
+	const int depthWidth  = (int)depthFrame.getWidth();
+	const int depthHeight = (int)depthFrame.getHeight();
+	const unsigned short* depth = static_cast<const unsigned short*>(depthFrame.data);
+	const int step = std::max(1, TrackingSystem::depthSampleStep);
+
+	//marker corners are given in tracker image coordinates
+	const float scaleX = depthWidth  / (float) mWidth;
+	const float scaleY = depthHeight / (float) mHeight;
+
+	mPlaneFitter.setIntrinsics(TrackingSystem::depthFx, TrackingSystem::depthFy, TrackingSystem::depthCx, TrackingSystem::depthCy);
+	mPlaneFitter.clear();
+
+	for (int m=0; m<mTracker->getNumDetectedMarkers(); ++m)
+	{
+		const ARToolKitPlus::ARMarkerInfo& info = mTracker->getDetectedMarker(m);
+		if (info.id < 0)
+			continue;
+
+		//shrink the quad toward its center to stay away from the marker border and depth edges
+		float cornerX[4], cornerY[4];
+		float centerX = 0, centerY = 0;
+		for (int k=0; k<4; ++k)
+		{
+			centerX += info.vertex[k][0] * 0.25f;
+			centerY += info.vertex[k][1] * 0.25f;
+		}
+		for (int k=0; k<4; ++k)
+		{
+			cornerX[k] = (centerX + (info.vertex[k][0] - centerX) * 0.8f) * scaleX;
+			cornerY[k] = (centerY + (info.vertex[k][1] - centerY) * 0.8f) * scaleY;
+		}
+
+		float minY = cornerY[0], maxY = cornerY[0];
+		for (int k=1; k<4; ++k)
+		{
+			minY = std::min(minY, cornerY[k]);
+			maxY = std::max(maxY, cornerY[k]);
+		}
+
+		int v0 = std::max(0, (int)Math::Ceil(minY));
+		int v1 = std::min(depthHeight - 1, (int)Math::Floor(maxY));
+
+		//scanline rasterization of the convex quad
+		for (int v=v0; v<=v1; v+=step)
+		{
+			float spanMin = (float)depthWidth, spanMax = -1.0f;
+			for (int k=0; k<4; ++k)
+			{
+				float ax = cornerX[k], ay = cornerY[k];
+				float bx = cornerX[(k+1)%4], by = cornerY[(k+1)%4];
+				if ((v < ay && v < by) || (v > ay && v > by) || ay == by)
+					continue;
+				float x = ax + (v - ay) * (bx - ax) / (by - ay);
+				spanMin = std::min(spanMin, x);
+				spanMax = std::max(spanMax, x);
+			}
+
+			int x0 = std::max(0, (int)Math::Ceil(spanMin));
+			int x1 = std::min(depthWidth - 1, (int)Math::Floor(spanMax));
+			if (x0 > x1)
+				continue;
+
+			mPlaneFitter.addRow(depth + v*depthFrame.rowPitch, v, x0, x1, step);
+		}
+	}
+
+	return mPlaneFitter.fit(mDepthPlane, TrackingSystem::depthMinSamples, TrackingSystem::depthMaxRmsError);
+}
+
+//Fuse the marker distance and normal measured on the depth plane with the ARToolKitPlus pose.
+//trans is the marker to camera transform, return false if the depth is rejected.
+bool TrackingSystem::refinePoseWithDepth(Ogre::Matrix4& trans) const
+{
+	Vector3 position = trans.getTrans();
+	Real distance = position.length();
+	if (distance <= 0)
+		return false;
+
+	//intersect the viewing ray of the marker origin with the depth plane
+	Vector3 ray = position / distance;
+	Real denom = ray.z - mDepthPlane.a*ray.x - mDepthPlane.b*ray.y;
+	if (Math::Abs(denom) < 1e-3f)
+		return false;
+	Real depthDistance = mDepthPlane.c / denom;
+	if (depthDistance <= 0)
+		return false;
+
+	if (Math::Abs(depthDistance - distance) > TrackingSystem::depthMaxDistanceGap * distance)
+		return false;
+
+	//plane normal, oriented like the marker z axis
+	Matrix3 rotation;
+	trans.extract3x3Matrix(rotation);
+	Vector3 markerNormal = rotation.GetColumn(2);
+	Vector3 depthNormal(mDepthPlane.a, mDepthPlane.b, -1.0f);
+	depthNormal.normalise();
+	if (depthNormal.dotProduct(markerNormal) < 0)
+		depthNormal = -depthNormal;
+
+	if (markerNormal.angleBetween(depthNormal) > Degree(TrackingSystem::depthMaxAngleGap))
+		return false;
+
+	Quaternion correction = Quaternion::Slerp(TrackingSystem::depthWeight, Quaternion::IDENTITY, markerNormal.getRotationTo(depthNormal), true);
+	Matrix3 correctionMatrix;
+	correction.ToRotationMatrix(correctionMatrix);
+
+	Real fusedDistance = distance + (depthDistance - distance) * TrackingSystem::depthWeight;
+
+	trans = Matrix4(correctionMatrix * rotation);
+	trans.setTrans(ray * fusedDistance);
+	return true;
+}
+
 const std::vector<int> TrackingSystem::getVisibleMarkersId() const
 {
 	std::vector<int> ids;
@@ -158,4 +332,14 @@ Ogre::Quaternion TrackingSystem::getOrientation() const
 bool TrackingSystem::isPoseComputed() const
 {
 	return mPoseComputed;
+}
+
+bool TrackingSystem::isPoseRefinedWithDepth() const
+{
+	return mPoseRefined;
+}
+
+const DepthPlane& TrackingSystem::getDepthPlane() const
+{
+	return mDepthPlane;
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef KINECTFRAMES
+#define KINECTFRAMES
+#include <stddef.h>
+#include <stdint.h>
+#include "Kinect-win32.h"
+
+// Frame assembly of the camera streams, apart from USB so it can be fed from a capture as well.
+
+namespace Kinect
+{
+	struct frame_hdr {
+		uint8_t magic[2];
+		uint8_t pad;
+		uint8_t flag;
+		uint8_t unk1;
+		uint8_t seq;
+		uint8_t unk2;
+		uint8_t unk3;
+		uint32_t timestamp;
+	};
+
+	struct KinectFrameInfo
+	{
+		KinectFrameStats Stats;
+		uint8_t RowValid[KINECT_DEPTH_HEIGHT];
+	};
+
+	// Three frame buffers of one stream. The event thread assembles a frame in the back buffer and
+	// publishes it with one atomic exchange, the reader swaps the latest published buffer for the
+	// one it had. Neither side waits for the other and frames are never copied. One reader per pool.
+	class KinectFramePool
+	{
+	public:
+		KinectFramePool(int Size);
+		~KinectFramePool();
+
+		enum { FRESH = 4 };
+
+		uint8_t *Back(){return mBuffers[mBack];};
+		KinectFrameInfo *BackInfo(){return &mInfo[mBack];};
+		// the frame published last, NULL before the first one. Only for the event thread: the
+		// reader may hold it, but nobody writes it until the next Publish.
+		uint8_t *Last(){return mLast<0?NULL:mBuffers[mLast];};
+		void Publish();
+		// latest published frame, valid until the next call. NULL before the first frame.
+		uint8_t *Acquire();
+		KinectFrameInfo *FrontInfo(){return &mInfo[mFront];};
+
+		uint8_t *mBuffers[3];
+		KinectFrameInfo mInfo[3];
+		int mBack;
+		int mLast;
+		int mFront;
+		bool mHaveFront;
+		// index of the published buffer, | FRESH until the reader takes it
+		volatile long mPublished;
+	};
+
+	// Puts the iso packets of one stream in place by their sequence number, so a lost packet
+	// leaves a hole instead of shifting the rest of the frame. The holes are filled with the rows
+	// of the frame before and the frame is published with its row mask and loss counters.
+	class KinectFrameAssembler
+	{
+	public:
+		KinectFrameAssembler(KinectFramePool *Pool, uint8_t FlagStart, int FrameSize, int PayloadSize, int RowBytes, int Rows);
+
+		// true when the packet completed a frame
+		bool Process(uint8_t *buf, size_t len);
+
+		bool IsReceived(int Index){return (mReceived[Index>>5] & (1u<<(Index&31))) != 0;};
+
+		KinectFramePool *mPool;
+		uint8_t mFlagStart, mFlagMiddle, mFlagEnd;
+		int mFrameSize;
+		int mPayloadSize;
+		int mRowBytes;
+		int mRows;
+		int mPacketsPerFrame;
+
+		bool mInFrame;
+		bool mHaveSeq;
+		uint8_t mSeqInit;
+		// one bit per packet of the frame, the sequence number wraps at 256
+		uint32_t mReceived[256/32];
+		int mReceivedCount;
+
+		KinectFrameStats mStats;
+
+	private:
+		void Begin(uint8_t SeqInit);
+		bool Finish();
+	};
+};
+#endif
@@ -0,0 +1,114 @@
+#ifndef KINECTTHREAD
+#define KINECTTHREAD
+
+// The few threading primitives the driver needs, on Win32 threads or pthreads.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace Kinect
+{
+#ifdef _WIN32
+	typedef CRITICAL_SECTION KinectLock;
+	typedef HANDLE KinectThread;
+	#define KINECT_THREAD_PROC DWORD WINAPI
+	#define KINECT_THREAD_RETURN return 0
+	typedef DWORD (WINAPI *KinectThreadProc)(void *);
+#else
+	typedef pthread_mutex_t KinectLock;
+	typedef pthread_t KinectThread;
+	#define KINECT_THREAD_PROC void *
+	#define KINECT_THREAD_RETURN return NULL
+	typedef void *(*KinectThreadProc)(void *);
+#endif
+
+	inline void KinectLockInit(KinectLock *L)
+	{
+#ifdef _WIN32
+		InitializeCriticalSection(L);
+#else
+		pthread_mutex_init(L, NULL);
+#endif
+	};
+
+	inline void KinectLockDestroy(KinectLock *L)
+	{
+#ifdef _WIN32
+		DeleteCriticalSection(L);
+#else
+		pthread_mutex_destroy(L);
+#endif
+	};
+
+	inline void KinectLockEnter(KinectLock *L)
+	{
+#ifdef _WIN32
+		EnterCriticalSection(L);
+#else
+		pthread_mutex_lock(L);
+#endif
+	};
+
+	inline void KinectLockLeave(KinectLock *L)
+	{
+#ifdef _WIN32
+		LeaveCriticalSection(L);
+#else
+		pthread_mutex_unlock(L);
+#endif
+	};
+
+	inline bool KinectThreadStart(KinectThread *T, KinectThreadProc Proc, void *Param)
+	{
+#ifdef _WIN32
+		*T = CreateThread(NULL, 0, Proc, Param, 0, NULL);
+		return *T != NULL;
+#else
+		return pthread_create(T, NULL, Proc, Param) == 0;
+#endif
+	};
+
+	inline void KinectThreadJoin(KinectThread T)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(T, INFINITE);
+		CloseHandle(T);
+#else
+		pthread_join(T, NULL);
+#endif
+	};
+
+	// Full barrier exchange, what one thread stores before it is seen by the thread that swaps the value out.
+	inline long KinectAtomicExchange(volatile long *Target, long Value)
+	{
+#ifdef _WIN32
+		return InterlockedExchange(Target, Value);
+#else
+		return __atomic_exchange_n(Target, Value, __ATOMIC_ACQ_REL);
+#endif
+	};
+
+	inline long KinectAtomicLoad(volatile long *Target)
+	{
+#ifdef _WIN32
+		return InterlockedCompareExchange(Target, 0, 0);
+#else
+		return __atomic_load_n(Target, __ATOMIC_ACQUIRE);
+#endif
+	};
+
+	inline void KinectSleep(int Milliseconds)
+	{
+#ifdef _WIN32
+		Sleep(Milliseconds);
+#else
+		usleep(Milliseconds * 1000);
+#endif
+	};
+};
+
+#endif
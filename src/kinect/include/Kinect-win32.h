@@ -2,7 +2,7 @@
 #define KINECTWIN32
 
 #include <vector>
-#include <windows.h>
+#include "Kinect-thread.h"
 
 namespace Kinect
 {
@@ -30,6 +30,18 @@ namespace Kinect
         Led_AlternateRedGreen = 0x7
 	};
 
+	// Packet loss of one stream. The counters run from the start of the streams, LostPackets and
+	// RepairedRows are those of the parsed frame.
+	struct KinectFrameStats
+	{
+		unsigned int FramesComplete;
+		unsigned int FramesRepaired;	// delivered with rows taken from the frame before
+		unsigned int FramesDropped;		// lost whole, or no start of frame seen yet
+		unsigned int PacketsLost;
+		unsigned int LostPackets;
+		unsigned int RepairedRows;
+	};
+
 	class KinectListener
 	{
 	public:
@@ -43,7 +55,7 @@ namespace Kinect
 	class Kinect
 	{
 	public:
-		Kinect(void *internalhandle, void *internalmotorhandle);  // takes usb handle.. never explicitly construct! use kinectfinder!
+		Kinect(void *internalhandle, void *internalmotorhandle, void *internalcontext);  // takes usb handle.. never explicitly construct! use kinectfinder!
 		virtual ~Kinect();
 		bool Opened();
 		void SetMotorPosition(double pos);
@@ -57,10 +69,16 @@ namespace Kinect
 		unsigned short mDepthBuffer[KINECT_DEPTH_WIDTH * KINECT_DEPTH_HEIGHT];
 		unsigned char mColorBuffer[KINECT_COLOR_WIDTH * KINECT_COLOR_HEIGHT * 3];
 		float mAudioBuffer[KINECT_MICROPHONE_COUNT][KINECT_AUDIO_BUFFER_LENGTH];
+
+		// filled by ParseDepthBuffer/ParseColorBuffer: 1 for rows that arrived, 0 for rows repaired from the frame before
+		unsigned char mDepthRowValid[KINECT_DEPTH_HEIGHT];
+		unsigned char mColorRowValid[KINECT_COLOR_HEIGHT];
+		KinectFrameStats mDepthStats;
+		KinectFrameStats mColorStats;
 		
 		std::vector<KinectListener *> mListeners;
 		
-		CRITICAL_SECTION mListenersLock;
+		KinectLock mListenersLock;
 		
 		void *mInternalData;
 
@@ -84,6 +102,8 @@ namespace Kinect
 		Kinect *GetKinect(int index = 0);
 
 		std::vector<Kinect *> mKinects;
+
+		void *mInternalData;
 	};
 };
 
@@ -25,398 +25,177 @@
  * either License.
  */
 
-#include <conio.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
 
 #include "Kinect-win32.h"
 #include "Kinect-win32-internal.h"
 
-#define DORGB 1
-#define DODEPTH 1
-
 namespace Kinect
 {
 	#include "init.h"
 
-	DWORD WINAPI DepthThread( LPVOID lpParam ) 
-	{ 
-		KinectInternalData *KID  = (KinectInternalData*) lpParam;
-		if (DODEPTH)
-		{
-		}
-		else
-		{
-			return 0;
-		};
-
-		KID->LockRGBThread();
-		
-		for (int i=0; i<DEPTH_NUM_XFERS; i++) 
+	void LIBUSB_CALL KinectInternalData::DepthTransferCallback(libusb_transfer *xfer)
+	{
+		KinectInternalData *KID = (KinectInternalData*) xfer->user_data;
+		if (xfer->status == LIBUSB_TRANSFER_COMPLETED)
 		{
-			int ret;
-			if (DODEPTH)
+			// every iso packet has its own length, they are handed on as they came in
+			for (int i=0; i<xfer->num_iso_packets; i++)
 			{
-				KID->depth_xfers[i] = 0;
-				ret = usb_isochronous_setup_async(KID->mDeviceHandle, &KID->depth_xfers[i], 0x82, 1760);
-				if (ret<0) 
+				libusb_iso_packet_descriptor *pkt = &xfer->iso_packet_desc[i];
+				if (pkt->status == LIBUSB_TRANSFER_COMPLETED && pkt->actual_length > 0)
 				{
-					printf("error setting up isochronous request for depth_xfer[%d]!", i);	
-					KID->mErrorCount++;
+					KID->depth_process(libusb_get_iso_packet_buffer_simple(xfer, i), pkt->actual_length);
 				};
 			};
-		}
-
+		};
+		KID->TransferDone(xfer);
+	};
 
-		for (int i=0; i<DEPTH_NUM_XFERS; i++) 
+	void LIBUSB_CALL KinectInternalData::RGBTransferCallback(libusb_transfer *xfer)
+	{
+		KinectInternalData *KID = (KinectInternalData*) xfer->user_data;
+		if (xfer->status == LIBUSB_TRANSFER_COMPLETED)
 		{
-			int ret;
-			if (DODEPTH)
+			for (int i=0; i<xfer->num_iso_packets; i++)
 			{
-				ZeroMemory(KID->depth_bufs[i], DEPTH_XFER_SIZE);
-				ret = usb_submit_async(KID->depth_xfers[i], (char*)KID->depth_bufs[i], DEPTH_XFER_SIZE);
-				if (ret<0)
+				libusb_iso_packet_descriptor *pkt = &xfer->iso_packet_desc[i];
+				if (pkt->status == LIBUSB_TRANSFER_COMPLETED && pkt->actual_length > 0)
 				{
-					printf("error submitting request!");
-					KID->mErrorCount++;
+					KID->rgb_process(libusb_get_iso_packet_buffer_simple(xfer, i), pkt->actual_length);
 				};
 			};
-		}
-		while (KID->Running)
-		{
-			int loopcount = 0;
-			while (	KID->depth_read() && loopcount++ < 20);
-			//if(loopcount == 20) printf("too much depth");
-			Sleep(1);
-
 		};
-		KID->UnlockRGBThread();
-		
-		return 0;
+		KID->TransferDone(xfer);
 	};
 
-
-	DWORD WINAPI RGBThread( LPVOID lpParam ) 
-	{ 
-		KinectInternalData *KID  = (KinectInternalData*) lpParam;
-		KID->LockDepthThread();
-		
-		for (int i=0; i<RGB_NUM_XFERS; i++) 
+	void KinectInternalData::TransferDone(libusb_transfer *xfer)
+	{
+		if (xfer->status == LIBUSB_TRANSFER_NO_DEVICE)
 		{
-			int ret;
-			if (DORGB)
-			{
-				KID->rgb_xfers[i] = 0;
-				ret = usb_isochronous_setup_async(KID->mDeviceHandle, &KID->rgb_xfers[i], 0x81, RGB_PKT_SIZE);
-				if (ret<0)
-				{
-					printf("error setting up isochronous request for rgb_xfer[%d]!", i);
-					KID->mErrorCount++;
-				}
-			};
-		};
+			KinectLockEnter(&stream_lock);
+			bool notify = !Disconnected;
+			Disconnected = true;
+			Running = false;
+			ActiveTransfers--;
+			KinectLockLeave(&stream_lock);
 
-		for (int i=0; i<RGB_NUM_XFERS; i++) 
-		{
-			int ret;
-			if (DORGB)
+			if (notify)
 			{
-				ZeroMemory(&KID->rgb_bufs[i][0], RGB_XFER_SIZE);
-				ret = usb_submit_async(KID->rgb_xfers[i], (char*)&KID->rgb_bufs[i][0], RGB_XFER_SIZE);
-				if (ret<0)
-				{
-					printf("error submitting request!");
-					KID->mErrorCount++;
-				};
+				mParent->KinectDisconnected();
 			};
+			return;
 		};
 
-		while (KID->Running)
+		// the packets of the buffer are overwritten by the next completion, there is nothing to clear
+		KinectLockEnter(&stream_lock);
+		bool resubmit = Running && xfer->status != LIBUSB_TRANSFER_CANCELLED;
+		if (!resubmit || !SubmitTransfer(xfer))
 		{
-			int loopcount = 0;
-			while (	KID->rgb_read() && loopcount++ < 20);
-			//if(loopcount == 20) printf("too much rgb");
-			Sleep(0);
+			ActiveTransfers--;
 		};
-		KID->UnlockDepthThread();
-		
-		return 0;
+		KinectLockLeave(&stream_lock);
 	};
 
-	void  KinectInternalData::depth_process(uint8_t *buf, size_t len)
+	bool KinectInternalData::SubmitTransfer(libusb_transfer *xfer)
 	{
-		if (len < sizeof(frame_hdr))
+		int ret = libusb_submit_transfer(xfer);
+		if (ret < 0)
 		{
-			return;
+			printf("error submitting iso transfer on endpoint %02x: %s\n", xfer->endpoint, libusb_error_name(ret));
+			mErrorCount++;
+			return false;
 		};
+		return true;
+	};
 
-		frame_hdr *hdr = (frame_hdr *)buf;
-		uint8_t *data = buf + sizeof(frame_hdr);
-		int datalen = len - sizeof(frame_hdr);
-
-		if (!(hdr->magic[0] == 0x52 && hdr->magic[1] == 0x42))
+	bool KinectInternalData::StartStreams()
+	{
+		for (int i=0; i<DEPTH_NUM_XFERS; i++)
 		{
-			return;
+			depth_xfers[i] = libusb_alloc_transfer(DEPTH_PKTS_PER_XFER);
+			libusb_fill_iso_transfer(depth_xfers[i], mDeviceHandle, DEPTH_ENDPOINT, depth_bufs[i], DEPTH_XFER_SIZE, DEPTH_PKTS_PER_XFER, DepthTransferCallback, this, 0);
+			libusb_set_iso_packet_lengths(depth_xfers[i], DEPTH_PKT_SIZE);
 		};
 
-		switch (hdr->flag) 
-		{
-		case 0x71:
-			depth_pos = 0;
-			DepthPacketCount = 0;
-			depth_seq_init = hdr->seq;
-		case 0x72:
-		case 0x75:
-			{
-				unsigned char pos = hdr->seq - depth_seq_init;			
-				memcpy(&depth_sourcebuf[depth_pos], data, __min(datalen, 1760-sizeof(frame_hdr)));
-				depth_pos+=datalen;
-				DepthPacketCount++;
-			}
-			break;
-		}
-
-		unsigned char newint = depth_seq + 1;
-		if (newint != hdr->seq)
-		{
-			printf("seq lost! %02x %02x \n", newint, hdr->seq);
-			depth_seq = hdr->seq;
-			//return 1760;
-		}
-		else
+		for (int i=0; i<RGB_NUM_XFERS; i++)
 		{
-			//printf("in seq! %02x\n", newint);
+			rgb_xfers[i] = libusb_alloc_transfer(RGB_PKTS_PER_XFER);
+			libusb_fill_iso_transfer(rgb_xfers[i], mDeviceHandle, RGB_ENDPOINT, rgb_bufs[i], RGB_XFER_SIZE, RGB_PKTS_PER_XFER, RGBTransferCallback, this, 0);
+			libusb_set_iso_packet_lengths(rgb_xfers[i], RGB_PKT_SIZE);
 		};
 
-		depth_seq = hdr->seq;
-		//if (depth_pos < 640*480*2) return 1760;
-
-		if (hdr->flag != 0x75) return;
-
-//		printf("packetcount: %d\n",packetcount);
-		if (DepthPacketCount == 0xf2)
-		{
-			LockDepth();
-			memcpy(depth_sourcebuf2, depth_sourcebuf, 640*480*2);
-			UnlockDepth();
-		
-			mParent->DepthReceived();
-		}
-		else
+		KinectLockEnter(&stream_lock);
+		Running = true;
+		for (int i=0; i<DEPTH_NUM_XFERS; i++)
 		{
-			printf("depth frame dropped - too incomplete!\n");
+			if (SubmitTransfer(depth_xfers[i])) ActiveTransfers++;
 		};
-		return;	
-	}
-
-	void KinectInternalData::rgb_process(uint8_t *buf, size_t len)
-	{	
-		if (len < sizeof(frame_hdr)) return;
-		
-		frame_hdr *hdr = (frame_hdr *)buf;
-		uint8_t *data = buf + sizeof(frame_hdr);
-		int datalen = len - sizeof(frame_hdr);
-
-		if (!(hdr->magic[0] == 0x52 && hdr->magic[1] == 0x42))
+		for (int i=0; i<RGB_NUM_XFERS; i++)
 		{
-		 return;
-		}
-
-		switch (hdr->flag) 
-		{
-		case 0x81:
-			rgb_pos = 0;
-			RGBPacketCount = 0;
-		case 0x82:
-		case 0x85:
-			memcpy(&rgb_buf[rgb_pos], data, datalen);
-			rgb_pos += datalen;
-			RGBPacketCount++;
-			break;
-		}
-
-		if (hdr->flag != 0x85)
-			return;
-		if (RGBPacketCount > 0xa1)
-		{
-			//printf("GOT RGB FRAME, %d bytes\n", rgb_pos);
-			
-			LockRGB();
-			memcpy(rgb_buf2,rgb_buf, 640*480*3);
-			UnlockRGB();
-
-			mParent->ColorReceived();
-		}
-		else
-		{
-			printf("rgb frame dropped - too incomplete!\n");
-		}
-	}
-
-
+			if (SubmitTransfer(rgb_xfers[i])) ActiveTransfers++;
+		};
+		bool started = ActiveTransfers > 0;
+		KinectLockLeave(&stream_lock);
 
-//	static int depthcount = 0;
-//	static int depthbytes = 0;
-//	static int rgbcount = 0;
-//	static int rgbbytes = 0;
+		return started;
+	};
 
-	int KinectInternalData::depth_read()
+	void KinectInternalData::StopStreams()
 	{
-		int i = 1;
-		int retval = 0;
-		i = usb_reap_async_nocancel(depth_xfers[mCurrentDepthContext], 10000);
-		if (i>0)
-		{
-			retval = i;
-			int off = 0;
-			int P = DEPTH_PKT_SIZE;
-			i = DEPTH_XFER_SIZE;
-			while (i >0)
-			{
-				int len = __min(i,P);
-				depth_process(&depth_bufs[mCurrentDepthContext][off], DEPTH_PKT_SIZE);
-				int used = DEPTH_PKT_SIZE;
-				off += used;
-				i-= used;
-			};
-			if (i > 0)
-			{
-				printf("%d bytes in last packet\n", P- -i);
-			}
-		} 
-		else
+		KinectLockEnter(&stream_lock);
+		Running = false;
+		if (ActiveTransfers > 0)
 		{
-			if (i<0)
-			{
-				if (i == -116 )
-				{
-					// timeout = not ready yet!
-					return 0;
-				}
-				printf("rgb code %d...\n",i);
-				usb_cancel_async(depth_xfers[mCurrentDepthContext]);
-			}
-			else
+			for (int i=0; i<DEPTH_NUM_XFERS; i++) if (depth_xfers[i]) libusb_cancel_transfer(depth_xfers[i]);
+			for (int i=0; i<RGB_NUM_XFERS; i++) if (rgb_xfers[i]) libusb_cancel_transfer(rgb_xfers[i]);
+		};
+		KinectLockLeave(&stream_lock);
+
+		// The cancelled transfers still write to the buffers of this object and call back into it.
+		// Run the event loop here as well until the last of them is back, so they drain even when
+		// the event thread is gone.
+		timeval tv = {0, 100000};
+		for (;;)
+		{
+			KinectLockEnter(&stream_lock);
+			int active = ActiveTransfers;
+			KinectLockLeave(&stream_lock);
+			if (active <= 0)
 			{
-				//	printf(",");
+				break;
 			};
+			libusb_handle_events_timeout_completed(mContext, &tv, NULL);
 		};
-		ZeroMemory(depth_bufs[mCurrentDepthContext], DEPTH_XFER_SIZE);
-		int ret = usb_submit_async(depth_xfers[mCurrentDepthContext], (char*)depth_bufs[mCurrentDepthContext],  DEPTH_XFER_SIZE);
-		if( ret < 0 )
-		{
-			printf("error: %s\n", usb_strerror());
-			usb_cancel_async(depth_xfers[mCurrentDepthContext]);
-		}
-		mCurrentDepthContext = (mCurrentDepthContext + 1) % DEPTH_NUM_XFERS;
-		return retval;
-	}
 
-	void KinectInternalData::ReadBoth()
-	{
-		int retbytes = 1;
-		int loopcount = 0;
-		while (retbytes >0 && loopcount<20)
+		for (int i=0; i<DEPTH_NUM_XFERS; i++)
+		{
+			if (depth_xfers[i]) libusb_free_transfer(depth_xfers[i]);
+			depth_xfers[i] = NULL;
+		};
+		for (int i=0; i<RGB_NUM_XFERS; i++)
 		{
-			retbytes = 0;
-			if (DORGB) retbytes += rgb_read();
-			if (DODEPTH) retbytes += depth_read();
-			loopcount++;
+			if (rgb_xfers[i]) libusb_free_transfer(rgb_xfers[i]);
+			rgb_xfers[i] = NULL;
 		};
-		if (loopcount == 20) printf("too many pending reads.. breaking out\n");
 	};
 
-	int KinectInternalData::rgb_read()
+	void KinectInternalData::depth_process(uint8_t *buf, size_t len)
 	{
-		int i = 1;
-		int retval = 0;
-		i = usb_reap_async_nocancel(rgb_xfers[mCurrentRGBContext], 10000);
-		if (i>0)
+		if (depth_assembler.Process(buf, len))
 		{
-			retval = i;
-			//rgbcount++ ;
-			//rgbbytes+=i;
-			//if (rgbcount%200== 0) printf("rgbbytes: %.3fMiB\n", (rgbbytes/1024.0)/1024.0);
-			int off = 0;
-			int P = RGB_PKT_SIZE;
-			i = RGB_XFER_SIZE;
-			int j = 0;
-			bool magicfound = false;
-			while (j<32 && magicfound == false)
-			{
-				if (rgb_bufs[mCurrentRGBContext][(j*RGB_PKT_SIZE)]  == 'R'
-					&& rgb_bufs[mCurrentRGBContext][(j*RGB_PKT_SIZE) +1] == 'B')
-				{
-					magicfound = true;
-				}
-				else
-				{
-					j++;
-				}
-				
-			}
-			
-			if (j>0)
-			{
-				off = j*RGB_PKT_SIZE;
-				i-=off;
-				//printf("skipped %d rgb packets in context %d!\n",j, mCurrentRGBContext);
-			};
-			int used = 0;
-			while (i >0)
-			{
-				int len = __min(i,P);
-				if (i<RGB_PKT_SIZE)
-				{
-					if (i == 960)
-					{
-					//	printf("last packet is halve!");
-						if (rgb_bufs[mCurrentRGBContext][off]  == 'R'
-					&& rgb_bufs[mCurrentRGBContext][off +1] == 'B')
-						{
-							printf ("valid halve packet found!\n");
-						}
-					};
-				}
+			mParent->DepthReceived();
+		};
+	}
 
-				if (rgb_bufs[mCurrentRGBContext][off]  == 'R' && rgb_bufs[mCurrentRGBContext][off +1] == 'B')
-				{
-					rgb_process(&rgb_bufs[mCurrentRGBContext][off], __min(i,RGB_PKT_SIZE));
-					used = __min(i,RGB_PKT_SIZE);
-				}
-				else
-				{
-					used = 960;
-				};
-				off += used;
-				i-= used;
-			};			
-		} 
-		else
+	void KinectInternalData::rgb_process(uint8_t *buf, size_t len)
+	{
+		if (rgb_assembler.Process(buf, len))
 		{
-			if (i<0)
-			{
-				if (i == -116 )
-				{
-					// timeout = not ready yet!
-					return 0;
-				}
-				//printf("rgb code %d...\n",i);
-				usb_cancel_async(rgb_xfers[mCurrentRGBContext]);
-			}
-			else
-			{
-				//	printf(",");
-			};
+			mParent->ColorReceived();
 		};
-		ZeroMemory(&rgb_bufs[mCurrentRGBContext][0], RGB_XFER_SIZE*2);
-		int ret = usb_submit_async(rgb_xfers[mCurrentRGBContext], (char*)&rgb_bufs[mCurrentRGBContext][0],  RGB_XFER_SIZE);
-		if( ret < 0 )
-		{
-			printf("error: %s\n", usb_strerror());
-			usb_cancel_async(rgb_xfers[mCurrentRGBContext]);
-		}
-		mCurrentRGBContext = (mCurrentRGBContext + 1) % RGB_NUM_XFERS;
-		return retval;
-
 	}
 
 	struct cam_hdr {
@@ -432,14 +211,14 @@ namespace Kinect
 		int i, j, ret;
 		uint8_t obuf[0x2000];
 		uint8_t ibuf[0x2000];
-		ZeroMemory(obuf, 0x2000);
-		ZeroMemory(ibuf, 0x2000);
+		memset(obuf, 0, 0x2000);
+		memset(ibuf, 0, 0x2000);
 		
 		cam_hdr *chdr = (cam_hdr *)obuf;
 		cam_hdr *rhdr = (cam_hdr *)ibuf;		
 		ret = 0;	
 		
-		ret = usb_control_msg(mDeviceHandle, 0x80, 0x06, 0x3ee, 0, (char*)ibuf, 0x12, 500);
+		ret = libusb_control_transfer(mDeviceHandle, 0x80, 0x06, 0x3ee, 0, ibuf, 0x12, 500);
 		if (ret <0)
 		{
 			//	this call is expected to stall!
@@ -451,7 +230,7 @@ namespace Kinect
 
 //	Addition by maa nov 16th 2010
 //	This table keeps track of which init codes need extra sleep time
-		CONST int bs = 1;
+		const int bs = 1;
 		int sleep[num_inits*2] =
 		{
 			0,0,	//1
@@ -488,7 +267,7 @@ namespace Kinect
 		{
 			if( sleep[2*i]!=0 )
 			{
-				Sleep(sleep[2*i]);	//maa
+				KinectSleep(sleep[2*i]);	//maa
 			};
 
 			//Sleep(100);
@@ -498,10 +277,10 @@ namespace Kinect
 			chdr->tag = ip->tag;
 			chdr->len = ip->cmdlen / 2;
 			memcpy(obuf+sizeof(cam_hdr), ip->cmddata, ip->cmdlen);
-			ret = usb_control_msg(mDeviceHandle, 0x40, 0, 0, 0, (char*)obuf, ip->cmdlen + sizeof(cam_hdr), 1600);
+			ret = libusb_control_transfer(mDeviceHandle, 0x40, 0, 0, 0, obuf, ip->cmdlen + sizeof(cam_hdr), 1600);
 			if (ret <0)
 			{
-				printf("error: %s\n", usb_strerror());
+				printf("error: %s\n", libusb_error_name(ret));
 				//return;
 			}
 			printf("sending init %d from %d... ", i+1, num_inits);
@@ -510,13 +289,13 @@ namespace Kinect
 			{
 				if( sleep[2*i+1]!=0 )
 				{
-					Sleep(sleep[2*i+1]);	//maa
+					KinectSleep(sleep[2*i+1]);	//maa
 				}
 
-				ret = usb_control_msg(mDeviceHandle, 0xc0, 0, 0, 0, (char*)ibuf, 0x200, 1600);
+				ret = libusb_control_transfer(mDeviceHandle, 0xc0, 0, 0, 0, ibuf, 0x200, 1600);
 				if (ret<0)
 				{
-					printf("error: %s\n", usb_strerror());				
+					printf("error: %s\n", libusb_error_name(ret));				
 				}
 
 			} while (ret == 0);
@@ -563,87 +342,87 @@ namespace Kinect
 	}
 
 	void KinectInternalData::cams_init()
-	{		
+	{
 		send_init();
-		RunThread();
+		if (!StartStreams())
+		{
+			printf("could not start the depth and rgb streams\n");
+		};
 	}
 
 	KinectInternalData::~KinectInternalData()
 	{
 		if (mDeviceHandle)
 		{
+			StopStreams();
 			if (mDeviceHandle_Motor)
 			{
-				usb_close(mDeviceHandle_Motor);
+				libusb_close(mDeviceHandle_Motor);
 				mDeviceHandle_Motor = NULL;
 			};
-			if (mDeviceHandle_Audio)
+
+			KinectLockEnter(&stream_lock);
+			bool notify = !Disconnected;
+			Disconnected = true;
+			KinectLockLeave(&stream_lock);
+			if (notify)
 			{
-				usb_close(mDeviceHandle_Audio);
-				mDeviceHandle_Motor = NULL;
+				libusb_reset_device(mDeviceHandle);
+				mParent->KinectDisconnected();
 			};
-			Running = false;
-			LockDepthThread();
-			UnlockDepthThread();
-			LockRGBThread();
-			UnlockRGBThread();
-			usb_reset(mDeviceHandle);
-			mParent->KinectDisconnected();
-			usb_close(mDeviceHandle);
-		};
-	};
-
 
-
-	void KinectInternalData::RunThread()
-	{
-		DWORD did, rid ;
-		if (DODEPTH)
-		{
-			HANDLE depththread = CreateThread(NULL,0,DepthThread,this,0,&did);   
-			SetThreadPriority(depththread, THREAD_PRIORITY_TIME_CRITICAL);
-		};
-		if (DORGB)
-		{
-			HANDLE rgbthread = CreateThread(NULL,0,RGBThread,this,0,&rid);   
-			SetThreadPriority(rgbthread, THREAD_PRIORITY_TIME_CRITICAL);
+			libusb_release_interface(mDeviceHandle, 0);
+			libusb_close(mDeviceHandle);
+			mDeviceHandle = NULL;
 		};
-		//		return;
 
-		
-		ThreadDone = true;
+		KinectLockDestroy(&stream_lock);
+
+		delete [] depth_frame;
+		delete [] depth_frame_color;
+		delete [] (rgb_frame - 1000);
 	};
 
 
-	void KinectInternalData::OpenDevice(usb_device_t *dev, usb_device_t *motordev)
+	void KinectInternalData::OpenDevice(libusb_context *context, libusb_device *dev, libusb_device *motordev)
 	{
-		mDeviceHandle = usb_open(dev);
-		if (!mDeviceHandle) 
-		{				
+		mContext = context;
+		int ret = libusb_open(dev, &mDeviceHandle);
+		if (ret<0)
+		{
+			mDeviceHandle = NULL;
 			return;
 		}
 
-		//mDeviceHandle_Motor  = NULL;
-		mDeviceHandle_Motor = usb_open(motordev); // dont check for null... just dont move when asked and the pointer is null
-		
-		int ret;
-		ret = usb_set_configuration(mDeviceHandle, 1);
+		// dont check for errors... just dont move when asked and the handle is null
+		if (!motordev || libusb_open(motordev, &mDeviceHandle_Motor) < 0)
+		{
+			mDeviceHandle_Motor = NULL;
+		};
+
+		// on Linux the gspca kinect driver may hold the camera
+		if (libusb_kernel_driver_active(mDeviceHandle, 0) == 1)
+		{
+			libusb_detach_kernel_driver(mDeviceHandle, 0);
+		};
+
+		ret = libusb_set_configuration(mDeviceHandle, 1);
 		if (ret<0)
 		{
-			printf("usb_set_configuration error: %s\n", usb_strerror());
+			printf("libusb_set_configuration error: %s\n", libusb_error_name(ret));
 			//return;
 		}
 
-		ret = usb_claim_interface(mDeviceHandle, 0);
-		ret = usb_set_configuration(mDeviceHandle, 1);
-
+		ret = libusb_claim_interface(mDeviceHandle, 0);
 		if (ret<0)
 		{
-			printf("usb_claim_interface error: %s\n", usb_strerror());
+			printf("libusb_claim_interface error: %s\n", libusb_error_name(ret));
+			libusb_close(mDeviceHandle);
+			mDeviceHandle = NULL;
 			return;
 		}
 
-		usb_clear_halt(mDeviceHandle, 0x81);usb_clear_halt(mDeviceHandle, 0x82);
+		libusb_clear_halt(mDeviceHandle, RGB_ENDPOINT);libusb_clear_halt(mDeviceHandle, DEPTH_ENDPOINT);
 		cams_init();
 	};
 
@@ -661,7 +440,7 @@ namespace Kinect
 //		cam_hdr *rhdr = (cam_hdr *)ibuf;		
 //		ret = 0;	
 		
-			usb_control_msg(mDeviceHandle_Motor, 0x40, 0x31, value, 0, NULL, 0, 160);
+			libusb_control_transfer(mDeviceHandle_Motor, 0x40, 0x31, value, 0, NULL, 0, 160);
 		
 		};
 	};
@@ -670,7 +449,7 @@ namespace Kinect
 	{
 		if (mDeviceHandle_Motor)
 		{			
-            usb_control_msg(mDeviceHandle_Motor, 0x40, 0x06, NewMode, 0, NULL, 0, 160);
+            libusb_control_transfer(mDeviceHandle_Motor, 0x40, 0x06, NewMode, 0, NULL, 0, 160);
 		};
 	};
 
@@ -679,7 +458,7 @@ namespace Kinect
 		if (mDeviceHandle_Motor)
 		{
 			unsigned char outbuf[10];
-			if (usb_control_msg(mDeviceHandle_Motor, 0xC0, 0x32, 0, 0, (char*)outbuf, 10, 1000)>0)
+			if (libusb_control_transfer(mDeviceHandle_Motor, 0xC0, 0x32, 0, 0, outbuf, 10, 1000)>0)
 			{
 				short ix = *(short*)(&outbuf[2]);
 				short iy = *(short*)(&outbuf[4]);
@@ -695,40 +474,104 @@ namespace Kinect
 	};
 
 	KinectInternalData::KinectInternalData(Kinect *inParent)
+		: depth_frames(1000*1000*3), rgb_frames(1000*1000*3),
+		// 11 bit depth and 8 bit bayer, behind the 12 byte header of each packet
+		depth_assembler(&depth_frames, 0x71, 640*480*11/8, DEPTH_PKT_SIZE-sizeof(frame_hdr), 640*11/8, 480),
+		rgb_assembler(&rgb_frames, 0x81, 640*480, RGB_PKT_SIZE-sizeof(frame_hdr), 640, 480)
 	{
 		mParent = inParent;
-		depth_pos = 0;
-		rgb_pos = 0;
+		mContext = NULL;
 		mDeviceHandle = NULL;
-		mDeviceHandle_Audio = NULL;
 		mDeviceHandle_Motor = NULL;
-		mCurrentDepthContext = 0;
-		mCurrentRGBContext = 0;
 		mErrorCount = 0;
 
-		ThreadDone = false;
-		Running = true;
-//			depth_leftoverbytes= 0;
-
-		DepthPacketCount = 0;
-		RGBPacketCount = 0;
+		Running = false;
+		ActiveTransfers = 0;
+		Disconnected = false;
 
+		for (int i=0; i<DEPTH_NUM_XFERS; i++) depth_xfers[i] = NULL;
+		for (int i=0; i<RGB_NUM_XFERS; i++) rgb_xfers[i] = NULL;
 
-		depth_sourcebuf = new uint8_t[1000*1000*3];
-		depth_sourcebuf2 = new uint8_t[1000*1000*3];
 		depth_frame = new uint16_t[1000*1000*3];
 		depth_frame_color = new uint8_t[1000*1000*3];
 
-		rgb_buf= new uint8_t[1000*1000*3];
 		rgb_frame= new uint8_t[1000*1000*3];
-		rgb_buf2= new uint8_t[1000*1000*3];
 
 		rgb_frame+=1000;
 		//rgb_frame2+=1000;
 
-		InitializeCriticalSection(&depth_lock);
-		InitializeCriticalSection(&rgb_lock);
-		InitializeCriticalSection(&depththread_lock);
-		InitializeCriticalSection(&rgbthread_lock);
+		KinectLockInit(&stream_lock);
 	}
+
+	KinectFinderInternalData::KinectFinderInternalData()
+	{
+		mContext = NULL;
+		mEventThreadStarted = false;
+		mRunning = false;
+		KinectLockInit(&mLock);
+
+		int ret = libusb_init(&mContext);
+		if (ret<0)
+		{
+			printf("libusb_init error: %s\n", libusb_error_name(ret));
+			mContext = NULL;
+		};
+	};
+
+	KinectFinderInternalData::~KinectFinderInternalData()
+	{
+		StopEventThread();
+		if (mContext)
+		{
+			libusb_exit(mContext);
+			mContext = NULL;
+		};
+		KinectLockDestroy(&mLock);
+	};
+
+	static KINECT_THREAD_PROC EventThread(void *param)
+	{
+		KinectFinderInternalData *FID = (KinectFinderInternalData*) param;
+		// the timeout only bounds how late a stop request is noticed, completions wake the thread right away
+		timeval tv = {0, 100000};
+		while (FID->EventThreadRunning())
+		{
+			libusb_handle_events_timeout_completed(FID->mContext, &tv, NULL);
+		};
+		KINECT_THREAD_RETURN;
+	};
+
+	bool KinectFinderInternalData::EventThreadRunning()
+	{
+		KinectLockEnter(&mLock);
+		bool running = mRunning;
+		KinectLockLeave(&mLock);
+		return running;
+	};
+
+	bool KinectFinderInternalData::StartEventThread()
+	{
+		if (!mContext) return false;
+		if (mEventThreadStarted) return true;
+
+		mRunning = true;
+		mEventThreadStarted = KinectThreadStart(&mEventThread, EventThread, this);
+		if (!mEventThreadStarted)
+		{
+			mRunning = false;
+		};
+		return mEventThreadStarted;
+	};
+
+	void KinectFinderInternalData::StopEventThread()
+	{
+		if (!mEventThreadStarted) return;
+
+		KinectLockEnter(&mLock);
+		mRunning = false;
+		KinectLockLeave(&mLock);
+
+		KinectThreadJoin(mEventThread);
+		mEventThreadStarted = false;
+	};
 };
\ No newline at end of file
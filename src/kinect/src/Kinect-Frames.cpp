@@ -0,0 +1,211 @@
+/*
+ * This file was ported by Stijn Kuipers / Zephod from a part of the OpenKinect 
+ * Project. http://www.openkinect.org
+ *
+ * Copyright (c) 2010 individual OpenKinect contributors. See the CONTRIB file
+ * for details.
+ *
+ * This code is licensed to you under the terms of the Apache License, version
+ * 2.0, or, at your option, the terms of the GNU General Public License,
+ * version 2.0. See the APACHE20 and GPL2 files for the text of the licenses,
+ * or the following URLs:
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * http://www.gnu.org/licenses/gpl-2.0.txt
+ *
+ * If you redistribute this file in source form, modified or unmodified, you
+ * may:
+ *   1) Leave this header intact and distribute it under the same terms,
+ *      accompanying it with the APACHE20 and GPL20 files, or
+ *   2) Delete the Apache 2.0 clause and accompany it with the GPL2 file, or
+ *   3) Delete the GPL v2 clause and accompany it with the APACHE20 file
+ * In all cases you must keep the copyright notice intact and include a copy
+ * of the CONTRIB file.
+ *
+ * Binary distributions must follow the binary distribution requirements of
+ * either License.
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "Kinect-frames.h"
+
+namespace Kinect
+{
+	KinectFramePool::KinectFramePool(int Size)
+	{
+		for (int i=0; i<3; i++) mBuffers[i] = new uint8_t[Size];
+		memset(mInfo, 0, sizeof(mInfo));
+		mBack = 0;
+		mLast = -1;
+		mPublished = 1;
+		mFront = 2;
+		mHaveFront = false;
+	};
+
+	KinectFramePool::~KinectFramePool()
+	{
+		for (int i=0; i<3; i++) delete [] mBuffers[i];
+	};
+
+	void KinectFramePool::Publish()
+	{
+		// the buffer given back is either the previous frame the reader never took, or the one it let go of
+		mLast = mBack;
+		mBack = KinectAtomicExchange(&mPublished, mBack | FRESH) & ~FRESH;
+	};
+
+	uint8_t *KinectFramePool::Acquire()
+	{
+		if (KinectAtomicLoad(&mPublished) & FRESH)
+		{
+			mFront = KinectAtomicExchange(&mPublished, mFront) & ~FRESH;
+			mHaveFront = true;
+		};
+		return mHaveFront?mBuffers[mFront]:NULL;
+	};
+
+	KinectFrameAssembler::KinectFrameAssembler(KinectFramePool *Pool, uint8_t FlagStart, int FrameSize, int PayloadSize, int RowBytes, int Rows)
+	{
+		mPool = Pool;
+		// start, middle and end of frame, 0x71 0x72 0x75 for depth and 0x81 0x82 0x85 for rgb
+		mFlagStart = FlagStart;
+		mFlagMiddle = FlagStart + 1;
+		mFlagEnd = FlagStart + 4;
+		mFrameSize = FrameSize;
+		mPayloadSize = PayloadSize;
+		mRowBytes = RowBytes;
+		mRows = Rows;
+		mPacketsPerFrame = (FrameSize + PayloadSize - 1) / PayloadSize;
+
+		mInFrame = false;
+		mHaveSeq = false;
+		mSeqInit = 0;
+		mReceivedCount = 0;
+		memset(mReceived, 0, sizeof(mReceived));
+		memset(&mStats, 0, sizeof(mStats));
+	};
+
+	void KinectFrameAssembler::Begin(uint8_t SeqInit)
+	{
+		mInFrame = true;
+		mHaveSeq = true;
+		mSeqInit = SeqInit;
+		mReceivedCount = 0;
+		memset(mReceived, 0, sizeof(mReceived));
+	};
+
+	bool KinectFrameAssembler::Process(uint8_t *buf, size_t len)
+	{
+		if (len < sizeof(frame_hdr)) return false;
+
+		frame_hdr *hdr = (frame_hdr *)buf;
+		uint8_t *data = buf + sizeof(frame_hdr);
+		int datalen = (int)(len - sizeof(frame_hdr));
+
+		if (!(hdr->magic[0] == 0x52 && hdr->magic[1] == 0x42)) return false;
+		if (hdr->flag != mFlagStart && hdr->flag != mFlagMiddle && hdr->flag != mFlagEnd) return false;
+
+		bool published = false;
+		if (hdr->flag == mFlagStart)
+		{
+			// the end of the frame before got lost
+			if (mInFrame) published = Finish();
+			// a start out of turn: whole frames got lost in between
+			if (mHaveSeq && hdr->seq != (uint8_t)(mSeqInit + mPacketsPerFrame)) mStats.FramesDropped++;
+			Begin(hdr->seq);
+		}
+		else if (!mInFrame)
+		{
+			// the start got lost, the sequence numbers carry on from the frame before
+			if (!mHaveSeq) return false;
+			uint8_t SeqInit = mSeqInit + mPacketsPerFrame;
+			if ((uint8_t)(hdr->seq - SeqInit) >= mPacketsPerFrame)
+			{
+				mStats.FramesDropped++;
+				mHaveSeq = false;
+				return false;
+			};
+			Begin(SeqInit);
+		};
+
+		int index = (uint8_t)(hdr->seq - mSeqInit);
+		if (index >= mPacketsPerFrame)
+		{
+			// past the end of the frame: both its end and the start of this one got lost
+			published = Finish() || published;
+			uint8_t SeqInit = mSeqInit + mPacketsPerFrame;
+			index = (uint8_t)(hdr->seq - SeqInit);
+			if (index >= mPacketsPerFrame)
+			{
+				mStats.FramesDropped++;
+				mHaveSeq = false;
+				return published;
+			};
+			Begin(SeqInit);
+		};
+
+		if (!IsReceived(index))
+		{
+			int offset = index * mPayloadSize;
+			int size = std::min(datalen, std::min(mPayloadSize, mFrameSize - offset));
+			if (size > 0) memcpy(mPool->Back() + offset, data, size);
+			mReceived[index>>5] |= 1u<<(index&31);
+			mReceivedCount++;
+		};
+
+		if (hdr->flag == mFlagEnd) published = Finish() || published;
+		return published;
+	};
+
+	bool KinectFrameAssembler::Finish()
+	{
+		mInFrame = false;
+
+		uint8_t *frame = mPool->Back();
+		uint8_t *previous = mPool->Last();
+		KinectFrameInfo *info = mPool->BackInfo();
+		memset(info->RowValid, 1, mRows);
+
+		int lost = mPacketsPerFrame - mReceivedCount;
+		int repaired = 0;
+		for (int index = 0; lost > 0 && index < mPacketsPerFrame; index++)
+		{
+			if (IsReceived(index)) continue;
+
+			// whole rows from the frame before, a row is never half new and half old
+			int offset = index * mPayloadSize;
+			int end = std::min(offset + mPayloadSize, mFrameSize);
+			for (int row = offset / mRowBytes; row <= (end - 1) / mRowBytes && row < mRows; row++)
+			{
+				if (!info->RowValid[row]) continue;
+				info->RowValid[row] = 0;
+				repaired++;
+				if (previous)
+				{
+					memcpy(frame + row * mRowBytes, previous + row * mRowBytes, mRowBytes);
+				}
+				else
+				{
+					memset(frame + row * mRowBytes, 0, mRowBytes);
+				};
+			};
+		};
+
+		if (lost == 0)
+		{
+			mStats.FramesComplete++;
+		}
+		else
+		{
+			mStats.FramesRepaired++;
+			mStats.PacketsLost += lost;
+		};
+		info->Stats = mStats;
+		info->Stats.LostPackets = lost;
+		info->Stats.RepairedRows = repaired;
+
+		mPool->Publish();
+		return true;
+	};
+};
@@ -2,44 +2,40 @@
 #include "Kinect-win32-internal.h"
 
 #include<algorithm>
+#include<string.h>
 
 namespace Kinect
 {
 	KinectFinder::KinectFinder()
 	{
-		usb_init();
-		usb_find_busses();
-		usb_find_devices();
+		KinectFinderInternalData *FID = new KinectFinderInternalData();
+		mInternalData = (void *)FID;
 
-		usb_bus *CurrentBus = usb_get_busses();
+		// transfers complete on the event thread, it has to run before the first Kinect starts its streams
+		if (!FID->StartEventThread()) return;
+
+		libusb_device **DeviceList = NULL;
+		ssize_t DeviceCount = libusb_get_device_list(FID->mContext, &DeviceList);
+		if (DeviceCount<0) return;
 
 		std::vector< void *> KinectsFound;
 		std::vector< void *> KinectMotorsFound;
-		std::vector< void *> KinectAudioFound;
 
-		while (CurrentBus)
+		for (ssize_t i = 0;i<DeviceCount;i++)
 		{
-			usb_device_t * CurrentDev = CurrentBus->devices;
-			while (CurrentDev)
+			libusb_device_descriptor Descriptor;
+			if (libusb_get_device_descriptor(DeviceList[i], &Descriptor)<0) continue;
+
+			if (Descriptor.idVendor == 0x045E &&
+				Descriptor.idProduct == 0x02AE) // cam = 0x02AE  motor = 0x02B0  audio = 0x02AD
 			{
-				if (CurrentDev->descriptor.idVendor == 0x045E &&
-					CurrentDev->descriptor.idProduct == 0x02AE) // cam = 0x02AE  motor = 0x02B0  audio = 0x02AD
-				{
-					KinectsFound.push_back(CurrentDev);
-				};
-				if (CurrentDev->descriptor.idVendor == 0x045E &&
-					CurrentDev->descriptor.idProduct == 0x02B0) // cam = 0x02AE  motor = 0x02B0  audio = 0x02AD
-				{
-					KinectMotorsFound.push_back(CurrentDev);
-				};
-				if (CurrentDev->descriptor.idVendor == 0x045E &&
-					CurrentDev->descriptor.idProduct == 0x02AD) // cam = 0x02AE  motor = 0x02B0  audio = 0x02AD
-				{
-					KinectAudioFound.push_back(CurrentDev);
-				};
-				CurrentDev = CurrentDev->next;
+				KinectsFound.push_back(DeviceList[i]);
+			};
+			if (Descriptor.idVendor == 0x045E &&
+				Descriptor.idProduct == 0x02B0) // cam = 0x02AE  motor = 0x02B0  audio = 0x02AD
+			{
+				KinectMotorsFound.push_back(DeviceList[i]);
 			};
-			CurrentBus = CurrentBus->next;
 		};
 
 
@@ -47,7 +43,7 @@ namespace Kinect
 		{
 			void *Motor = NULL;
 			if (i<KinectMotorsFound.size()) Motor = KinectMotorsFound[i];
-			Kinect *K = new Kinect(KinectsFound[i], Motor);
+			Kinect *K = new Kinect(KinectsFound[i], Motor, FID->mContext);
 			if (K->Opened())
 			{
 				mKinects.push_back(K);
@@ -59,7 +55,8 @@ namespace Kinect
 
 		};
 
-
+		// opened devices hold a reference of their own
+		libusb_free_device_list(DeviceList, 1);
 	};
 
 	KinectFinder::~KinectFinder()
@@ -69,6 +66,9 @@ namespace Kinect
 			delete mKinects[i];
 		};
 		mKinects.clear();
+
+		KinectFinderInternalData *FID = (KinectFinderInternalData *) mInternalData;
+		delete FID;
 	};
 
 	Kinect *KinectFinder::GetKinect(int index)
@@ -79,7 +79,7 @@ namespace Kinect
 
 	int KinectFinder::GetKinectCount()
 	{
-		return mKinects.size();
+		return (int)mKinects.size();
 	};
 
 	bool Kinect::Opened()
@@ -89,12 +89,16 @@ namespace Kinect
 		return false;
 	};
 
-	Kinect::Kinect(void *internaldata, void *internalmotordata)
+	Kinect::Kinect(void *internaldata, void *internalmotordata, void *internalcontext)
 	{
-		InitializeCriticalSection(&mListenersLock);
+		KinectLockInit(&mListenersLock);
+		memset(mDepthRowValid, 0, sizeof(mDepthRowValid));
+		memset(mColorRowValid, 0, sizeof(mColorRowValid));
+		memset(&mDepthStats, 0, sizeof(mDepthStats));
+		memset(&mColorStats, 0, sizeof(mColorStats));
 		KinectInternalData *KID = new KinectInternalData(this);
 		mInternalData = (void *)KID;
-		KID->OpenDevice((usb_device_t *)internaldata, (usb_device_t *)internalmotordata);
+		KID->OpenDevice((libusb_context *)internalcontext, (libusb_device *)internaldata, (libusb_device *)internalmotordata);
 
 	};
 
@@ -105,56 +109,63 @@ namespace Kinect
 			KinectInternalData *KID = (KinectInternalData *) mInternalData;
 			delete KID;
 		}
+		KinectLockDestroy(&mListenersLock);
 	};
 
 	void Kinect::KinectDisconnected()
 	{
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		for (unsigned int i=0;i<mListeners.size();i++) mListeners[i]->KinectDisconnected(this);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 
 	void Kinect::DepthReceived()
 	{		
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		for (unsigned int i=0;i<mListeners.size();i++) mListeners[i]->DepthReceived(this);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 
 	void Kinect::ColorReceived()
 	{	
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		for (unsigned int i=0;i<mListeners.size();i++) mListeners[i]->ColorReceived(this);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 	
 	void Kinect::AddListener(KinectListener *KL)
 	{
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		if (KL) mListeners.push_back(KL);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 	
 	void Kinect::RemoveListener(KinectListener *KL)
 	{
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		std::vector<KinectListener*>::iterator f = find(mListeners.begin(), mListeners.end(), KL);
 		if (f!= mListeners.end()) mListeners.erase(f);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 	
 	void Kinect::AudioReceived()
 	{
-		EnterCriticalSection(&mListenersLock);
+		KinectLockEnter(&mListenersLock);
 		for (unsigned int i=0;i<mListeners.size();i++) mListeners[i]->AudioReceived(this);
-		LeaveCriticalSection(&mListenersLock);
+		KinectLockLeave(&mListenersLock);
 	};
 
 	void Kinect::ParseColorBuffer()
 	{
 		KinectInternalData *KID = (KinectInternalData *) mInternalData;
 
-		KID->LockRGB();
+		// the event thread keeps assembling into another buffer meanwhile
+		uint8_t *rgb_buf = KID->rgb_frames.Acquire();
+		if (!rgb_buf) return;
+		KinectFrameInfo *info = KID->rgb_frames.FrontInfo();
+		memcpy(mColorRowValid, info->RowValid, sizeof(mColorRowValid));
+		mColorStats = info->Stats;
+
 		for (int y=1; y<479; y++) 
 		{
 			for (int x=0; x<640; x++) 
@@ -164,50 +175,53 @@ namespace Kinect
 				{
 					if (y&1) 
 					{
-						mColorBuffer[3*i+1] = KID->rgb_buf2[i];
-						mColorBuffer[3*i+4] = KID->rgb_buf2[i];
+						mColorBuffer[3*i+1] = rgb_buf[i];
+						mColorBuffer[3*i+4] = rgb_buf[i];
 					} 
 					else 
 					{
-						mColorBuffer[3*i] = KID->rgb_buf2[i];
-						mColorBuffer[3*i+3] = KID->rgb_buf2[i];
-						mColorBuffer[3*(i-640)] = KID->rgb_buf2[i];
-						mColorBuffer[3*(i-640)+3] = KID->rgb_buf2[i];
+						mColorBuffer[3*i] = rgb_buf[i];
+						mColorBuffer[3*i+3] = rgb_buf[i];
+						mColorBuffer[3*(i-640)] = rgb_buf[i];
+						mColorBuffer[3*(i-640)+3] = rgb_buf[i];
 					}
 				} 
 				else 
 				{
 					if (y&1) 
 					{
-						mColorBuffer[3*i+2] = KID->rgb_buf2[i];
-						mColorBuffer[3*i-1] = KID->rgb_buf2[i];
-						mColorBuffer[3*(i+640)+2] = KID->rgb_buf2[i];
-						mColorBuffer[3*(i+640)-1] = KID->rgb_buf2[i];
+						mColorBuffer[3*i+2] = rgb_buf[i];
+						mColorBuffer[3*i-1] = rgb_buf[i];
+						mColorBuffer[3*(i+640)+2] = rgb_buf[i];
+						mColorBuffer[3*(i+640)-1] = rgb_buf[i];
 					}
 					else 
 					{
-						mColorBuffer[3*i+1] = KID->rgb_buf2[i];
-						mColorBuffer[3*i-2] = KID->rgb_buf2[i];
+						mColorBuffer[3*i+1] = rgb_buf[i];
+						mColorBuffer[3*i-2] = rgb_buf[i];
 					}
 				}
 			}
 		}
-		KID->UnlockRGB();
 	}
 	
 	void Kinect::ParseDepthBuffer()
 	{
 		KinectInternalData *KID = (KinectInternalData *) mInternalData;
+		uint8_t *depth_buf = KID->depth_frames.Acquire();
+		if (!depth_buf) return;
+		KinectFrameInfo *info = KID->depth_frames.FrontInfo();
+		memcpy(mDepthRowValid, info->RowValid, sizeof(mDepthRowValid));
+		mDepthStats = info->Stats;
+
 		int bitshift = 0;
-		KID->LockDepth();
 		for (int i=0; i<640*480; i++) 
 		{
 			int idx = (i*11)/8;
-			uint32_t word = (KID->depth_sourcebuf2[idx]<<16) | (KID->depth_sourcebuf2[idx+1]<<8) | KID->depth_sourcebuf2[idx+2];
+			uint32_t word = (depth_buf[idx]<<16) | (depth_buf[idx+1]<<8) | depth_buf[idx+2];
 			mDepthBuffer[i] = ((word >> (13-bitshift)) & 0x7ff);
 			bitshift = (bitshift + 11) % 8;
 		}
-		KID->UnlockDepth();
 	};
 
 	void Kinect::SetMotorPosition(double newpos)
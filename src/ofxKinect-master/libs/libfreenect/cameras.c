@@ -732,6 +732,10 @@ static int write_register(freenect_device *dev, uint16_t reg, uint16_t data)
 	uint16_t cmd[2];
 	int res;
 
+	// a replay device has no camera to configure
+	if (dev->replay_file)
+		return 0;
+
 	cmd[0] = fn_le16(reg);
 	cmd[1] = fn_le16(data);
 
@@ -973,7 +977,7 @@ int freenect_start_depth(freenect_device *dev)
 			return -1;
 	}
 
-	res = fnusb_start_iso(&dev->usb_cam, &dev->depth_isoc, depth_process, 0x82, NUM_XFERS, PKTS_PER_XFER, DEPTH_PKTBUF);
+	res = fnusb_start_iso(&dev->usb_cam, &dev->depth_isoc, depth_process, 0x82, dev->iso_profile, DEPTH_PKTBUF);
 	if (res < 0)
 		return res;
 
@@ -1119,7 +1123,7 @@ int freenect_start_video(freenect_device *dev)
 			break;
 	}
 
-	res = fnusb_start_iso(&dev->usb_cam, &dev->video_isoc, video_process, 0x81, NUM_XFERS, PKTS_PER_XFER, VIDEO_PKTBUF);
+	res = fnusb_start_iso(&dev->usb_cam, &dev->video_isoc, video_process, 0x81, dev->iso_profile, VIDEO_PKTBUF);
 	if (res < 0)
 		return res;
 
@@ -1260,8 +1264,9 @@ int freenect_set_video_mode(freenect_device* dev, const freenect_frame_mode mode
 	dev->video_format = fmt;
 	dev->video_resolution = res;
 	// Now that we've changed video format and resolution, we need to update
-	// registration tables.
-	freenect_fetch_reg_info(dev);
+	// registration tables. A replay device keeps those of its capture.
+	if (!dev->replay_file)
+		freenect_fetch_reg_info(dev);
 	return 0;
 }
 
@@ -1333,6 +1338,37 @@ int freenect_set_video_buffer(freenect_device *dev, void *buf)
 	return stream_setbuf(dev->parent, &dev->video, buf);
 }
 
+int freenect_set_iso_profile(freenect_device *dev, freenect_iso_profile profile)
+{
+	freenect_context *ctx = dev->parent;
+	if (profile < FREENECT_ISO_PROFILE_DEFAULT || profile > FREENECT_ISO_PROFILE_AUTO) {
+		FN_ERROR("freenect_set_iso_profile() called with invalid profile %d\n", profile);
+		return -1;
+	}
+	dev->iso_profile = profile;
+	if (dev->depth.running)
+		fnusb_request_iso_profile(&dev->depth_isoc, profile);
+	if (dev->video.running)
+		fnusb_request_iso_profile(&dev->video_isoc, profile);
+	return 0;
+}
+
+int freenect_get_depth_stream_stats(freenect_device *dev, freenect_stream_stats *stats)
+{
+	if (!dev->depth.running)
+		return -1;
+	fnusb_get_iso_stats(&dev->depth_isoc, stats);
+	return 0;
+}
+
+int freenect_get_video_stream_stats(freenect_device *dev, freenect_stream_stats *stats)
+{
+	if (!dev->video.running)
+		return -1;
+	fnusb_get_iso_stats(&dev->video_isoc, stats);
+	return 0;
+}
+
 FN_INTERNAL int freenect_camera_init(freenect_device *dev)
 {
 	freenect_context *ctx = dev->parent;
@@ -1361,20 +1397,21 @@ FN_INTERNAL int freenect_camera_teardown(freenect_device *dev)
 {
 	freenect_context *ctx = dev->parent;
 	int res = 0;
+	// stop both streams, a device closed while streaming both used to leak the video buffers
 	if (dev->depth.running) {
 		res = freenect_stop_depth(dev);
 		if (res < 0) {
 			FN_ERROR("freenect_camera_teardown(): Failed to stop depth camera\n");
 		}
-		return res;
 	}
 	if (dev->video.running) {
-		res = freenect_stop_video(dev);
-		if (res < 0) {
+		int vres = freenect_stop_video(dev);
+		if (vres < 0) {
 			FN_ERROR("freenect_camera_teardown(): Failed to stop video camera\n");
+			if (res == 0)
+				res = vres;
 		}
-		return res;
 	}
 	freenect_destroy_registration(&(dev->registration));
-	return 0;
+	return res;
 }
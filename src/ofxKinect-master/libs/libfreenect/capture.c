@@ -0,0 +1,252 @@
+/*
+ * This file is part of the OpenKinect Project. http://www.openkinect.org
+ *
+ * Copyright (c) 2011 individual OpenKinect contributors. See the CONTRIB file
+ * for details.
+ *
+ * This code is licensed to you under the terms of the Apache License, version
+ * 2.0, or, at your option, the terms of the GNU General Public License,
+ * version 2.0. See the APACHE20 and GPL2 files for the text of the licenses,
+ * or the following URLs:
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * http://www.gnu.org/licenses/gpl-2.0.txt
+ *
+ * If you redistribute this file in source form, modified or unmodified, you
+ * may:
+ *   1) Leave this header intact and distribute it under the same terms,
+ *      accompanying it with the APACHE20 and GPL20 files, or
+ *   2) Delete the Apache 2.0 clause and accompany it with the GPL2 file, or
+ *   3) Delete the GPL v2 clause and accompany it with the APACHE20 file
+ * In all cases you must keep the copyright notice intact and include a copy
+ * of the CONTRIB file.
+ *
+ * Binary distributions must follow the binary distribution requirements of
+ * either License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "freenect_internal.h"
+#include "libfreenect-capture.h"
+#include "capture.h"
+
+static void capture_sleep_us(uint64_t us)
+{
+#ifdef _WIN32
+	Sleep((DWORD)(us / 1000));
+#else
+	usleep((useconds_t)us);
+#endif
+}
+
+FN_INTERNAL void freenect_capture_transfer(freenect_device *dev, struct libusb_transfer *xfer, int pkt_stride)
+{
+	freenect_context *ctx = dev->parent;
+	uint16_t lengths[FREENECT_CAPTURE_MAX_PKTS];
+	freenect_capture_xfer_hdr hdr;
+	int i, ok;
+
+	// only the camera streams, the audio endpoints go through the same callback
+	if (xfer->endpoint != 0x81 && xfer->endpoint != 0x82)
+		return;
+	if (xfer->num_iso_packets > FREENECT_CAPTURE_MAX_PKTS)
+		return;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.timestamp = fn_time_us();
+	hdr.endpoint = xfer->endpoint;
+	hdr.num_pkts = xfer->num_iso_packets;
+	for (i=0; i<xfer->num_iso_packets; i++)
+		lengths[i] = xfer->iso_packet_desc[i].actual_length;
+
+	ok = fwrite(&hdr, sizeof(hdr), 1, dev->capture_file) == 1;
+	ok = ok && fwrite(lengths, sizeof(uint16_t), hdr.num_pkts, dev->capture_file) == hdr.num_pkts;
+	for (i=0; ok && i<hdr.num_pkts; i++) {
+		if (lengths[i])
+			ok = fwrite(xfer->buffer + i * pkt_stride, lengths[i], 1, dev->capture_file) == 1;
+	}
+
+	if (!ok) {
+		FN_ERROR("freenect_capture_transfer(): write failed, stopping the capture\n");
+		fclose(dev->capture_file);
+		dev->capture_file = NULL;
+	}
+}
+
+FN_INTERNAL void freenect_capture_close(freenect_device *dev)
+{
+	if (dev->capture_file) {
+		fclose(dev->capture_file);
+		dev->capture_file = NULL;
+	}
+	if (dev->replay_file) {
+		fclose(dev->replay_file);
+		dev->replay_file = NULL;
+	}
+}
+
+FREENECTAPI int freenect_start_packet_capture(freenect_device *dev, const char *filename)
+{
+	freenect_context *ctx = dev->parent;
+	freenect_capture_file_hdr hdr;
+
+	if (dev->capture_file) {
+		FN_ERROR("freenect_start_packet_capture(): device is already being captured\n");
+		return -1;
+	}
+
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		FN_ERROR("freenect_start_packet_capture(): cannot create %s\n", filename);
+		return -1;
+	}
+
+	// the parameters registration needs, so replayed depth can be registered as well
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, "FNPC", 4);
+	hdr.version = FREENECT_CAPTURE_VERSION;
+	hdr.reg_info = dev->registration.reg_info;
+	hdr.reg_pad_info = dev->registration.reg_pad_info;
+	hdr.zero_plane_info = dev->registration.zero_plane_info;
+	hdr.const_shift = dev->registration.const_shift;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+		FN_ERROR("freenect_start_packet_capture(): cannot write to %s\n", filename);
+		fclose(f);
+		return -1;
+	}
+
+	dev->capture_file = f;
+	return 0;
+}
+
+FREENECTAPI int freenect_stop_packet_capture(freenect_device *dev)
+{
+	if (!dev->capture_file)
+		return -1;
+	fclose(dev->capture_file);
+	dev->capture_file = NULL;
+	return 0;
+}
+
+FREENECTAPI int freenect_open_replay_device(freenect_context *ctx, freenect_device **dev, const char *filename)
+{
+	freenect_capture_file_hdr hdr;
+
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		FN_ERROR("freenect_open_replay_device(): cannot open %s\n", filename);
+		return -1;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, "FNPC", 4) != 0 || hdr.version != FREENECT_CAPTURE_VERSION) {
+		FN_ERROR("freenect_open_replay_device(): %s is not a packet capture\n", filename);
+		fclose(f);
+		return -1;
+	}
+
+	freenect_device *pdev = (freenect_device*)malloc(sizeof(freenect_device));
+	if (!pdev) {
+		fclose(f);
+		return -1;
+	}
+
+	memset(pdev, 0, sizeof(*pdev));
+
+	pdev->parent = ctx;
+	pdev->usb_cam.parent = pdev;
+	pdev->usb_motor.parent = pdev;
+	pdev->replay_file = f;
+	pdev->replay_data_start = ftell(f);
+
+	pdev->registration.reg_info = hdr.reg_info;
+	pdev->registration.reg_pad_info = hdr.reg_pad_info;
+	pdev->registration.zero_plane_info = hdr.zero_plane_info;
+	pdev->registration.const_shift = hdr.const_shift;
+
+	// the defaults of freenect_camera_init(), without asking the camera
+	pdev->video_format = FREENECT_VIDEO_RGB;
+	pdev->video_resolution = FREENECT_RESOLUTION_MEDIUM;
+	pdev->depth_format = FREENECT_DEPTH_11BIT;
+	pdev->depth_resolution = FREENECT_RESOLUTION_MEDIUM;
+
+	if (!ctx->first) {
+		ctx->first = pdev;
+	} else {
+		freenect_device *prev = ctx->first;
+		while (prev->next)
+			prev = prev->next;
+		prev->next = pdev;
+	}
+
+	*dev = pdev;
+	return 0;
+}
+
+FREENECTAPI int freenect_replay_packets(freenect_device *dev, double speed, int max_transfers)
+{
+	freenect_context *ctx = dev->parent;
+	uint16_t lengths[FREENECT_CAPTURE_MAX_PKTS];
+	uint8_t pkt[FREENECT_CAPTURE_MAX_PKTSIZE];
+	freenect_capture_xfer_hdr hdr;
+	int n, i;
+
+	if (!dev->replay_file)
+		return -1;
+
+	for (n = 0; n < max_transfers; n++) {
+		if (fread(&hdr, sizeof(hdr), 1, dev->replay_file) != 1)
+			break;
+		if (hdr.num_pkts > FREENECT_CAPTURE_MAX_PKTS ||
+		    fread(lengths, sizeof(uint16_t), hdr.num_pkts, dev->replay_file) != hdr.num_pkts) {
+			FN_ERROR("freenect_replay_packets(): damaged transfer header\n");
+			return -1;
+		}
+
+		if (speed > 0) {
+			// keep the recorded spacing of the transfers, scaled by speed
+			uint64_t now = fn_time_us();
+			if (!dev->replay_clock) {
+				dev->replay_clock = now;
+				dev->replay_first_timestamp = hdr.timestamp;
+			} else if (hdr.timestamp > dev->replay_first_timestamp) {
+				uint64_t due = dev->replay_clock + (uint64_t)((hdr.timestamp - dev->replay_first_timestamp) / speed);
+				if (due > now)
+					capture_sleep_us(due - now);
+			}
+		}
+
+		fnusb_isoc_stream *strm = NULL;
+		if (hdr.endpoint == 0x82)
+			strm = &dev->depth_isoc;
+		else if (hdr.endpoint == 0x81)
+			strm = &dev->video_isoc;
+
+		for (i=0; i<hdr.num_pkts; i++) {
+			if (lengths[i] > FREENECT_CAPTURE_MAX_PKTSIZE ||
+			    (lengths[i] && fread(pkt, lengths[i], 1, dev->replay_file) != 1)) {
+				FN_ERROR("freenect_replay_packets(): damaged packet\n");
+				return -1;
+			}
+			// as iso_callback() would: every packet, empty ones included
+			if (strm && strm->cb)
+				strm->cb(dev, pkt, lengths[i]);
+		}
+	}
+	return n;
+}
+
+FREENECTAPI int freenect_rewind_replay(freenect_device *dev)
+{
+	if (!dev->replay_file)
+		return -1;
+	if (fseek(dev->replay_file, dev->replay_data_start, SEEK_SET) != 0)
+		return -1;
+	dev->replay_clock = 0;
+	return 0;
+}
@@ -30,10 +30,17 @@
 #include <stdarg.h>
 
 #include <unistd.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
 
 #include "freenect_internal.h"
 #include "registration.h"
 #include "cameras.h"
+#include "capture.h"
 #ifdef BUILD_AUDIO
 #include "loader.h"
 #endif
@@ -93,6 +100,12 @@ FREENECTAPI int freenect_process_events_timeout(freenect_context *ctx, struct ti
 			res = -1;
 			freenect_stop_video(dev);
 			freenect_stop_depth(dev);
+		} else {
+			// transfer profile changes, asked for on completion or by freenect_set_iso_profile()
+			if (dev->depth_isoc.restart && fnusb_restart_iso(&dev->usb_cam, &dev->depth_isoc) < 0)
+				FN_ERROR("Failed to restart depth isochronous stream\n");
+			if (dev->video_isoc.restart && fnusb_restart_iso(&dev->usb_cam, &dev->video_isoc) < 0)
+				FN_ERROR("Failed to restart RGB isochronous stream\n");
 		}
 #ifdef BUILD_AUDIO
 		if (dev->usb_audio.device_dead) {
@@ -215,9 +228,10 @@ FREENECTAPI int freenect_close_device(freenect_device *dev)
 	freenect_context *ctx = dev->parent;
 	int res;
 
-	if (dev->usb_cam.dev) {
+	if (dev->usb_cam.dev || dev->replay_file) {
 		freenect_camera_teardown(dev);
 	}
+	freenect_capture_close(dev);
 
 	res = fnusb_close_subdevices(dev);
 	if (res < 0) {
@@ -289,3 +303,18 @@ FN_INTERNAL void fn_log(freenect_context *ctx, freenect_loglevel level, const ch
 		va_end(ap);
 	}
 }
+
+FN_INTERNAL uint64_t fn_time_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (uint64_t)(count.QuadPart / (double)freq.QuadPart * 1000000.0);
+#else
+	// monotonic, a wall clock step would stretch or squeeze the transfer intervals
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,219 @@
+/*
+ * This file is part of the OpenKinect Project. http://www.openkinect.org
+ *
+ * Copyright (c) 2011 individual OpenKinect contributors. See the CONTRIB file
+ * for details.
+ *
+ * This code is licensed to you under the terms of the Apache License, version
+ * 2.0, or, at your option, the terms of the GNU General Public License,
+ * version 2.0. See the APACHE20 and GPL2 files for the text of the licenses,
+ * or the following URLs:
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * http://www.gnu.org/licenses/gpl-2.0.txt
+ *
+ * If you redistribute this file in source form, modified or unmodified, you
+ * may:
+ *   1) Leave this header intact and distribute it under the same terms,
+ *      accompanying it with the APACHE20 and GPL20 files, or
+ *   2) Delete the Apache 2.0 clause and accompany it with the GPL2 file, or
+ *   3) Delete the GPL v2 clause and accompany it with the APACHE20 file
+ * In all cases you must keep the copyright notice intact and include a copy
+ * of the CONTRIB file.
+ *
+ * Binary distributions must follow the binary distribution requirements of
+ * either License.
+ */
+
+// Replays a packet capture (libfreenect-capture.h) through a replay device:
+// packet assembly, unpacking and registration run as for a live Kinect.
+//
+// As a benchmark it replays the capture as fast as it can and prints the
+// frame and transfer rates:
+//
+//   cc -O2 -I.. packetreplay.c ../*.c -lusb-1.0 -lpthread -lm -o packetreplay
+//   packetreplay [-d 11bit|10bit|mm|registered] [-s speed] [-n loops] capture
+//
+// Built with -DPACKETREPLAY_FUZZER it is a libFuzzer entry point instead,
+// every input is replayed as a capture in registered depth and RGB:
+//
+//   clang -g -fsanitize=fuzzer,address -DPACKETREPLAY_FUZZER -I.. packetreplay.c ../*.c -lusb-1.0 -lm -o packetreplay-fuzz
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "libfreenect.h"
+#include "libfreenect-capture.h"
+
+typedef struct {
+	int depth_frames;
+	int video_frames;
+} replay_counts;
+
+static void depth_cb(freenect_device *dev, void *depth, uint32_t timestamp)
+{
+	((replay_counts*)freenect_get_user(dev))->depth_frames++;
+}
+
+static void video_cb(freenect_device *dev, void *video, uint32_t timestamp)
+{
+	((replay_counts*)freenect_get_user(dev))->video_frames++;
+}
+
+// Opens a replay device of the capture with both streams started
+static freenect_device *open_replay(freenect_context *ctx, const char *filename, freenect_depth_format depth_format, replay_counts *counts)
+{
+	freenect_device *dev;
+	if (freenect_open_replay_device(ctx, &dev, filename) < 0)
+		return NULL;
+
+	freenect_set_user(dev, counts);
+	freenect_set_depth_callback(dev, depth_cb);
+	freenect_set_video_callback(dev, video_cb);
+	if (freenect_set_depth_mode(dev, freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM, depth_format)) < 0 ||
+	    freenect_set_video_mode(dev, freenect_find_video_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB)) < 0 ||
+	    freenect_start_depth(dev) < 0 || freenect_start_video(dev) < 0) {
+		freenect_close_device(dev);
+		return NULL;
+	}
+	return dev;
+}
+
+#ifdef PACKETREPLAY_FUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static freenect_context *ctx = NULL;
+	static const char *filename = "packetreplay-fuzz.fnpc";
+	replay_counts counts = { 0, 0 };
+	freenect_device *dev;
+	FILE *f;
+
+	if (!ctx) {
+		if (freenect_init(&ctx, NULL) < 0)
+			abort();
+		freenect_set_log_level(ctx, FREENECT_LOG_FATAL);
+	}
+
+	// the replay device reads a file
+	f = fopen(filename, "wb");
+	if (!f || fwrite(data, 1, size, f) != size)
+		abort();
+	fclose(f);
+
+	dev = open_replay(ctx, filename, FREENECT_DEPTH_REGISTERED, &counts);
+	if (dev) {
+		while (freenect_replay_packets(dev, 0, 64) > 0)
+			;
+		freenect_close_device(dev);
+	}
+	return 0;
+}
+
+#else
+
+static double seconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return count.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void usage(void)
+{
+	printf("usage: packetreplay [-d 11bit|10bit|mm|registered] [-s speed] [-n loops] capture\n"
+	       "  -d  depth format to unpack to, 11bit by default\n"
+	       "  -s  1 replays at the recorded pace, 0 (the default) as fast as possible\n"
+	       "  -n  times to replay the capture, 1 by default\n");
+}
+
+int main(int argc, char **argv)
+{
+	freenect_depth_format depth_format = FREENECT_DEPTH_11BIT;
+	double speed = 0;
+	int loops = 1;
+	const char *filename = NULL;
+	freenect_context *ctx;
+	freenect_device *dev;
+	replay_counts counts = { 0, 0 };
+	long transfers = 0;
+	double start, elapsed;
+	int i, n = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			const char *format = argv[++i];
+			if (!strcmp(format, "11bit"))
+				depth_format = FREENECT_DEPTH_11BIT;
+			else if (!strcmp(format, "10bit"))
+				depth_format = FREENECT_DEPTH_10BIT;
+			else if (!strcmp(format, "mm"))
+				depth_format = FREENECT_DEPTH_MM;
+			else if (!strcmp(format, "registered"))
+				depth_format = FREENECT_DEPTH_REGISTERED;
+			else {
+				usage();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			speed = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			loops = atoi(argv[++i]);
+		} else if (argv[i][0] != '-' && !filename) {
+			filename = argv[i];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!filename || loops < 1) {
+		usage();
+		return 1;
+	}
+
+	if (freenect_init(&ctx, NULL) < 0) {
+		printf("freenect_init() failed\n");
+		return 1;
+	}
+	dev = open_replay(ctx, filename, depth_format, &counts);
+	if (!dev) {
+		printf("cannot replay %s\n", filename);
+		freenect_shutdown(ctx);
+		return 1;
+	}
+
+	start = seconds();
+	for (i = 0; i < loops && n >= 0; i++) {
+		if (i > 0)
+			freenect_rewind_replay(dev);
+		while ((n = freenect_replay_packets(dev, speed, 64)) > 0)
+			transfers += n;
+	}
+	elapsed = seconds() - start;
+
+	printf("%ld transfers, %d depth frames, %d video frames in %.3f s\n",
+	       transfers, counts.depth_frames, counts.video_frames, elapsed);
+	if (elapsed > 0)
+		printf("%.0f transfers/s, %.1f depth frames/s, %.1f video frames/s\n",
+		       transfers / elapsed, counts.depth_frames / elapsed, counts.video_frames / elapsed);
+	if (n < 0)
+		printf("%s is damaged after %ld transfers\n", filename, transfers);
+
+	freenect_close_device(dev);
+	freenect_shutdown(ctx);
+	return n < 0 ? 1 : 0;
+}
+
+#endif
@@ -28,6 +28,7 @@
 #define FREENECT_INTERNAL_H
 
 #include <stdint.h>
+#include <stdio.h>
 
 #include "libfreenect.h"
 #include "libfreenect-registration.h"
@@ -75,6 +76,9 @@ void fn_log(freenect_context *ctx, freenect_loglevel level, const char *fmt, ...
 
 #define FN_LOG(level, ...) fn_log(ctx, level, __VA_ARGS__)
 
+// Microseconds of the system clock, for timing transfers
+uint64_t fn_time_us(void);
+
 #define FN_FATAL(...) FN_LOG(LL_FATAL, __VA_ARGS__)
 #define FN_ERROR(...) FN_LOG(LL_ERROR, __VA_ARGS__)
 #define FN_WARNING(...) FN_LOG(LL_WARNING, __VA_ARGS__)
@@ -239,6 +243,16 @@ struct _freenect_device {
 	// Motor
 	fnusb_dev usb_motor;
 	freenect_raw_tilt_state raw_state;
+
+	// Packet capture and replay, see capture.c
+	FILE *capture_file;
+	FILE *replay_file; // set on replay devices, which have no USB
+	long replay_data_start;
+	uint64_t replay_clock;
+	uint64_t replay_first_timestamp;
+
+	// Transfer profile of the camera streams, see freenect_set_iso_profile()
+	freenect_iso_profile iso_profile;
 };
 
 #endif
@@ -0,0 +1,133 @@
+/*
+ * This file is part of the OpenKinect Project. http://www.openkinect.org
+ *
+ * Copyright (c) 2011 individual OpenKinect contributors. See the CONTRIB file
+ * for details.
+ *
+ * This code is licensed to you under the terms of the Apache License, version
+ * 2.0, or, at your option, the terms of the GNU General Public License,
+ * version 2.0. See the APACHE20 and GPL2 files for the text of the licenses,
+ * or the following URLs:
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * http://www.gnu.org/licenses/gpl-2.0.txt
+ *
+ * If you redistribute this file in source form, modified or unmodified, you
+ * may:
+ *   1) Leave this header intact and distribute it under the same terms,
+ *      accompanying it with the APACHE20 and GPL20 files, or
+ *   2) Delete the Apache 2.0 clause and accompany it with the GPL2 file, or
+ *   3) Delete the GPL v2 clause and accompany it with the APACHE20 file
+ * In all cases you must keep the copyright notice intact and include a copy
+ * of the CONTRIB file.
+ *
+ * Binary distributions must follow the binary distribution requirements of
+ * either License.
+ */
+
+#ifndef LIBFREENECT_CAPTURE_H
+#define LIBFREENECT_CAPTURE_H
+
+#include <libfreenect.h>
+#include <libfreenect-registration.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Packet capture and replay of the camera streams.
+///
+/// A capture holds every isochronous transfer of the depth and video
+/// endpoints as it completed: its time, its endpoint and the raw packets,
+/// behind the registration parameters of the device. A replay device is fed
+/// from such a file instead of USB and runs the packets through the same
+/// path as a live device: packet assembly, unpacking and registration, into
+/// the usual depth and video callbacks. The files use host byte order.
+/// examples/packetreplay.c replays a capture as a benchmark or a fuzz target.
+
+#define FREENECT_CAPTURE_VERSION 1
+#define FREENECT_CAPTURE_MAX_PKTS 1024    /**< Packets of one transfer at most */
+#define FREENECT_CAPTURE_MAX_PKTSIZE 2048 /**< Bytes of one packet at most */
+
+/// Start of a capture file
+typedef struct {
+	char magic[4];     /**< "FNPC" */
+	uint32_t version;  /**< FREENECT_CAPTURE_VERSION */
+	freenect_reg_info reg_info;
+	freenect_reg_pad_info reg_pad_info;
+	freenect_zero_plane_info zero_plane_info;
+	double const_shift;
+} freenect_capture_file_hdr;
+
+/// One per transfer, followed by num_pkts uint16_t packet lengths and then the
+/// packets back to back. Empty packets are kept, they show the gaps.
+typedef struct {
+	uint64_t timestamp; /**< Microseconds, from an arbitrary origin */
+	uint8_t endpoint;   /**< 0x81 video, 0x82 depth */
+	uint8_t pad;
+	uint16_t num_pkts;
+	uint32_t pad2;
+} freenect_capture_xfer_hdr;
+
+/**
+ * Start writing the transfers of the camera streams of a device to a file.
+ * Call it from the thread that runs freenect_process_events(), before or
+ * after the streams start.
+ *
+ * @param dev Device to capture
+ * @param filename File to create, an existing one is overwritten
+ *
+ * @return 0 on success, < 0 on error
+ */
+FREENECTAPI int freenect_start_packet_capture(freenect_device *dev, const char *filename);
+
+/**
+ * Stop and close the capture of a device.
+ *
+ * @param dev Device being captured
+ *
+ * @return 0 on success, < 0 if there was no capture running
+ */
+FREENECTAPI int freenect_stop_packet_capture(freenect_device *dev);
+
+/**
+ * Open a device that replays a capture. It has no motor and no USB; set its
+ * modes, callbacks and buffers and start its streams as for a live device,
+ * then feed it with freenect_replay_packets(). Close it with
+ * freenect_close_device().
+ *
+ * @param ctx Context to open the device in
+ * @param dev Output: the replay device
+ * @param filename Capture written by freenect_start_packet_capture()
+ *
+ * @return 0 on success, < 0 on error
+ */
+FREENECTAPI int freenect_open_replay_device(freenect_context *ctx, freenect_device **dev, const char *filename);
+
+/**
+ * Feed the next transfers of a capture to the started streams of a replay
+ * device. Transfers of streams that are not started are skipped.
+ *
+ * @param dev Replay device
+ * @param speed 1.0 to wait for the recorded time of each transfer, 2.0 for
+ *              twice as fast, 0 not to wait at all
+ * @param max_transfers Number of transfers to feed at most
+ *
+ * @return Number of transfers read, 0 at the end of the capture, < 0 on a
+ *         damaged file
+ */
+FREENECTAPI int freenect_replay_packets(freenect_device *dev, double speed, int max_transfers);
+
+/**
+ * Start a replay device over from the first transfer of its capture.
+ *
+ * @param dev Replay device
+ *
+ * @return 0 on success, < 0 on error
+ */
+FREENECTAPI int freenect_rewind_replay(freenect_device *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBFREENECT_CAPTURE_H
@@ -400,6 +400,63 @@ FREENECTAPI int freenect_set_depth_buffer(freenect_device *dev, void *buf);
  */
 FREENECTAPI int freenect_set_video_buffer(freenect_device *dev, void *buf);
 
+/// How the isochronous transfers of the camera streams are sized. Short
+/// transfers hand packets over sooner, long ones leave the host more time
+/// to resubmit them before the device runs out of queued transfers.
+typedef enum {
+	FREENECT_ISO_PROFILE_DEFAULT     = 0, /**< Transfer sizes the library was built with */
+	FREENECT_ISO_PROFILE_LOW_LATENCY = 1, /**< Many short transfers */
+	FREENECT_ISO_PROFILE_ROBUST      = 2, /**< Few long transfers */
+	FREENECT_ISO_PROFILE_AUTO        = 3, /**< Low latency, robust while transfers fail or complete irregularly */
+} freenect_iso_profile;
+
+/// Transfer counters of one camera stream, since it was started
+typedef struct {
+	freenect_iso_profile profile; /**< Profile in use, never FREENECT_ISO_PROFILE_AUTO */
+	int num_xfers;                /**< Transfers in flight */
+	int pkts_per_xfer;            /**< Packets per transfer */
+	uint32_t transfers;           /**< Completed transfers */
+	uint32_t failed_transfers;    /**< Transfers that completed with an error or could not be resubmitted */
+	uint32_t profile_switches;    /**< Times FREENECT_ISO_PROFILE_AUTO changed the profile */
+	double interval_mean_us;      /**< Mean time between two completions, also how long the first packet of a transfer waits for it */
+	double interval_jitter_us;    /**< Mean deviation of that time */
+	double interval_max_us;       /**< Longest time between two completions */
+} freenect_stream_stats;
+
+/**
+ * Set the transfer profile of the camera streams of a device. Streams
+ * already running are restarted with it by the next call to
+ * freenect_process_events(), which drops the frame in progress.
+ *
+ * @param dev Device to set the profile of
+ * @param profile Profile to use
+ *
+ * @return 0 on success, < 0 on error
+ */
+FREENECTAPI int freenect_set_iso_profile(freenect_device *dev, freenect_iso_profile profile);
+
+/**
+ * Get the transfer counters of the depth stream. Call it from the thread
+ * that calls freenect_process_events().
+ *
+ * @param dev Device to get the counters of
+ * @param stats Filled with the counters
+ *
+ * @return 0 on success, < 0 if the stream is not running
+ */
+FREENECTAPI int freenect_get_depth_stream_stats(freenect_device *dev, freenect_stream_stats *stats);
+
+/**
+ * Get the transfer counters of the video stream. Call it from the thread
+ * that calls freenect_process_events().
+ *
+ * @param dev Device to get the counters of
+ * @param stats Filled with the counters
+ *
+ * @return 0 on success, < 0 if the stream is not running
+ */
+FREENECTAPI int freenect_get_video_stream_stats(freenect_device *dev, freenect_stream_stats *stats);
+
 /**
  * Start the depth information stream for a device.
  *
@@ -32,6 +32,7 @@
 #include <libusb.h>
 #include "freenect_internal.h"
 #include "loader.h"
+#include "capture.h"
 
 FN_INTERNAL int fnusb_num_devices(fnusb_ctx *ctx)
 {
@@ -417,6 +418,83 @@ FN_INTERNAL int fnusb_close_subdevices(freenect_device *dev)
 	return 0;
 }
 
+static void iso_profile_size(freenect_iso_profile profile, int *xfers, int *pkts)
+{
+	switch (profile) {
+		case FREENECT_ISO_PROFILE_LOW_LATENCY:
+			*xfers = LOW_LATENCY_NUM_XFERS;
+			*pkts = LOW_LATENCY_PKTS_PER_XFER;
+			break;
+		case FREENECT_ISO_PROFILE_ROBUST:
+			*xfers = ROBUST_NUM_XFERS;
+			*pkts = ROBUST_PKTS_PER_XFER;
+			break;
+		default:
+			*xfers = NUM_XFERS;
+			*pkts = PKTS_PER_XFER;
+			break;
+	}
+}
+
+// Called for every completion of a running stream. Keeps the interval
+// counters and, for FREENECT_ISO_PROFILE_AUTO, judges the stream once per
+// window. A failed transfer, completions that wander by more than half their
+// interval on average, or a gap that used up half of the queued transfers
+// mean the host is late to resubmit: low latency gives way to robust until
+// a few windows in a row go clean.
+static void iso_sample(fnusb_isoc_stream *strm, int failed)
+{
+	fnusb_iso_stats *st = &strm->stats;
+	uint64_t now = fn_time_us();
+
+	st->transfers++;
+	st->window_transfers++;
+	if (failed) {
+		st->failed_transfers++;
+		st->window_failed++;
+	}
+
+	if (st->last_completion && now > st->last_completion) {
+		double interval = (double)(now - st->last_completion);
+		double deviation;
+		// running means over about the last 64 completions
+		if (st->interval_mean == 0)
+			st->interval_mean = interval;
+		else
+			st->interval_mean += (interval - st->interval_mean) / 64;
+		deviation = interval > st->interval_mean ? interval - st->interval_mean : st->interval_mean - interval;
+		st->interval_jitter += (deviation - st->interval_jitter) / 64;
+		if (interval > st->interval_max)
+			st->interval_max = interval;
+		st->window_deviation += deviation;
+		if (interval > st->window_max)
+			st->window_max = interval;
+	}
+	st->last_completion = now;
+
+	if (!strm->auto_profile || st->window_transfers < ISO_AUTO_WINDOW)
+		return;
+
+	int troubled = st->window_failed > 0 ||
+		st->window_deviation / st->window_transfers > st->interval_mean / 2 ||
+		st->window_max > st->interval_mean * strm->num_xfers / 2;
+	if (troubled) {
+		st->clean_windows = 0;
+		if (strm->profile != FREENECT_ISO_PROFILE_ROBUST && !strm->restart) {
+			strm->restart_profile = FREENECT_ISO_PROFILE_ROBUST;
+			strm->restart = 1;
+		}
+	} else if (strm->profile == FREENECT_ISO_PROFILE_ROBUST && ++st->clean_windows >= ISO_AUTO_CLEAN_WINDOWS && !strm->restart) {
+		st->clean_windows = 0;
+		strm->restart_profile = FREENECT_ISO_PROFILE_LOW_LATENCY;
+		strm->restart = 1;
+	}
+	st->window_transfers = 0;
+	st->window_failed = 0;
+	st->window_deviation = 0;
+	st->window_max = 0;
+}
+
 static void iso_callback(struct libusb_transfer *xfer)
 {
 	int i;
@@ -433,6 +511,9 @@ static void iso_callback(struct libusb_transfer *xfer)
 		case LIBUSB_TRANSFER_COMPLETED: // Normal operation.
 		{
 			uint8_t *buf = (uint8_t*)xfer->buffer;
+			iso_sample(strm, 0);
+			if (strm->parent->parent->capture_file)
+				freenect_capture_transfer(strm->parent->parent, xfer, strm->len);
 			for (i=0; i<strm->pkts; i++) {
 				strm->cb(strm->parent->parent, buf, xfer->iso_packet_desc[i].actual_length);
 				buf += strm->len;
@@ -442,6 +523,8 @@ static void iso_callback(struct libusb_transfer *xfer)
 			if (res != 0) {
 				FN_ERROR("iso_callback(): failed to resubmit transfer after successful completion: %d\n", res);
 				strm->dead_xfers++;
+				strm->stats.failed_transfers++;
+				strm->stats.window_failed++;
 				if (res == LIBUSB_ERROR_NO_DEVICE) {
 					strm->parent->device_dead = 1;
 				}
@@ -485,11 +568,14 @@ static void iso_callback(struct libusb_transfer *xfer)
 			// the transfers, eventually all of them die and then we don't get
 			// any more data from the Kinect.
 			FN_WARNING("Isochronous transfer error: %d\n", xfer->status);
+			iso_sample(strm, 1);
 			int res;
 			res = libusb_submit_transfer(xfer);
 			if (res != 0) {
 				FN_ERROR("Isochronous transfer resubmission failed after unknown error: %d\n", res);
 				strm->dead_xfers++;
+				strm->stats.failed_transfers++;
+				strm->stats.window_failed++;
 				if (res == LIBUSB_ERROR_NO_DEVICE) {
 					strm->parent->device_dead = 1;
 				}
@@ -499,13 +585,25 @@ static void iso_callback(struct libusb_transfer *xfer)
 	}
 }
 
-FN_INTERNAL int fnusb_start_iso(fnusb_dev *dev, fnusb_isoc_stream *strm, fnusb_iso_cb cb, int ep, int xfers, int pkts, int len)
+FN_INTERNAL int fnusb_start_iso(fnusb_dev *dev, fnusb_isoc_stream *strm, fnusb_iso_cb cb, int ep, freenect_iso_profile profile, int len)
 {
 	freenect_context *ctx = dev->parent->parent;
-	int ret, i;
+	int ret, i, xfers, pkts;
+
+	strm->auto_profile = profile == FREENECT_ISO_PROFILE_AUTO;
+	if (strm->auto_profile)
+		profile = FREENECT_ISO_PROFILE_LOW_LATENCY;
+	iso_profile_size(profile, &xfers, &pkts);
+
+	// a replay device is fed by freenect_replay_packets() instead
+	if (dev->parent->replay_file)
+		xfers = 0;
 
 	strm->parent = dev;
 	strm->cb = cb;
+	strm->ep = ep;
+	strm->profile = profile;
+	strm->restart = 0;
 	strm->num_xfers = xfers;
 	strm->pkts = pkts;
 	strm->len = len;
@@ -568,6 +666,70 @@ FN_INTERNAL int fnusb_stop_iso(fnusb_dev *dev, fnusb_isoc_stream *strm)
 	return 0;
 }
 
+FN_INTERNAL int fnusb_restart_iso(fnusb_dev *dev, fnusb_isoc_stream *strm)
+{
+	freenect_context *ctx = dev->parent->parent;
+	fnusb_iso_cb cb = strm->cb;
+	int ep = strm->ep;
+	int len = strm->len;
+	int auto_profile = strm->auto_profile;
+	freenect_iso_profile profile = strm->restart_profile;
+	fnusb_iso_stats stats = strm->stats;
+	int res;
+
+	FN_INFO("Restarting stream %02x with transfer profile %d\n", ep, profile);
+
+	res = fnusb_stop_iso(dev, strm);
+	if (res < 0)
+		return res;
+	res = fnusb_start_iso(dev, strm, cb, ep, profile, len);
+	if (res < 0)
+		return res;
+
+	// the counters go on across the restart, the interval means start over
+	// with the new transfer size and the gap is no interval
+	strm->auto_profile = auto_profile;
+	strm->stats = stats;
+	strm->stats.last_completion = 0;
+	strm->stats.interval_mean = 0;
+	strm->stats.interval_jitter = 0;
+	strm->stats.window_transfers = 0;
+	strm->stats.window_failed = 0;
+	strm->stats.window_deviation = 0;
+	strm->stats.window_max = 0;
+	if (auto_profile)
+		strm->stats.profile_switches++;
+	return 0;
+}
+
+FN_INTERNAL void fnusb_request_iso_profile(fnusb_isoc_stream *strm, freenect_iso_profile profile)
+{
+	int auto_profile = profile == FREENECT_ISO_PROFILE_AUTO;
+	// auto goes on from the profile the stream has or is about to get
+	if (auto_profile)
+		profile = strm->restart ? strm->restart_profile : strm->profile;
+	strm->auto_profile = auto_profile;
+	if (profile != strm->profile) {
+		strm->restart_profile = profile;
+		strm->restart = 1;
+	} else {
+		strm->restart = 0;
+	}
+}
+
+FN_INTERNAL void fnusb_get_iso_stats(fnusb_isoc_stream *strm, freenect_stream_stats *stats)
+{
+	stats->profile = strm->profile;
+	stats->num_xfers = strm->num_xfers;
+	stats->pkts_per_xfer = strm->pkts;
+	stats->transfers = strm->stats.transfers;
+	stats->failed_transfers = strm->stats.failed_transfers;
+	stats->profile_switches = strm->stats.profile_switches;
+	stats->interval_mean_us = strm->stats.interval_mean;
+	stats->interval_jitter_us = strm->stats.interval_jitter;
+	stats->interval_max_us = strm->stats.interval_max;
+}
+
 FN_INTERNAL int fnusb_control(fnusb_dev *dev, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint8_t *data, uint16_t wLength)
 {
 	return libusb_control_transfer(dev->dev, bmRequestType, bRequest, wValue, wIndex, data, wLength, 0);
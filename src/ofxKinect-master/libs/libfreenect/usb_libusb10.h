@@ -61,6 +61,18 @@
 #define VIDEO_PKTBUF 1920
 #endif
 
+// Sizes of the freenect_iso_profile profiles, both within the OSX rules above.
+// Low latency hands packets over every 1ms, robust keeps 96ms of packets queued.
+#define LOW_LATENCY_PKTS_PER_XFER 8
+#define LOW_LATENCY_NUM_XFERS 32
+#define ROBUST_PKTS_PER_XFER 64
+#define ROBUST_NUM_XFERS 12
+
+// Completions per window of FREENECT_ISO_PROFILE_AUTO, and the clean robust
+// windows after which it tries low latency again.
+#define ISO_AUTO_WINDOW 128
+#define ISO_AUTO_CLEAN_WINDOWS 8
+
 typedef struct {
 	libusb_context *ctx;
 	int should_free_ctx;
@@ -72,6 +84,22 @@ typedef struct {
 	int device_dead; // set to 1 when the underlying libusb_device_handle vanishes (ie, Kinect was unplugged)
 } fnusb_dev;
 
+typedef struct {
+	uint64_t last_completion; // fn_time_us() of the last completion, 0 for none
+	double interval_mean;
+	double interval_jitter;
+	double interval_max;
+	uint32_t transfers;
+	uint32_t failed_transfers;
+	uint32_t profile_switches;
+	// current window of FREENECT_ISO_PROFILE_AUTO
+	int window_transfers;
+	int window_failed;
+	double window_deviation;
+	double window_max;
+	int clean_windows;
+} fnusb_iso_stats;
+
 typedef struct {
 	fnusb_dev *parent; //so we can go up from the libusb userdata
 	struct libusb_transfer **xfers;
@@ -82,6 +110,14 @@ typedef struct {
 	int len;
 	int dead;
 	int dead_xfers;
+	int ep;
+	freenect_iso_profile profile; // what the transfers are sized by, never AUTO
+	int auto_profile;
+	// set on completion when the transfers should be sized by restart_profile,
+	// fnusb_restart_iso() does it outside of the callbacks
+	int restart;
+	freenect_iso_profile restart_profile;
+	fnusb_iso_stats stats;
 } fnusb_isoc_stream;
 
 int fnusb_num_devices(fnusb_ctx *ctx);
@@ -95,8 +131,11 @@ int fnusb_process_events_timeout(fnusb_ctx *ctx, struct timeval* timeout);
 int fnusb_open_subdevices(freenect_device *dev, int index);
 int fnusb_close_subdevices(freenect_device *dev);
 
-int fnusb_start_iso(fnusb_dev *dev, fnusb_isoc_stream *strm, fnusb_iso_cb cb, int ep, int xfers, int pkts, int len);
+int fnusb_start_iso(fnusb_dev *dev, fnusb_isoc_stream *strm, fnusb_iso_cb cb, int ep, freenect_iso_profile profile, int len);
 int fnusb_stop_iso(fnusb_dev *dev, fnusb_isoc_stream *strm);
+int fnusb_restart_iso(fnusb_dev *dev, fnusb_isoc_stream *strm);
+void fnusb_request_iso_profile(fnusb_isoc_stream *strm, freenect_iso_profile profile);
+void fnusb_get_iso_stats(fnusb_isoc_stream *strm, freenect_stream_stats *stats);
 
 int fnusb_control(fnusb_dev *dev, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint8_t *data, uint16_t wLength);
 #ifdef BUILD_AUDIO
@@ -0,0 +1,140 @@
+#include "Check.h"
+#include "AudioRing.h"
+
+#include <stdlib.h>
+#include <vector>
+
+using namespace Kinect;
+
+//Deinterleave (the SSE2 path where the CPU has it) against DeinterleaveReference for every frame
+//count up to a few SSE2 steps, with the extreme samples in every lane
+static int countDeinterleaveMismatches(XnUInt32 nChannels)
+{
+	int nMismatches = 0;
+	for (XnUInt32 nFrames = 0; nFrames < 40; nFrames++)
+	{
+		std::vector<XnInt16> interleaved(nFrames*nChannels + 1);
+		for (size_t i = 0; i < interleaved.size(); i++)
+			interleaved[i] = (XnInt16)(i % 7 == 0 ? -32768 : (i % 7 == 1 ? 32767 : rand() % 65536 - 32768));
+
+		std::vector<XnFloat> fast(AudioStream::MAX_CHANNELS*(nFrames + 1), -2.0f), reference(fast);
+		XnFloat* pFast[AudioStream::MAX_CHANNELS];
+		XnFloat* pReference[AudioStream::MAX_CHANNELS];
+		for (XnUInt32 c = 0; c < AudioStream::MAX_CHANNELS; c++)
+		{
+			pFast[c] = &fast[c*(nFrames + 1)];
+			pReference[c] = &reference[c*(nFrames + 1)];
+		}
+		AudioStream::Deinterleave(&interleaved[0], nFrames, nChannels, pFast);
+		AudioStream::DeinterleaveReference(&interleaved[0], nFrames, nChannels, pReference);
+		if (fast != reference)
+			++nMismatches;
+	}
+	return nMismatches;
+}
+
+int main()
+{
+	srand(1);
+	for (XnUInt32 nChannels = 1; nChannels <= 4; nChannels++)
+		CHECK(countDeinterleaveMismatches(nChannels) == 0);
+
+	//the scale: full scale negative is -1, a positive sample never reaches 1
+	{
+		const XnInt16 samples[] = { -32768, 32767, 0, 16384 };
+		XnFloat left[2], right[2];
+		XnFloat* pDest[] = { left, right };
+		AudioStream::DeinterleaveReference(samples, 2, 2, pDest);
+		CHECK(left[0] == -1.0f && right[0] < 1.0f && left[1] == 0.0f && right[1] == 0.5f);
+	}
+
+	//the ring runs over its end: the samples come out in order across the wrap, the indices too
+	{
+		AudioRing ring;
+		ring.Init(12);
+		CHECK(ring.GetCapacity() == 16);
+		std::vector<XnFloat> in(10), out(10);
+		XnFloat fNext = 0, fExpected = 0;
+		int nWrong = 0;
+		for (int pass = 0; pass < 100; pass++)
+		{
+			XnUInt32 nCount = 1 + pass % 10;
+			for (XnUInt32 i = 0; i < nCount; i++)
+				in[i] = fNext++;
+			CHECK(ring.Write(&in[0], nCount) == nCount);
+			CHECK(ring.GetAvailable() == nCount);
+			CHECK(ring.Read(&out[0], nCount) == nCount);
+			for (XnUInt32 i = 0; i < nCount; i++)
+				if (out[i] != fExpected++)
+					++nWrong;
+		}
+		CHECK(nWrong == 0);
+		CHECK(ring.GetStats().nOverruns == 0 && ring.GetStats().nUnderruns == 0);
+	}
+
+	//overrun: the queued samples are kept and the rest of the write is dropped and counted;
+	//underrun: the read gets what there is and the shortfall is counted
+	{
+		AudioRing ring;
+		ring.Init(8);
+		XnFloat in[12], out[12];
+		for (int i = 0; i < 12; i++)
+			in[i] = (XnFloat)i;
+		CHECK(ring.Write(in, 5) == 5);
+		CHECK(ring.Write(in + 5, 7) == 3);
+		CHECK(ring.GetFree() == 0);
+		CHECK(ring.GetStats().nOverruns == 1 && ring.GetStats().nDroppedSamples == 4);
+
+		CHECK(ring.Read(out, 12) == 8);
+		for (int i = 0; i < 8; i++)
+			CHECK(out[i] == (XnFloat)i);
+		CHECK(ring.GetStats().nUnderruns == 1 && ring.GetStats().nMissingSamples == 4);
+		CHECK(ring.Read(out, 1) == 0);
+		CHECK(ring.GetStats().nUnderruns == 2 && ring.GetStats().nMissingSamples == 5);
+
+		//a discard is not an underrun
+		CHECK(ring.Write(in, 6) == 6);
+		CHECK(ring.Discard(10) == 6);
+		CHECK(ring.GetStats().nUnderruns == 2);
+
+		ring.Reset();
+		CHECK(ring.GetAvailable() == 0 && ring.GetStats().nOverruns == 0 && ring.GetStats().nUnderruns == 0);
+	}
+
+	//a stream keeps its channels aligned across the wrap, overruns drop whole frames
+	{
+		const XnUInt32 nChannels = 3;
+		AudioStream stream;
+		stream.Init(nChannels, 16000, 64);
+		std::vector<XnInt16> interleaved(nChannels*48);
+		std::vector<XnFloat> out(nChannels*64);
+		XnFloat* pDest[] = { &out[0], &out[64], &out[128] };
+		XnInt16 nNext = 0, nExpected = 0;
+		int nWrong = 0;
+		for (int pass = 0; pass < 20; pass++)
+		{
+			for (XnUInt32 i = 0; i < 48; i++, nNext++)
+				for (XnUInt32 c = 0; c < nChannels; c++)
+					interleaved[i*nChannels + c] = (XnInt16)(nNext*4 + c);
+			CHECK(stream.Push(&interleaved[0], 48) == 48);
+			CHECK(stream.Read(pDest, 48) == 48);
+			for (XnUInt32 i = 0; i < 48; i++, nExpected++)
+				for (XnUInt32 c = 0; c < nChannels; c++)
+					if (pDest[c][i] != (XnInt16)(nExpected*4 + c) / 32768.0f)
+						++nWrong;
+		}
+		CHECK(nWrong == 0);
+		CHECK(stream.GetStats().nOverruns == 0 && stream.GetStats().nUnderruns == 0);
+
+		CHECK(stream.Push(&interleaved[0], 48) == 48);
+		CHECK(stream.Push(&interleaved[0], 48) == 16);
+		AudioRingStats stats = stream.GetStats();
+		CHECK(stats.nOverruns == 1 && stats.nDroppedSamples == 32*nChannels);
+		CHECK(stream.Trim(10) == 54);
+		CHECK(stream.Read(pDest, 20) == 10);
+		stats = stream.GetStats();
+		CHECK(stats.nUnderruns == 1 && stats.nMissingSamples == 10*nChannels);
+	}
+
+	return checkResult("AudioRingTest");
+}
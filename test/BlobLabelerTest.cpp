@@ -0,0 +1,201 @@
+#include "Check.h"
+#include "BlobLabeler.h"
+#include "DepthBackground.h"
+
+#include <stdlib.h>
+#include <map>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Kinect;
+
+//Component of every pixel by a plain 4 connected flood fill, 0 for the background
+struct FloodFill
+{
+	FloodFill(const std::vector<XnUInt8>& mask, const std::vector<XnDepthPixel>& depth, int width, int height)
+		: labels(width*height, 0)
+	{
+		std::vector<int> stack;
+		for (int i=0; i<width*height; ++i)
+		{
+			if (!mask[i] || labels[i])
+				continue;
+
+			const int label = (int)area.size() + 1;
+			area.push_back(0);
+			sumX.push_back(0);
+			sumY.push_back(0);
+			sumDepth.push_back(0);
+			depthCount.push_back(0);
+			labels[i] = label;
+			stack.push_back(i);
+			while (!stack.empty())
+			{
+				int p = stack.back();
+				stack.pop_back();
+				int x = p % width, y = p / width;
+				area.back()++;
+				sumX.back() += x;
+				sumY.back() += y;
+				if (depth[p])
+				{
+					sumDepth.back() += depth[p];
+					depthCount.back()++;
+				}
+				int neighbours[4] = { x > 0 ? p - 1 : -1, x < width - 1 ? p + 1 : -1, y > 0 ? p - width : -1, y < height - 1 ? p + width : -1 };
+				for (int k=0; k<4; ++k)
+				{
+					int q = neighbours[k];
+					if (q >= 0 && mask[q] && !labels[q])
+					{
+						labels[q] = label;
+						stack.push_back(q);
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<int> labels;
+	std::vector<long long> area, sumX, sumY, sumDepth, depthCount;
+};
+
+//Same partition of the pixels, same area, centroid and mean depth for every blob
+static void checkAgainstFloodFill(const BlobLabeler& labeler, const std::vector<XnUInt8>& mask, const std::vector<XnDepthPixel>& depth, int width, int height)
+{
+	FloodFill reference(mask, depth, width, height);
+	const XnUInt32* labels = labeler.GetLabelMap();
+
+	std::map<int, XnUInt32> toLabeler;
+	std::map<XnUInt32, int> toReference;
+	int nMismatches = 0;
+	for (int i=0; i<width*height; ++i)
+	{
+		if ((reference.labels[i] == 0) != (labels[i] == 0))
+		{
+			++nMismatches;
+			continue;
+		}
+		if (!labels[i])
+			continue;
+		std::map<int, XnUInt32>::iterator a = toLabeler.find(reference.labels[i]);
+		std::map<XnUInt32, int>::iterator b = toReference.find(labels[i]);
+		if ((a != toLabeler.end() && a->second != labels[i]) || (b != toReference.end() && b->second != reference.labels[i]))
+			++nMismatches;
+		toLabeler[reference.labels[i]] = labels[i];
+		toReference[labels[i]] = reference.labels[i];
+	}
+	CHECK(nMismatches == 0);
+	CHECK(labeler.GetComponentCount() == reference.area.size());
+
+	const BlobStats& blobs = labeler.GetBlobs();
+	XnUInt32 nExpected = 0;
+	for (size_t k=0; k<reference.area.size(); ++k)
+		if (reference.area[k] >= labeler.m_nMinArea)
+			++nExpected;
+	CHECK(blobs.nCount == nExpected);
+
+	int nStatErrors = 0;
+	for (XnUInt32 b=0; b<blobs.nCount; ++b)
+	{
+		int k = toReference[blobs.nLabel[b]] - 1;
+		if (k < 0 || blobs.nArea[b] != reference.area[k])
+		{
+			++nStatErrors;
+			continue;
+		}
+		double centerX = (double)reference.sumX[k] / reference.area[k];
+		double centerY = (double)reference.sumY[k] / reference.area[k];
+		double meanDepth = reference.depthCount[k] ? (double)reference.sumDepth[k] / reference.depthCount[k] : 0;
+		if (blobs.fCenterX[b] - centerX > 1e-2 || centerX - blobs.fCenterX[b] > 1e-2 ||
+			blobs.fCenterY[b] - centerY > 1e-2 || centerY - blobs.fCenterY[b] > 1e-2 ||
+			blobs.fMeanDepth[b] - meanDepth > 1e-1 || meanDepth - blobs.fMeanDepth[b] > 1e-1)
+			++nStatErrors;
+	}
+	CHECK(nStatErrors == 0);
+}
+
+int main()
+{
+	const int width = 640, height = 480;
+	std::vector<XnUInt8> mask(width*height);
+	std::vector<XnDepthPixel> depth(width*height);
+
+#ifdef _OPENMP
+	//several threads even on a single core machine, the bands are labelled concurrently
+	omp_set_num_threads(4);
+#endif
+
+	//random masks of several densities, band heights from a single row to the whole frame
+	const XnUInt32 bandHeights[] = { 1, 2, 7, 32, 33, 100, 480 };
+	for (int trial=0; trial<28; ++trial)
+	{
+		srand(trial);
+		int density = 2 + (trial % 4) * 2;
+		for (int i=0; i<width*height; ++i)
+		{
+			mask[i] = (rand() % 10) < density ? 255 : 0;
+			depth[i] = (XnDepthPixel)(rand() % 10 ? rand() % 4000 : 0);
+		}
+
+		BlobLabeler labeler;
+		labeler.m_nMinArea = trial % 2 ? 1 : 20;
+		labeler.Init(width, height, bandHeights[trial % 7]);
+		labeler.Label(&mask[0], &depth[0]);
+		checkAgainstFloodFill(labeler, mask, depth, width, height);
+	}
+
+	//a blob covering the whole frame in a single band: the depth sum goes beyond 32 bits
+	{
+		for (int i=0; i<width*height; ++i)
+		{
+			mask[i] = 255;
+			depth[i] = 60000;
+		}
+		BlobLabeler labeler;
+		labeler.Init(width, height, height);
+		CHECK(labeler.Label(&mask[0], &depth[0]) == 1);
+		CHECK(labeler.GetBlobs().nArea[0] == (XnUInt32)(width*height));
+		CHECK_NEAR(labeler.GetBlobs().fMeanDepth[0], 60000.0f, 0.5f);
+		CHECK(labeler.GetBlobs().nMinDepth[0] == 60000);
+		CHECK_NEAR(labeler.GetBlobs().fCenterX[0], (width - 1) / 2.0f, 1e-2f);
+		CHECK_NEAR(labeler.GetBlobs().fCenterY[0], (height - 1) / 2.0f, 1e-2f);
+	}
+
+	//the background model keeps the blobs one struct each, with its own minimum area
+	{
+		DepthBackgroundModel model;
+		model.m_nLearningFrames = 2;
+		model.m_nMinBlobArea = 50;
+		model.Init(width, height);
+
+		std::vector<XnDepthPixel> scene(width*height, 3000);
+		for (int frame=0; frame<3; ++frame)
+			model.Update(&scene[0]);
+		for (int y=100; y<200; ++y)
+			for (int x=100; x<150; ++x)
+				scene[y*width + x] = 1500;
+		for (int y=300; y<305; ++y)
+			for (int x=400; x<405; ++x)
+				scene[y*width + x] = 1000;
+		model.Update(&scene[0]);
+		model.ExtractBlobs();
+
+		const std::vector<DepthBlob>& blobs = model.GetBlobs();
+		const BlobStats& stats = model.GetBlobStats();
+		CHECK(blobs.size() == 1);
+		CHECK(stats.nCount == 1);
+		if (blobs.size() == 1 && stats.nCount == 1)
+		{
+			CHECK(blobs[0].nArea == 50*100);
+			CHECK(blobs[0].nMinX == 100 && blobs[0].nMaxX == 149);
+			CHECK(blobs[0].nMinY == 100 && blobs[0].nMaxY == 199);
+			CHECK_NEAR(blobs[0].fMeanDepth, 1500.0f, 1e-3f);
+			CHECK(blobs[0].fCenterX == stats.fCenterX[0]);
+		}
+	}
+
+	return checkResult("BlobLabelerTest");
+}
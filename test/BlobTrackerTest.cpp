@@ -0,0 +1,102 @@
+#include "Check.h"
+#include "BlobTracker.h"
+
+using namespace Kinect;
+
+//Appends a blob of the given centroid, mean depth and area to the statistics of a frame
+static void addBlob(BlobStats& blobs, XnFloat fX, XnFloat fY, XnFloat fDepth, XnUInt32 nArea)
+{
+	XnUInt32 nBlob = blobs.nCount;
+	blobs.Resize(nBlob + 1);
+	blobs.nLabel[nBlob] = nBlob + 1;
+	blobs.nArea[nBlob] = nArea;
+	blobs.fCenterX[nBlob] = fX;
+	blobs.fCenterY[nBlob] = fY;
+	blobs.fMeanDepth[nBlob] = fDepth;
+	blobs.nMinDepth[nBlob] = (XnDepthPixel)fDepth;
+}
+
+//The track of a given ID, NULL when it was dropped
+static const TrackedBlob* findTrack(const BlobTracker& tracker, XnUInt32 nID)
+{
+	for (size_t i=0; i<tracker.GetTracks().size(); ++i)
+		if (tracker.GetTracks()[i].nID == nID)
+			return &tracker.GetTracks()[i];
+	return NULL;
+}
+
+int main()
+{
+	BlobTracker tracker;
+	BlobStats blobs;
+	XnFloat fX = 50;
+
+	//a blob moving 10 pixels a frame keeps its ID and the velocity converges
+	for (int frame=0; frame<8; ++frame, fX += 10)
+	{
+		blobs.Resize(0);
+		addBlob(blobs, fX, 100, 1500, 400);
+		tracker.Update(blobs);
+		CHECK(tracker.GetTracks().size() == 1);
+		const TrackedBlob* pTrack = tracker.GetTrackOfBlob(0);
+		CHECK(pTrack != NULL && pTrack->nID == 1);
+		CHECK(pTrack != NULL && pTrack->nAge == (XnUInt32)frame);
+	}
+	const TrackedBlob* pMoving = findTrack(tracker, 1);
+	CHECK(pMoving != NULL);
+	CHECK_NEAR(pMoving->fVelocityX, 10.0f, 0.2f);
+	CHECK_NEAR(pMoving->fVelocityY, 0.0f, 1e-3f);
+	CHECK_NEAR(pMoving->fX, fX - 10, 1e-3f);
+
+	//split: the part closest to the prediction keeps the ID, the other part starts a new track
+	blobs.Resize(0);
+	addBlob(blobs, fX + 25, 100, 1500, 150);
+	addBlob(blobs, fX + 2, 100, 1500, 250);
+	tracker.Update(blobs);
+	CHECK(tracker.GetTracks().size() == 2);
+	CHECK(tracker.GetTrackOfBlob(1) != NULL && tracker.GetTrackOfBlob(1)->nID == 1);
+	CHECK(tracker.GetTrackOfBlob(0) != NULL && tracker.GetTrackOfBlob(0)->nID == 2);
+	CHECK(findTrack(tracker, 1) != NULL && findTrack(tracker, 1)->nArea == 250);
+	CHECK(findTrack(tracker, 2) != NULL && findTrack(tracker, 2)->nAge == 0);
+	fX += 2;
+
+	//the new part disappears: its track coasts for m_nMaxMissedFrames frames, then it is dropped
+	for (XnUInt32 frame=1; frame<=tracker.m_nMaxMissedFrames + 1; ++frame)
+	{
+		fX += 10;
+		blobs.Resize(0);
+		addBlob(blobs, fX, 100, 1500, 250);
+		tracker.Update(blobs);
+		CHECK(tracker.GetTrackOfBlob(0) != NULL && tracker.GetTrackOfBlob(0)->nID == 1);
+		const TrackedBlob* pGone = findTrack(tracker, 2);
+		if (frame <= tracker.m_nMaxMissedFrames)
+		{
+			CHECK(pGone != NULL && pGone->nBlob == -1 && pGone->nMissedFrames == frame);
+		}
+		else
+		{
+			CHECK(pGone == NULL);
+		}
+	}
+	CHECK(tracker.GetTracks().size() == 1);
+
+	//everything disappears, a blob then showing up where the first one was gets a new ID
+	for (XnUInt32 frame=0; frame<=tracker.m_nMaxMissedFrames; ++frame)
+	{
+		blobs.Resize(0);
+		tracker.Update(blobs);
+	}
+	CHECK(tracker.GetTracks().empty());
+	blobs.Resize(0);
+	addBlob(blobs, fX + 10, 100, 1500, 250);
+	tracker.Update(blobs);
+	CHECK(tracker.GetTrackOfBlob(0) != NULL && tracker.GetTrackOfBlob(0)->nID == 3);
+
+	//a blob at the same place but well behind is another object
+	blobs.Resize(0);
+	addBlob(blobs, fX + 10, 100, 1500 + 2*tracker.m_fMaxDepthGap, 250);
+	tracker.Update(blobs);
+	CHECK(tracker.GetTrackOfBlob(0) != NULL && tracker.GetTrackOfBlob(0)->nID == 4);
+
+	return checkResult("BlobTrackerTest");
+}
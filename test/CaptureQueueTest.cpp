@@ -0,0 +1,154 @@
+#include "Check.h"
+#include "CaptureQueue.h"
+
+#include <XnOS.h>
+#include <XnCodecIDs.h>
+#include <XnPropNames.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace xn;
+
+//Records two mock nodes through the capture queue while the draw loop side changes the codec of
+//one of them and takes it out of the recording for a while, the way NiViewer does from its menus.
+//Half way it changes the output mode and mirror of the depth, the recording is then played back
+//with OpenNI to check the changes and the device node reached the file.
+//Built with ThreadSanitizer it checks that the draw loop and the recording thread share nothing
+//unguarded:
+//
+//   make -C test CaptureQueueTest CXXFLAGS="-O1 -g -fsanitize=thread" && test/CaptureQueueTest
+
+static const XnChar* s_csFileName = "CaptureQueueTest.oni";
+static const XnUInt32 s_nXRes = 160, s_nYRes = 120;
+static const XnUInt32 s_nChangeFrame = 150;
+
+//Waits for the recording thread to empty the queue
+static CaptureQueueStatistics drain()
+{
+	CaptureQueueStatistics statistics;
+	for (;;)
+	{
+		captureQueueGetStatistics(&statistics);
+		if (statistics.nQueued == 0)
+			return statistics;
+		xnOSSleep(1);
+	}
+}
+
+//Plays the recording back and checks every depth frame matches the output mode it was recorded with
+static void checkPlayback(XnUInt32 nQueued, const XnMapOutputMode& lastMode)
+{
+	Context context;
+	Player player;
+	CHECK(context.Init() == XN_STATUS_OK);
+	CHECK(context.OpenFileRecording(s_csFileName, player) == XN_STATUS_OK);
+	CHECK(player.SetRepeat(FALSE) == XN_STATUS_OK);
+
+	ProductionNode device;
+	CHECK(context.FindExistingNode(XN_NODE_TYPE_DEVICE, device) == XN_STATUS_OK);
+
+	DepthGenerator depth;
+	CHECK(context.FindExistingNode(XN_NODE_TYPE_DEPTH, depth) == XN_STATUS_OK);
+	XnUInt32 nFrames = 0;
+	CHECK(player.GetNumFrames(depth.GetName(), nFrames) == XN_STATUS_OK);
+	CHECK(nFrames == nQueued);
+
+	XnMapOutputMode mode;
+	for (XnUInt32 nFrame = 0; nFrame < nFrames; ++nFrame)
+	{
+		CHECK(context.WaitOneUpdateAll(depth) == XN_STATUS_OK);
+		CHECK(depth.GetMapOutputMode(mode) == XN_STATUS_OK);
+		CHECK(depth.GetDataSize() == mode.nXRes*mode.nYRes*sizeof(XnDepthPixel));
+	}
+	CHECK(mode.nXRes == lastMode.nXRes && mode.nYRes == lastMode.nYRes);
+	CHECK(depth.GetMirrorCap().IsMirrored());
+
+	depth.Release();
+	device.Release();
+	player.Release();
+	context.Release();
+}
+
+int main()
+{
+	Context context;
+	ProductionNode device;
+	MockDepthGenerator depth;
+	MockImageGenerator image;
+	CHECK(context.Init() == XN_STATUS_OK);
+	CHECK(context.CreateMockNode(XN_NODE_TYPE_DEVICE, "Device1", device) == XN_STATUS_OK);
+	CHECK(depth.Create(context, "Depth1") == XN_STATUS_OK);
+	CHECK(image.Create(context, "Image1") == XN_STATUS_OK);
+	XnMapOutputMode mode = { s_nXRes, s_nYRes, 30 };
+	XnMapOutputMode changedMode = { s_nXRes/2, s_nYRes/2, 30 };
+	CHECK(depth.SetMapOutputMode(mode) == XN_STATUS_OK);
+	CHECK(depth.SetIntProperty(XN_PROP_MIRROR, FALSE) == XN_STATUS_OK);
+	CHECK(image.SetMapOutputMode(mode) == XN_STATUS_OK);
+	CHECK(image.SetPixelFormat(XN_PIXEL_FORMAT_RGB24) == XN_STATUS_OK);
+
+	std::vector<XnDepthPixel> depthMap(s_nXRes*s_nYRes);
+	std::vector<XnUInt8> imageMap(3*s_nXRes*s_nYRes);
+
+	CHECK(captureQueueOpen(s_csFileName) == XN_STATUS_OK);
+	CHECK(captureQueueAddDevice(device) == XN_STATUS_OK);
+	CHECK(captureQueueAddNode(depth, XN_CODEC_16Z_EMB_TABLES) == XN_STATUS_OK);
+	CHECK(captureQueueAddNode(image, XN_CODEC_JPEG) == XN_STATUS_OK);
+
+	const XnUInt32 nFrames = 300;
+	XnUInt32 nQueued = 0, nImageQueued = 0;
+	bool bImage = true;
+	for (XnUInt32 nFrame = 1; nFrame <= nFrames; ++nFrame)
+	{
+		//the frames queued before the change are still recorded with the old mode
+		if (nFrame == s_nChangeFrame)
+		{
+			CHECK(depth.SetMapOutputMode(changedMode) == XN_STATUS_OK);
+			CHECK(depth.GetMirrorCap().SetMirror(TRUE) == XN_STATUS_OK);
+			depthMap.resize(changedMode.nXRes*changedMode.nYRes);
+		}
+
+		for (XnUInt32 i = 0; i < depthMap.size(); ++i)
+			depthMap[i] = (XnDepthPixel)(1000 + (i + nFrame) % 1000);
+		for (XnUInt32 i = 0; i < imageMap.size(); ++i)
+			imageMap[i] = (XnUInt8)(i + nFrame);
+		CHECK(depth.SetData(nFrame, nFrame*33333, (XnUInt32)(depthMap.size()*sizeof(XnDepthPixel)), &depthMap[0]) == XN_STATUS_OK);
+		CHECK(image.SetData(nFrame, nFrame*33333, (XnUInt32)imageMap.size(), &imageMap[0]) == XN_STATUS_OK);
+		CHECK(context.WaitNoneUpdateAll() == XN_STATUS_OK);
+
+		//frames of the image queued before are still waiting when it changes
+		if (nFrame % 40 == 0)
+		{
+			bImage = !bImage;
+			CHECK((bImage ? captureQueueAddNode(image, XN_CODEC_JPEG) : captureQueueRemoveNode(image)) == XN_STATUS_OK);
+		}
+		else if (nFrame % 25 == 0 && bImage)
+		{
+			CHECK(captureQueueAddNode(image, nFrame % 50 ? XN_CODEC_UNCOMPRESSED : XN_CODEC_JPEG) == XN_STATUS_OK);
+		}
+
+		bool bQueued = false;
+		CHECK(captureQueuePush(&bQueued) == XN_STATUS_OK);
+		if (bQueued)
+		{
+			++nQueued;
+			if (bImage)
+				++nImageQueued;
+		}
+	}
+
+	//every frame has new depth: it is either recorded or dropped, and the draw loop saw which
+	CaptureQueueStatistics statistics = drain();
+	CHECK(statistics.nRecorded == nQueued);
+	CHECK(statistics.nRecorded + statistics.nDropped == nFrames);
+	CHECK(statistics.nMaxQueued <= CAPTURE_QUEUE_SLOTS);
+	captureQueueClose();
+
+	checkPlayback(nQueued, changedMode);
+
+	image.Release();
+	depth.Release();
+	device.Release();
+	context.Release();
+	remove(s_csFileName);
+	return checkResult("CaptureQueueTest");
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+
+//Minimal checks for the standalone test programs of this directory, each one returns
+//non zero from main when a check failed
+
+static int g_checkFailures = 0;
+
+#define CHECK(cond)                                                         \
+	do {                                                                    \
+		if (!(cond))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			++g_checkFailures;                                              \
+		}                                                                   \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(((a) > (b) ? (a) - (b) : (b) - (a)) <= (tolerance))
+
+static int checkResult(const char* name)
+{
+	if (g_checkFailures)
+		printf("%s: %d check(s) failed\n", name, g_checkFailures);
+	else
+		printf("%s: ok\n", name);
+	return g_checkFailures ? 1 : 0;
+}
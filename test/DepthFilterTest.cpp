@@ -0,0 +1,222 @@
+#include "Check.h"
+#include "DepthFilter.h"
+
+#include <stdlib.h>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Kinect;
+
+//Two walls meeting on a vertical edge, sensor noise, scattered holes and an object entering the
+//view after a few frames
+static void makeFrame(std::vector<XnDepthPixel>& depth, int width, int height, int frame)
+{
+	for (int y=0; y<height; ++y)
+	{
+		for (int x=0; x<width; ++x)
+		{
+			int z = (x < width/2 ? 1000 : 2500) + rand() % 11 - 5;
+			if (rand() % 20 == 0)
+				z = 0;
+			if (frame > 3 && x > width/8 && x < width/3 && y > height/4 && y < height/2)
+				z = 800 + rand() % 5;
+			depth[y*width + x] = (XnDepthPixel)z;
+		}
+	}
+}
+
+//The SSE2 loops against the scalar ones over frames with holes, edges and motion; the odd width
+//leaves tails to the scalar loops of the SSE2 filter too
+static void checkScalarMatch(int width, int height)
+{
+	DepthFilter simd, scalar;
+	simd.Init(width, height);
+	scalar.Init(width, height);
+	scalar.m_bScalar = TRUE;
+	simd.m_fBudget = scalar.m_fBudget = 1e9;
+
+	std::vector<XnDepthPixel> input(width*height);
+	srand(1);
+	int nDifferent = 0;
+	for (int frame=0; frame<8; ++frame)
+	{
+		makeFrame(input, width, height, frame);
+		const XnDepthPixel* a = simd.Process(&input[0]);
+		const XnDepthPixel* b = scalar.Process(&input[0]);
+		for (int i=0; i<width*height; ++i)
+			if (a[i] != b[i])
+				++nDifferent;
+		CHECK(simd.GetStats().nHolesOut == scalar.GetStats().nHolesOut);
+		CHECK(simd.GetStats().nSkippedStages == 0);
+	}
+	CHECK(nDifferent == 0);
+}
+
+#ifdef _OPENMP
+//The bands spread over several threads against a single thread: same maps, same holes, the noise
+//only differs by the order of the reduction
+static void checkThreadsMatch(int width, int height)
+{
+	DepthFilter threaded, serial;
+	threaded.Init(width, height);
+	serial.Init(width, height);
+	threaded.m_fBudget = serial.m_fBudget = 1e9;
+
+	std::vector<XnDepthPixel> input(width*height);
+	srand(3);
+	int nDifferent = 0;
+	for (int frame=0; frame<8; ++frame)
+	{
+		makeFrame(input, width, height, frame);
+		omp_set_num_threads(4);
+		const XnDepthPixel* a = threaded.Process(&input[0]);
+		omp_set_num_threads(1);
+		const XnDepthPixel* b = serial.Process(&input[0]);
+		for (int i=0; i<width*height; ++i)
+			if (a[i] != b[i])
+				++nDifferent;
+		CHECK(threaded.GetStats().nHolesOut == serial.GetStats().nHolesOut);
+		CHECK_NEAR(threaded.GetStats().fTemporalNoise, serial.GetStats().fTemporalNoise, 1e-3f);
+	}
+	CHECK(nDifferent == 0);
+	omp_set_num_threads(4);
+}
+#endif
+
+int main()
+{
+#ifdef _OPENMP
+	//several threads even on a single core machine, the bands must not step on each other
+	omp_set_num_threads(4);
+	checkThreadsMatch(640, 480);
+	checkThreadsMatch(643, 37);
+#endif
+	checkScalarMatch(640, 480);
+	checkScalarMatch(643, 37);
+
+	//hole filling: the median of the valid neighbours, only with enough of them
+	{
+		const int width = 16, height = 8;
+		DepthFilter filter;
+		filter.Init(width, height);
+		filter.m_bBilateral = FALSE;
+		filter.m_bTemporal = FALSE;
+		filter.m_nMinValidNeighbours = 4;
+
+		std::vector<XnDepthPixel> input(width*height, 1200);
+		input[3*width + 4] = 0;
+		input[2*width + 3] = 1100;
+		input[2*width + 4] = 1300;
+		for (int y=4; y<7; ++y)
+			for (int x=9; x<14; ++x)
+				input[y*width + x] = 0;
+		input[5*width + 14] = 1500;
+
+		const XnDepthPixel* output = filter.Process(&input[0]);
+		CHECK(output[3*width + 4] == 1200);
+		CHECK(output[5*width + 11] == 0);
+		CHECK(output[5*width + 13] == 0);
+		CHECK(output[4*width + 9] == 1200);
+		CHECK(filter.GetStats().nHolesIn == 16);
+		CHECK(filter.GetStats().nHolesOut < 16);
+		CHECK(input[3*width + 4] == 0);
+	}
+
+	//bilateral: flat areas are smoothed, a step edge is kept
+	{
+		const int width = 64, height = 32;
+		DepthFilter filter;
+		filter.Init(width, height);
+		filter.m_bHoleFill = FALSE;
+		filter.m_bTemporal = FALSE;
+
+		std::vector<XnDepthPixel> input(width*height);
+		for (int y=0; y<height; ++y)
+			for (int x=0; x<width; ++x)
+				input[y*width + x] = (XnDepthPixel)((x < 32 ? 1000 : 2000) + ((x + y) % 2 ? 4 : -4));
+
+		const XnDepthPixel* output = filter.Process(&input[0]);
+		for (int y=2; y<height-2; ++y)
+		{
+			CHECK_NEAR((int)output[y*width + 10], 1000, 3);
+			CHECK_NEAR((int)output[y*width + 31], 1000, 5);
+			CHECK_NEAR((int)output[y*width + 32], 2000, 5);
+			CHECK_NEAR((int)output[y*width + 50], 2000, 3);
+		}
+	}
+
+	//temporal: still pixels are averaged, moving ones follow at once, holes are held a few frames
+	{
+		const int width = 16, height = 4;
+		DepthFilter filter;
+		filter.Init(width, height);
+		filter.m_bHoleFill = FALSE;
+		filter.m_bBilateral = FALSE;
+		filter.m_nHoleHoldFrames = 2;
+
+		std::vector<XnDepthPixel> input(width*height, 1000);
+		std::vector<XnDepthPixel> output(width*height);
+		filter.Process(&input[0], &output[0]);
+		input[5] = 1010;
+		filter.Process(&input[0], &output[0]);
+		CHECK(output[5] == 1004);
+
+		input[5] = 1500;
+		input[6] = 0;
+		filter.Process(&input[0], &output[0]);
+		CHECK(output[5] == 1500);
+		CHECK(output[6] == 1000);
+		filter.Process(&input[0], &output[0]);
+		CHECK(output[6] == 1000);
+		filter.Process(&input[0], &output[0]);
+		CHECK(output[6] == 0);
+	}
+
+	//temporal noise: the change of the still pixels only, holes and moving pixels do not dilute it
+	for (int nScalar=0; nScalar<2; ++nScalar)
+	{
+		const int width = 16, height = 4;
+		DepthFilter filter;
+		filter.Init(width, height);
+		filter.m_bScalar = nScalar;
+		filter.m_bHoleFill = FALSE;
+		filter.m_bBilateral = FALSE;
+
+		std::vector<XnDepthPixel> input(width*height, 1000);
+		for (int i=2*width; i<3*width; ++i)
+			input[i] = 0;
+		filter.Process(&input[0]);
+		CHECK(filter.GetStats().fTemporalNoise == 0);
+
+		for (int i=0; i<2*width; ++i)
+			input[i] = 1010;
+		for (int i=3*width; i<4*width; ++i)
+			input[i] = 2000;
+		filter.Process(&input[0]);
+		CHECK_NEAR(filter.GetStats().fTemporalNoise, 10*filter.m_fTemporalAlpha, 1e-3f);
+	}
+
+	//in place and into the buffer of the filter give the same map
+	{
+		const int width = 64, height = 48;
+		DepthFilter a, b;
+		a.Init(width, height);
+		b.Init(width, height);
+		std::vector<XnDepthPixel> input(width*height);
+		srand(2);
+		makeFrame(input, width, height, 0);
+		std::vector<XnDepthPixel> inPlace = input;
+		a.Process(&inPlace[0], &inPlace[0]);
+		const XnDepthPixel* output = b.Process(&input[0]);
+		CHECK(output == b.GetOutput());
+		int nDifferent = 0;
+		for (int i=0; i<width*height; ++i)
+			if (output[i] != inPlace[i])
+				++nDifferent;
+		CHECK(nDifferent == 0);
+	}
+
+	return checkResult("DepthFilterTest");
+}
@@ -0,0 +1,210 @@
+#include "Check.h"
+#include "DepthOcclusion.h"
+
+#include <cmath>
+#include <vector>
+
+//Depth frame of the tests, row pitch larger than the width like a cropped or padded buffer
+struct DepthFrame
+{
+	DepthFrame(int _width, int _height, int _pitch) : width(_width), height(_height), pitch(_pitch), data(_pitch*_height, 0) {}
+
+	void fill(int x0, int y0, int x1, int y1, unsigned short z)
+	{
+		for (int y=y0; y<y1; ++y)
+			for (int x=x0; x<x1; ++x)
+				data[y*pitch + x] = z;
+	}
+
+	int width, height, pitch;
+	std::vector<unsigned short> data;
+};
+
+//Wall at 3 m with a floor getting closer toward the bottom, a person standing in front of it,
+//a hole (no depth) and a window out of the depth range
+static void drawScene(DepthFrame& frame, int personX)
+{
+	frame.fill(0, 0, frame.width, frame.height, 3000);
+	for (int y=300; y<frame.height; ++y)
+		frame.fill(0, y, frame.width, y + 1, (unsigned short)(3000 - (y - 300) * 2));
+	frame.fill(personX, 100, personX + 100, 420, 1500);
+	frame.fill(500, 40, 560, 90, 0);
+	frame.fill(20, 20, 120, 80, 6000);
+}
+
+//Reference mask computed from scratch on the frame: a cell occludes when its 4 corners are in the
+//depth range and do not span a silhouette
+static bool referenceCell(const DepthFrame& frame, int step, int cellX, int cellY)
+{
+	float zMin = 1e9f, zMax = 0.0f;
+	for (int k=0; k<4; ++k)
+	{
+		int x = (cellX + (k & 1)) * step;
+		int y = (cellY + (k >> 1)) * step;
+		float z = frame.data[y*frame.pitch + x];
+		if (z < DepthOcclusion::minDepth || z > DepthOcclusion::maxDepth)
+			return false;
+		zMin = z < zMin ? z : zMin;
+		zMax = z > zMax ? z : zMax;
+	}
+	return zMax - zMin <= zMin * DepthOcclusion::maxJumpRatio;
+}
+
+static int countMaskErrors(const DepthOcclusion& occlusion, const DepthFrame& frame)
+{
+	int errors = 0;
+	const int step = occlusion.getGridStep();
+	for (int cellY=0; cellY<occlusion.getGridHeight()-1; ++cellY)
+		for (int cellX=0; cellX<occlusion.getGridWidth()-1; ++cellX)
+			if (occlusion.isCellOccluder(cellX, cellY) != referenceCell(frame, step, cellX, cellY))
+				++errors;
+	return errors;
+}
+
+//Grid points back-projected with the intrinsics, holes and out of range samples at the origin
+static int countVertexErrors(const DepthOcclusion& occlusion, const DepthFrame& frame)
+{
+	int errors = 0;
+	const int step = occlusion.getGridStep();
+	const float* vertex = occlusion.getVertices();
+	for (int r=0; r<occlusion.getGridHeight(); ++r)
+	{
+		for (int c=0; c<occlusion.getGridWidth(); ++c, vertex+=3)
+		{
+			float z = frame.data[r*step*frame.pitch + c*step];
+			if (z < DepthOcclusion::minDepth || z > DepthOcclusion::maxDepth)
+				z = 0.0f;
+			float x = (c*step - DepthOcclusion::cx) / DepthOcclusion::fx * z;
+			float y = -(r*step - DepthOcclusion::cy) / DepthOcclusion::fy * z;
+			float dx = vertex[0] - x, dy = vertex[1] - y, dz = vertex[2] + z;
+			if (dx*dx + dy*dy + dz*dz > 1e-4f)
+				++errors;
+		}
+	}
+	return errors;
+}
+
+//Pixel where a camera space point lands with the camera of DepthOcclusion::setupCamera, following the
+//Ogre frustum (perspective divide, then NDC to a width x height viewport, Y down)
+static void projectToPixel(const float* point, int width, int height, float& u, float& v)
+{
+	Ogre::Radian fovY;
+	Ogre::Real aspectRatio;
+	Ogre::Vector2 offset;
+	DepthOcclusion::getProjection(width, height, fovY, aspectRatio, offset);
+
+	float tanY = Ogre::Math::Tan(fovY * 0.5f);
+	float tanX = tanY * aspectRatio;
+	float left = -tanX + offset.x, right = tanX + offset.x;
+	float bottom = -tanY + offset.y, top = tanY + offset.y;
+
+	float x = point[0] / -point[2], y = point[1] / -point[2];
+	float ndcX = (2*x - (right + left)) / (right - left);
+	float ndcY = (2*y - (top + bottom)) / (top - bottom);
+	u = (ndcX + 1) * 0.5f * width;
+	v = (1 - ndcY) * 0.5f * height;
+}
+
+int main()
+{
+	//full frame, then incremental updates
+	{
+		DepthOcclusion occlusion;
+		occlusion.resize(640, 480, 4);
+		CHECK(occlusion.getGridStep() == 4);
+		CHECK(occlusion.getGridWidth() == 160);
+		CHECK(occlusion.getGridHeight() == 120);
+
+		DepthFrame frame(640, 480, 648);
+		drawScene(frame, 200);
+		CHECK(occlusion.updateGrid(&frame.data[0], frame.pitch));
+		CHECK(occlusion.getDirtyRowBegin() == 0);
+		CHECK(occlusion.getDirtyRowEnd() == 120);
+		CHECK(countMaskErrors(occlusion, frame) == 0);
+		CHECK(countVertexErrors(occlusion, frame) == 0);
+
+		//the person walks to the right, only the grid rows it spans are rebuilt
+		drawScene(frame, 260);
+		CHECK(occlusion.updateGrid(&frame.data[0], frame.pitch));
+		CHECK(occlusion.getDirtyRowBegin() == 100 / 4);
+		CHECK(occlusion.getDirtyRowEnd() == (420 + 3) / 4);
+		CHECK(countMaskErrors(occlusion, frame) == 0);
+		CHECK(countVertexErrors(occlusion, frame) == 0);
+
+		//sensor noise below the tolerance dirties nothing, the mesh stays the one of the last frame
+		DepthFrame noisy = frame;
+		for (size_t i=0; i<noisy.data.size(); ++i)
+			if (noisy.data[i] >= DepthOcclusion::minDepth && noisy.data[i] <= DepthOcclusion::maxDepth)
+				noisy.data[i] += (unsigned short)(i % 5);
+		CHECK(!occlusion.updateGrid(&noisy.data[0], noisy.pitch));
+		CHECK(countMaskErrors(occlusion, frame) == 0);
+
+		//a hole opening in a single row
+		drawScene(frame, 260);
+		frame.fill(0, 240, 640, 241, 0);
+		CHECK(occlusion.updateGrid(&frame.data[0], frame.pitch));
+		CHECK(occlusion.getDirtyRowBegin() == 60);
+		CHECK(occlusion.getDirtyRowEnd() == 61);
+		CHECK(countMaskErrors(occlusion, frame) == 0);
+		CHECK(countVertexErrors(occlusion, frame) == 0);
+	}
+
+	//meshes of different sizes and steps do not share their grid step
+	{
+		DepthOcclusion coarse, fine, full;
+		coarse.resize(640, 480, 4);
+		fine.resize(160, 120, 1);
+		full.resize(640, 480, 1);
+		CHECK(coarse.getGridStep() == 4);
+		CHECK(fine.getGridStep() == 1);
+		CHECK(full.getGridStep() == 3);
+		CHECK(full.getGridWidth() * full.getGridHeight() <= 65535);
+		CHECK(DepthOcclusion::gridStep == 4);
+
+		DepthFrame small(160, 120, 160);
+		small.fill(0, 0, 160, 120, 2000);
+		small.fill(40, 30, 80, 90, 1000);
+		CHECK(fine.updateGrid(&small.data[0], small.pitch));
+		CHECK(countMaskErrors(fine, small) == 0);
+		CHECK(countVertexErrors(fine, small) == 0);
+
+		DepthFrame frame(640, 480, 640);
+		drawScene(frame, 330);
+		CHECK(coarse.updateGrid(&frame.data[0], frame.pitch));
+		CHECK(full.updateGrid(&frame.data[0], frame.pitch));
+		CHECK(countMaskErrors(coarse, frame) == 0);
+		CHECK(countMaskErrors(full, frame) == 0);
+		CHECK(countVertexErrors(full, frame) == 0);
+	}
+
+	//the camera projection matches the intrinsics: grid points land back on their depth pixel
+	{
+		DepthOcclusion occlusion;
+		occlusion.resize(640, 480, 4);
+		DepthFrame frame(640, 480, 640);
+		drawScene(frame, 200);
+		CHECK(occlusion.updateGrid(&frame.data[0], frame.pitch));
+
+		const int points[][2] = { {0, 0}, {159, 0}, {0, 119}, {159, 119}, {82, 67}, {60, 50} };
+		for (int i=0; i<6; ++i)
+		{
+			int c = points[i][0], r = points[i][1];
+			const float* vertex = occlusion.getVertices() + (r*occlusion.getGridWidth() + c)*3;
+			CHECK(vertex[2] < 0);
+			float u, v;
+			projectToPixel(vertex, 640, 480, u, v);
+			CHECK_NEAR(u, c*4, 1e-2f);
+			CHECK_NEAR(v, r*4, 1e-2f);
+		}
+
+		//the principal point is off centre, a centred 40 degrees camera would miss it
+		Ogre::Radian fovY;
+		Ogre::Real aspectRatio;
+		Ogre::Vector2 offset;
+		DepthOcclusion::getProjection(640, 480, fovY, aspectRatio, offset);
+		CHECK(offset.x != 0 && offset.y != 0);
+		CHECK_NEAR(fovY.valueRadians(), 2*atan(240 / DepthOcclusion::fy), 1e-5f);
+	}
+
+	return checkResult("DepthOcclusionTest");
+}
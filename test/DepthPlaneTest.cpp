@@ -0,0 +1,105 @@
+#include "Check.h"
+#include "DepthPlane.h"
+
+#include <stdlib.h>
+#include <vector>
+
+//Samples of Z = a*X + b*Y + c on a size x size mm square centered on (x0, y0), plus uniform noise
+static void addPlane(DepthPlaneFitter& fitter, float a, float b, float c, float x0, float y0, float size, int count, float noise)
+{
+	srand(1);
+	for (int j=0; j<count; ++j)
+	{
+		for (int i=0; i<count; ++i)
+		{
+			float x = x0 + size * (i / (float)(count - 1) - 0.5f);
+			float y = y0 + size * (j / (float)(count - 1) - 0.5f);
+			float n = noise * (rand() / (float)RAND_MAX * 2.0f - 1.0f);
+			fitter.addSample(x, y, a*x + b*y + c + n);
+		}
+	}
+}
+
+int main()
+{
+	DepthPlane plane;
+
+	//a marker 1.5 m away, tilted on both axes
+	{
+		DepthPlaneFitter fitter;
+		addPlane(fitter, 0.3f, -0.2f, 1500.0f, 100.0f, -50.0f, 120.0f, 33, 1.0f);
+		CHECK(fitter.fit(plane, 64, 15.0f));
+		CHECK(plane.samples == 33*33);
+		CHECK_NEAR(plane.a, 0.3f, 0.01f);
+		CHECK_NEAR(plane.b, -0.2f, 0.01f);
+		CHECK_NEAR(plane.c, 1500.0f, 1.0f);
+		CHECK(plane.rmsError < 1.0f);
+	}
+
+	//a small marker 4 m away: the mean dominates the raw moments, the centered ones keep the slope
+	{
+		DepthPlaneFitter fitter;
+		addPlane(fitter, 0.5f, 0.25f, 4000.0f, -900.0f, 600.0f, 20.0f, 15, 0.0f);
+		CHECK(fitter.fit(plane, 64, 15.0f));
+		CHECK_NEAR(plane.a, 0.5f, 1e-3f);
+		CHECK_NEAR(plane.b, 0.25f, 1e-3f);
+		CHECK(plane.rmsError < 0.5f);
+	}
+
+	//an odd sample count goes through the scalar tail after the paired loop
+	{
+		DepthPlaneFitter fitter;
+		addPlane(fitter, -0.1f, 0.4f, 2500.0f, 0.0f, 0.0f, 80.0f, 9, 0.0f);
+		CHECK(fitter.getSampleCount() % 2 == 1);
+		CHECK(fitter.fit(plane, 64, 15.0f));
+		CHECK_NEAR(plane.a, -0.1f, 1e-3f);
+		CHECK_NEAR(plane.b, 0.4f, 1e-3f);
+	}
+
+	//samples on a line are degenerate whatever their scale
+	{
+		DepthPlaneFitter nearFitter, farFitter;
+		for (int i=0; i<200; ++i)
+		{
+			nearFitter.addSample(i * 0.01f, 0.0f, 500.0f + i * 0.01f);
+			farFitter.addSample(i * 20.0f, i * 10.0f, 4000.0f + i);
+		}
+		CHECK(!nearFitter.fit(plane, 64, 15.0f));
+		CHECK(!farFitter.fit(plane, 64, 15.0f));
+	}
+
+	//too few samples, or a residual above the threshold
+	{
+		DepthPlaneFitter fitter;
+		addPlane(fitter, 0.0f, 0.0f, 1000.0f, 0.0f, 0.0f, 50.0f, 7, 0.0f);
+		CHECK(!fitter.fit(plane, 64, 15.0f));
+		CHECK(plane.samples == 49);
+
+		DepthPlaneFitter noisy;
+		addPlane(noisy, 0.0f, 0.0f, 1000.0f, 0.0f, 0.0f, 50.0f, 20, 60.0f);
+		CHECK(!noisy.fit(plane, 64, 15.0f));
+		CHECK(plane.rmsError > 15.0f);
+	}
+
+	//depth rows: holes are skipped, the pixels are back-projected with the intrinsics
+	{
+		DepthPlaneFitter fitter;
+		fitter.setIntrinsics(500.0f, 500.0f, 320.0f, 240.0f);
+		std::vector<unsigned short> row(640, 2000);
+		row[330] = 0;
+		row[331] = 0;
+		for (int v=200; v<260; ++v)
+			fitter.addRow(&row[0], v, 300, 359, 1);
+		CHECK(fitter.getSampleCount() == 60*58);
+		CHECK(fitter.fit(plane, 64, 15.0f));
+		CHECK_NEAR(plane.a, 0.0f, 1e-4f);
+		CHECK_NEAR(plane.b, 0.0f, 1e-4f);
+		CHECK_NEAR(plane.c, 2000.0f, 0.01f);
+
+		fitter.clear();
+		fitter.addRow(&row[0], 200, 300, 359, 2);
+		CHECK(fitter.getSampleCount() == 30 - 1);
+	}
+
+	return checkResult("DepthPlaneTest");
+}
@@ -0,0 +1,75 @@
+#include "Check.h"
+#include "FrameIndex.h"
+
+//Frames of a 30 FPS recording, timestamps in microseconds like the player gives them
+static XnUInt64 frameTime(XnUInt32 nFrame)
+{
+	return 1000000 + (XnUInt64)(nFrame - 1) * 33333;
+}
+
+static XnUInt32 findFrame(const XnChar* strNodeName, XnUInt64 nTimestamp, XnUInt32 nNumFrames)
+{
+	XnUInt32 nFrame = 0;
+	CHECK(frameIndexFindFrame(strNodeName, nTimestamp, nNumFrames, &nFrame) == XN_STATUS_OK);
+	return nFrame;
+}
+
+int main()
+{
+	//nothing to look up before the first frame is read
+	{
+		XnUInt32 nFrame = 0;
+		CHECK(frameIndexFindFrame("Depth1", 0, 900, &nFrame) == XN_STATUS_NO_MATCH);
+	}
+
+	//frames played in order: exact times, times between two frames, the ends of the recording
+	{
+		frameIndexClear();
+		for (XnUInt32 nFrame = 1; nFrame <= 100; ++nFrame)
+			frameIndexAddFrame("Depth1", nFrame, frameTime(nFrame));
+		CHECK(findFrame("Depth1", frameTime(40), 900) == 40);
+		CHECK(findFrame("Depth1", frameTime(40) + 1, 900) == 41);
+		CHECK(findFrame("Depth1", 0, 900) == 1);
+		CHECK(findFrame("Depth1", frameTime(100), 900) == 100);
+	}
+
+	//past the frames seen so far, at their frame rate and up to the frame count of the player
+	{
+		CHECK(findFrame("Depth1", frameTime(400), 900) == 400);
+		CHECK(findFrame("Depth1", frameTime(400) - 100, 900) == 400);
+		CHECK(findFrame("Depth1", frameTime(2000), 900) == 900);
+		CHECK(findFrame("Depth1", frameTime(2000), 0) == 2000);
+	}
+
+	//a seek leaves a gap, frames in it are interpolated; frames read again are not added twice
+	{
+		for (XnUInt32 nFrame = 500; nFrame <= 510; ++nFrame)
+			frameIndexAddFrame("Depth1", nFrame, frameTime(nFrame));
+		frameIndexAddFrame("Depth1", 50, frameTime(50));
+		frameIndexAddFrame("Depth1", 505, frameTime(505));
+		CHECK(findFrame("Depth1", frameTime(300), 900) == 300);
+		CHECK(findFrame("Depth1", frameTime(505), 900) == 505);
+		CHECK(findFrame("Depth1", frameTime(700), 900) == 700);
+
+		//played backwards from further on, before the frames seen
+		frameIndexClear();
+		for (XnUInt32 nFrame = 600; nFrame >= 590; --nFrame)
+			frameIndexAddFrame("Depth1", nFrame, frameTime(nFrame));
+		CHECK(findFrame("Depth1", frameTime(595), 900) == 595);
+		CHECK(findFrame("Depth1", frameTime(200), 900) == 200);
+		CHECK(findFrame("Depth1", 0, 900) == 1);
+	}
+
+	//nodes are indexed apart, a single frame cannot tell a frame rate
+	{
+		frameIndexAddFrame("Image1", 7, frameTime(7));
+		CHECK(findFrame("Image1", frameTime(3), 900) == 7);
+		CHECK(findFrame("Image1", frameTime(9), 900) == 7);
+		CHECK(findFrame("Depth1", frameTime(595), 900) == 595);
+		frameIndexClear();
+		XnUInt32 nFrame = 0;
+		CHECK(frameIndexFindFrame("Image1", frameTime(7), 900, &nFrame) == XN_STATUS_NO_MATCH);
+	}
+
+	return checkResult("FrameIndexTest");
+}
@@ -0,0 +1,223 @@
+#include "Check.h"
+#include "JointFilter.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Replays the joint filter over skeleton tracks: synthetic ones for the checks, or the track given
+//on the command line (written by KinectDevice::recordSkeletonTrack) to tune the filter
+//
+//   JointFilterTest                                  runs the checks
+//   JointFilterTest <track> [minCutoff beta ...]     prints lag and jitter of the track for each
+//                                                    tuning, the same for all joint groups
+
+static const double PI = 3.14159265358979;
+
+//Uniform noise in [-amplitude, amplitude]
+static float noise(float amplitude)
+{
+	return amplitude * (rand() / (float)RAND_MAX * 2.0f - 1.0f);
+}
+
+//One snapshot line per frame, every joint at the same position plus its own offset and noise
+static void writeFrame(FILE* file, XnUInt64 timestamp, XnUInt32 frame, const XnUserID* users, const float (*positions)[3], XnUInt32 userCount, float jitter, float confidence)
+{
+	fprintf(file, "skeleton %llu %u %u %x\n", (unsigned long long)timestamp, frame, userCount, 0xfffff7);
+	for (XnUInt32 u=0; u<userCount; ++u)
+	{
+		fprintf(file, "%u", users[u]);
+		for (int j=0; j<SKELETON_JOINT_COUNT; ++j)
+			fprintf(file, " %.3f %.3f %.3f %.2f", positions[u][0] + j*10 + noise(jitter), positions[u][1] + noise(jitter), positions[u][2] + noise(jitter), confidence);
+		fprintf(file, "\n");
+	}
+}
+
+static XnUInt32 replay(FILE* track, JointFilter& filter)
+{
+	SkeletonSnapshot snapshot;
+	XnUInt32 frames = 0;
+	rewind(track);
+	filter.Reset();
+	while (snapshot.Read(track) == XN_STATUS_OK)
+	{
+		filter.Update(snapshot);
+		++frames;
+	}
+	return frames;
+}
+
+static int tune(const char* fileName, int paramCount, char** params)
+{
+	FILE* track = fopen(fileName, "r");
+	if (track == NULL)
+	{
+		printf("cannot open %s\n", fileName);
+		return 1;
+	}
+
+	for (int p=0; p==0 || p+1<paramCount; p+=2)
+	{
+		JointFilter filter;
+		filter.m_bCollectStats = TRUE;
+		if (p+1 < paramCount)
+		{
+			for (int g=0; g<JOINT_GROUP_COUNT; ++g)
+			{
+				JointFilterParams tuning = filter.GetParams((JointGroup)g);
+				tuning.fMinCutoff = (XnFloat)atof(params[p]);
+				tuning.fBeta = (XnFloat)atof(params[p+1]);
+				filter.SetParams((JointGroup)g, tuning);
+			}
+		}
+		XnUInt32 frames = replay(track, filter);
+		const JointFilterStats& stats = filter.GetStats();
+		if (p+1 < paramCount)
+			printf("min cutoff %s beta %s: ", params[p], params[p+1]);
+		else
+			printf("default tuning: ");
+		printf("%u frames, jitter %.2f mm (raw %.2f), lag %.2f mm over %u samples\n",
+			frames, stats.fJitter, stats.fRawJitter, stats.fLag, stats.nSamples);
+	}
+
+	fclose(track);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		return tune(argv[1], argc - 2, argv + 2);
+
+	const XnUInt64 frameTime = 33333;
+	srand(1);
+
+	//the track format: read back and written again gives the same text
+	{
+		FILE* track = tmpfile();
+		XnUserID users[2] = { 3, 7 };
+		float positions[2][3] = { { 100, -50, 2000 }, { -400, 20, 2500 } };
+		writeFrame(track, 1000, 1, users, positions, 2, 0, 0.5f);
+		writeFrame(track, 1000 + frameTime, 2, users, positions, 1, 0, 1.0f);
+		rewind(track);
+
+		SkeletonSnapshot snapshot;
+		CHECK(snapshot.Read(track) == XN_STATUS_OK);
+		CHECK(snapshot.GetUserCount() == 2);
+		CHECK(snapshot.GetUserID(1) == 7);
+		CHECK(snapshot.GetTimestamp() == 1000);
+		CHECK(!snapshot.IsJointActive(XN_SKEL_WAIST));
+		CHECK(snapshot.IsJointActive(XN_SKEL_RIGHT_FOOT));
+		CHECK(snapshot.GetProjectivePositions() == NULL);
+		XnSkeletonJointPosition joint;
+		CHECK(snapshot.GetSkeletonJointPosition(7, XN_SKEL_NECK, joint) == XN_STATUS_OK);
+		CHECK_NEAR(joint.position.X, -390.0f, 1e-3f);
+		CHECK_NEAR(joint.position.Z, 2500.0f, 1e-3f);
+		CHECK_NEAR(joint.fConfidence, 0.5f, 1e-6f);
+
+		FILE* copy = tmpfile();
+		CHECK(snapshot.Write(copy) == XN_STATUS_OK);
+		CHECK(snapshot.Read(track) == XN_STATUS_OK);
+		CHECK(snapshot.GetUserCount() == 1);
+		CHECK(snapshot.GetFrameID() == 2);
+		CHECK(snapshot.Read(track) == XN_STATUS_EOF);
+		rewind(copy);
+		CHECK(snapshot.Read(copy) == XN_STATUS_OK);
+		CHECK(snapshot.GetUserCount() == 2);
+		CHECK(snapshot.GetSkeletonJointPosition(3, XN_SKEL_TORSO, joint) == XN_STATUS_OK);
+		CHECK_NEAR(joint.position.X, 120.0f, 1e-2f);
+
+		fputs("skeleton 5 5 1 fff\n3 1 2\n", copy);
+		rewind(copy);
+		CHECK(snapshot.Read(copy) == XN_STATUS_OK);
+		CHECK(snapshot.Read(copy) == XN_STATUS_CORRUPT_FILE);
+		fclose(copy);
+		fclose(track);
+	}
+
+	//a user standing still: the noise is smoothed, the filtered joints stay on the user
+	{
+		FILE* track = tmpfile();
+		XnUserID user = 3;
+		float position[1][3] = { { 100, -50, 2000 } };
+		for (XnUInt32 frame=0; frame<300; ++frame)
+			writeFrame(track, 1000 + frame*frameTime, frame, &user, position, 1, 8, 1);
+
+		JointFilter filter;
+		filter.m_bCollectStats = TRUE;
+		CHECK(replay(track, filter) == 300);
+		const JointFilterStats& stats = filter.GetStats();
+		CHECK(stats.nSamples > 0);
+		CHECK(stats.fJitter < 0.25f * stats.fRawJitter);
+		CHECK(stats.fLag < 10.0f);
+
+		XnPoint3D torso;
+		CHECK(filter.GetJointPosition(3, XN_SKEL_TORSO, torso, FALSE));
+		CHECK_NEAR(torso.X, 120.0f, 4.0f);
+		CHECK_NEAR(torso.Z, 2000.0f, 4.0f);
+		CHECK(!filter.GetJointPosition(4, XN_SKEL_TORSO, torso, FALSE));
+		fclose(track);
+	}
+
+	//a hand swinging at 1 Hz: the filter follows it, the prediction is closer to the next frame
+	{
+		FILE* track = tmpfile();
+		XnUserID user = 3;
+		for (XnUInt32 frame=0; frame<300; ++frame)
+		{
+			float position[1][3] = { { (float)(400*sin(2*PI*frame/30.0)), 0, 2000 } };
+			writeFrame(track, 1000 + frame*frameTime, frame, &user, position, 1, 0, 1);
+		}
+		rewind(track);
+
+		JointFilter filter;
+		SkeletonSnapshot snapshot;
+		double filteredError = 0, predictedError = 0;
+		for (XnUInt32 frame=0; snapshot.Read(track) == XN_STATUS_OK; ++frame)
+		{
+			filter.Update(snapshot);
+			filter.Predict(frameTime / 1e6f);
+			XnPoint3D filtered, predicted;
+			CHECK(filter.GetJointPosition(3, XN_SKEL_HEAD, filtered, FALSE));
+			CHECK(filter.GetJointPosition(3, XN_SKEL_HEAD, predicted, TRUE));
+			double next = 400*sin(2*PI*(frame + 1)/30.0);
+			if (frame >= 30)
+			{
+				filteredError += fabs(filtered.X - next);
+				predictedError += fabs(predicted.X - next);
+			}
+		}
+		CHECK(predictedError < filteredError);
+		CHECK(filteredError / 270 < 100.0);
+		fclose(track);
+	}
+
+	//users leaving free their slot, low confidence joints hold their last position
+	{
+		FILE* track = tmpfile();
+		XnUserID users[2] = { 3, 5 };
+		float positions[2][3] = { { 0, 0, 2000 }, { 500, 0, 3000 } };
+		for (XnUInt32 frame=0; frame<10; ++frame)
+			writeFrame(track, 1000 + frame*frameTime, frame, users, positions, 2, 0, 1);
+		positions[0][0] = 300;
+		writeFrame(track, 1000 + 10*frameTime, 10, users, positions, 1, 0, 0);
+		rewind(track);
+
+		JointFilter filter;
+		SkeletonSnapshot snapshot;
+		while (snapshot.Read(track) == XN_STATUS_OK)
+		{
+			filter.Update(snapshot);
+			if (snapshot.GetFrameID() == 9)
+				CHECK(filter.FindUser(5) == 1);
+		}
+		CHECK(filter.FindUser(5) < 0);
+		CHECK(filter.FindUser(3) == 0);
+		XnPoint3D head;
+		CHECK(filter.GetJointPosition(3, XN_SKEL_HEAD, head, FALSE));
+		CHECK_NEAR(head.X, 0.0f, 1e-3f);
+		fclose(track);
+	}
+
+	return checkResult("JointFilterTest");
+}
@@ -0,0 +1,341 @@
+#include "Check.h"
+#include "Kinect-frames.h"
+
+#include <libfreenect-capture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace Kinect;
+
+//Writes packet captures in the libfreenect format (libfreenect-capture.h) with packets left out the
+//way a busy hub loses them, replays them through the frame assemblers of both camera streams and
+//checks every published frame: its rows, its row mask and its loss counters. A capture taken from
+//a device can be replayed as well:
+//
+//   KinectFrameAssemblerTest              runs the checks
+//   KinectFrameAssemblerTest <capture>    prints the loss counters of the capture
+
+static const char* s_csFileName = "KinectFrameAssemblerTest.fnpc";
+
+//The stream parameters of the driver (KinectInternalData)
+struct Stream
+{
+	uint8_t nEndpoint;
+	uint8_t nFlagStart;
+	int nPacketSize;
+	int nPacketsPerTransfer;
+	int nFrameSize;
+	int nRowBytes;
+	int nRows;
+
+	int payload() const { return nPacketSize - (int)sizeof(frame_hdr); }
+	int packetsPerFrame() const { return (nFrameSize + payload() - 1) / payload(); }
+};
+
+static const Stream s_Depth = { 0x82, 0x71, 1760, 32, 640*480*11/8, 640*11/8, 480 };
+static const Stream s_Video = { 0x81, 0x81, 1920, 16, 640*480, 640, 480 };
+
+//Every byte of row r of frame f, never 0 so zeroed rows show
+static uint8_t rowValue(int f, int r)
+{
+	return (uint8_t)(f*7 + r) | 1;
+}
+
+//Which packets of each frame the capture leaves out
+typedef std::vector< std::vector<bool> > LossPattern;
+
+static LossPattern noLoss(const Stream& stream, int nFrames)
+{
+	return LossPattern(nFrames, std::vector<bool>(stream.packetsPerFrame(), false));
+}
+
+//One packet in nRate lost at random. The first start and the last end always arrive: before the
+//first start there is nothing to count on, after the last end there is no frame to end it.
+static LossPattern randomLoss(const Stream& stream, int nFrames, int nRate, unsigned int nSeed)
+{
+	LossPattern lost = noLoss(stream, nFrames);
+	srand(nSeed);
+	for (int f=0; f<nFrames; ++f)
+		for (int i=0; i<stream.packetsPerFrame(); ++i)
+			lost[f][i] = rand() % nRate == 0;
+	lost[0][0] = false;
+	lost[nFrames - 1][stream.packetsPerFrame() - 1] = false;
+	return lost;
+}
+
+//The packets of a stream as the camera sends them, the lost ones empty as the capture keeps them
+static void makePackets(const Stream& stream, const LossPattern& lost, std::vector< std::vector<uint8_t> >& packets)
+{
+	const int nPackets = stream.packetsPerFrame();
+	uint8_t nSeq = 0x40;
+	for (size_t f=0; f<lost.size(); ++f)
+	{
+		for (int i=0; i<nPackets; ++i, ++nSeq)
+		{
+			packets.push_back(std::vector<uint8_t>());
+			if (lost[f][i])
+				continue;
+
+			const int nOffset = i * stream.payload();
+			const int nSize = std::min(stream.payload(), stream.nFrameSize - nOffset);
+			std::vector<uint8_t>& packet = packets.back();
+			packet.resize(sizeof(frame_hdr) + nSize);
+			frame_hdr* pHeader = (frame_hdr*)&packet[0];
+			memset(pHeader, 0, sizeof(frame_hdr));
+			pHeader->magic[0] = 0x52;
+			pHeader->magic[1] = 0x42;
+			pHeader->flag = i == 0 ? stream.nFlagStart : i == nPackets - 1 ? stream.nFlagStart + 4 : stream.nFlagStart + 1;
+			pHeader->seq = nSeq;
+			for (int k=0; k<nSize; ++k)
+				packet[sizeof(frame_hdr) + k] = rowValue((int)f, (nOffset + k) / stream.nRowBytes);
+		}
+	}
+}
+
+static bool writeTransfer(FILE* file, const Stream& stream, const std::vector< std::vector<uint8_t> >& packets, size_t nFirst, uint64_t nTimestamp)
+{
+	freenect_capture_xfer_hdr header;
+	memset(&header, 0, sizeof(header));
+	header.timestamp = nTimestamp;
+	header.endpoint = stream.nEndpoint;
+	header.num_pkts = (uint16_t)std::min((size_t)stream.nPacketsPerTransfer, packets.size() - nFirst);
+
+	bool bOk = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (int i=0; bOk && i<header.num_pkts; ++i)
+	{
+		uint16_t nLength = (uint16_t)packets[nFirst + i].size();
+		bOk = fwrite(&nLength, sizeof(nLength), 1, file) == 1;
+	}
+	for (int i=0; bOk && i<header.num_pkts; ++i)
+	{
+		const std::vector<uint8_t>& packet = packets[nFirst + i];
+		bOk = packet.empty() || fwrite(&packet[0], packet.size(), 1, file) == 1;
+	}
+	return bOk;
+}
+
+//A capture of both streams, their transfers interleaved as they complete
+static bool writeCapture(const LossPattern& depthLost, const LossPattern& videoLost)
+{
+	std::vector< std::vector<uint8_t> > depth, video;
+	makePackets(s_Depth, depthLost, depth);
+	makePackets(s_Video, videoLost, video);
+
+	FILE* file = fopen(s_csFileName, "wb");
+	if (file == NULL)
+		return false;
+	freenect_capture_file_hdr header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "FNPC", 4);
+	header.version = FREENECT_CAPTURE_VERSION;
+	bool bOk = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	size_t nDepth = 0, nVideo = 0;
+	for (uint64_t nTimestamp = 0; bOk && (nDepth < depth.size() || nVideo < video.size()); nTimestamp += 1000)
+	{
+		if (nDepth < depth.size())
+		{
+			bOk = bOk && writeTransfer(file, s_Depth, depth, nDepth, nTimestamp);
+			nDepth += s_Depth.nPacketsPerTransfer;
+		}
+		if (nVideo < video.size())
+		{
+			bOk = bOk && writeTransfer(file, s_Video, video, nVideo, nTimestamp);
+			nVideo += s_Video.nPacketsPerTransfer;
+		}
+	}
+	return fclose(file) == 0 && bOk;
+}
+
+//One stream being replayed: the assembler fed from the capture, and what its frames must hold
+struct Replay
+{
+	Replay(const Stream& stream, const LossPattern* pLost)
+		: stream(stream), pool(stream.nFrameSize),
+		assembler(&pool, stream.nFlagStart, stream.nFrameSize, stream.payload(), stream.nRowBytes, stream.nRows),
+		pLost(pLost), expected(stream.nFrameSize, 0), nFrames(0), nMismatches(0)
+	{
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	//The frame the assembler published must be the next one of the pattern that was not lost whole
+	void Published()
+	{
+		const uint8_t* pFrame = pool.Acquire();
+		const KinectFrameInfo* pInfo = pool.FrontInfo();
+		++nFrames;
+		if (pLost == NULL || pFrame == NULL)
+			return;
+
+		size_t f = nFrames - 1 + pInfo->Stats.FramesDropped;
+		if (f >= pLost->size())
+		{
+			++nMismatches;
+			return;
+		}
+		int nLost = 0;
+		std::vector<uint8_t> rowValid(stream.nRows, 1);
+		for (int i=0; i<stream.packetsPerFrame(); ++i)
+		{
+			if (!(*pLost)[f][i])
+				continue;
+			++nLost;
+			const int nOffset = i * stream.payload();
+			const int nEnd = std::min(nOffset + stream.payload(), stream.nFrameSize);
+			for (int r = nOffset / stream.nRowBytes; r <= (nEnd - 1) / stream.nRowBytes; ++r)
+				rowValid[r] = 0;
+		}
+
+		//rows of the lost packets hold those of the frame before
+		int nRepaired = 0;
+		for (int r=0; r<stream.nRows; ++r)
+		{
+			if (rowValid[r])
+				memset(&expected[r*stream.nRowBytes], rowValue((int)f, r), stream.nRowBytes);
+			else
+				++nRepaired;
+		}
+
+		if (nLost == 0)
+			stats.FramesComplete++;
+		else
+			stats.FramesRepaired++;
+		stats.PacketsLost += nLost;
+
+		if (memcmp(pFrame, &expected[0], stream.nFrameSize) != 0 ||
+			memcmp(pInfo->RowValid, &rowValid[0], stream.nRows) != 0 ||
+			pInfo->Stats.FramesComplete != stats.FramesComplete ||
+			pInfo->Stats.FramesRepaired != stats.FramesRepaired ||
+			pInfo->Stats.PacketsLost != stats.PacketsLost ||
+			pInfo->Stats.LostPackets != (unsigned int)nLost ||
+			pInfo->Stats.RepairedRows != (unsigned int)nRepaired)
+			++nMismatches;
+	}
+
+	const Stream& stream;
+	KinectFramePool pool;
+	KinectFrameAssembler assembler;
+	const LossPattern* pLost;
+	std::vector<uint8_t> expected;
+	KinectFrameStats stats;
+	size_t nFrames;
+	int nMismatches;
+};
+
+//Feeds every packet of the capture to the assembler of its stream, empty ones included, as
+//freenect_replay_packets() does. False on a damaged capture.
+static bool replay(const char* csFileName, Replay& depth, Replay& video)
+{
+	FILE* file = fopen(csFileName, "rb");
+	if (file == NULL)
+		return false;
+
+	freenect_capture_file_hdr header;
+	bool bOk = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "FNPC", 4) == 0 &&
+		header.version == FREENECT_CAPTURE_VERSION;
+
+	freenect_capture_xfer_hdr transfer;
+	std::vector<uint16_t> lengths(FREENECT_CAPTURE_MAX_PKTS);
+	std::vector<uint8_t> packet(FREENECT_CAPTURE_MAX_PKTSIZE);
+	while (bOk && fread(&transfer, sizeof(transfer), 1, file) == 1)
+	{
+		bOk = transfer.num_pkts <= FREENECT_CAPTURE_MAX_PKTS &&
+			fread(&lengths[0], sizeof(uint16_t), transfer.num_pkts, file) == transfer.num_pkts;
+		Replay* pStream = transfer.endpoint == s_Depth.nEndpoint ? &depth : transfer.endpoint == s_Video.nEndpoint ? &video : NULL;
+		for (int i=0; bOk && i<transfer.num_pkts; ++i)
+		{
+			bOk = lengths[i] <= FREENECT_CAPTURE_MAX_PKTSIZE && (lengths[i] == 0 || fread(&packet[0], lengths[i], 1, file) == 1);
+			if (bOk && pStream != NULL && pStream->assembler.Process(&packet[0], lengths[i]))
+				pStream->Published();
+		}
+	}
+	fclose(file);
+	return bOk;
+}
+
+static void printStats(const char* csName, const Replay& stream)
+{
+	const KinectFrameStats& stats = stream.assembler.mStats;
+	printf("%s: %u frames, %u complete, %u repaired, %u dropped, %u packets lost\n", csName, (unsigned int)stream.nFrames,
+		stats.FramesComplete, stats.FramesRepaired, stats.FramesDropped, stats.PacketsLost);
+}
+
+static int replayCapture(const char* csFileName)
+{
+	Replay depth(s_Depth, NULL), video(s_Video, NULL);
+	bool bOk = replay(csFileName, depth, video);
+	printStats("depth", depth);
+	printStats("video", video);
+	if (!bOk)
+		printf("%s is damaged or not a capture\n", csFileName);
+	return bOk ? 0 : 1;
+}
+
+//Replays a capture written with the given losses, every frame that was not lost whole is published
+static void checkReplay(const LossPattern& depthLost, const LossPattern& videoLost, unsigned int nDepthDropped)
+{
+	CHECK(writeCapture(depthLost, videoLost));
+	Replay depth(s_Depth, &depthLost), video(s_Video, &videoLost);
+	CHECK(replay(s_csFileName, depth, video));
+	CHECK(depth.nMismatches == 0);
+	CHECK(video.nMismatches == 0);
+	CHECK(depth.nFrames + nDepthDropped == depthLost.size());
+	CHECK(video.nFrames == videoLost.size());
+	CHECK(depth.assembler.mStats.FramesDropped == nDepthDropped);
+	CHECK(video.assembler.mStats.FramesDropped == 0);
+	CHECK(depth.assembler.mStats.PacketsLost == depth.stats.PacketsLost);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		return replayCapture(argv[1]);
+
+	const int nFrames = 12;
+
+	//nothing lost: every frame complete, every row valid
+	{
+		LossPattern depthLost = noLoss(s_Depth, nFrames), videoLost = noLoss(s_Video, nFrames);
+		checkReplay(depthLost, videoLost, 0);
+	}
+
+	//a packet in 50 lost, and the packets that tell where frames start and end
+	{
+		LossPattern depthLost = randomLoss(s_Depth, nFrames, 50, 1), videoLost = randomLoss(s_Video, nFrames, 50, 2);
+		const int nEnd = s_Depth.packetsPerFrame() - 1;
+		depthLost[0][nEnd] = true;
+		depthLost[2][0] = true;
+		depthLost[4][nEnd] = depthLost[5][0] = true;
+		depthLost[6][nEnd] = depthLost[7][0] = depthLost[7][1] = true;
+		videoLost[3][0] = true;
+		videoLost[8][s_Video.packetsPerFrame() - 1] = true;
+		checkReplay(depthLost, videoLost, 0);
+	}
+
+	//a depth frame lost whole, the one after comes complete and the loss is counted
+	{
+		LossPattern depthLost = noLoss(s_Depth, nFrames), videoLost = noLoss(s_Video, nFrames);
+		depthLost[5].assign(s_Depth.packetsPerFrame(), true);
+		checkReplay(depthLost, videoLost, 1);
+	}
+
+	//a damaged capture is refused
+	{
+		FILE* file = fopen(s_csFileName, "wb");
+		CHECK(file != NULL);
+		if (file != NULL)
+		{
+			fputs("not a capture", file);
+			fclose(file);
+		}
+		Replay depth(s_Depth, NULL), video(s_Video, NULL);
+		CHECK(!replay(s_csFileName, depth, video));
+	}
+
+	remove(s_csFileName);
+	return checkResult("KinectFrameAssemblerTest");
+}
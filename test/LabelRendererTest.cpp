@@ -0,0 +1,80 @@
+#include "Check.h"
+#include "LabelRenderer.h"
+
+#include <stdlib.h>
+#include <vector>
+
+//Label row of runs of random length, from single pixels to whole SSE2 steps, with labels above
+//the table size so the wrap is taken on both paths
+static void makeRow(std::vector<XnLabel>& labels)
+{
+	XnUInt32 i = 0;
+	while (i < labels.size())
+	{
+		XnLabel nLabel = (XnLabel)(rand() % 4 ? rand() % 4 : rand() % 1024);
+		XnUInt32 nRun = 1 + rand() % 20;
+		for (; nRun > 0 && i < labels.size(); nRun--, i++)
+			labels[i] = nLabel;
+	}
+}
+
+//RenderRow (the SSE2 path where the CPU has it) against RenderRowReference, every width from 0
+//to a few steps so each tail length is seen, mirrored and not
+static int countMismatches(const LabelRenderer& renderer)
+{
+	int nMismatches = 0;
+	for (XnUInt32 nCount = 0; nCount < 64; nCount++)
+	{
+		std::vector<XnLabel> labels(nCount + 1);
+		std::vector<XnUInt32> fast(nCount + 1, 0xDEADBEEF), reference(nCount + 1, 0xDEADBEEF);
+		for (int nTrial = 0; nTrial < 50; nTrial++)
+		{
+			makeRow(labels);
+			for (int bMirror = 0; bMirror < 2; bMirror++)
+			{
+				renderer.RenderRow(&labels[0], &fast[0], nCount, bMirror);
+				renderer.RenderRowReference(&labels[0], &reference[0], nCount, bMirror);
+				if (fast != reference)
+					++nMismatches;
+			}
+		}
+	}
+	return nMismatches;
+}
+
+int main()
+{
+	srand(1);
+	LabelRenderer renderer;
+	for (XnUInt32 i = 0; i < LabelRenderer::TABLE_SIZE; i++)
+		renderer.SetColor((XnLabel)i, (XnUInt32)rand() * 65599u + i);
+	CHECK(countMismatches(renderer) == 0);
+
+	//a palette wraps at its size, label 0 is the background
+	{
+		const XnUInt32 colors[] = { 0x11, 0x22, 0x33 };
+		LabelRenderer palette;
+		palette.SetPalette(colors, 3, 0xFF);
+		CHECK(countMismatches(palette) == 0);
+		CHECK(palette.GetColor(0) == 0xFF);
+		CHECK(palette.GetColor(1) == 0x22);
+		CHECK(palette.GetColor(3) == 0x11);
+		CHECK(palette.GetColor(LabelRenderer::TABLE_SIZE + 1) == 0x22);
+	}
+
+	//the mirror reads the row right to left, across a run step and a mixed step
+	{
+		XnLabel labels[20];
+		XnUInt32 pixels[20];
+		for (XnUInt32 i = 0; i < 20; i++)
+			labels[i] = (XnLabel)(i < 8 ? 1 : i);
+		renderer.RenderRow(labels, pixels, 20, TRUE);
+		for (XnUInt32 i = 0; i < 20; i++)
+			CHECK(pixels[i] == renderer.GetColor(labels[19 - i]));
+		renderer.RenderRow(labels, pixels, 20, FALSE);
+		for (XnUInt32 i = 0; i < 20; i++)
+			CHECK(pixels[i] == renderer.GetColor(labels[i]));
+	}
+
+	return checkResult("LabelRendererTest");
+}
@@ -0,0 +1,143 @@
+#include "Check.h"
+#include "ReplayDecoder.h"
+
+#include <XnCodecIDs.h>
+
+#include <stdio.h>
+#include <vector>
+
+using namespace xn;
+using namespace Kinect;
+
+//Writes a short depth recording through a mock node, then reads it back through ReplayDecoder with
+//several thread counts, queue sizes and start frames. Every pixel carries the number of its frame,
+//so a frame handed out of order, twice, from the wrong seek or half written shows.
+
+static const XnChar* s_csFileName = "ReplayDecoderTest.oni";
+static const XnUInt32 s_nFrames = 100;
+static const XnUInt32 s_nXRes = 16, s_nYRes = 8;
+//ms, a frame that never comes fails the checks instead of hanging the test
+static const XnUInt32 s_nTimeout = 5000;
+
+static XnDepthPixel pixel(XnUInt32 nFrame, XnUInt32 i)
+{
+	return (XnDepthPixel)(nFrame*100 + i % 100);
+}
+
+static XnStatus writeRecording()
+{
+	Context context;
+	MockDepthGenerator depth;
+	Recorder recorder;
+	XnStatus rc = context.Init();
+	if (rc == XN_STATUS_OK)
+		rc = depth.Create(context, "Depth1");
+	XnMapOutputMode mode = { s_nXRes, s_nYRes, 30 };
+	if (rc == XN_STATUS_OK)
+		rc = depth.SetMapOutputMode(mode);
+	if (rc == XN_STATUS_OK)
+		rc = recorder.Create(context);
+	if (rc == XN_STATUS_OK)
+		rc = recorder.SetDestination(XN_RECORD_MEDIUM_FILE, s_csFileName);
+	if (rc == XN_STATUS_OK)
+		rc = recorder.AddNodeToRecording(depth, XN_CODEC_UNCOMPRESSED);
+
+	std::vector<XnDepthPixel> map(s_nXRes*s_nYRes);
+	for (XnUInt32 nFrame = 1; nFrame <= s_nFrames && rc == XN_STATUS_OK; ++nFrame)
+	{
+		for (XnUInt32 i = 0; i < map.size(); ++i)
+			map[i] = pixel(nFrame, i);
+		rc = depth.SetData(nFrame, nFrame*33333, (XnUInt32)(map.size()*sizeof(XnDepthPixel)), &map[0]);
+		if (rc == XN_STATUS_OK)
+			rc = context.WaitNoneUpdateAll();
+		if (rc == XN_STATUS_OK)
+			rc = recorder.Record();
+	}
+
+	recorder.Release();
+	depth.Release();
+	context.Release();
+	return rc;
+}
+
+//Frame nFrame of the recording, whole
+static bool isFrame(const ReplayFrame* pFrame, XnUInt32 nFrame)
+{
+	if (pFrame == NULL || pFrame->nFrame != nFrame || pFrame->nXRes != s_nXRes || pFrame->nYRes != s_nYRes ||
+		pFrame->nDataSize != s_nXRes*s_nYRes*sizeof(XnDepthPixel))
+		return false;
+	const XnDepthPixel* pMap = (const XnDepthPixel*)pFrame->pData;
+	for (XnUInt32 i = 0; i < s_nXRes*s_nYRes; ++i)
+		if (pMap[i] != pixel(nFrame, i))
+			return false;
+	return true;
+}
+
+//Reads from nFirstFrame to the end, the frames must come in recording order whatever thread
+//decoded their chunk
+static void checkDecode(XnUInt32 nThreads, XnUInt32 nQueueSize, XnUInt32 nFirstFrame)
+{
+	ReplayDecoder decoder;
+	CHECK(decoder.Open(s_csFileName, XN_NODE_TYPE_DEPTH, nFirstFrame, nThreads, nQueueSize) == XN_STATUS_OK);
+	CHECK(decoder.GetThreadCount() == nThreads);
+	CHECK(decoder.GetFrameCount() == s_nFrames);
+
+	XnUInt32 nMismatches = 0;
+	XnUInt32 nFrame = nFirstFrame;
+	XnUInt64 nLastTimestamp = 0;
+	for (const ReplayFrame* pFrame = decoder.Next(s_nTimeout); pFrame != NULL; pFrame = decoder.Next(s_nTimeout), ++nFrame)
+	{
+		if (!isFrame(pFrame, nFrame) || pFrame->nTimestamp <= nLastTimestamp)
+			++nMismatches;
+		nLastTimestamp = pFrame->nTimestamp;
+	}
+	CHECK(nMismatches == 0);
+	CHECK(nFrame == s_nFrames + 1);
+	CHECK(decoder.GetLastError() == XN_STATUS_OK);
+}
+
+int main()
+{
+	CHECK(writeRecording() == XN_STATUS_OK);
+
+	//one thread, more threads than chunks in the queue, a queue smaller than a chunk
+	const XnUInt32 threads[] = { 1, 3, 4 };
+	const XnUInt32 queueSizes[] = { 1, 0, 20 };
+	const XnUInt32 firstFrames[] = { 1, 7, 97 };
+	for (int t = 0; t < 3; ++t)
+		for (int q = 0; q < 3; ++q)
+			for (int f = 0; f < 3; ++f)
+				checkDecode(threads[t], queueSizes[q], firstFrames[f]);
+
+	//stopped and started again from the frame after the last one read, as the viewer does
+	{
+		ReplayDecoder decoder;
+		CHECK(decoder.Open(s_csFileName, XN_NODE_TYPE_DEPTH, 1, 3, 8) == XN_STATUS_OK);
+		XnUInt32 nLast = 0;
+		for (XnUInt32 i = 0; i < 30; ++i)
+		{
+			const ReplayFrame* pFrame = decoder.Next(s_nTimeout);
+			CHECK(isFrame(pFrame, i + 1));
+			if (pFrame != NULL)
+				nLast = pFrame->nFrame;
+		}
+		decoder.Close();
+		CHECK(!decoder.IsOpen());
+		CHECK(decoder.Next(s_nTimeout) == NULL);
+
+		CHECK(decoder.Open(s_csFileName, XN_NODE_TYPE_DEPTH, nLast + 1, 2) == XN_STATUS_OK);
+		CHECK(isFrame(decoder.Next(s_nTimeout), 31));
+		CHECK(isFrame(decoder.Next(s_nTimeout), 32));
+	}
+
+	//started past the end, there is nothing to read and no error
+	{
+		ReplayDecoder decoder;
+		CHECK(decoder.Open(s_csFileName, XN_NODE_TYPE_DEPTH, s_nFrames + 1, 2) == XN_STATUS_OK);
+		CHECK(decoder.Next(s_nTimeout) == NULL);
+		CHECK(decoder.GetLastError() == XN_STATUS_OK);
+	}
+
+	remove(s_csFileName);
+	return checkResult("ReplayDecoderTest");
+}
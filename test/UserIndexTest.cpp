@@ -0,0 +1,149 @@
+#include "Check.h"
+#include "UserIndex.h"
+
+#include <XnStatusCodes.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace Kinect;
+
+//Label map of a few users as overlapping rectangles on the background, with single stray pixels
+//so runs of every length and labels right at the row ends are seen
+static void makeLabels(std::vector<XnLabel>& labels, int width, int height, int nUsers)
+{
+	labels.assign(width*height, 0);
+	for (int nUser=1; nUser<=nUsers; ++nUser)
+	{
+		int x0 = rand() % width, y0 = rand() % height;
+		int x1 = x0 + rand() % (width - x0), y1 = y0 + rand() % (height - y0);
+		for (int y=y0; y<=y1; ++y)
+			for (int x=x0; x<=x1; ++x)
+				labels[y*width + x] = (XnLabel)nUser;
+	}
+	for (int i=0; i<width*height/50; ++i)
+		labels[rand() % (width*height)] = (XnLabel)(rand() % (nUsers + 1));
+}
+
+//Every user of the index against a plain count of the map: pixels, box, and the mask of its runs
+static void checkAgainstMap(const UserIndex& index, const std::vector<XnLabel>& labels, int width, int height, int nUsers)
+{
+	XnUInt32 nFound = 0;
+	std::vector<XnUInt8> mask(width*height);
+	for (int nUser=1; nUser<=nUsers + 1; ++nUser)
+	{
+		XnUInt32 nPixels = 0;
+		int minX = width, minY = height, maxX = -1, maxY = -1;
+		for (int y=0; y<height; ++y)
+		{
+			for (int x=0; x<width; ++x)
+			{
+				if (labels[y*width + x] != nUser)
+					continue;
+				++nPixels;
+				if (x < minX) minX = x;
+				if (x > maxX) maxX = x;
+				if (y < minY) minY = y;
+				if (y > maxY) maxY = y;
+			}
+		}
+
+		const UserRegion* pRegion = index.FindUser((XnLabel)nUser);
+		if (nPixels == 0)
+		{
+			CHECK(pRegion == NULL);
+			continue;
+		}
+		++nFound;
+		CHECK(pRegion != NULL);
+		if (pRegion == NULL)
+			continue;
+
+		CHECK(pRegion->nLabel == nUser);
+		CHECK(pRegion->nPixels == nPixels);
+		CHECK(pRegion->nMinX == minX && pRegion->nMinY == minY);
+		CHECK(pRegion->nMaxX == maxX && pRegion->nMaxY == maxY);
+		CHECK(pRegion->GetWidth() == (XnUInt32)(maxX - minX + 1) && pRegion->GetHeight() == (XnUInt32)(maxY - minY + 1));
+
+		//the mask outside the box is left as it was
+		mask.assign(width*height, 7);
+		index.FillMask(*pRegion, &mask[0], width);
+		int nWrong = 0;
+		for (int y=0; y<height; ++y)
+		{
+			for (int x=0; x<width; ++x)
+			{
+				bool bInBox = x >= minX && x <= maxX && y >= minY && y <= maxY;
+				XnUInt8 nExpected = labels[y*width + x] == nUser ? 255 : (bInBox ? 0 : 7);
+				if (mask[y*width + x] != nExpected)
+					++nWrong;
+			}
+		}
+		CHECK(nWrong == 0);
+
+		//the silhouette comes back as the same mask
+		std::vector<XnUInt8> encoded(3, 0xAB);
+		index.Encode(*pRegion, encoded);
+		std::vector<XnUInt8> decoded(width*height, 7);
+		XnUInt32 nUsed = 0;
+		CHECK(UserIndex::Decode(&encoded[3], (XnUInt32)encoded.size() - 3, &decoded[0], width, height, &nUsed) == XN_STATUS_OK);
+		CHECK(nUsed == encoded.size() - 3);
+		nWrong = 0;
+		for (int i=0; i<width*height; ++i)
+			if (decoded[i] != (labels[i] == nUser ? 255 : 0))
+				++nWrong;
+		CHECK(nWrong == 0);
+		CHECK(UserIndex::Decode(&encoded[3], (XnUInt32)encoded.size() - 4, &decoded[0], width, height) == XN_STATUS_BAD_PARAM);
+		CHECK(UserIndex::Decode(&encoded[3], (XnUInt32)encoded.size() - 3, &decoded[0], width, pRegion->nMaxY) == XN_STATUS_BAD_PARAM);
+	}
+	CHECK(index.GetUserCount() == nFound);
+	for (XnUInt32 i=0; i<index.GetUserCount(); ++i)
+		CHECK(index.FindUser(index.GetUser(i).nLabel) == &index.GetUser(i));
+}
+
+int main()
+{
+	//random scenes, widths that leave tails to the four label background skip; one index is
+	//rebuilt every frame so the runs kept between frames must not leak into the next one
+	UserIndex index;
+	const int widths[] = { 1, 3, 4, 37, 160 };
+	for (int trial=0; trial<40; ++trial)
+	{
+		srand(trial);
+		int width = widths[trial % 5], height = 1 + rand() % 60;
+		int nUsers = trial % 6;
+		std::vector<XnLabel> labels;
+		makeLabels(labels, width, height, nUsers);
+		index.Build(&labels[0], width, height);
+		CHECK(index.GetXRes() == (XnUInt32)width && index.GetYRes() == (XnUInt32)height);
+		checkAgainstMap(index, labels, width, height, nUsers);
+	}
+
+	//two users side by side in one row are two runs, a user split by another one keeps both runs
+	{
+		const XnLabel row[] = { 0, 0, 0, 0, 0, 2, 2, 1, 1, 1, 2, 0 };
+		index.Build(row, 12, 1);
+		CHECK(index.GetUserCount() == 2);
+		const UserRegion* pTwo = index.FindUser(2);
+		CHECK(pTwo != NULL && pTwo->nRuns == 2 && pTwo->nPixels == 3);
+		CHECK(pTwo != NULL && pTwo->nMinX == 5 && pTwo->nMaxX == 10);
+		CHECK(pTwo != NULL && pTwo->pRuns[1].nX == 10 && pTwo->pRuns[1].nLength == 1);
+		const UserRegion* pOne = index.FindUser(1);
+		CHECK(pOne != NULL && pOne->nRuns == 1 && pOne->pRuns[0].nX == 7 && pOne->pRuns[0].nLength == 3);
+		CHECK(index.FindUser(3) == NULL);
+	}
+
+	//an empty scene, then Clear
+	{
+		std::vector<XnLabel> labels(64*48, 0);
+		index.Build(&labels[0], 64, 48);
+		CHECK(index.GetUserCount() == 0);
+		CHECK(index.FindUser(1) == NULL);
+		labels[100] = 5;
+		index.Build(&labels[0], 64, 48);
+		CHECK(index.GetUserCount() == 1);
+		index.Clear();
+		CHECK(index.GetUserCount() == 0 && index.FindUser(5) == NULL);
+	}
+
+	return checkResult("UserIndexTest");
+}
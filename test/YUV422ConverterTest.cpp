@@ -0,0 +1,99 @@
+#include "Check.h"
+#include "YUV422Converter.h"
+
+#include <string.h>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Kinect;
+
+//Row of 256 macro pixels sharing U and V: macro pixel k holds Y = k and 255 - k, so every Y goes
+//through both pixels of a macro pixel and through every lane of the 8 pixel SSE2 steps
+static void makeRow(std::vector<XnUInt8>& row, XnUInt8 u, XnUInt8 v, YUV422Layout eInput)
+{
+	for (int k=0; k<256; ++k)
+	{
+		XnUInt8* p = &row[4*k];
+		if (eInput == YUV422_UYVY)
+		{
+			p[0] = u; p[1] = (XnUInt8)k; p[2] = v; p[3] = (XnUInt8)(255 - k);
+		}
+		else
+		{
+			p[0] = (XnUInt8)k; p[1] = u; p[2] = (XnUInt8)(255 - k); p[3] = v;
+		}
+	}
+}
+
+//ConvertRow (the SSE2 path where the CPU has it) against ConvertRowReference for every Y, U and V
+static int countMismatches(YUV422Layout eInput, RGBLayout eOutput)
+{
+	const XnUInt32 nWidth = 512;
+	const XnUInt32 nBytes = nWidth * YUV422Converter::GetBytesPerPixel(eOutput);
+	std::vector<XnUInt8> row(2*nWidth), fast(nBytes), reference(nBytes);
+	int nMismatches = 0;
+	for (int u=0; u<256; ++u)
+	{
+		for (int v=0; v<256; ++v)
+		{
+			makeRow(row, (XnUInt8)u, (XnUInt8)v, eInput);
+			YUV422Converter::ConvertRow(&row[0], &fast[0], nWidth, eInput, eOutput);
+			YUV422Converter::ConvertRowReference(&row[0], &reference[0], nWidth, eInput, eOutput);
+			if (memcmp(&fast[0], &reference[0], nBytes) != 0)
+				++nMismatches;
+		}
+	}
+	return nMismatches;
+}
+
+int main()
+{
+	const YUV422Layout inputs[] = { YUV422_UYVY, YUV422_YUYV };
+	const RGBLayout outputs[] = { RGB_LAYOUT_RGB, RGB_LAYOUT_BGR, RGB_LAYOUT_RGBA, RGB_LAYOUT_BGRA };
+	for (int i=0; i<2; ++i)
+		for (int o=0; o<4; ++o)
+			CHECK(countMismatches(inputs[i], outputs[o]) == 0);
+
+	//the formula itself: studio black and white, a saturated red, clamped outputs
+	{
+		XnUInt8 uyvy[8] = { 128, 16, 128, 235, 90, 81, 240, 81 };
+		XnUInt8 rgba[16];
+		YUV422Converter::ConvertRowReference(uyvy, rgba, 4, YUV422_UYVY, RGB_LAYOUT_RGBA);
+		CHECK(rgba[0] == 0 && rgba[1] == 0 && rgba[2] == 0 && rgba[3] == 255);
+		CHECK(rgba[4] == 255 && rgba[5] == 255 && rgba[6] == 255);
+		CHECK(rgba[8] == 255 && rgba[9] <= 1 && rgba[10] <= 1);
+	}
+
+	//widths that are not a multiple of 8 finish on the scalar loop, an odd last pixel is not written
+	{
+		std::vector<XnUInt8> row(2*512);
+		makeRow(row, 60, 200, YUV422_YUYV);
+		for (XnUInt32 nWidth=1; nWidth<40; ++nWidth)
+		{
+			std::vector<XnUInt8> fast(3*40, 7), reference(3*40, 7);
+			YUV422Converter::ConvertRow(&row[0], &fast[0], nWidth, YUV422_YUYV, RGB_LAYOUT_BGR);
+			YUV422Converter::ConvertRowReference(&row[0], &reference[0], nWidth, YUV422_YUYV, RGB_LAYOUT_BGR);
+			CHECK(fast == reference);
+			CHECK(fast[3*nWidth - 1] == 7 || nWidth % 2 == 0);
+		}
+	}
+
+	//whole images with padded rows, the rows spread over several threads when OpenMP is on
+	{
+#ifdef _OPENMP
+		omp_set_num_threads(4);
+#endif
+		const XnUInt32 nWidth = 100, nHeight = 6, nYUVStride = 2*nWidth + 8, nDestStride = 4*nWidth + 12;
+		std::vector<XnUInt8> image(nYUVStride*nHeight), fast(nDestStride*nHeight, 0), reference(nDestStride*nHeight, 0);
+		for (size_t i=0; i<image.size(); ++i)
+			image[i] = (XnUInt8)(i * 37 + 11);
+		YUV422Converter::Convert(&image[0], nYUVStride, &fast[0], nDestStride, nWidth, nHeight, YUV422_UYVY, RGB_LAYOUT_BGRA);
+		for (XnUInt32 y=0; y<nHeight; ++y)
+			YUV422Converter::ConvertRowReference(&image[y*nYUVStride], &reference[y*nDestStride], nWidth, YUV422_UYVY, RGB_LAYOUT_BGRA);
+		CHECK(fast == reference);
+	}
+
+	return checkResult("YUV422ConverterTest");
+}